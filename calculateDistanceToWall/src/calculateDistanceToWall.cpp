@@ -43,9 +43,13 @@ CalculateDistanceToWall::CalculateDistanceToWall(std::string name)
   : TaskContext(name,PreOperational)
   ,_laserScanPort("LaserScan")
   ,_distanceToWallPort("DistanceToWall")
+  ,_scanDecimation(1)
+  ,_scanCount(0)
+  ,_calculateDistanceProbe(0)
 { 
   this->addEventPort(_laserScanPort,boost::bind(&CalculateDistanceToWall::calculateDistance,this,_1)).doc("Triggers calcualteDistanceToWall() when new laser scan data arrives");
   this->addPort(_distanceToWallPort).doc("Calculated distance to wall");
+  this->addProperty("ScanDecimation", _scanDecimation).doc("Process every n-th laser scan only, the others are dropped (1: every scan)");
 }
 
 CalculateDistanceToWall::~CalculateDistanceToWall(){}
@@ -66,6 +70,7 @@ bool CalculateDistanceToWall::configureHook()
     return false;
   }
   lookupTransform = this->getPeer("rtt_tf")->provides()->getOperation("lookupTransform");
+  _calculateDistanceProbe = youbot::HookStatsService::probe(this,"calculateDistance",0.0);
 #ifndef NDEBUG    
   log(Debug) << "(CalculateDistanceToWall) configureHook finished " << endlog();
 #endif
@@ -95,10 +100,15 @@ void CalculateDistanceToWall::stopHook()
 
 void CalculateDistanceToWall::calculateDistance(RTT::base::PortInterface* portInterface)
 {
+  youbot::HookTimer timer(_calculateDistanceProbe);
 #ifndef NDEBUG    
   log(Debug) << "(CalculateDistanceToWall) calculateDistance() entered " << endlog();
 #endif
    _laserScanPort.read(_laserScan); 
+  if(_scanDecimation > 1 && _scanCount++ % _scanDecimation != 0)
+    return;
+  // Latency trace of this scan, see youbot_diagnostics
+  youbot::LatencyTracer::Instance().begin(_laserScan.header.seq);
 #ifndef NDEBUG    
   log(Debug) << "(CalculateDistanceToWall) _laserScan "<< _laserScan << endlog();
   log(Debug) << "(CalculateDistanceToWall) _laserScan "<< _laserScan.angle_min << endlog();
@@ -111,6 +121,7 @@ void CalculateDistanceToWall::calculateDistance(RTT::base::PortInterface* portIn
   int laser_number = (int)((yaw-_laserScan.angle_min)/_laserScan.angle_increment);
   double distance_measurement=_laserScan.ranges[laser_number];
   _distanceToWall.data=distance_measurement;
+  youbot::LatencyTracer::Instance().mark(youbot::LatencyTracer::DISTANCE,_laserScan.header.seq);
   _distanceToWallPort.write(_distanceToWall);
 #ifndef NDEBUG    
   log(Debug) << "(CalculateDistanceToWall) Transform of laser wrt world " << _transformLaserWorld << endlog();
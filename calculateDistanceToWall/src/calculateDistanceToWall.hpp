@@ -57,6 +57,9 @@
 #include <sensor_msgs/LaserScan.h>    
 #include <std_msgs/Float64.h>    
 
+#include <latencyTracer.hpp>
+#include <hookStatsService.hpp>
+
 using namespace std;
 using namespace BFL;
 using namespace OCL;
@@ -78,6 +81,8 @@ class CalculateDistanceToWall : public TaskContext
       /*********
       PROPERTIES
       *********/
+      /// Process every n-th laser scan only (load shedding by the supervisor)
+      int                                       _scanDecimation;
 
     public:
       /*!
@@ -101,6 +106,10 @@ class CalculateDistanceToWall : public TaskContext
       geometry_msgs::TransformStamped   _transformLaserWorld; 
       sensor_msgs::LaserScan            _laserScan;
       std_msgs::Float64                 _distanceToWall;
+      /// number of laser scans received, for the scan decimation
+      unsigned int                      _scanCount;
+      /// Timing of calculateDistance(), 0 without the hookstats service
+      youbot::HookProbe*                _calculateDistanceProbe;
       /*!
        * calculate distance to wall
        */
@@ -0,0 +1,86 @@
+/****************************************************************************** 
+* OROCOS Extended Kalman Filter component for estimating the position         *
+* off a mobile robot by measuring its distance to a wall at position x=0      * 
+*                                                                             *
+*                           (C) 2011 Tinne De Laet                            *
+*                       tinne.delaet@mech.kuleuven.be                         *                              
+*                    Department of Mechanical Engineering,                    *
+*                   Katholieke Universiteit Leuven, Belgium.                  *
+*                                                                             *
+*       You may redistribute this software and/or modify it under either the  *
+*       terms of the GNU Lesser General Public License version 2.1 (LGPLv2.1  *
+*       <http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>) or (at your *
+*       discretion) of the Modified BSD License:                              *
+*       Redistribution and use in source and binary forms, with or without    *
+*       modification, are permitted provided that the following conditions    *
+*       are met:                                                              *
+*       1. Redistributions of source code must retain the above copyright     *
+*       notice, this list of conditions and the following disclaimer.         *
+*       2. Redistributions in binary form must reproduce the above copyright  *
+*       notice, this list of conditions and the following disclaimer in the   *
+*       documentation and/or other materials provided with the distribution.  *
+*       3. The name of the author may not be used to endorse or promote       *
+*       products derived from this software without specific prior written    *
+*       permission.                                                           *
+*       THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR  *
+*       IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED        *
+*       WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE    *
+*       ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,*
+*       INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    *
+*       (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS       *
+*       OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) *
+*       HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,   *
+*       STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING *
+*       IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE    *
+*       POSSIBILITY OF SUCH DAMAGE.                                           *
+*                                                                             *
+*******************************************************************************/
+#include "estimateDecimator.hpp"
+
+EstimateDecimator::EstimateDecimator()
+  : _dimension(0)
+  ,_decimation(1)
+  ,_average(false)
+  ,_first(true)
+  ,_updates(0)
+  ,_count(0)
+{
+}
+
+void EstimateDecimator::configure(int dimension, int decimation, bool average)
+{
+  _dimension = dimension;
+  _decimation = decimation;
+  _average = average;
+  _sum.resize(dimension);
+  _output.resize(dimension);
+  reset();
+}
+
+void EstimateDecimator::reset()
+{
+  _first = true;
+  _updates = 0;
+  _count = 0;
+}
+
+bool EstimateDecimator::add(const ColumnVector& state, bool system_update)
+{
+  if(_average)
+  {
+    for(int i=1 ; i<=_dimension; i++)
+      _sum(i) = _count == 0 ? state(i) : _sum(i) + state(i);
+    _count++;
+  }
+  if(system_update)
+    _updates++;
+  if(!_first && _decimation > 1 && (!system_update || _updates < _decimation))
+    return false;
+
+  for(int i=1 ; i<=_dimension; i++)
+    _output(i) = _average ? _sum(i) / _count : state(i);
+  _first = false;
+  _updates = 0;
+  _count = 0;
+  return true;
+}
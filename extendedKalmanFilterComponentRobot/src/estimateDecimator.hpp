@@ -0,0 +1,96 @@
+/****************************************************************************** 
+* OROCOS Extended Kalman Filter component for estimating the position         *
+* off a mobile robot by measuring its distance to a wall at position x=0      * 
+*                                                                             *
+*                           (C) 2011 Tinne De Laet                            *
+*                       tinne.delaet@mech.kuleuven.be                         *                              
+*                    Department of Mechanical Engineering,                    *
+*                   Katholieke Universiteit Leuven, Belgium.                  *
+*                                                                             *
+*       You may redistribute this software and/or modify it under either the  *
+*       terms of the GNU Lesser General Public License version 2.1 (LGPLv2.1  *
+*       <http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>) or (at your *
+*       discretion) of the Modified BSD License:                              *
+*       Redistribution and use in source and binary forms, with or without    *
+*       modification, are permitted provided that the following conditions    *
+*       are met:                                                              *
+*       1. Redistributions of source code must retain the above copyright     *
+*       notice, this list of conditions and the following disclaimer.         *
+*       2. Redistributions in binary form must reproduce the above copyright  *
+*       notice, this list of conditions and the following disclaimer in the   *
+*       documentation and/or other materials provided with the distribution.  *
+*       3. The name of the author may not be used to endorse or promote       *
+*       products derived from this software without specific prior written    *
+*       permission.                                                           *
+*       THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR  *
+*       IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED        *
+*       WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE    *
+*       ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,*
+*       INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    *
+*       (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS       *
+*       OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) *
+*       HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,   *
+*       STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING *
+*       IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE    *
+*       POSSIBILITY OF SUCH DAMAGE.                                           *
+*                                                                             *
+*******************************************************************************/
+/* @Description: Decimation (and optional averaging) of the estimates of the RobotFilter to the
+ * rate they are published at.
+ *
+ * @Author: Tinne De Laet
+ */
+#ifndef _ESTIMATE_DECIMATOR_
+#define _ESTIMATE_DECIMATOR_
+
+#include <bfl/wrappers/matrix/vector_wrapper.h>
+
+using namespace MatrixWrapper;
+
+/*!
+ * Decides which estimates are published when the filter predicts faster
+ * than the consumers need: with a decimation of n, one estimate per n system
+ * updates; measurement updates are published with the next one. With a
+ * decimation of 1 every estimate is published. The published state is the
+ * latest estimate, or the average of the estimates since the previous
+ * publication. Allocates in configure() only.
+ */
+class EstimateDecimator
+  {
+    public:
+      EstimateDecimator();
+
+      /*!
+       * \brief Size the buffers
+       * @param decimation publish on every decimation'th system update (<= 1: every estimate)
+       * @param average publish the average of the estimates instead of the latest one
+       */
+      void configure(int dimension, int decimation, bool average);
+
+      /// Publish the next estimate, e.g. the prior
+      void reset();
+
+      /*!
+       * \brief Add an estimate
+       * @param system_update whether a system update (or else a measurement update) produced it
+       * @return true if output() has to be published now
+       */
+      bool add(const ColumnVector& state, bool system_update);
+
+      /// The state to publish
+      const ColumnVector& output() const { return _output; }
+
+    private:
+      int           _dimension;
+      int           _decimation;
+      bool          _average;
+      /// The next estimate is published
+      bool          _first;
+      /// System updates since the last publication
+      int           _updates;
+      /// Estimates in _sum
+      int           _count;
+      ColumnVector  _sum;
+      ColumnVector  _output;
+  };
+#endif // _ESTIMATE_DECIMATOR_
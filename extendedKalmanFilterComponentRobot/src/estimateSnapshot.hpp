@@ -0,0 +1,66 @@
+/****************************************************************************** 
+* OROCOS Extended Kalman Filter component for estimating the position         *
+* off a mobile robot by measuring its distance to a wall at position x=0      * 
+*                                                                             *
+*                           (C) 2011 Tinne De Laet                            *
+*                       tinne.delaet@mech.kuleuven.be                         *                              
+*                    Department of Mechanical Engineering,                    *
+*                   Katholieke Universiteit Leuven, Belgium.                  *
+*                                                                             *
+*       You may redistribute this software and/or modify it under either the  *
+*       terms of the GNU Lesser General Public License version 2.1 (LGPLv2.1  *
+*       <http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>) or (at your *
+*       discretion) of the Modified BSD License:                              *
+*       Redistribution and use in source and binary forms, with or without    *
+*       modification, are permitted provided that the following conditions    *
+*       are met:                                                              *
+*       1. Redistributions of source code must retain the above copyright     *
+*       notice, this list of conditions and the following disclaimer.         *
+*       2. Redistributions in binary form must reproduce the above copyright  *
+*       notice, this list of conditions and the following disclaimer in the   *
+*       documentation and/or other materials provided with the distribution.  *
+*       3. The name of the author may not be used to endorse or promote       *
+*       products derived from this software without specific prior written    *
+*       permission.                                                           *
+*       THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR  *
+*       IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED        *
+*       WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE    *
+*       ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,*
+*       INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    *
+*       (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS       *
+*       OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) *
+*       HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,   *
+*       STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING *
+*       IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE    *
+*       POSSIBILITY OF SUCH DAMAGE.                                           *
+*                                                                             *
+*******************************************************************************/
+/* @Description: Snapshot of the estimate of the ExtendedKalmanFilterComponentRobot, as published
+ * through its seqlock block (getEstimate operation, EstimateSegment shared memory segment).
+ *
+ * @Author: Tinne De Laet
+ */
+#ifndef _EKF_ESTIMATE_SNAPSHOT_
+#define _EKF_ESTIMATE_SNAPSHOT_
+
+/// Largest state the snapshot holds: PosStateDimension * (Level+1)
+#define ESTIMATE_MAX_DIMENSION 12
+
+/*!
+ * A plain copy of the estimate, readable without locks by any number of
+ * readers (in the same or in another process).
+ */
+struct EstimateSnapshot
+{
+  /// Number of the update that produced the estimate (system and measurement updates)
+  unsigned int  update;
+  /// Dimension of the state
+  unsigned int  dimension;
+  /// Time of the update, in seconds (RTT time)
+  double        stamp;
+  /// The estimated state
+  double        state[ESTIMATE_MAX_DIMENSION];
+  /// The covariance of the state, upper triangle row by row
+  double        covariance[ESTIMATE_MAX_DIMENSION*(ESTIMATE_MAX_DIMENSION+1)/2];
+};
+#endif // _EKF_ESTIMATE_SNAPSHOT_
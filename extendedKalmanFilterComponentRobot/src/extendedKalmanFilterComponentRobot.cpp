@@ -38,23 +38,43 @@
 *******************************************************************************/
 #include "extendedKalmanFilterComponentRobot.hpp"
 
+#include <sys/time.h>
+
 ORO_CREATE_COMPONENT(ExtendedKalmanFilterComponentRobot)
 
 ExtendedKalmanFilterComponentRobot::ExtendedKalmanFilterComponentRobot(std::string name)
   : TaskContext(name,PreOperational)
   ,_timerId("TimerId")
   ,_inputPort("Input")
+  ,_odometryPort("Odometry")
+  ,_baseOdometryPort("BaseOdometry")
   ,_measurementPort("Measurement")
+  ,_receivedMeasurementPort("ReceivedMeasurement")
   ,_estimatedStatePort("EstimatedState")
   ,_covarianceStatePort("CovarianceState")
   ,_level(0)
+  ,_outputDecimation(1)
+  ,_averageOutput(false)
+  ,_covarianceDecimation(1)
+  ,_odometrySamplePeriod(0.001)
+  ,_checkpointPeriod(0.0)
+  ,_restoreCheckpoint(false)
+  ,_checkpointMaxAge(0.0)
   ,_posStateDimension(0)
   ,_measDimension(0)
-  ,_inputColumnVector(4)
+  ,_traceCount(0)
+  ,_estimateCount(0)
+  ,_sysUpdateProbe(0)
+  ,_measUpdateProbe(0)
+  ,_checkpointWriter(0)
+  ,_checkpointActivity(0)
 { 
   this->addEventPort(_timerId,boost::bind(&ExtendedKalmanFilterComponentRobot::sysUpdate,this,_1)).doc("Triggers sysUpdate() when new data arrives");
   this->addEventPort(_measurementPort,boost::bind(&ExtendedKalmanFilterComponentRobot::measUpdate,this,_1)).doc("Measurement - this port triggers measUpdate() when new data arrives");
   this->addPort(_inputPort).doc("Input (twist) send to robot ");
+  this->addPort(_odometryPort).doc("Measured twist of the base (wheel odometry), integrated between system updates instead of the input when samples arrive (buffered connection)");
+  this->addPort(_baseOdometryPort).doc("Odometry of the base driver (nav_msgs/Odometry, twist in the base frame), integrated like the Odometry port (buffered connection)");
+  this->addPort(_receivedMeasurementPort).doc("Copy of every processed measurement, for the logger (youbot_replay -m)");
   this->addPort(_estimatedStatePort).doc("Estimated state");
   this->addPort(_covarianceStatePort).doc("Covariance of state ");
   this->addProperty("PriorMean", _priorMean).doc("The mean of the prior distribution on the marker state");
@@ -68,9 +88,23 @@ ExtendedKalmanFilterComponentRobot::ExtendedKalmanFilterComponentRobot(std::stri
   this->addProperty("MeasNoiseMean", _measNoiseMean).doc("Mean of additive Gaussian noise on measurement model");
   this->addProperty("Period", _period).doc("Period at which the system model gets updated");
   this->addProperty("TimerIdSystemUpdate", _timerIdSystemUpdate).doc("timerId for the system update");
+  this->addProperty("EstimateSegment", _estimateSegmentName).doc("Name of the shared memory segment to publish the estimate in (empty: in-process only)");
+  this->addProperty("OutputDecimation", _outputDecimation).doc("Write EstimatedState and CovarianceState on every n-th system update only, measurement updates are written with the next one (1: every estimate)");
+  this->addProperty("AverageOutput", _averageOutput).doc("Write the average of the estimates since the last write to EstimatedState instead of the latest one");
+  this->addProperty("CovarianceDecimation", _covarianceDecimation).doc("Write CovarianceState on every n-th written estimate only, the estimated state is always written (1: every written estimate)");
+  this->addProperty("OdometrySamplePeriod", _odometrySamplePeriod).doc("Period of the samples on the Odometry and BaseOdometry ports");
+  this->addProperty("CheckpointFile", _checkpointFile).doc("File to checkpoint the estimate in (empty: no checkpoints)");
+  this->addProperty("CheckpointPeriod", _checkpointPeriod).doc("Period of the checkpoints, written in a non real-time thread (0: only on the checkpoint operation and at stop)");
+  this->addProperty("RestoreCheckpoint", _restoreCheckpoint).doc("Start from the estimate in CheckpointFile instead of from the prior, when it fits the model");
+  this->addProperty("CheckpointMaxAge", _checkpointMaxAge).doc("Oldest checkpoint to restore, in seconds (0: any age)");
+  this->addOperation("getEstimate", &ExtendedKalmanFilterComponentRobot::getEstimate, this, RTT::ClientThread).doc("Lock-free snapshot of the latest estimate").arg("Snapshot","The estimate");
+  this->addOperation("checkpoint", &ExtendedKalmanFilterComponentRobot::checkpoint, this, RTT::ClientThread).doc("Write the latest estimate to CheckpointFile, in the thread of the caller");
 }
 
-ExtendedKalmanFilterComponentRobot::~ExtendedKalmanFilterComponentRobot(){}
+ExtendedKalmanFilterComponentRobot::~ExtendedKalmanFilterComponentRobot()
+{
+  deleteCheckpointWriter();
+}
 
 bool ExtendedKalmanFilterComponentRobot::configureHook()
 {
@@ -79,136 +113,67 @@ bool ExtendedKalmanFilterComponentRobot::configureHook()
 #endif
   // dimension of the state
   _dimension = _posStateDimension * (_level+1);
-  
-  /************************
-  * Resize class variables
-  ************************/
-#ifndef NDEBUG    
-  log(Debug) << "(ExtendedKalmanFilterComponentRobot) resizing class variables" << endlog();
-#endif
-  _systemState.resize(_dimension);
-  _stateCovariance.resize(_dimension);
-  _measurement.resize(_measDimension);
-  _inputColumnVector=0.0;
-  
-  /************************
-  * Create prior distribution for pose state
-  ************************/
-#ifndef NDEBUG    
-  log(Debug) << "(ExtendedKalmanFilterComponentRobot) create prior distribution" << endlog();
-#endif
-  if((_dimension != _priorMean.rows()) )
+  if(_dimension > ESTIMATE_MAX_DIMENSION)
   {
-      log(Error) << "The size of the prior mean does not fit the dimension of the state " << endlog();
-      log(Error) << "The size of the prior mean: " << _priorMean.rows() << endlog();
-      log(Error) << "The _dimension : " << _dimension << endlog();
+      log(Error) << "The dimension of the state is larger than the estimate snapshot holds (" << ESTIMATE_MAX_DIMENSION << ")" << endlog();
       return false;
   }
-  _priorCont.DimensionSet(_dimension); 
-  _priorCont.ExpectedValueSet(_priorMean); 
-  
-  if((_dimension != _priorCovariance.rows())  )
-  {
-      log(Error) << "The size of the prior covariance does not fit the dimension of the state " << endlog();
-      return false;
-  }
-  SymmetricMatrix _priorCovarianceMatrix(_dimension);
-  _priorCovarianceMatrix = 0.0;
-  for(int i=1 ; i<=_dimension; i++)
-    _priorCovarianceMatrix(i,i) = _priorCovariance(i);
-  
-  _priorCont.CovarianceSet(_priorCovarianceMatrix); 
-  
-  /************************
-  * Create extended kalman filter  
-  ************************/
-#ifndef NDEBUG    
-  log(Debug) << "(ExtendedKalmanFilterComponentRobot) create extended Kalman filter" << endlog();
-#endif
-  _extendedKalmanFilter = new ExtendedKalmanFilter(&_priorCont);
-  
-  /************************
-  * Make system model: a constant level'th derivative model
-  * assumption: the position level components of the state are assumed to evolve independently
-  ************************/
-#ifndef NDEBUG    
-  log(Debug) << "(ExtendedKalmanFilterComponentRobot) make system model " << endlog();
-#endif
-  ColumnVector sysNoiseVector = ColumnVector(_level+1);
-  sysNoiseVector = 0.0;
-  ColumnVector sysNoiseMean(_dimension);
-  sysNoiseMean = _sysNoiseMean;
-  SymmetricMatrix sysNoiseMatrixOne = SymmetricMatrix(_level +1);
-  sysNoiseMatrixOne = 0.0;
-  Matrix sysNoiseMatrixNonSymOne = Matrix(_level+1,_level+1);  
-  sysNoiseMatrixNonSymOne = 0.0;
-  for(int i =0 ; i<=_level; i++) 
-  {
-    sysNoiseVector(i+1) = pow(_period,_level-i+1)/double(factorial(_level-i+1));
-  }
-  sysNoiseMatrixNonSymOne =  (sysNoiseVector* sysNoiseVector.transpose()) * _sysNoiseCovariance ;
-  sysNoiseMatrixNonSymOne.convertToSymmetricMatrix(sysNoiseMatrixOne);
-  
-  SymmetricMatrix sysNoiseMatrix = SymmetricMatrix(_dimension);
-  sysNoiseMatrix = 0.0;
-  for(int i =0 ; i<=_level; i++) 
+  if(!_estimateSegmentName.empty())
   {
-    for(int j =0 ; j<=_level; j++)
-    {
-      for (int k=1 ; k <=_posStateDimension; k++)
+      std::string error;
+      if(!_estimateSegment.open(_estimateSegmentName, error))
       {
-        sysNoiseMatrix(i*_posStateDimension+k,j*_posStateDimension+k)=sysNoiseMatrixOne(i+1,j+1);
+          log(Error) << "Cannot publish the estimate in shared memory: " << error << endlog();
+          return false;
       }
-    }
   }
-  
-#ifndef NDEBUG    
-  log(Debug) << "(ExtendedKalmanFilterComponentRobot) create system_Uncertainty " << endlog();
-#endif
-  Gaussian*  system_Uncertainty = new Gaussian(sysNoiseMean, sysNoiseMatrix);
-#ifndef NDEBUG    
-  log(Debug) << "(ExtendedKalmanFilterComponentRobot) create NonLinearAnalyticConditionalGaussianMobile " << endlog();
-  log(Debug) << "(ExtendedKalmanFilterComponentRobot) system_Uncertainty.ExpectedValueGet()"  << system_Uncertainty->ExpectedValueGet()<< endlog();
-  log(Debug) << "(ExtendedKalmanFilterComponentRobot) system_Uncertainty.CovarianceGet()"  << system_Uncertainty->CovarianceGet()<< endlog();
-#endif
-  _sysPdf = new NonLinearAnalyticConditionalGaussianMobile(*system_Uncertainty);
-#ifndef NDEBUG    
-  log(Debug) << "(ExtendedKalmanFilterComponentRobot) create AnalyticSystemModelGaussianUncertainty " << endlog();
-#endif
-  _sysModel = new AnalyticSystemModelGaussianUncertainty(_sysPdf);
-  
+  _snapshot.update = 0;
+  _sysUpdateProbe = youbot::HookStatsService::probe(this,"sysUpdate",_period);
+  _measUpdateProbe = youbot::HookStatsService::probe(this,"measUpdate",0.0);
+
   /************************
-  * Make measurement model
+  * Create the filter: prior, system model and measurement model
   ************************/
-#ifndef NDEBUG    
-  log(Debug) << "(ExtendedKalmanFilterComponentRobot) make measurement model " << endlog();
-#endif
-  if(_measDimension != _measNoiseMean.rows() )
-  {
-      log(Error) << "The size of the measurement does not fit the size of the mean of te mesurement noise, creating measurement model failed" << endlog();
+  RobotFilterParameters parameters;
+  parameters.priorMean = _priorMean;
+  parameters.priorCovariance = _priorCovariance;
+  parameters.level = _level;
+  parameters.sysNoiseMean = _sysNoiseMean;
+  parameters.sysNoiseCovariance = _sysNoiseCovariance;
+  parameters.posStateDimension = _posStateDimension;
+  parameters.measDimension = _measDimension;
+  parameters.measModelCovariance = _measModelCovariance;
+  parameters.measNoiseMean = _measNoiseMean;
+  parameters.period = _period;
+  if(!_filter.configure(parameters))
       return false;
-  }
-  if(_measDimension != _measModelCovariance.rows() )
-  {
-      log(Error) << "The size of the measurement covariance matrix  does not fit the size of the mean of te mesurement noise, creating measurement model failed " << endlog();
-      return false;
-  }
-  _measurement.resize(_measDimension);
 
-  Gaussian measurement_Uncertainty(_measNoiseMean, _measModelCovariance);
-  _measPdf= new YoubotLaserPdf(measurement_Uncertainty);
-  _measModel = new AnalyticMeasurementModelGaussianUncertainty(_measPdf);
+  // Size the estimate buffers and the data samples of the ports: no
+  // allocations in the updates
+  _decimator.configure(_dimension,_outputDecimation,_averageOutput);
+  _estimatedStatePort.setDataSample(_filter.state());
+  _covarianceStatePort.setDataSample(_filter.covariance());
 
-#ifndef NDEBUG    
-  log(Debug) << "(ExtendedKalmanFilterComponentRobot) startHook() entered" << endlog();
-#endif
-  // Get estimated position and covariance
-  _systemState = _extendedKalmanFilter->PostGet()->ExpectedValueGet();
-  _stateCovariance = _extendedKalmanFilter->PostGet()->CovarianceGet();
-#ifndef NDEBUG    
-  log(Debug) << "_systemState " << _systemState << endlog();
-  log(Debug) << "_stateCovariance " << _stateCovariance << endlog();
-#endif
+  /************************
+  * Checkpoints: continue from the last one, write new ones off the real-time thread
+  ************************/
+  if(_restoreCheckpoint && !_checkpointFile.empty())
+      restoreCheckpoint();
+  deleteCheckpointWriter();
+  if(!_checkpointFile.empty())
+  {
+      FilterCheckpoint model;
+      model.level = _level;
+      model.posStateDimension = _posStateDimension;
+      model.measDimension = _measDimension;
+      model.period = _period;
+      model.sysNoiseMean = _sysNoiseMean;
+      model.sysNoiseCovariance = _sysNoiseCovariance;
+      model.measNoiseVariance = _measModelCovariance(1,1);
+      _checkpointWriter = new FilterCheckpointWriter(_checkpointFile,model,_estimateBlock);
+      if(_checkpointPeriod > 0.0)
+          _checkpointActivity = new RTT::Activity(ORO_SCHED_OTHER,RTT::os::LowestPriority,_checkpointPeriod,_checkpointWriter,getName()+".checkpoint");
+  }
 
 #ifndef NDEBUG    
   log(Debug) << "(ExtendedKalmanFilterComponentRobot) configureHook finished " << endlog();
@@ -221,14 +186,14 @@ bool ExtendedKalmanFilterComponentRobot::startHook()
 #ifndef NDEBUG    
   log(Debug) << "(ExtendedKalmanFilterComponentRobot) startHook() entered" << endlog();
 #endif
-  // Get estimated position and covariance
-  _systemState = _extendedKalmanFilter->PostGet()->ExpectedValueGet();
-  _stateCovariance = _extendedKalmanFilter->PostGet()->CovarianceGet();
-  _estimatedStatePort.write(_systemState);
-  _covarianceStatePort.write(_stateCovariance);
+  // Publish the prior (or the restored checkpoint)
+  _decimator.reset();
+  publishEstimate(true);
+  if(_checkpointActivity)
+    _checkpointActivity->start();
 #ifndef NDEBUG    
-  log(Debug) << "_systemState " << _systemState << endlog();
-  log(Debug) << "_stateCovariance " << _stateCovariance << endlog();
+  log(Debug) << "_systemState " << _filter.state() << endlog();
+  log(Debug) << "_stateCovariance " << _filter.covariance() << endlog();
 #endif
   
 #ifndef NDEBUG    
@@ -247,6 +212,7 @@ void ExtendedKalmanFilterComponentRobot::sysUpdate(RTT::base::PortInterface* por
    int timer_id;                                                                                                                                                                                             
    _timerId.read(timer_id);  
    if( timer_id == _timerIdSystemUpdate){ 
+  youbot::HookTimer timer(_sysUpdateProbe);
 #ifndef NDEBUG    
   log(Debug) << "(ExtendedKalmanFilterComponentRobot) sysUpdate() entered" << endlog();
 #endif
@@ -254,30 +220,29 @@ void ExtendedKalmanFilterComponentRobot::sysUpdate(RTT::base::PortInterface* por
 #ifndef NDEBUG    
   log(Debug) << "(ExtendedKalmanFilterComponentRobot) read input" << endlog();
 #endif
-  _inputPort.read(_input);
-  _inputColumnVector(1) = _input.linear.x;
-  _inputColumnVector(2) = _input.linear.y;
-  _inputColumnVector(3) = _input.angular.z;
-  _inputColumnVector(4) = _period;
-  // apply current input
-#ifndef NDEBUG    
-  log(Debug) << "(ExtendedKalmanFilterComponentRobot) update filter " << endlog();
-#endif
-  _extendedKalmanFilter->Update(_sysModel,_inputColumnVector);
-  
-  // Get estimated pose and covariance
-#ifndef NDEBUG    
-  log(Debug) << "(ExtendedKalmanFilterComponentRobot) get estimated pose and covariance " << endlog();
-#endif
-  _systemState = _extendedKalmanFilter->PostGet()->ExpectedValueGet();
-  _stateCovariance = _extendedKalmanFilter->PostGet()->CovarianceGet();
+  // The measured odometry since the last system update (all samples of a
+  // buffered connection), or else the current input
+  _odometry.reset();
+  while(_odometryPort.read(_odometrySample,false) == NewData)
+    _odometry.add(_odometrySample.linear.x,_odometrySample.linear.y,_odometrySample.angular.z,_odometrySamplePeriod);
+  while(_baseOdometryPort.read(_baseOdometrySample,false) == NewData)
+    _odometry.add(_baseOdometrySample.twist.twist.linear.x,_baseOdometrySample.twist.twist.linear.y,_baseOdometrySample.twist.twist.angular.z,_odometrySamplePeriod);
+  if(_odometry.samples() > 0)
+  {
+    _filter.sysUpdateDelta(_odometry.dx(),_odometry.dy(),_odometry.dtheta());
+  }
+  else
+  {
+    _inputPort.read(_input);
+    // apply current input
+    _filter.sysUpdate(_input.linear.x,_input.linear.y,_input.angular.z);
+  }
   
   // write results to port
 #ifndef NDEBUG    
   log(Debug) << "(ExtendedKalmanFilterComponentRobot) write results to port" << endlog();
 #endif
-  _estimatedStatePort.write(_systemState);
-  _covarianceStatePort.write(_stateCovariance);
+  publishEstimate(true);
 
 #ifndef NDEBUG    
   log(Debug) << "(ExtendedKalmanFilterComponentRobot) sysUpdate() finished" << endlog();
@@ -287,62 +252,128 @@ void ExtendedKalmanFilterComponentRobot::sysUpdate(RTT::base::PortInterface* por
 
 void ExtendedKalmanFilterComponentRobot::measUpdate(RTT::base::PortInterface* portInterface)
 {
+    youbot::HookTimer timer(_measUpdateProbe);
 #ifndef NDEBUG    
     log(Debug) << "(ExtendedKalmanFilterComponentRobot) measUpdate() entered" << endlog();
 #endif
     _measurementPort.read(_measurementFloat64);
-    _measurement(1)=_measurementFloat64.data;
-    if(_measurement.rows() != _measDimension )
+    _receivedMeasurementPort.write(_measurementFloat64);
+    // Continue the latency trace of the scan behind this measurement, or
+    // start one here when the scan was processed in another deployment
+    unsigned int trace = 0;
+    if(!youbot::LatencyTracer::Instance().follow(youbot::LatencyTracer::DISTANCE,youbot::LatencyTracer::MEASUREMENT,trace))
     {
-        log(Error) << "The size of the measurement does not fit the size of the measurement model matrix, measurement update not executed " << endlog();
-        log(Error) << "_measurement " << _measurement << endlog();
-        return;
+      trace = ++_traceCount;
+      youbot::LatencyTracer::Instance().begin(trace,youbot::LatencyTracer::MEASUREMENT);
     }
-
-#ifndef NDEBUG    
-    log(Debug) << "(ExtendedKalmanFilterComponentRobot) _measurement: " << _measurement << endlog();
-    log(Debug) << "(ExtendedKalmanFilterComponentRobot) _measModelCovariance: " << _measModelCovariance << endlog();
-    log(Debug) << "(ExtendedKalmanFilterComponentRobot) _measNoiseMean: " << _measNoiseMean << endlog();
-#endif
-    bool result = _extendedKalmanFilter->Update(_measModel,_measurement);
-    if(!result)
-    {
-#ifndef NDEBUG    
-      log(Error) << "(ExtendedKalmanFilterComponentRobot) updating Kalman Filter failed" << endlog();
-#endif
-    }
-    // Get estimated pose and covariance
-    _systemState = _extendedKalmanFilter->PostGet()->ExpectedValueGet();
-    _stateCovariance = _extendedKalmanFilter->PostGet()->CovarianceGet();
-#ifndef NDEBUG    
-    log(Debug) << "_systemState " << _systemState << endlog();
-    log(Debug) << "_stateCovariance " << _stateCovariance << endlog();
-#endif
+    _filter.measUpdate(_measurementFloat64.data);
   // write results to port
-  _estimatedStatePort.write(_systemState);
-  _covarianceStatePort.write(_stateCovariance);
+  youbot::LatencyTracer::Instance().mark(youbot::LatencyTracer::ESTIMATE,trace);
+  publishEstimate(false);
   
 #ifndef NDEBUG    
-    log(Debug) << "(ExtendedKalmanFilterComponentRobot) measUpdate() entered" << endlog();
+    log(Debug) << "(ExtendedKalmanFilterComponentRobot) measUpdate() finished" << endlog();
 #endif
 }
 
-void ExtendedKalmanFilterComponentRobot::stopHook()
+void ExtendedKalmanFilterComponentRobot::publishEstimate(bool system_update)
+{
+  const ColumnVector& state = _filter.state();
+  const SymmetricMatrix& covariance = _filter.covariance();
+  // The ports at the output rate, the seqlock blocks always hold the latest estimate
+  if(_decimator.add(state,system_update))
+  {
+    _estimatedStatePort.write(_decimator.output());
+    if(_covarianceDecimation <= 1 || _estimateCount % _covarianceDecimation == 0)
+      _covarianceStatePort.write(covariance);
+    _estimateCount++;
+  }
+
+  _snapshot.update++;
+  _snapshot.dimension = _dimension;
+  _snapshot.stamp = RTT::os::TimeService::ticks2nsecs(RTT::os::TimeService::Instance()->getTicks()) * 1e-9;
+  int k = 0;
+  for(int i=1 ; i<=_dimension; i++)
+  {
+    _snapshot.state[i-1] = state(i);
+    for(int j=i ; j<=_dimension; j++)
+      _snapshot.covariance[k++] = covariance(i,j);
+  }
+  // Constant cost, however many readers there are
+  _estimateBlock.write(_snapshot);
+  if(_estimateSegment.isOpen())
+    _estimateSegment.block().write(_snapshot);
+}
+
+bool ExtendedKalmanFilterComponentRobot::getEstimate(EstimateSnapshot& snapshot)
 {
+  return _estimateBlock.read(snapshot);
 }
 
-int ExtendedKalmanFilterComponentRobot::factorial (int num)
+bool ExtendedKalmanFilterComponentRobot::checkpoint()
+{
+  return _checkpointWriter && _checkpointWriter->write();
+}
+
+void ExtendedKalmanFilterComponentRobot::restoreCheckpoint()
+{
+  FilterCheckpoint checkpoint;
+  if(!readFilterCheckpoint(_checkpointFile,checkpoint))
+  {
+      log(Info) << "(ExtendedKalmanFilterComponentRobot) No checkpoint in " << _checkpointFile << ", starting from the prior" << endlog();
+      return;
+  }
+  if(checkpoint.level != _level || checkpoint.posStateDimension != _posStateDimension || (int)checkpoint.estimate.dimension != _dimension)
+  {
+      log(Warning) << "(ExtendedKalmanFilterComponentRobot) The checkpoint in " << _checkpointFile << " has another state, starting from the prior" << endlog();
+      return;
+  }
+  struct timeval now;
+  gettimeofday(&now,0);
+  double age = now.tv_sec + now.tv_usec * 1e-6 - checkpoint.written;
+  if(_checkpointMaxAge > 0.0 && age > _checkpointMaxAge)
+  {
+      log(Warning) << "(ExtendedKalmanFilterComponentRobot) The checkpoint in " << _checkpointFile << " is " << age << " s old, starting from the prior" << endlog();
+      return;
+  }
+  if(checkpoint.period != _period || checkpoint.sysNoiseMean != _sysNoiseMean || checkpoint.sysNoiseCovariance != _sysNoiseCovariance
+     || checkpoint.measDimension != _measDimension || checkpoint.measNoiseVariance != _measModelCovariance(1,1))
+      log(Warning) << "(ExtendedKalmanFilterComponentRobot) The checkpoint was written with other noise parameters, restoring its estimate anyway" << endlog();
+
+  ColumnVector state(_dimension);
+  SymmetricMatrix covariance(_dimension);
+  int k = 0;
+  for(int i=1 ; i<=_dimension; i++)
+  {
+    state(i) = checkpoint.estimate.state[i-1];
+    for(int j=i ; j<=_dimension; j++)
+      covariance(i,j) = checkpoint.estimate.covariance[k++];
+  }
+  if(_filter.restore(state,covariance))
+    log(Info) << "(ExtendedKalmanFilterComponentRobot) Restored the estimate of " << _checkpointFile << ", " << age << " s old" << endlog();
+}
+
+void ExtendedKalmanFilterComponentRobot::deleteCheckpointWriter()
+{
+  if(_checkpointActivity)
+    _checkpointActivity->stop();
+  delete _checkpointActivity;
+  delete _checkpointWriter;
+  _checkpointActivity = 0;
+  _checkpointWriter = 0;
+}
+
+void ExtendedKalmanFilterComponentRobot::stopHook()
 {
-  if (num==1)
-      return 1;
-  return factorial(num-1)*num; // recursive call
+  // Stopping the activity writes a last checkpoint
+  if(_checkpointActivity)
+    _checkpointActivity->stop();
+  else if(_checkpointWriter)
+    _checkpointWriter->write();
 }
 
-void ExtendedKalmanFilterComponentRobot::cleanUpHook()
+void ExtendedKalmanFilterComponentRobot::cleanupHook()
 {
-  delete _extendedKalmanFilter;
-  delete _sysPdf;
-  delete _sysModel;
-  delete _measPdf;
-  delete _measModel;
+  deleteCheckpointWriter();
+  _filter.cleanup();
 }
@@ -58,18 +58,28 @@
 #include <bfl/pdf/gaussian.h>
 
 #include <rtt/TaskContext.hpp>
+#include <rtt/Activity.hpp>
 #include <rtt/Port.hpp>
 #include <rtt/Property.hpp>
 #include <rtt/base/PortInterface.hpp>
 #include <rtt/os/Timer.hpp>
+#include <rtt/os/TimeService.hpp>
 
 #include <ocl/Component.hpp>
 
 #include <geometry_msgs/Twist.h>
+#include <nav_msgs/Odometry.h>
 #include <std_msgs/Float64.h>
 
-#include "nonlinearanalyticconditionalgaussianmobile.h"
-#include "youbotLaserPdf.h"
+#include <seqlockBlock.hpp>
+#include <latencyTracer.hpp>
+#include <hookStatsService.hpp>
+
+#include "robotFilter.hpp"
+#include "estimateSnapshot.hpp"
+#include "filterCheckpoint.hpp"
+#include "odometryIntegrator.hpp"
+#include "estimateDecimator.hpp"
 
 
 using namespace std;
@@ -88,8 +98,14 @@ class ExtendedKalmanFilterComponentRobot : public TaskContext
       InputPort< RTT::os::Timer::TimerId >      _timerId;
       /// The input (velocity send to te robot)
       InputPort<geometry_msgs::Twist>           _inputPort;
+      /// The measured twist of the base (wheel odometry), replaces the input when connected
+      InputPort<geometry_msgs::Twist>           _odometryPort;
+      /// The odometry message of the base driver, its twist is used like the samples on _odometryPort
+      InputPort<nav_msgs::Odometry>             _baseOdometryPort;
       /// The measurement
       InputPort< std_msgs::Float64 >            _measurementPort;
+      /// Every measurement that is processed, so a logger can record it when the measurement arrives over a stream
+      OutputPort< std_msgs::Float64 >           _receivedMeasurementPort;
       /// The estimated state
       OutputPort< ColumnVector >                _estimatedStatePort;
       /// The covariance on the estimated state
@@ -114,6 +130,24 @@ class ExtendedKalmanFilterComponentRobot : public TaskContext
       ColumnVector              _measNoiseMean;
       /// ID of timer to trigger system update
       int                       _timerIdSystemUpdate;
+      /// Name of the shared memory segment to publish the estimate in (empty: in-process only)
+      std::string               _estimateSegmentName;
+      /// Write the ports on every n-th system update only (1: every estimate)
+      int                       _outputDecimation;
+      /// Write the average of the estimates since the last write instead of the latest one
+      bool                      _averageOutput;
+      /// Write the covariance on every n-th written estimate only (load shedding by the supervisor)
+      int                       _covarianceDecimation;
+      /// Period of the samples on the Odometry and BaseOdometry ports
+      double                    _odometrySamplePeriod;
+      /// File to checkpoint the estimate in (empty: no checkpoints)
+      std::string               _checkpointFile;
+      /// Period of the checkpoints, in a non real-time thread (0: only on the checkpoint operation and at stop)
+      double                    _checkpointPeriod;
+      /// Start from the checkpoint instead of from the prior, when there is one
+      bool                      _restoreCheckpoint;
+      /// Oldest checkpoint to restore, in seconds (0: any age)
+      double                    _checkpointMaxAge;
 
     public:
       /*!
@@ -131,7 +165,25 @@ class ExtendedKalmanFilterComponentRobot : public TaskContext
       bool      startHook();
       void      updateHook();
       void      stopHook();
-      void      cleanUpHook();
+      void      cleanupHook();
+
+      /*!
+       * \brief Get the latest estimate
+       *
+       * Lock-free snapshot of the estimate, taken in the thread of the caller.
+       * @return false if there is no estimate yet, or no consistent snapshot
+       * could be taken in a bounded number of attempts
+       */
+      bool      getEstimate(EstimateSnapshot& snapshot);
+
+      /*!
+       * \brief Checkpoint the latest estimate
+       *
+       * Writes the estimate and the model to CheckpointFile, in the thread of
+       * the caller.
+       * @return false if there is no CheckpointFile or it cannot be written
+       */
+      bool      checkpoint();
     
     private:
       /// The dimension of the state space
@@ -140,45 +192,39 @@ class ExtendedKalmanFilterComponentRobot : public TaskContext
       int                                                     _posStateDimension;
       /// The dimension of the measurement space
       int                                                     _measDimension;
-      /// Gaussian to represent the initial state
-      Gaussian                                                _priorCont; 
-      /// EKF to estimate the state
-      ExtendedKalmanFilter*                                   _extendedKalmanFilter; 
-      /// The conditional Gaussian underlying the system model
-      NonLinearAnalyticConditionalGaussianMobile*             _sysPdf;
-      /// The system model 
-      AnalyticSystemModelGaussianUncertainty*                 _sysModel;
-      /// The linear conditional Gaussian underlying the measurement model
-      //LinearAnalyticConditionalGaussian*                      _measPdf; 
-      AnalyticConditionalGaussian*                              _measPdf; 
-      /// The analytic measurement model with addtive Gaussian noise
-      AnalyticMeasurementModelGaussianUncertainty*            _measModel; 
-      /// The system state: (Fx,Fy,Fz,wz,wy,wz) for level = 0, ...
-      ColumnVector                                            _systemState; 
-      /// The system state covariance matrix
-      SymmetricMatrix                                         _stateCovariance; 
-      /// Measurement 
-      std_msgs::Float64                                       _measurementFloat64;
-      /// Measurement as a ColumnVector
-      ColumnVector                                            _measurement;
-      /// Matrix to store the covariance
-      SymmetricMatrix                                         _mat;
-      /// ColumnVector to store the state
-      ColumnVector                                            _state;
       /// Period at which the system model gets updated
       double                                                  _period;
+      /// The filter: prior, system model and measurement model
+      RobotFilter                                             _filter;
+      /// Measurement 
+      std_msgs::Float64                                       _measurementFloat64;
       /// helper variable to store input
       geometry_msgs::Twist                                    _input;
-      /// helper variable to store input
-      ColumnVector                                            _inputColumnVector;
+      /// helper variable to read the odometry
+      geometry_msgs::Twist                                    _odometrySample;
+      nav_msgs::Odometry                                      _baseOdometrySample;
+      /// The odometry received since the last system update
+      OdometryIntegrator                                      _odometry;
+      /// The latest estimate, for any number of readers
+      youbot::SeqlockBlock<EstimateSnapshot>                  _estimateBlock;
+      /// The latest estimate in shared memory, if EstimateSegment is set
+      youbot::ShmSeqlock<EstimateSnapshot>                    _estimateSegment;
+      /// helper variable to fill the snapshots
+      EstimateSnapshot                                        _snapshot;
+      /// id of the last latency trace started here (scans processed in another deployment)
+      unsigned int                                            _traceCount;
+      /// number of estimates written to the ports, for the covariance decimation
+      unsigned int                                            _estimateCount;
+      /// which estimates are written to the ports
+      EstimateDecimator                                       _decimator;
+      /// Timing of sysUpdate() and measUpdate(), 0 without the hookstats service
+      youbot::HookProbe*                                      _sysUpdateProbe;
+      youbot::HookProbe*                                      _measUpdateProbe;
+      /// Writes the checkpoints, 0 without CheckpointFile
+      FilterCheckpointWriter*                                 _checkpointWriter;
+      /// Runs the _checkpointWriter every CheckpointPeriod
+      RTT::Activity*                                          _checkpointActivity;
       
-      /*!
-      * helper function calculating the factorial of an int 
-      * @param the integer of which to calculate the factorial
-      * @return the factorial
-      */
-      int factorial(int);
-
       /*!
        * update the measurement model each time new data arrives
        */
@@ -188,6 +234,22 @@ class ExtendedKalmanFilterComponentRobot : public TaskContext
        * update the system model
        */
       void sysUpdate(RTT::base::PortInterface*);
+
+      /*!
+       * write the estimate to the seqlock blocks, and to the ports at the output rate
+       * @param system_update whether a system update (or else a measurement update) produced it
+       */
+      void publishEstimate(bool system_update);
+
+      /*!
+       * continue from the checkpoint in CheckpointFile, if it fits the model
+       */
+      void restoreCheckpoint();
+
+      /*!
+       * stop and delete the checkpoint writer
+       */
+      void deleteCheckpointWriter();
   };
 #endif // _EKF_COMPONENT_ROBOT_
 
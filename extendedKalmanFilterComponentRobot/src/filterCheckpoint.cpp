@@ -0,0 +1,123 @@
+/****************************************************************************** 
+* OROCOS Extended Kalman Filter component for estimating the position         *
+* off a mobile robot by measuring its distance to a wall at position x=0      * 
+*                                                                             *
+*                           (C) 2011 Tinne De Laet                            *
+*                       tinne.delaet@mech.kuleuven.be                         *                              
+*                    Department of Mechanical Engineering,                    *
+*                   Katholieke Universiteit Leuven, Belgium.                  *
+*                                                                             *
+*       You may redistribute this software and/or modify it under either the  *
+*       terms of the GNU Lesser General Public License version 2.1 (LGPLv2.1  *
+*       <http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>) or (at your *
+*       discretion) of the Modified BSD License:                              *
+*       Redistribution and use in source and binary forms, with or without    *
+*       modification, are permitted provided that the following conditions    *
+*       are met:                                                              *
+*       1. Redistributions of source code must retain the above copyright     *
+*       notice, this list of conditions and the following disclaimer.         *
+*       2. Redistributions in binary form must reproduce the above copyright  *
+*       notice, this list of conditions and the following disclaimer in the   *
+*       documentation and/or other materials provided with the distribution.  *
+*       3. The name of the author may not be used to endorse or promote       *
+*       products derived from this software without specific prior written    *
+*       permission.                                                           *
+*       THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR  *
+*       IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED        *
+*       WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE    *
+*       ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,*
+*       INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    *
+*       (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS       *
+*       OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) *
+*       HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,   *
+*       STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING *
+*       IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE    *
+*       POSSIBILITY OF SUCH DAMAGE.                                           *
+*                                                                             *
+*******************************************************************************/
+#include "filterCheckpoint.hpp"
+
+#include <rtt/Logger.hpp>
+#include <rtt/os/MutexLock.hpp>
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+using namespace RTT;
+
+bool writeFilterCheckpoint(const std::string& file_name, const FilterCheckpoint& checkpoint)
+{
+  std::string temporary = file_name + ".tmp";
+  FILE* file = fopen(temporary.c_str(),"wb");
+  if(!file)
+  {
+      log(Warning) << "(FilterCheckpoint) Cannot open " << temporary << endlog();
+      return false;
+  }
+  bool ok = fwrite(&checkpoint,sizeof(checkpoint),1,file) == 1 && fflush(file) == 0 && fsync(fileno(file)) == 0;
+  ok = fclose(file) == 0 && ok;
+  if(!ok || rename(temporary.c_str(),file_name.c_str()) != 0)
+  {
+      log(Warning) << "(FilterCheckpoint) Cannot write " << file_name << endlog();
+      unlink(temporary.c_str());
+      return false;
+  }
+  return true;
+}
+
+bool readFilterCheckpoint(const std::string& file_name, FilterCheckpoint& checkpoint)
+{
+  FILE* file = fopen(file_name.c_str(),"rb");
+  if(!file)
+      return false;
+  bool ok = fread(&checkpoint,sizeof(checkpoint),1,file) == 1;
+  fclose(file);
+  if(!ok || memcmp(checkpoint.magic,FILTER_CHECKPOINT_MAGIC,sizeof(FILTER_CHECKPOINT_MAGIC)) != 0
+     || checkpoint.version != FILTER_CHECKPOINT_VERSION || checkpoint.size != sizeof(FilterCheckpoint)
+     || checkpoint.estimate.dimension > ESTIMATE_MAX_DIMENSION)
+  {
+      log(Warning) << "(FilterCheckpoint) " << file_name << " is not a version " << FILTER_CHECKPOINT_VERSION << " checkpoint" << endlog();
+      return false;
+  }
+  return true;
+}
+
+FilterCheckpointWriter::FilterCheckpointWriter(const std::string& file_name, const FilterCheckpoint& model, const youbot::SeqlockBlock<EstimateSnapshot>& estimate)
+  : _fileName(file_name)
+  ,_estimate(estimate)
+  ,_checkpoint(model)
+  ,_written(0)
+{
+  memcpy(_checkpoint.magic,FILTER_CHECKPOINT_MAGIC,sizeof(FILTER_CHECKPOINT_MAGIC));
+  _checkpoint.version = FILTER_CHECKPOINT_VERSION;
+  _checkpoint.size = sizeof(FilterCheckpoint);
+}
+
+bool FilterCheckpointWriter::write()
+{
+  os::MutexLock lock(_lock);
+  unsigned int published = _estimate.count();
+  if(published == _written)
+      return true;
+  if(!_estimate.read(_checkpoint.estimate))
+      return false;
+  struct timeval now;
+  gettimeofday(&now,0);
+  _checkpoint.written = now.tv_sec + now.tv_usec * 1e-6;
+  if(!writeFilterCheckpoint(_fileName,_checkpoint))
+      return false;
+  _written = published;
+  return true;
+}
+
+void FilterCheckpointWriter::step()
+{
+  write();
+}
+
+void FilterCheckpointWriter::finalize()
+{
+  write();
+}
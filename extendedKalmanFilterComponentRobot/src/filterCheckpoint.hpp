@@ -0,0 +1,133 @@
+/****************************************************************************** 
+* OROCOS Extended Kalman Filter component for estimating the position         *
+* off a mobile robot by measuring its distance to a wall at position x=0      * 
+*                                                                             *
+*                           (C) 2011 Tinne De Laet                            *
+*                       tinne.delaet@mech.kuleuven.be                         *                              
+*                    Department of Mechanical Engineering,                    *
+*                   Katholieke Universiteit Leuven, Belgium.                  *
+*                                                                             *
+*       You may redistribute this software and/or modify it under either the  *
+*       terms of the GNU Lesser General Public License version 2.1 (LGPLv2.1  *
+*       <http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>) or (at your *
+*       discretion) of the Modified BSD License:                              *
+*       Redistribution and use in source and binary forms, with or without    *
+*       modification, are permitted provided that the following conditions    *
+*       are met:                                                              *
+*       1. Redistributions of source code must retain the above copyright     *
+*       notice, this list of conditions and the following disclaimer.         *
+*       2. Redistributions in binary form must reproduce the above copyright  *
+*       notice, this list of conditions and the following disclaimer in the   *
+*       documentation and/or other materials provided with the distribution.  *
+*       3. The name of the author may not be used to endorse or promote       *
+*       products derived from this software without specific prior written    *
+*       permission.                                                           *
+*       THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR  *
+*       IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED        *
+*       WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE    *
+*       ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,*
+*       INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    *
+*       (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS       *
+*       OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) *
+*       HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,   *
+*       STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING *
+*       IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE    *
+*       POSSIBILITY OF SUCH DAMAGE.                                           *
+*                                                                             *
+*******************************************************************************/
+/* @Description: Checkpoints of the ExtendedKalmanFilterComponentRobot: the estimate and the model it
+ * belongs to in a small versioned binary file, so a restarted component continues from the last
+ * estimate instead of from the prior.
+ *
+ * @Author: Tinne De Laet
+ */
+#ifndef _EKF_FILTER_CHECKPOINT_
+#define _EKF_FILTER_CHECKPOINT_
+
+#include <rtt/base/RunnableInterface.hpp>
+#include <rtt/os/Mutex.hpp>
+
+#include <seqlockBlock.hpp>
+
+#include <string>
+
+#include "estimateSnapshot.hpp"
+
+/// First bytes of a checkpoint file
+const char FILTER_CHECKPOINT_MAGIC[8] = {'Y','B','E','K','F','C','P','\0'};
+/// Version of the checkpoint layout
+const unsigned int FILTER_CHECKPOINT_VERSION = 1;
+
+/*!
+ * The contents of a checkpoint file, in the byte order of the machine that
+ * wrote it. The filter is Markov: the posterior is all the history it has.
+ */
+struct FilterCheckpoint
+{
+  char              magic[8];
+  unsigned int      version;
+  /// Size of the checkpoint, to detect incompatible builds
+  unsigned int      size;
+  /// Wall clock time of the checkpoint, in seconds since the epoch
+  double            written;
+  /// @name The model the estimate belongs to
+  //@{
+  int               level;
+  int               posStateDimension;
+  int               measDimension;
+  double            period;
+  double            sysNoiseMean;
+  double            sysNoiseCovariance;
+  /// First element of MeasModelCovariance
+  double            measNoiseVariance;
+  //@}
+  /// The posterior
+  EstimateSnapshot  estimate;
+};
+
+/*!
+ * \brief Write a checkpoint
+ *
+ * Written to file_name.tmp, then renamed, so the file always holds a
+ * complete checkpoint. Not real-time.
+ */
+bool writeFilterCheckpoint(const std::string& file_name, const FilterCheckpoint& checkpoint);
+
+/*!
+ * \brief Read a checkpoint
+ * @return false if there is no checkpoint of this version in the file
+ */
+bool readFilterCheckpoint(const std::string& file_name, FilterCheckpoint& checkpoint);
+
+/*!
+ * Writes the latest estimate of the component to the checkpoint file, when
+ * it changed. Run by a non real-time activity of its own, and by the
+ * checkpoint operation in the thread of the caller; the estimate is taken
+ * from the seqlock block, the filter is never touched.
+ */
+class FilterCheckpointWriter : public RTT::base::RunnableInterface
+  {
+    public:
+      /*!
+       * @param model the model part of the checkpoints
+       * @param estimate the block the component publishes the estimate in
+       */
+      FilterCheckpointWriter(const std::string& file_name, const FilterCheckpoint& model, const youbot::SeqlockBlock<EstimateSnapshot>& estimate);
+
+      /// Write the latest estimate if it was not written yet
+      bool write();
+
+      void step();
+      /// A last checkpoint when the activity stops
+      void finalize();
+
+    private:
+      std::string                                     _fileName;
+      const youbot::SeqlockBlock<EstimateSnapshot>&   _estimate;
+      FilterCheckpoint                                _checkpoint;
+      /// Number of estimates published when the last checkpoint was written
+      unsigned int                                    _written;
+      /// The activity and the operation may write at the same time
+      RTT::os::Mutex                                  _lock;
+  };
+#endif // _EKF_FILTER_CHECKPOINT_
@@ -0,0 +1,86 @@
+/****************************************************************************** 
+* OROCOS Extended Kalman Filter component for estimating the position         *
+* off a mobile robot by measuring its distance to a wall at position x=0      * 
+*                                                                             *
+*                           (C) 2011 Tinne De Laet                            *
+*                       tinne.delaet@mech.kuleuven.be                         *                              
+*                    Department of Mechanical Engineering,                    *
+*                   Katholieke Universiteit Leuven, Belgium.                  *
+*                                                                             *
+*       You may redistribute this software and/or modify it under either the  *
+*       terms of the GNU Lesser General Public License version 2.1 (LGPLv2.1  *
+*       <http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>) or (at your *
+*       discretion) of the Modified BSD License:                              *
+*       Redistribution and use in source and binary forms, with or without    *
+*       modification, are permitted provided that the following conditions    *
+*       are met:                                                              *
+*       1. Redistributions of source code must retain the above copyright     *
+*       notice, this list of conditions and the following disclaimer.         *
+*       2. Redistributions in binary form must reproduce the above copyright  *
+*       notice, this list of conditions and the following disclaimer in the   *
+*       documentation and/or other materials provided with the distribution.  *
+*       3. The name of the author may not be used to endorse or promote       *
+*       products derived from this software without specific prior written    *
+*       permission.                                                           *
+*       THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR  *
+*       IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED        *
+*       WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE    *
+*       ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,*
+*       INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    *
+*       (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS       *
+*       OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) *
+*       HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,   *
+*       STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING *
+*       IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE    *
+*       POSSIBILITY OF SUCH DAMAGE.                                           *
+*                                                                             *
+*******************************************************************************/
+/* @Description: Pre-integration of high rate odometry (measured twists of the base) into a single
+ * pose delta per system update of the RobotFilter.
+ *
+ * @Author: Tinne De Laet
+ */
+#ifndef _ODOMETRY_INTEGRATOR_
+#define _ODOMETRY_INTEGRATOR_
+
+/*!
+ * Integrates the measured twists (vx, vy in the frame of the base, omega)
+ * received between two system updates into the motion of the base over that
+ * interval, expressed in the frame of the base at its start. Each sample is
+ * rotated with the heading halfway the sample (midpoint rule). Real-time:
+ * no allocation, a sine and a cosine per sample.
+ */
+class OdometryIntegrator
+  {
+    public:
+      OdometryIntegrator();
+
+      /// Start a new interval
+      void reset();
+
+      /*!
+       * \brief Add a measured twist
+       * @param vx, vy, omega the twist of the base, in the frame of the base
+       * @param dt the time the twist was applied
+       */
+      void add(double vx, double vy, double omega, double dt);
+
+      /// @name The delta since reset(), in the frame of the base at reset()
+      //@{
+      double dx() const { return _dx; }
+      double dy() const { return _dy; }
+      double dtheta() const { return _dtheta; }
+      //@}
+      /// Number of samples since reset()
+      unsigned int samples() const { return _samples; }
+      /// Time covered by the samples since reset()
+      double duration() const { return _duration; }
+
+    private:
+      double        _dx;
+      double        _dy;
+      double        _dtheta;
+      double        _duration;
+      unsigned int  _samples;
+  };
+#endif // _ODOMETRY_INTEGRATOR_
@@ -0,0 +1,300 @@
+/****************************************************************************** 
+* OROCOS Extended Kalman Filter component for estimating the position         *
+* off a mobile robot by measuring its distance to a wall at position x=0      * 
+*                                                                             *
+*                           (C) 2011 Tinne De Laet                            *
+*                       tinne.delaet@mech.kuleuven.be                         *                              
+*                    Department of Mechanical Engineering,                    *
+*                   Katholieke Universiteit Leuven, Belgium.                  *
+*                                                                             *
+*       You may redistribute this software and/or modify it under either the  *
+*       terms of the GNU Lesser General Public License version 2.1 (LGPLv2.1  *
+*       <http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>) or (at your *
+*       discretion) of the Modified BSD License:                              *
+*       Redistribution and use in source and binary forms, with or without    *
+*       modification, are permitted provided that the following conditions    *
+*       are met:                                                              *
+*       1. Redistributions of source code must retain the above copyright     *
+*       notice, this list of conditions and the following disclaimer.         *
+*       2. Redistributions in binary form must reproduce the above copyright  *
+*       notice, this list of conditions and the following disclaimer in the   *
+*       documentation and/or other materials provided with the distribution.  *
+*       3. The name of the author may not be used to endorse or promote       *
+*       products derived from this software without specific prior written    *
+*       permission.                                                           *
+*       THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR  *
+*       IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED        *
+*       WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE    *
+*       ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,*
+*       INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    *
+*       (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS       *
+*       OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) *
+*       HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,   *
+*       STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING *
+*       IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE    *
+*       POSSIBILITY OF SUCH DAMAGE.                                           *
+*                                                                             *
+*******************************************************************************/
+#include "robotFilter.hpp"
+#include "youbotLaserPdf.h"
+
+#include <rtt/Logger.hpp>
+
+using namespace RTT;
+
+RobotFilter::RobotFilter()
+  : _dimension(0)
+  ,_measDimension(0)
+  ,_period(0.0)
+  ,_measVariance(0.0)
+  ,_extendedKalmanFilter(0)
+  ,_sysPdf(0)
+  ,_sysModel(0)
+  ,_measPdf(0)
+  ,_measModel(0)
+  ,_inputColumnVector(4)
+{
+}
+
+RobotFilter::~RobotFilter()
+{
+  cleanup();
+}
+
+bool RobotFilter::configure(const RobotFilterParameters& parameters)
+{
+  cleanup();
+  // dimension of the state
+  _dimension = parameters.posStateDimension * (parameters.level+1);
+  _measDimension = parameters.measDimension;
+  _period = parameters.period;
+  int level = parameters.level;
+  int posStateDimension = parameters.posStateDimension;
+
+  /************************
+  * Resize class variables
+  ************************/
+#ifndef NDEBUG    
+  log(Debug) << "(RobotFilter) resizing class variables" << endlog();
+#endif
+  _systemState.resize(_dimension);
+  _stateCovariance.resize(_dimension);
+  _measurement.resize(_measDimension);
+  _inputColumnVector=0.0;
+
+  /************************
+  * Create prior distribution for pose state
+  ************************/
+#ifndef NDEBUG    
+  log(Debug) << "(RobotFilter) create prior distribution" << endlog();
+#endif
+  if((_dimension != parameters.priorMean.rows()) )
+  {
+      log(Error) << "The size of the prior mean does not fit the dimension of the state " << endlog();
+      log(Error) << "The size of the prior mean: " << parameters.priorMean.rows() << endlog();
+      log(Error) << "The _dimension : " << _dimension << endlog();
+      return false;
+  }
+  _priorCont.DimensionSet(_dimension); 
+  _priorCont.ExpectedValueSet(parameters.priorMean); 
+  
+  if((_dimension != parameters.priorCovariance.rows())  )
+  {
+      log(Error) << "The size of the prior covariance does not fit the dimension of the state " << endlog();
+      return false;
+  }
+  SymmetricMatrix _priorCovarianceMatrix(_dimension);
+  _priorCovarianceMatrix = 0.0;
+  for(int i=1 ; i<=_dimension; i++)
+    _priorCovarianceMatrix(i,i) = parameters.priorCovariance(i);
+  
+  _priorCont.CovarianceSet(_priorCovarianceMatrix); 
+
+  /************************
+  * Make measurement model
+  ************************/
+#ifndef NDEBUG    
+  log(Debug) << "(RobotFilter) make measurement model " << endlog();
+#endif
+  if(_measDimension != parameters.measNoiseMean.rows() )
+  {
+      log(Error) << "The size of the measurement does not fit the size of the mean of te mesurement noise, creating measurement model failed" << endlog();
+      return false;
+  }
+  if(_measDimension != parameters.measModelCovariance.rows() )
+  {
+      log(Error) << "The size of the measurement covariance matrix  does not fit the size of the mean of te mesurement noise, creating measurement model failed " << endlog();
+      return false;
+  }
+  
+  /************************
+  * Create extended kalman filter  
+  ************************/
+#ifndef NDEBUG    
+  log(Debug) << "(RobotFilter) create extended Kalman filter" << endlog();
+#endif
+  _extendedKalmanFilter = new ExtendedKalmanFilter(&_priorCont);
+  
+  /************************
+  * Make system model: a constant level'th derivative model
+  * assumption: the position level components of the state are assumed to evolve independently
+  ************************/
+#ifndef NDEBUG    
+  log(Debug) << "(RobotFilter) make system model " << endlog();
+#endif
+  ColumnVector sysNoiseVector = ColumnVector(level+1);
+  sysNoiseVector = 0.0;
+  ColumnVector sysNoiseMean(_dimension);
+  sysNoiseMean = parameters.sysNoiseMean;
+  SymmetricMatrix sysNoiseMatrixOne = SymmetricMatrix(level +1);
+  sysNoiseMatrixOne = 0.0;
+  Matrix sysNoiseMatrixNonSymOne = Matrix(level+1,level+1);  
+  sysNoiseMatrixNonSymOne = 0.0;
+  for(int i =0 ; i<=level; i++) 
+  {
+    sysNoiseVector(i+1) = pow(_period,level-i+1)/double(factorial(level-i+1));
+  }
+  sysNoiseMatrixNonSymOne =  (sysNoiseVector* sysNoiseVector.transpose()) * parameters.sysNoiseCovariance ;
+  sysNoiseMatrixNonSymOne.convertToSymmetricMatrix(sysNoiseMatrixOne);
+  
+  SymmetricMatrix sysNoiseMatrix = SymmetricMatrix(_dimension);
+  sysNoiseMatrix = 0.0;
+  for(int i =0 ; i<=level; i++) 
+  {
+    for(int j =0 ; j<=level; j++)
+    {
+      for (int k=1 ; k <=posStateDimension; k++)
+      {
+        sysNoiseMatrix(i*posStateDimension+k,j*posStateDimension+k)=sysNoiseMatrixOne(i+1,j+1);
+      }
+    }
+  }
+  
+#ifndef NDEBUG    
+  log(Debug) << "(RobotFilter) create system_Uncertainty " << endlog();
+#endif
+  Gaussian system_Uncertainty(sysNoiseMean, sysNoiseMatrix);
+#ifndef NDEBUG    
+  log(Debug) << "(RobotFilter) create NonLinearAnalyticConditionalGaussianMobile " << endlog();
+  log(Debug) << "(RobotFilter) system_Uncertainty.ExpectedValueGet()"  << system_Uncertainty.ExpectedValueGet()<< endlog();
+  log(Debug) << "(RobotFilter) system_Uncertainty.CovarianceGet()"  << system_Uncertainty.CovarianceGet()<< endlog();
+#endif
+  _sysPdf = new NonLinearAnalyticConditionalGaussianMobile(system_Uncertainty);
+#ifndef NDEBUG    
+  log(Debug) << "(RobotFilter) create AnalyticSystemModelGaussianUncertainty " << endlog();
+#endif
+  _sysModel = new AnalyticSystemModelGaussianUncertainty(_sysPdf);
+  
+  _measVariance = parameters.measModelCovariance(1,1);
+  Gaussian measurement_Uncertainty(parameters.measNoiseMean, parameters.measModelCovariance);
+  _measPdf= new YoubotLaserPdf(measurement_Uncertainty);
+  _measModel = new AnalyticMeasurementModelGaussianUncertainty(_measPdf);
+
+  // Get estimated position and covariance
+  getEstimate();
+#ifndef NDEBUG    
+  log(Debug) << "_systemState " << _systemState << endlog();
+  log(Debug) << "_stateCovariance " << _stateCovariance << endlog();
+#endif
+  return true;
+}
+
+void RobotFilter::cleanup()
+{
+  delete _extendedKalmanFilter;
+  delete _sysModel;
+  delete _sysPdf;
+  delete _measModel;
+  delete _measPdf;
+  _extendedKalmanFilter = 0;
+  _sysModel = 0;
+  _sysPdf = 0;
+  _measModel = 0;
+  _measPdf = 0;
+}
+
+void RobotFilter::sysUpdate(double vx, double vy, double omega)
+{
+  _inputColumnVector(1) = vx;
+  _inputColumnVector(2) = vy;
+  _inputColumnVector(3) = omega;
+  _inputColumnVector(4) = _period;
+  // apply current input
+#ifndef NDEBUG    
+  log(Debug) << "(RobotFilter) update filter " << endlog();
+#endif
+  _extendedKalmanFilter->Update(_sysModel,_inputColumnVector);
+  getEstimate();
+}
+
+void RobotFilter::sysUpdateDelta(double dx, double dy, double dtheta)
+{
+  sysUpdate(dx / _period, dy / _period, dtheta / _period);
+}
+
+bool RobotFilter::measUpdate(double distance)
+{
+  _measurement(1)=distance;
+  if(_measurement.rows() != _measDimension )
+  {
+      log(Error) << "The size of the measurement does not fit the size of the measurement model matrix, measurement update not executed " << endlog();
+      log(Error) << "_measurement " << _measurement << endlog();
+      return false;
+  }
+#ifndef NDEBUG    
+  log(Debug) << "(RobotFilter) _measurement: " << _measurement << endlog();
+#endif
+  bool result = _extendedKalmanFilter->Update(_measModel,_measurement);
+  if(!result)
+  {
+#ifndef NDEBUG    
+    log(Error) << "(RobotFilter) updating Kalman Filter failed" << endlog();
+#endif
+  }
+  getEstimate();
+#ifndef NDEBUG    
+  log(Debug) << "_systemState " << _systemState << endlog();
+  log(Debug) << "_stateCovariance " << _stateCovariance << endlog();
+#endif
+  return result;
+}
+
+bool RobotFilter::restore(const ColumnVector& state, const SymmetricMatrix& covariance)
+{
+  if(!_extendedKalmanFilter || (int)state.rows() != _dimension || (int)covariance.rows() != _dimension)
+  {
+      log(Error) << "(RobotFilter) The size of the restored estimate does not fit the dimension of the state " << endlog();
+      return false;
+  }
+  _priorCont.ExpectedValueSet(state);
+  _priorCont.CovarianceSet(covariance);
+  delete _extendedKalmanFilter;
+  _extendedKalmanFilter = new ExtendedKalmanFilter(&_priorCont);
+  getEstimate();
+  return true;
+}
+
+double RobotFilter::nis(double distance) const
+{
+  _measPdf->ConditionalArgumentSet(0,_systemState);
+  double innovation = distance - _measPdf->ExpectedValueGet()(1);
+  Matrix df = _measPdf->dfGet(0);
+  double variance = _measVariance;
+  for(int i=1 ; i<=_dimension; i++)
+    for(int j=1 ; j<=_dimension; j++)
+      variance += df(1,i) * _stateCovariance(i,j) * df(1,j);
+  return innovation * innovation / variance;
+}
+
+void RobotFilter::getEstimate()
+{
+  _systemState = _extendedKalmanFilter->PostGet()->ExpectedValueGet();
+  _stateCovariance = _extendedKalmanFilter->PostGet()->CovarianceGet();
+}
+
+int RobotFilter::factorial (int num)
+{
+  if (num==1)
+      return 1;
+  return factorial(num-1)*num; // recursive call
+}
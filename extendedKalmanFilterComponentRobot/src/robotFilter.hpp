@@ -0,0 +1,197 @@
+/****************************************************************************** 
+* OROCOS Extended Kalman Filter component for estimating the position         *
+* off a mobile robot by measuring its distance to a wall at position x=0      * 
+*                                                                             *
+*                           (C) 2011 Tinne De Laet                            *
+*                       tinne.delaet@mech.kuleuven.be                         *                              
+*                    Department of Mechanical Engineering,                    *
+*                   Katholieke Universiteit Leuven, Belgium.                  *
+*                                                                             *
+*       You may redistribute this software and/or modify it under either the  *
+*       terms of the GNU Lesser General Public License version 2.1 (LGPLv2.1  *
+*       <http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>) or (at your *
+*       discretion) of the Modified BSD License:                              *
+*       Redistribution and use in source and binary forms, with or without    *
+*       modification, are permitted provided that the following conditions    *
+*       are met:                                                              *
+*       1. Redistributions of source code must retain the above copyright     *
+*       notice, this list of conditions and the following disclaimer.         *
+*       2. Redistributions in binary form must reproduce the above copyright  *
+*       notice, this list of conditions and the following disclaimer in the   *
+*       documentation and/or other materials provided with the distribution.  *
+*       3. The name of the author may not be used to endorse or promote       *
+*       products derived from this software without specific prior written    *
+*       permission.                                                           *
+*       THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR  *
+*       IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED        *
+*       WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE    *
+*       ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,*
+*       INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    *
+*       (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS       *
+*       OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) *
+*       HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,   *
+*       STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING *
+*       IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE    *
+*       POSSIBILITY OF SUCH DAMAGE.                                           *
+*                                                                             *
+*******************************************************************************/
+/* @Description: The filter of the ExtendedKalmanFilterComponentRobot: a BFL Extended Kalman Filter
+ * with a n'th order system model of the mobile robot and the distance to the wall as measurement.
+ * It has no Orocos interface, so the component and the offline replay (youbot_replay) run the
+ * same filter.
+ *
+ * @Author: Tinne De Laet
+ */
+#ifndef _ROBOT_FILTER_
+#define _ROBOT_FILTER_
+
+#include <bfl/wrappers/matrix/matrix_wrapper.h>
+#include <bfl/wrappers/matrix/vector_wrapper.h>
+
+#include <bfl/filter/extendedkalmanfilter.h>
+#include <bfl/model/analyticsystemmodel_gaussianuncertainty.h>
+#include <bfl/model/analyticmeasurementmodel_gaussianuncertainty.h>
+#include <bfl/pdf/analyticconditionalgaussian.h>
+#include <bfl/pdf/gaussian.h>
+
+#include "nonlinearanalyticconditionalgaussianmobile.h"
+
+using namespace BFL;
+
+/*!
+ * The parameters of the filter, the properties of the ExtendedKalmanFilterComponentRobot
+ */
+struct RobotFilterParameters
+{
+  /// The estimated initial state
+  ColumnVector            priorMean;
+  /// The diagonal values of the initial covariance
+  ColumnVector            priorCovariance;
+  /// The level of continuity of the system model
+  int                     level;
+  /// The mean of the white noise on the system model
+  double                  sysNoiseMean;
+  /// The covariance of the white noise on the system model
+  double                  sysNoiseCovariance;
+  /// The dimension of the state space, only at position level
+  int                     posStateDimension;
+  /// The dimension of the measurement space
+  int                     measDimension;
+  /// Covariance matrix of additive Gaussian noise on measurement model
+  SymmetricMatrix         measModelCovariance;
+  /// Mean of additive Gaussian noise on measurement model
+  ColumnVector            measNoiseMean;
+  /// Period at which the system model gets updated
+  double                  period;
+};
+
+class RobotFilter
+  {
+    public:
+      RobotFilter();
+      ~RobotFilter();
+
+      /*!
+       * \brief Build the filter
+       *
+       * Builds the prior, the system model and the measurement model from the
+       * parameters. A filter that was built before is deleted first.
+       * @return false if the sizes of the parameters do not fit the state
+       */
+      bool configure(const RobotFilterParameters& parameters);
+
+      /// Delete the filter
+      void cleanup();
+
+      /*!
+       * \brief Restart the filter from a known estimate
+       *
+       * Replaces the posterior of a configured filter, e.g. by the estimate of
+       * a checkpoint. The models are kept.
+       * @return false if the sizes do not fit the state
+       */
+      bool restore(const ColumnVector& state, const SymmetricMatrix& covariance);
+
+      /*!
+       * \brief System update over one period
+       * @param vx, vy, omega the input (velocity send to the robot)
+       */
+      void sysUpdate(double vx, double vy, double omega);
+
+      /*!
+       * \brief System update with a measured motion over one period
+       *
+       * Moves the estimate by a pose delta, e.g. pre-integrated odometry
+       * (OdometryIntegrator). The system model applied with the constant twist
+       * that covers the delta in one period moves the pose by exactly the
+       * delta, so its Jacobian is the Jacobian of the composition of the
+       * estimate with the delta.
+       * @param dx, dy, dtheta the motion, in the frame of the robot at the start of the period
+       */
+      void sysUpdateDelta(double dx, double dy, double dtheta);
+
+      /*!
+       * \brief Measurement update
+       * @param distance the measured distance to the wall
+       * @return false if the filter could not be updated
+       */
+      bool measUpdate(double distance);
+
+      /*!
+       * \brief Normalized innovation squared of a measurement
+       *
+       * The innovation of the measurement with respect to the current
+       * estimate, squared and divided by its predicted variance (H P H' + R).
+       * Call it before measUpdate(). With the right noise parameters it is
+       * chi-square distributed with one degree of freedom.
+       */
+      double nis(double distance) const;
+
+      /// The estimated state
+      const ColumnVector&     state() const { return _systemState; }
+      /// The covariance of the estimated state
+      const SymmetricMatrix&  covariance() const { return _stateCovariance; }
+      /// The dimension of the state space
+      int                     dimension() const { return _dimension; }
+
+    private:
+      /// The dimension of the state space
+      int                                                     _dimension;
+      /// The dimension of the measurement space
+      int                                                     _measDimension;
+      /// Period at which the system model gets updated
+      double                                                  _period;
+      /// Variance of the additive noise on the measurement
+      double                                                  _measVariance;
+      /// Gaussian to represent the initial state
+      Gaussian                                                _priorCont;
+      /// EKF to estimate the state
+      ExtendedKalmanFilter*                                   _extendedKalmanFilter;
+      /// The conditional Gaussian underlying the system model
+      NonLinearAnalyticConditionalGaussianMobile*             _sysPdf;
+      /// The system model
+      AnalyticSystemModelGaussianUncertainty*                 _sysModel;
+      /// The conditional Gaussian underlying the measurement model
+      AnalyticConditionalGaussian*                            _measPdf;
+      /// The analytic measurement model with addtive Gaussian noise
+      AnalyticMeasurementModelGaussianUncertainty*            _measModel;
+      /// The system state: (Fx,Fy,Fz,wz,wy,wz) for level = 0, ...
+      ColumnVector                                            _systemState;
+      /// The system state covariance matrix
+      SymmetricMatrix                                         _stateCovariance;
+      /// Measurement as a ColumnVector
+      ColumnVector                                            _measurement;
+      /// helper variable to store input
+      ColumnVector                                            _inputColumnVector;
+
+      /*!
+      * helper function calculating the factorial of an int
+      * @param the integer of which to calculate the factorial
+      * @return the factorial
+      */
+      int factorial(int);
+
+      /// Take the estimate from the posterior of the filter
+      void getEstimate();
+  };
+#endif // _ROBOT_FILTER_
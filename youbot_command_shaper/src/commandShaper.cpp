@@ -0,0 +1,161 @@
+/******************************************************************************
+*                    OROCOS Youbot command shaper component                   *
+*                                                                             *
+*                         (C) 2011 Steven Bellens                             *
+*                     steven.bellens@mech.kuleuven.be                         *
+*                    Department of Mechanical Engineering,                    *
+*                   Katholieke Universiteit Leuven, Belgium.                  *
+*                                                                             *
+*       You may redistribute this software and/or modify it under either the  *
+*       terms of the GNU Lesser General Public License version 2.1 (LGPLv2.1  *
+*       <http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>) or (at your *
+*       discretion) of the Modified BSD License:                              *
+*       Redistribution and use in source and binary forms, with or without    *
+*       modification, are permitted provided that the following conditions    *
+*       are met:                                                              *
+*       1. Redistributions of source code must retain the above copyright     *
+*       notice, this list of conditions and the following disclaimer.         *
+*       2. Redistributions in binary form must reproduce the above copyright  *
+*       notice, this list of conditions and the following disclaimer in the   *
+*       documentation and/or other materials provided with the distribution.  *
+*       3. The name of the author may not be used to endorse or promote       *
+*       products derived from this software without specific prior written    *
+*       permission.                                                           *
+*       THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR  *
+*       IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED        *
+*       WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE    *
+*       ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,*
+*       INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    *
+*       (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS       *
+*       OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) *
+*       HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,   *
+*       STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING *
+*       IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE    *
+*       POSSIBILITY OF SUCH DAMAGE.                                           *
+*                                                                             *
+*******************************************************************************/
+#include "commandShaper.hpp"
+
+#include <math.h>
+#include <algorithm>
+
+// This macro is used whenever a new Orocos component is generated. Here we
+// generate a Youbot CommandShaper component.
+ORO_CREATE_COMPONENT(youbot::CommandShaper)
+
+namespace youbot{
+  CommandShaper::CommandShaper(std::string name) : TaskContext(name,PreOperational)
+  ,m_max_acceleration(3,1.0)
+  ,m_max_jerk(3,10.0)
+  ,m_deadband(3,0.0)
+  ,m_command_period(0.01)
+  ,m_command_timeout(0.2)
+  ,m_cmd_stamp(0)
+  ,m_last_update(0)
+  ,m_update_probe(0)
+  {
+    /// Add the input and output ports to the Orocos interface
+    this->addPort("cmd_in",cmd_in_port).doc("Velocity command");
+    this->addPort("cmd_out",cmd_out_port).doc("Shaped velocity command");
+    /// Add property variables to the Orocos interface
+    this->addProperty("max_acceleration",m_max_acceleration).doc("Maximum acceleration [x y yaw]");
+    this->addProperty("max_jerk",m_max_jerk).doc("Maximum jerk [x y yaw]");
+    this->addProperty("deadband",m_deadband).doc("Commands smaller than this are sent as zero [x y yaw]");
+    this->addProperty("command_period",m_command_period).doc("The incoming commands are interpolated over this period");
+    this->addProperty("command_timeout",m_command_timeout).doc("Stop the YouBot when no command arrived for this long");
+  }
+
+  CommandShaper::~CommandShaper(){}
+
+  bool CommandShaper::configureHook(){
+    if(m_max_acceleration.size() != 3 || m_max_jerk.size() != 3 || m_deadband.size() != 3){
+      log(Error) << "(CommandShaper) The limits need 3 elements [x y yaw]" << endlog();
+      return false;
+    }
+    for(unsigned int i = 0; i < 3; i++){
+      if(m_max_acceleration[i] <= 0.0 || m_max_jerk[i] <= 0.0 || m_deadband[i] < 0.0){
+        log(Error) << "(CommandShaper) The acceleration and jerk limits must be positive" << endlog();
+        return false;
+      }
+    }
+    if(m_command_period < 0.0 || m_command_timeout <= 0.0){
+      log(Error) << "(CommandShaper) The command period and timeout must be positive" << endlog();
+      return false;
+    }
+    cmd_out_port.setDataSample(m_cmd_out);
+    m_update_probe = HookStatsService::probe(this, "updateHook", this->getPeriod());
+    return true;
+  }
+
+  bool CommandShaper::startHook(){
+    for(unsigned int i = 0; i < 3; i++){
+      m_from[i] = m_to[i] = 0.0;
+      m_velocity[i] = m_acceleration[i] = 0.0;
+      m_target[i] = 0.0;
+    }
+    m_cmd_out = geometry_msgs::Twist();
+    m_last_update = RTT::os::TimeService::Instance()->getTicks();
+    m_cmd_stamp = m_last_update;
+    return true;
+  }
+
+  void CommandShaper::updateHook(){
+    HookTimer timer(m_update_probe);
+    RTT::os::TimeService* time_service = RTT::os::TimeService::Instance();
+    double dt = time_service->secondsSince(m_last_update);
+    m_last_update = time_service->getTicks();
+    /// A new command: interpolate from the current target to the new command
+    if(cmd_in_port.read(m_cmd_in) == NewData){
+      double since = time_service->secondsSince(m_cmd_stamp);
+      double f = (m_command_period > 0.0) ? std::min(1.0, since / m_command_period) : 1.0;
+      const double cmd[3] = {m_cmd_in.linear.x, m_cmd_in.linear.y, m_cmd_in.angular.z};
+      for(unsigned int i = 0; i < 3; i++){
+        m_from[i] = m_from[i] + f * (m_to[i] - m_from[i]);
+        m_to[i] = (fabs(cmd[i]) < m_deadband[i]) ? 0.0 : cmd[i];
+      }
+      m_cmd_stamp = m_last_update;
+    }
+    double since = time_service->secondsSince(m_cmd_stamp);
+    bool timeout = since > m_command_timeout;
+    double f = (m_command_period > 0.0) ? std::min(1.0, since / m_command_period) : 1.0;
+    for(unsigned int i = 0; i < 3; i++){
+      double target = timeout ? 0.0 : m_from[i] + f * (m_to[i] - m_from[i]);
+      shape(i, target, dt);
+    }
+    m_cmd_out.linear.x = m_velocity[0];
+    m_cmd_out.linear.y = m_velocity[1];
+    m_cmd_out.angular.z = m_velocity[2];
+    cmd_out_port.write(m_cmd_out);
+  }
+
+  void CommandShaper::shape(unsigned int axis, double target, double dt){
+    double& v = m_velocity[axis];
+    double& a = m_acceleration[axis];
+    /// Feed forward the slope of the (interpolated) target, a jump of the target counts as the maximum slope
+    double slope = (dt > 0.0) ? (target - m_target[axis]) / dt : 0.0;
+    slope = std::max(-m_max_acceleration[axis], std::min(m_max_acceleration[axis], slope));
+    /// Error at the time of the previous update, the slope covers the motion of the target since then
+    double error = m_target[axis] - v;
+    m_target[axis] = target;
+    /// The acceleration that still allows to ramp down to the target slope at the target
+    double desired = sqrt(2.0 * m_max_jerk[axis] * fabs(error));
+    if(error < 0.0) desired = -desired;
+    desired = std::max(-m_max_acceleration[axis], std::min(m_max_acceleration[axis], slope + desired));
+    double max_change = m_max_jerk[axis] * dt;
+    a += std::max(-max_change, std::min(max_change, desired - a));
+    v += a * dt;
+    /// Do not overshoot the target, the acceleration converges to the slope with the jerk limit in the next updates
+    if((target - v) * (target - v + a * dt) < 0.0){
+      v = target;
+    }
+  }
+
+  void CommandShaper::stopHook(){
+    /// Leave the YouBot standing still
+    m_cmd_out = geometry_msgs::Twist();
+    cmd_out_port.write(m_cmd_out);
+  }
+
+  void CommandShaper::cleanupHook(){
+  }
+}
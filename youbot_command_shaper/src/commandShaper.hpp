@@ -0,0 +1,142 @@
+/******************************************************************************
+*                    OROCOS Youbot command shaper component                   *
+*                                                                             *
+*                         (C) 2011 Steven Bellens                             *
+*                     steven.bellens@mech.kuleuven.be                         *
+*                    Department of Mechanical Engineering,                    *
+*                   Katholieke Universiteit Leuven, Belgium.                  *
+*                                                                             *
+*       You may redistribute this software and/or modify it under either the  *
+*       terms of the GNU Lesser General Public License version 2.1 (LGPLv2.1  *
+*       <http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>) or (at your *
+*       discretion) of the Modified BSD License:                              *
+*       Redistribution and use in source and binary forms, with or without    *
+*       modification, are permitted provided that the following conditions    *
+*       are met:                                                              *
+*       1. Redistributions of source code must retain the above copyright     *
+*       notice, this list of conditions and the following disclaimer.         *
+*       2. Redistributions in binary form must reproduce the above copyright  *
+*       notice, this list of conditions and the following disclaimer in the   *
+*       documentation and/or other materials provided with the distribution.  *
+*       3. The name of the author may not be used to endorse or promote       *
+*       products derived from this software without specific prior written    *
+*       permission.                                                           *
+*       THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR  *
+*       IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED        *
+*       WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE    *
+*       ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,*
+*       INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    *
+*       (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS       *
+*       OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) *
+*       HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,   *
+*       STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING *
+*       IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE    *
+*       POSSIBILITY OF SUCH DAMAGE.                                           *
+*                                                                             *
+*******************************************************************************/
+/* @Description:
+ * @brief Youbot command shaper - OROCOS component
+ * @Author: Steven Bellens
+ */
+
+ /*
+  * The YouBot CommandShaper component sits between the Controller (100Hz)
+  * and the YouBot base (1kHz). It interpolates the incoming velocity
+  * commands over the command period, suppresses commands within a deadband,
+  * and limits the acceleration and jerk of the velocity that is sent to the
+  * base on each axis [x y yaw]. When no command arrives within the command
+  * timeout, the YouBot is brought to a standstill with the same limits.
+  * The component does not allocate memory after configuration, so it can
+  * run at the rate and priority of the YouBot master component.
+ */
+
+#include <rtt/TaskContext.hpp>
+#include <rtt/Port.hpp>
+#include <rtt/Property.hpp>
+#include <rtt/Component.hpp>
+#include <rtt/os/TimeService.hpp>
+
+#include <geometry_msgs/Twist.h>
+
+#include <hookStatsService.hpp>
+
+namespace youbot{
+
+  using namespace std;
+  using namespace RTT;
+
+  class CommandShaper : public TaskContext{
+    protected:
+      /// @name Ports
+      //@{
+      /// Velocity command - from the Controller component
+      InputPort<geometry_msgs::Twist> cmd_in_port;
+      /// Shaped velocity command - for the YouBot master component
+      OutputPort<geometry_msgs::Twist> cmd_out_port;
+      //@}
+      /// @name Properties
+      //@{
+      /// Maximum acceleration [x y yaw]
+      std::vector<double> m_max_acceleration;
+      /// Maximum jerk [x y yaw]
+      std::vector<double> m_max_jerk;
+      /// Deadband - commands smaller than this are sent as zero [x y yaw]
+      std::vector<double> m_deadband;
+      /// Command period - the incoming commands are interpolated over this period
+      double m_command_period;
+      /// Command timeout - stop the YouBot when no command arrived for this long
+      double m_command_timeout;
+      //@}
+
+    public:
+      /**
+       * \brief Constructor
+       *
+       * Constructor building a Youbot command shaper component
+       * \param name The component name
+       */
+      CommandShaper(std::string name);
+      //! Destructor
+      ~CommandShaper();
+
+      /// @name Public methods
+      //@{
+      bool configureHook();
+      bool startHook();
+      void updateHook();
+      void stopHook();
+      void cleanupHook();
+      //@}
+
+    private:
+      /// Last received command
+      geometry_msgs::Twist m_cmd_in;
+      /// Shaped command
+      geometry_msgs::Twist m_cmd_out;
+      /// Interpolation: the previous and the last command, per axis
+      double m_from[3];
+      double m_to[3];
+      /// Shaped velocity and acceleration, per axis
+      double m_velocity[3];
+      double m_acceleration[3];
+      /// Target velocity of the previous update, per axis
+      double m_target[3];
+      /// Arrival time of the last command
+      RTT::os::TimeService::ticks m_cmd_stamp;
+      /// Time of the previous update
+      RTT::os::TimeService::ticks m_last_update;
+      /// Timing of updateHook(), 0 without the hookstats service
+      HookProbe* m_update_probe;
+
+      /**
+       * \brief Jerk limited tracking of a velocity on one axis
+       *
+       * Chooses the acceleration that reaches the target velocity as fast
+       * as possible, while it can still return to the slope of the target
+       * with the jerk limit when the target is reached. The acceleration is
+       * never changed faster than the jerk limit, also not when the target
+       * is crossed.
+       */
+      void shape(unsigned int axis, double target, double dt);
+  };
+}
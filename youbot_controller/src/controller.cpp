@@ -36,6 +36,8 @@
 *******************************************************************************/
 #include "controller.hpp"
 
+#include <algorithm>
+
 // This macro is used whenever a new Orocos component is generated. Here we
 // generate a Youbot Controller component.
 ORO_CREATE_COMPONENT(youbot::Controller)
@@ -44,21 +46,236 @@ namespace youbot{
   Controller::Controller(std::string name) : TaskContext(name,PreOperational)
   ,m_goal_tolerance(3,0.0)
   ,m_velocity(3,0.0)
+  ,m_event_triggered(false)
+  ,m_watchdog_timer_id(2)
+  ,m_watchdog_period(0.05)
+  ,m_control_mode("threshold")
+  ,m_max_velocity(3,0.0)
+  ,m_max_acceleration(3,0.0)
+  ,m_max_jerk(3,0.0)
+  ,m_position_gain(3,0.0)
+  ,m_path_capacity(1000)
+  ,m_blend_radius(0.1)
+  ,m_lookahead_distance(0.3)
+  ,m_search_window(50)
+  ,m_mpc_horizon(30)
+  ,m_mpc_step(0.0)
+  ,m_mpc_iterations(20)
+  ,m_mpc_budget(0.004)
+  ,m_mpc_gradient_step(0.5)
+  ,m_mpc_state_weight(3,10.0)
+  ,m_mpc_input_weight(3,0.01)
+  ,m_mpc_rate_weight(3,0.1)
+  ,m_mpc_overruns(0)
+  ,m_latency_compensation(false)
+  ,m_pipeline_latency(0.03)
+  ,m_command_history_size(50)
+  ,m_obstacle_avoidance(false)
+  ,m_dwa_samples(7)
+  ,m_dwa_window(3,0.1)
+  ,m_dwa_horizon(1.0)
+  ,m_dwa_steps(10)
+  ,m_clearance_weight(0.05)
+  ,m_robot_radius(0.35)
+  ,m_laser_pose(3,0.0)
+  ,m_max_scan_points(512)
+  ,m_goal_mailbox(GoalSet())
+  ,m_goal_seq(0)
+  ,m_limits_seq(0)
   ,m_goal_reached(false)
+  ,m_goal_reached_published(false)
+  ,m_goal_changed(false)
+  ,m_pose_since_watchdog(false)
+  ,m_mode(THRESHOLD)
+  ,m_replan(false)
+  ,m_trajectory_stamp(0)
+  ,m_profile_time(0.0)
+  ,m_time_rate(1.0)
+  ,m_blend_omega(0.0)
+  ,m_blend_time(0.0)
+  ,m_path_queue(0)
+  ,m_waypoint_active(false)
+  ,m_path_progress(0)
+  ,m_last_step(0)
+  ,m_path_index(0)
+  ,m_command_head(0)
+  ,m_command_count(0)
+  ,m_pose_stamp(0)
+  ,m_scan_received(false)
+  ,m_trace(0)
+  ,m_traced(false)
+  ,m_update_probe(0)
   {
     /// Add the input and output ports to the Orocos interface
-    this->addPort("current_pose",current_pose_port).doc("Youbot pose");
-    this->addOperation("moveTo",&Controller::moveTo,this,RTT::OwnThread).doc("Move to goal pose").arg("X","Goal X position").arg("Y","Goal Y position").arg("Theta","Goal Theta orientation");
+    /// Both the pose and the watchdog port are event ports: with a non-periodic activity, every new
+    /// estimate wakes up the controller
+    this->addEventPort("current_pose",current_pose_port).doc("Youbot pose - triggers updateHook() in event triggered mode");
+    this->addEventPort("TimerId",timer_port).doc("Watchdog timer - triggers updateHook() in event triggered mode");
+    this->addOperation("moveTo",&Controller::moveTo,this,RTT::ClientThread).doc("Move to goal pose").arg("X","Goal X position").arg("Y","Goal Y position").arg("Theta","Goal Theta orientation");
     this->addPort("ctrl",ctrl_port).doc("Youbot control input");
+    this->addPort("scan",scan_port).doc("Laser scan for the obstacle avoidance");
+    this->addPort("path",path_port).doc("Path to track in pursuit and mpc mode [x0 y0 theta0 x1 y1 theta1 ...]");
+    this->addPort("path_progress",path_progress_port).doc("Number of waypoints of the path that have been reached");
+    this->addPort("goal_reached",goal_reached_port).doc("Written whenever the YouBot reaches its goal or leaves it for a new one");
+    this->addOperation("setGoalTolerance",&Controller::setGoalTolerance,this,RTT::ClientThread).doc("Set the goal tolerance").arg("X","X tolerance").arg("Y","Y tolerance").arg("Theta","Theta tolerance");
+    this->addOperation("setVelocityLimits",&Controller::setVelocityLimits,this,RTT::ClientThread).doc("Set the control velocity ('threshold' mode) or maximum velocity (other modes)").arg("X","X velocity").arg("Y","Y velocity").arg("Theta","Theta velocity");
+    this->addOperation("setSpeedScale",&Controller::setSpeedScale,this,RTT::ClientThread).doc("Scale the velocity limits, used by the supervisor to slow down in overload (1.0: nominal)").arg("Scale","Scale in ]0, 1]");
+    this->addOperation("addWaypoint",&Controller::addWaypoint,this,RTT::ClientThread).doc("Add a waypoint to the path").arg("X","Waypoint X position").arg("Y","Waypoint Y position").arg("Theta","Waypoint Theta orientation");
+    this->addOperation("addPath",&Controller::addPath,this,RTT::ClientThread).doc("Add a path of waypoints").arg("X","Waypoint X positions").arg("Y","Waypoint Y positions").arg("Theta","Waypoint Theta orientations");
+    this->addOperation("clearPath",&Controller::clearPath,this,RTT::OwnThread).doc("Remove all waypoints from the path");
+    this->addOperation("setPath",&Controller::setPath,this,RTT::OwnThread).doc("Set the path to track in pursuit mode").arg("X","Path X positions").arg("Y","Path Y positions").arg("Theta","Path Theta orientations");
     /// Add property variables to the Orocos interface
     this->addProperty("goal_tolerance",m_goal_tolerance).doc("Tolerance on goal pose [x y yaw]");
     this->addProperty("control_velocity",m_velocity).doc("Control velocity");
-    this->addProperty("goal_reached",m_goal_reached).doc("Goal reached");
+    this->addProperty("event_triggered",m_event_triggered).doc("Only run the control law when a new pose estimate arrives (use a non-periodic activity)");
+    this->addProperty("watchdog_timer_id",m_watchdog_timer_id).doc("Timer id of the watchdog in event triggered mode");
+    this->addProperty("watchdog_period",m_watchdog_period).doc("Fallback period of the control law in event triggered mode");
+    this->addProperty("control_mode",m_control_mode).doc("Control mode: 'threshold', 'trajectory', 'path', 'pursuit' or 'mpc'");
+    this->addProperty("max_velocity",m_max_velocity).doc("Maximum trajectory velocity [x y yaw]");
+    this->addProperty("max_acceleration",m_max_acceleration).doc("Maximum trajectory acceleration [x y yaw]");
+    this->addProperty("max_jerk",m_max_jerk).doc("Maximum trajectory jerk [x y yaw]");
+    this->addProperty("position_gain",m_position_gain).doc("Feedback gain on the trajectory tracking error [x y yaw]");
+    this->addProperty("path_capacity",m_path_capacity).doc("Maximum number of waypoints in the path queue");
+    this->addProperty("blend_radius",m_blend_radius).doc("Switch to the next waypoint when the YouBot is this close to the current one");
+    this->addProperty("lookahead_distance",m_lookahead_distance).doc("Pursuit mode steers towards the path point this far ahead along the path");
+    this->addProperty("search_window",m_search_window).doc("Number of path points searched for the closest point in each cycle");
+    this->addProperty("mpc_horizon",m_mpc_horizon).doc("Number of steps of the MPC prediction horizon");
+    this->addProperty("mpc_step",m_mpc_step).doc("Duration of one step of the MPC prediction horizon, 0 uses the period of the activity");
+    this->addProperty("mpc_iterations",m_mpc_iterations).doc("Number of MPC solver iterations per control step");
+    this->addProperty("mpc_budget",m_mpc_budget).doc("Time the MPC solver may use per control step");
+    this->addProperty("mpc_gradient_step",m_mpc_gradient_step).doc("Step size of the MPC solver iterations");
+    this->addProperty("mpc_state_weight",m_mpc_state_weight).doc("Weight on the MPC tracking error [x y yaw]");
+    this->addProperty("mpc_input_weight",m_mpc_input_weight).doc("Weight on the MPC input [x y yaw]");
+    this->addProperty("mpc_rate_weight",m_mpc_rate_weight).doc("Weight on the MPC input change [x y yaw]");
+    this->addProperty("mpc_overruns",m_mpc_overruns).doc("Number of control steps in which the MPC solver exceeded its budget");
+    this->addProperty("latency_compensation",m_latency_compensation).doc("Predict the pose forward over the pipeline latency with the sent commands");
+    this->addProperty("pipeline_latency",m_pipeline_latency).doc("Age of a pose estimate when it arrives");
+    this->addProperty("command_history",m_command_history_size).doc("Number of sent commands remembered for the latency compensation");
+    this->addProperty("obstacle_avoidance",m_obstacle_avoidance).doc("Replace the control signal by the closest velocity that does not collide with the laser scan");
+    this->addProperty("dwa_samples",m_dwa_samples).doc("Number of velocity samples on each axis of the dynamic window");
+    this->addProperty("dwa_window",m_dwa_window).doc("Half width of the dynamic window around the current velocity [x y yaw]");
+    this->addProperty("dwa_horizon",m_dwa_horizon).doc("Duration of the rollouts of the velocity samples");
+    this->addProperty("dwa_steps",m_dwa_steps).doc("Number of steps of the rollouts");
+    this->addProperty("clearance_weight",m_clearance_weight).doc("Weight on the inverse of the clearance to the obstacles");
+    this->addProperty("robot_radius",m_robot_radius).doc("Radius of the YouBot");
+    this->addProperty("laser_pose",m_laser_pose).doc("Pose of the laser in the YouBot frame [x y yaw]");
+    this->addProperty("max_scan_points",m_max_scan_points).doc("Maximum number of scan points used by the obstacle avoidance");
   }
 
   Controller::~Controller(){}
 
   bool Controller::configureHook(){
+    if(m_goal_tolerance.size() != 3 || m_velocity.size() != 3){
+      log(Error) << "(Controller) The goal tolerance and control velocity need 3 elements [x y yaw]" << endlog();
+      return false;
+    }
+    if(m_event_triggered && m_watchdog_period <= 0.0){
+      log(Error) << "(Controller) The watchdog period must be positive in event triggered mode" << endlog();
+      return false;
+    }
+    if(m_control_mode == "threshold"){
+      m_mode = THRESHOLD;
+    }
+    else if(m_control_mode == "trajectory" || m_control_mode == "path" || m_control_mode == "pursuit" || m_control_mode == "mpc"){
+      if(m_control_mode == "trajectory") m_mode = TRAJECTORY;
+      else if(m_control_mode == "path") m_mode = PATH;
+      else if(m_control_mode == "pursuit") m_mode = PURSUIT;
+      else m_mode = MPC;
+      if(m_max_velocity.size() != 3 || m_max_acceleration.size() != 3 || m_max_jerk.size() != 3 || m_position_gain.size() != 3){
+        log(Error) << "(Controller) The trajectory limits and gains need 3 elements [x y yaw]" << endlog();
+        return false;
+      }
+      for(unsigned int i = 0; i < 3; i++){
+        if(m_max_velocity[i] <= 0.0 || m_max_acceleration[i] <= 0.0 || m_max_jerk[i] <= 0.0){
+          log(Error) << "(Controller) The trajectory limits must be positive" << endlog();
+          return false;
+        }
+      }
+    }
+    else{
+      log(Error) << "(Controller) Unknown control mode " << m_control_mode << endlog();
+      return false;
+    }
+    if(m_latency_compensation && (m_pipeline_latency < 0.0 || m_command_history_size <= 0)){
+      log(Error) << "(Controller) The pipeline latency and command history must be positive" << endlog();
+      return false;
+    }
+    if(m_obstacle_avoidance){
+      if(m_max_velocity.size() != 3 || m_dwa_window.size() != 3 || m_laser_pose.size() != 3){
+        log(Error) << "(Controller) The maximum velocity, dynamic window and laser pose need 3 elements [x y yaw]" << endlog();
+        return false;
+      }
+      if(m_max_velocity[0] <= 0.0 || m_max_velocity[1] <= 0.0 || m_max_velocity[2] <= 0.0 || m_dwa_samples <= 0 ||
+        m_dwa_horizon <= 0.0 || m_dwa_steps <= 0 || m_robot_radius <= 0.0 || m_max_scan_points <= 0){
+        log(Error) << "(Controller) The maximum velocity and the obstacle avoidance parameters must be positive" << endlog();
+        return false;
+      }
+      /// Allocate the velocity samples and the scan points
+      m_dynamic_window.resize(std::vector<int>(3, m_dwa_samples), m_max_scan_points);
+    }
+    if(m_path_capacity <= 0 || m_search_window <= 0){
+      log(Error) << "(Controller) The path capacity and search window must be positive" << endlog();
+      return false;
+    }
+    /// Allocate the path queue, so that adding waypoints does not allocate memory
+    delete m_path_queue;
+    m_path_queue = new RTT::base::BufferLockFree<geometry_msgs::Pose2D>(m_path_capacity, geometry_msgs::Pose2D());
+    m_waypoint_active = false;
+    m_path_progress = 0;
+    path_progress_port.setDataSample(m_path_progress);
+    /// Reserve the pursuit path storage
+    m_path_x.clear();
+    m_path_y.clear();
+    m_path_theta.clear();
+    m_path_s.clear();
+    m_path_x.reserve(m_path_capacity);
+    m_path_y.reserve(m_path_capacity);
+    m_path_theta.reserve(m_path_capacity);
+    m_path_s.reserve(m_path_capacity);
+    m_path_sample.reserve(3 * m_path_capacity);
+    m_path_index = 0;
+    /// Allocate the command history
+    m_command_history.assign(m_command_history_size, Command());
+    m_command_head = 0;
+    m_command_count = 0;
+    if(m_mode == MPC){
+      double step = m_mpc_step;
+      if(step <= 0.0) step = this->getPeriod();
+      if(m_mpc_horizon <= 0 || m_mpc_iterations <= 0 || step <= 0.0 || m_mpc_budget <= 0.0 || m_mpc_gradient_step <= 0.0){
+        log(Error) << "(Controller) The MPC horizon, step, iterations, budget and gradient step must be positive" << endlog();
+        return false;
+      }
+      /// A budget that does not fit in the control period would overrun every cycle
+      if(this->getActivity() && this->getActivity()->isPeriodic() && m_mpc_budget >= this->getPeriod()){
+        log(Error) << "(Controller) The MPC budget (" << m_mpc_budget << " s) must be shorter than the control period (" << this->getPeriod() << " s)" << endlog();
+        return false;
+      }
+      if(m_mpc_state_weight.size() != 3 || m_mpc_input_weight.size() != 3 || m_mpc_rate_weight.size() != 3){
+        log(Error) << "(Controller) The MPC weights need 3 elements [x y yaw]" << endlog();
+        return false;
+      }
+      /// Allocate the solver workspaces, solving does not allocate memory
+      /// Without a periodic activity the controller runs about once per MPC step
+      double period = (this->getPeriod() > 0.0) ? this->getPeriod() : step;
+      m_mpc.resize(m_mpc_horizon, step, period);
+      m_mpc.setParameters(m_mpc_state_weight, m_mpc_input_weight, m_mpc_rate_weight, m_max_velocity, m_max_acceleration, m_mpc_gradient_step);
+      m_mpc_overruns = 0;
+    }
+    /// Initialise the goal mailbox with the configured tolerance and velocity limits
+    GoalSet goal_set;
+    m_goal_mailbox.Get(goal_set);
+    for(unsigned int i = 0; i < 3; i++){
+      goal_set.tolerance[i] = m_goal_tolerance[i];
+      goal_set.velocity[i] = (m_mode == THRESHOLD) ? m_velocity[i] : m_max_velocity[i];
+    }
+    goal_set.speed_scale = 1.0;
+    m_goal_mailbox.Set(goal_set);
+    m_goal_seq = goal_set.goal_seq;
+    m_limits_seq = goal_set.limits_seq;
+    m_goal_reached = false;
+    m_goal_reached_published = false;
+    goal_reached_port.setDataSample(m_goal_reached);
+    m_update_probe = HookStatsService::probe(this, "updateHook", this->getPeriod());
     return true;
   }
 
@@ -68,19 +285,171 @@ namespace youbot{
       return false;
     }
     else{
-      m_goal_pose.x = m_current_pose[0];
-      m_goal_pose.y = m_current_pose[1];
-      m_goal_pose.theta = m_current_pose[2];
+      double goal[3] = {m_current_pose[0], m_current_pose[1], m_current_pose[2]};
+      writeGoalSet(goal, 0, 0, 0);
+      applyGoalSet();
+      m_pose_since_watchdog = false;
+      m_waypoint_active = false;
+      m_path_velocity = KDL::Vector::Zero();
+      m_ctrl = geometry_msgs::Twist();
+      m_mpc.reset();
+      m_command_count = 0;
+      m_scan_received = false;
+      m_traced = false;
+      m_sent_velocity[0] = m_sent_velocity[1] = m_sent_velocity[2] = 0.0;
+      for(unsigned int i = 0; i < 3; i++) m_plan_velocity[i] = m_max_velocity[i];
+      m_profile_time = 0.0;
+      m_time_rate = 1.0;
+      m_last_step = RTT::os::TimeService::Instance()->getTicks();
+      m_pose_stamp = m_last_step;
       return true;
     }
   }
 
   void Controller::updateHook(){
-    m_goal_reached = false;
+    HookTimer timer(m_update_probe);
+    /// Take over new goals and limits
+    applyGoalSet();
+    if(path_port.read(m_path_sample) == NewData) readPath();
     /// Read in the current pose
-    current_pose_port.read(m_current_pose);
+    bool new_pose = (current_pose_port.read(m_current_pose) == NewData);
+    if(new_pose){
+      m_pose_stamp = RTT::os::TimeService::Instance()->getTicks();
+      if(LatencyTracer::Instance().follow(LatencyTracer::ESTIMATE, LatencyTracer::CONTROL, m_trace)) m_traced = true;
+    }
+    if(!controlStepRequired(new_pose)) return;
+    m_goal_reached = false;
+    if(m_latency_compensation) predictPose();
     /// Calculate the pose difference
     calcPoseDiff();
+    switch(m_mode){
+      case TRAJECTORY:
+        if(m_replan) planTrajectory();
+        trajectoryControl();
+        break;
+      case PATH:
+        pathControl();
+        break;
+      case PURSUIT:
+        pursuitControl();
+        break;
+      case MPC:
+        mpcControl();
+        break;
+      default:
+        thresholdControl();
+    }
+    if(m_obstacle_avoidance) avoidObstacles();
+    // Write the control values to the ctrl output port
+    if(m_traced){
+      LatencyTracer::Instance().mark(LatencyTracer::COMMAND, m_trace);
+      m_traced = false;
+    }
+    ctrl_port.write(m_ctrl);
+    recordCommand();
+    /// Publish arrival at (or departure from) the goal
+    if(m_goal_reached != m_goal_reached_published){
+      m_goal_reached_published = m_goal_reached;
+      goal_reached_port.write(m_goal_reached);
+    }
+  }
+
+  void Controller::applyGoalSet(){
+    m_goal_mailbox.Get(m_goal_set);
+    if(m_goal_set.limits_seq != m_limits_seq){
+      m_limits_seq = m_goal_set.limits_seq;
+      for(unsigned int i = 0; i < 3; i++){
+        m_goal_tolerance[i] = m_goal_set.tolerance[i];
+        if(m_mode == THRESHOLD) m_velocity[i] = m_goal_set.velocity[i] * m_goal_set.speed_scale;
+        else m_max_velocity[i] = m_goal_set.velocity[i] * m_goal_set.speed_scale;
+      }
+      if(m_mode == MPC){
+        m_mpc.setParameters(m_mpc_state_weight, m_mpc_input_weight, m_mpc_rate_weight, m_max_velocity, m_max_acceleration, m_mpc_gradient_step);
+      }
+    }
+    if(m_goal_set.goal_seq != m_goal_seq){
+      m_goal_seq = m_goal_set.goal_seq;
+      m_goal_pose.x = m_goal_set.goal[0];
+      m_goal_pose.y = m_goal_set.goal[1];
+      m_goal_pose.theta = m_goal_set.goal[2];
+      m_goal_changed = true;
+      m_replan = true;
+    }
+  }
+
+  void Controller::writeGoalSet(const double* goal, const double* tolerance, const double* velocity, const double* speed_scale){
+    RTT::os::MutexLock lock(m_goal_mutex);
+    GoalSet goal_set;
+    m_goal_mailbox.Get(goal_set);
+    for(unsigned int i = 0; i < 3; i++){
+      if(goal) goal_set.goal[i] = goal[i];
+      if(tolerance) goal_set.tolerance[i] = tolerance[i];
+      if(velocity) goal_set.velocity[i] = velocity[i];
+    }
+    if(speed_scale) goal_set.speed_scale = *speed_scale;
+    if(goal) goal_set.goal_seq++;
+    if(tolerance || velocity || speed_scale) goal_set.limits_seq++;
+    m_goal_mailbox.Set(goal_set);
+  }
+
+  void Controller::predictPose(){
+    RTT::os::TimeService::ticks now = RTT::os::TimeService::Instance()->getTicks();
+    /// The estimate describes the YouBot at this time
+    RTT::os::TimeService::ticks from = m_pose_stamp - RTT::os::TimeService::nsecs2ticks((RTT::os::TimeService::nsecs)(m_pipeline_latency * 1e9));
+    unsigned int size = m_command_history.size();
+    unsigned int oldest = (m_command_head + size - m_command_count) % size;
+    for(unsigned int k = 0; k < m_command_count; k++){
+      const Command& command = m_command_history[(oldest + k) % size];
+      /// Each command is applied until the next one was sent
+      RTT::os::TimeService::ticks end = now;
+      if(k + 1 < m_command_count) end = m_command_history[(oldest + k + 1) % size].stamp;
+      RTT::os::TimeService::ticks begin = max(command.stamp, from);
+      if(end <= begin) continue;
+      double dt = RTT::os::TimeService::ticks2nsecs(end - begin) * 1e-9;
+      /// Motion model of the estimator
+      double theta = m_current_pose[2];
+      m_current_pose[0] += (cos(theta) * command.vx - sin(theta) * command.vy) * dt;
+      m_current_pose[1] += (sin(theta) * command.vx + cos(theta) * command.vy) * dt;
+      m_current_pose[2] += command.omega * dt;
+    }
+  }
+
+  void Controller::avoidObstacles(){
+    if(scan_port.read(m_scan) == NewData){
+      /// Points further away than the YouBot can drive within the horizon are irrelevant
+      double reach = max(m_max_velocity[0], m_max_velocity[1]) * m_dwa_horizon + m_robot_radius;
+      m_dynamic_window.setScan(m_scan.ranges, m_scan.angle_min, m_scan.angle_increment, m_scan.range_min, m_scan.range_max, m_laser_pose, reach);
+      m_scan_received = true;
+    }
+    if(!m_scan_received){
+      m_sent_velocity[0] = m_ctrl.linear.x;
+      m_sent_velocity[1] = m_ctrl.linear.y;
+      m_sent_velocity[2] = m_ctrl.angular.z;
+      return;
+    }
+    double desired[3] = {m_ctrl.linear.x, m_ctrl.linear.y, m_ctrl.angular.z};
+    if(!m_dynamic_window.select(desired, m_sent_velocity, m_max_velocity, m_dwa_window, m_dwa_horizon, m_dwa_steps, m_robot_radius, m_clearance_weight, m_sent_velocity)){
+#ifndef NDEBUG
+      log(Debug) << "(Controller) All velocities collide, stopping" << endlog();
+#endif
+    }
+    m_ctrl.linear.x = m_sent_velocity[0];
+    m_ctrl.linear.y = m_sent_velocity[1];
+    m_ctrl.angular.z = m_sent_velocity[2];
+  }
+
+  void Controller::recordCommand(){
+    if(m_command_history.empty()) return;
+    Command& command = m_command_history[m_command_head];
+    command.stamp = RTT::os::TimeService::Instance()->getTicks();
+    command.vx = m_ctrl.linear.x;
+    command.vy = m_ctrl.linear.y;
+    command.omega = m_ctrl.angular.z;
+    m_command_head = (m_command_head + 1) % m_command_history.size();
+    if(m_command_count < m_command_history.size()) m_command_count++;
+  }
+
+  void Controller::thresholdControl(){
     // Generate control inputs, but don't do anything for those DOFs that are within the specified tolerance
     // X
     if(abs(m_delta_pose[0]) > m_goal_tolerance[0]){
@@ -111,8 +480,122 @@ namespace youbot{
       0){
       m_goal_reached = true;
     }
-    // Write the control values to the ctrl output port
-    ctrl_port.write(m_ctrl);
+  }
+
+  void Controller::planTrajectory(){
+    m_replan = false;
+    // A new goal while moving: the velocity commanded until now is blended
+    // out (see blend()) on top of a rest-to-rest profile, which starts where
+    // the blended out motion ends, instead of stepping to zero
+    m_blend_velocity = KDL::Rotation::RotZ(m_current_pose[2]) * KDL::Vector(m_ctrl.linear.x, m_ctrl.linear.y, 0.0);
+    m_blend_omega = m_ctrl.angular.z;
+    m_blend_time = 0.0;
+    double speed[3] = {fabs(m_blend_velocity[0]), fabs(m_blend_velocity[1]), fabs(m_blend_omega)};
+    for(unsigned int i = 0; i < 3; i++){
+      // Peak acceleration 1.5 v / T and jerk 6 v / T^2 of the smoothstep
+      if(speed[i] > 0.0) m_blend_time = max(m_blend_time, max(1.5 * speed[i] / m_max_acceleration[i], sqrt(6.0 * speed[i] / m_max_jerk[i])));
+    }
+    m_start_pose.x = m_current_pose[0] + 0.5 * m_blend_time * m_blend_velocity[0];
+    m_start_pose.y = m_current_pose[1] + 0.5 * m_blend_time * m_blend_velocity[1];
+    m_start_pose.theta = m_current_pose[2] + 0.5 * m_blend_time * m_blend_omega;
+    // Straight line from the start position to the goal position
+    KDL::Vector diff_world(m_goal_pose.x - m_start_pose.x, m_goal_pose.y - m_start_pose.y, 0.0);
+    double distance = diff_world.Norm();
+    m_direction = KDL::Vector(1.0, 0.0, 0.0);
+    if(distance > 0.0) m_direction = diff_world / distance;
+    // The line can have any orientation in the YouBot frame, so the
+    // translation limits are the most restrictive of the x and y limits
+    m_linear_profile.plan(distance, min(m_max_velocity[0], m_max_velocity[1]), min(m_max_acceleration[0], m_max_acceleration[1]), min(m_max_jerk[0], m_max_jerk[1]));
+    m_angular_profile.plan(m_goal_pose.theta - m_start_pose.theta, m_max_velocity[2], m_max_acceleration[2], m_max_jerk[2]);
+    // Synchronise translation and rotation
+    double duration = max(m_linear_profile.duration(), m_angular_profile.duration());
+    m_linear_profile.stretch(duration);
+    m_angular_profile.stretch(duration);
+    for(unsigned int i = 0; i < 3; i++) m_plan_velocity[i] = m_max_velocity[i];
+    m_profile_time = 0.0;
+    m_time_rate = 1.0;
+    m_trajectory_stamp = RTT::os::TimeService::Instance()->getTicks();
+#ifndef NDEBUG
+    log(Debug) << "(Controller) Planned trajectory of " << duration << " s, blending out the previous motion in " << m_blend_time << " s" << endlog();
+#endif
+  }
+
+  void Controller::blend(double t, double& factor, double& travelled) const{
+    if(m_blend_time <= 0.0 || t >= m_blend_time){
+      factor = 0.0;
+      travelled = 0.5 * m_blend_time;
+      return;
+    }
+    double tau = max(0.0, t) / m_blend_time;
+    // 1 - smoothstep: zero acceleration at both ends
+    factor = 1.0 - tau * tau * (3.0 - 2.0 * tau);
+    travelled = m_blend_time * (tau - tau * tau * tau + 0.5 * tau * tau * tau * tau);
+  }
+
+  void Controller::trajectoryControl(){
+    RTT::os::TimeService* time_service = RTT::os::TimeService::Instance();
+    double dt = time_service->secondsSince(m_trajectory_stamp);
+    m_trajectory_stamp = time_service->getTicks();
+    // Time rate that keeps the trajectory within the current velocity limits, the profile is not sped up beyond its plan
+    double lin_plan = min(m_plan_velocity[0], m_plan_velocity[1]);
+    double rate = min(1.0, min(min(m_max_velocity[0], m_max_velocity[1]) / lin_plan, m_max_velocity[2] / m_plan_velocity[2]));
+    // Change the rate no faster than the acceleration limits allow at the planned velocities
+    double max_change = dt * min(min(m_max_acceleration[0], m_max_acceleration[1]) / lin_plan, m_max_acceleration[2] / m_plan_velocity[2]);
+    double previous_rate = m_time_rate;
+    m_time_rate += max(-max_change, min(max_change, rate - m_time_rate));
+    m_profile_time += 0.5 * (previous_rate + m_time_rate) * dt;
+    double t = m_profile_time;
+    double s, s_vel, s_acc, th, th_vel, th_acc;
+    m_linear_profile.sample(t, s, s_vel, s_acc);
+    m_angular_profile.sample(t, th, th_vel, th_acc);
+    // The previous motion that is still being blended out
+    double factor, travelled;
+    blend(t, factor, travelled);
+    double offset = travelled - 0.5 * m_blend_time;
+    // Reference velocity (feedforward) plus feedback on the tracking error, in the world frame
+    KDL::Vector ref = KDL::Vector(m_start_pose.x, m_start_pose.y, 0.0) + m_direction * s + m_blend_velocity * offset;
+    KDL::Vector vel_world = (m_direction * s_vel + m_blend_velocity * factor) * m_time_rate;
+    vel_world[0] += m_position_gain[0] * (ref[0] - m_current_pose[0]);
+    vel_world[1] += m_position_gain[1] * (ref[1] - m_current_pose[1]);
+    double vel_theta = (th_vel + m_blend_omega * factor) * m_time_rate + m_position_gain[2] * (m_start_pose.theta + th + m_blend_omega * offset - m_current_pose[2]);
+    // Express the velocity in the YouBot frame
+    KDL::Vector vel = KDL::Rotation::RotZ(m_current_pose[2]).Inverse(vel_world);
+    // Clip at the limits, which follow the time rate down while the trajectory slows down
+    double limit[3];
+    for(unsigned int i = 0; i < 3; i++) limit[i] = max(m_max_velocity[i], m_plan_velocity[i] * m_time_rate);
+    m_ctrl.linear.x = max(-limit[0], min(limit[0], vel[0]));
+    m_ctrl.linear.y = max(-limit[1], min(limit[1], vel[1]));
+    m_ctrl.angular.z = max(-limit[2], min(limit[2], vel_theta));
+    /// Did the YouBot reach its goal yet?
+    if(t >= max(m_linear_profile.duration(), m_blend_time) && abs(m_delta_pose[0]) <= m_goal_tolerance[0] &&
+      abs(m_delta_pose[1]) <= m_goal_tolerance[1] && abs(m_delta_pose[2]) <= m_goal_tolerance[2]){
+      m_ctrl.linear.x = 0.0;
+      m_ctrl.linear.y = 0.0;
+      m_ctrl.angular.z = 0.0;
+      m_goal_reached = true;
+    }
+  }
+
+  bool Controller::controlStepRequired(bool new_pose){
+    /// Check for a watchdog tick, other timer ids are not meant for us
+    bool watchdog = false;
+    RTT::os::Timer::TimerId timer_id;
+    while(timer_port.read(timer_id) == NewData){
+      if(timer_id == m_watchdog_timer_id) watchdog = true;
+    }
+    bool goal_changed = m_goal_changed;
+    m_goal_changed = false;
+    if(!m_event_triggered){
+      return true;
+    }
+    if(new_pose){
+      m_pose_since_watchdog = true;
+    }
+    bool required = new_pose || goal_changed || (watchdog && !m_pose_since_watchdog);
+    if(watchdog){
+      m_pose_since_watchdog = false;
+    }
+    return required;
   }
 
   void Controller::calcPoseDiff(){
@@ -126,11 +609,313 @@ namespace youbot{
     m_delta_pose[2] = m_goal_pose.theta - m_current_pose[2];
   }
 
+  void Controller::pathControl(){
+    geometry_msgs::Pose2D waypoint;
+    if(!m_waypoint_active && m_path_queue->Pop(waypoint)){
+      m_goal_pose = waypoint;
+      m_waypoint_active = true;
+    }
+    KDL::Vector diff_world(m_goal_pose.x - m_current_pose[0], m_goal_pose.y - m_current_pose[1], 0.0);
+    /// Blend into the next segment as soon as we are close enough to the current waypoint
+    while(m_waypoint_active && diff_world.Norm() < m_blend_radius && m_path_queue->Pop(waypoint)){
+      m_goal_pose = waypoint;
+      m_path_progress++;
+      path_progress_port.write(m_path_progress);
+      diff_world = KDL::Vector(m_goal_pose.x - m_current_pose[0], m_goal_pose.y - m_current_pose[1], 0.0);
+    }
+    calcPoseDiff();
+    double distance = diff_world.Norm();
+    bool last = m_path_queue->empty();
+    double speed = min(m_max_velocity[0], m_max_velocity[1]);
+    double acc = min(m_max_acceleration[0], m_max_acceleration[1]);
+    /// Decelerate towards the last waypoint only
+    if(last) speed = min(speed, sqrt(2.0 * acc * distance));
+    KDL::Vector desired = KDL::Vector::Zero();
+    if(distance > 0.0) desired = diff_world * (speed / distance);
+    if(last && abs(m_delta_pose[0]) <= m_goal_tolerance[0] && abs(m_delta_pose[1]) <= m_goal_tolerance[1]){
+      desired = KDL::Vector::Zero();
+    }
+    double omega = 0.0;
+    if(abs(m_delta_pose[2]) > m_goal_tolerance[2]){
+      omega = m_position_gain[2] * m_delta_pose[2];
+    }
+    /// The acceleration limit blends the velocity between two segments
+    commandVelocity(desired, omega);
+    /// Did the YouBot reach the end of the path?
+    if(m_waypoint_active && last && m_ctrl.linear.x == 0 && m_ctrl.linear.y == 0 && m_ctrl.angular.z == 0){
+      m_waypoint_active = false;
+      m_path_progress++;
+      path_progress_port.write(m_path_progress);
+    }
+    m_goal_reached = !m_waypoint_active && m_path_queue->empty();
+  }
+
+  void Controller::pursuitControl(){
+    if(m_path_s.empty()){
+      commandVelocity(KDL::Vector::Zero(), 0.0);
+      m_goal_reached = true;
+      return;
+    }
+    /// Closest path point and lookahead point
+    double closest = updatePathIndex();
+    double x, y, theta;
+    interpolatePath(m_path_s[m_path_index] + m_lookahead_distance, x, y, theta);
+    /// The end of the path is the goal
+    unsigned int last = m_path_s.size() - 1;
+    m_goal_pose.x = m_path_x[last];
+    m_goal_pose.y = m_path_y[last];
+    m_goal_pose.theta = m_path_theta[last];
+    calcPoseDiff();
+    /// Drive towards the lookahead point, decelerate towards the end of the path
+    KDL::Vector diff_world(x - m_current_pose[0], y - m_current_pose[1], 0.0);
+    double distance = diff_world.Norm();
+    double remaining = m_path_s[last] - m_path_s[m_path_index] + sqrt(closest);
+    double speed = min(min(m_max_velocity[0], m_max_velocity[1]), sqrt(2.0 * min(m_max_acceleration[0], m_max_acceleration[1]) * remaining));
+    KDL::Vector desired = KDL::Vector::Zero();
+    if(distance > 0.0) desired = diff_world * (speed / distance);
+    double omega = m_position_gain[2] * (theta - m_current_pose[2]);
+    bool at_end = false;
+    if(m_path_index == last && abs(m_delta_pose[0]) <= m_goal_tolerance[0] && abs(m_delta_pose[1]) <= m_goal_tolerance[1]){
+      desired = KDL::Vector::Zero();
+      if(abs(m_delta_pose[2]) <= m_goal_tolerance[2]){
+        omega = 0.0;
+        at_end = true;
+      }
+    }
+    commandVelocity(desired, omega);
+    /// Did the YouBot reach the end of the path?
+    m_goal_reached = at_end && m_path_velocity.Norm() == 0.0;
+  }
+
+  double Controller::updatePathIndex(){
+    /// Closest path point, searched in a window ahead of the previous one
+    unsigned int end = min((unsigned int)m_path_s.size(), m_path_index + (unsigned int)m_search_window);
+    double closest = -1.0;
+    for(unsigned int i = m_path_index; i < end; i++){
+      double dx = m_path_x[i] - m_current_pose[0];
+      double dy = m_path_y[i] - m_current_pose[1];
+      double d = dx * dx + dy * dy;
+      if(closest < 0.0 || d < closest){
+        closest = d;
+        m_path_index = i;
+      }
+    }
+    return closest;
+  }
+
+  void Controller::interpolatePath(double s, double& x, double& y, double& theta) const{
+    unsigned int j = std::lower_bound(m_path_s.begin() + m_path_index, m_path_s.end(), s) - m_path_s.begin();
+    if(j >= m_path_s.size()){
+      j = m_path_s.size() - 1;
+      x = m_path_x[j];
+      y = m_path_y[j];
+      theta = m_path_theta[j];
+    }
+    else if(j == 0 || m_path_s[j] == m_path_s[j-1]){
+      x = m_path_x[j];
+      y = m_path_y[j];
+      theta = m_path_theta[j];
+    }
+    else{
+      double f = (s - m_path_s[j-1]) / (m_path_s[j] - m_path_s[j-1]);
+      x = m_path_x[j-1] + f * (m_path_x[j] - m_path_x[j-1]);
+      y = m_path_y[j-1] + f * (m_path_y[j] - m_path_y[j-1]);
+      theta = m_path_theta[j-1] + f * (m_path_theta[j] - m_path_theta[j-1]);
+    }
+  }
+
+  void Controller::mpcControl(){
+    RTT::os::TimeService* time_service = RTT::os::TimeService::Instance();
+    RTT::os::TimeService::ticks start = time_service->getTicks();
+    double state[3] = {m_current_pose[0], m_current_pose[1], m_current_pose[2]};
+    double input[3] = {m_ctrl.linear.x, m_ctrl.linear.y, m_ctrl.angular.z};
+    m_mpc.prepare(state, input);
+    /// Reference: the path travelled at the maximum velocity, or the goal pose
+    if(!m_path_s.empty()){
+      unsigned int last = m_path_s.size() - 1;
+      m_goal_pose.x = m_path_x[last];
+      m_goal_pose.y = m_path_y[last];
+      m_goal_pose.theta = m_path_theta[last];
+      updatePathIndex();
+    }
+    calcPoseDiff();
+    double speed = min(m_max_velocity[0], m_max_velocity[1]);
+    for(int k = 1; k <= m_mpc_horizon; k++){
+      double* ref = m_mpc.reference(k);
+      if(m_path_s.empty()){
+        ref[0] = m_goal_pose.x;
+        ref[1] = m_goal_pose.y;
+        ref[2] = m_goal_pose.theta;
+      }
+      else{
+        interpolatePath(m_path_s[m_path_index] + speed * k * m_mpc.step(), ref[0], ref[1], ref[2]);
+      }
+    }
+    /// Fixed number of iterations, stop before an iteration would exceed the budget
+    bool completed = true;
+    double iteration_time = 0.0;
+    for(int i = 0; i < m_mpc_iterations; i++){
+      double elapsed = time_service->secondsSince(start);
+      if(elapsed + iteration_time > m_mpc_budget){
+        completed = false;
+        break;
+      }
+      m_mpc.iterate();
+      iteration_time = max(iteration_time, time_service->secondsSince(start) - elapsed);
+    }
+    /// On an overrun the previous (shifted) solution is applied
+    if(completed){
+      m_mpc.accept();
+    }
+    else{
+      m_mpc_overruns++;
+#ifndef NDEBUG
+      log(Debug) << "(Controller) MPC overrun, applying the previous solution" << endlog();
+#endif
+    }
+    const double* u = m_mpc.input();
+    m_ctrl.linear.x = u[0];
+    m_ctrl.linear.y = u[1];
+    m_ctrl.angular.z = u[2];
+    /// Did the YouBot reach its goal yet?
+    if(abs(m_delta_pose[0]) <= m_goal_tolerance[0] && abs(m_delta_pose[1]) <= m_goal_tolerance[1] &&
+      abs(m_delta_pose[2]) <= m_goal_tolerance[2] && (m_path_s.empty() || m_path_index == m_path_s.size() - 1)){
+      m_ctrl = geometry_msgs::Twist();
+      m_mpc.reset();
+      m_goal_reached = true;
+    }
+  }
+
+  void Controller::commandVelocity(const KDL::Vector& desired, double omega){
+    double dt = RTT::os::TimeService::Instance()->secondsSince(m_last_step);
+    m_last_step = RTT::os::TimeService::Instance()->getTicks();
+    /// Limit the acceleration
+    KDL::Vector change = desired - m_path_velocity;
+    double max_change = min(m_max_acceleration[0], m_max_acceleration[1]) * dt;
+    if(change.Norm() > max_change) change = change * (max_change / change.Norm());
+    m_path_velocity = m_path_velocity + change;
+    /// Express the velocity in the YouBot frame, scale it down (keeping its direction) when exceeding a limit
+    KDL::Vector vel = KDL::Rotation::RotZ(m_current_pose[2]).Inverse(m_path_velocity);
+    double scale = 1.0;
+    if(abs(vel[0]) > m_max_velocity[0]) scale = min(scale, m_max_velocity[0] / abs(vel[0]));
+    if(abs(vel[1]) > m_max_velocity[1]) scale = min(scale, m_max_velocity[1] / abs(vel[1]));
+    m_ctrl.linear.x = scale * vel[0];
+    m_ctrl.linear.y = scale * vel[1];
+    m_ctrl.angular.z = max(-m_max_velocity[2], min(m_max_velocity[2], omega));
+  }
+
+  bool Controller::setPath(const std::vector<double>& x, const std::vector<double>& y, const std::vector<double>& theta){
+    if(x.size() != y.size() || x.size() != theta.size() || x.empty()){
+      log(Error) << "(Controller) The path vectors are empty or differ in size" << endlog();
+      return false;
+    }
+    if(x.size() > (unsigned int)m_path_capacity){
+      log(Error) << "(Controller) The path has " << x.size() << " points, the path capacity is " << m_path_capacity << endlog();
+      return false;
+    }
+    m_path_x.assign(x.begin(), x.end());
+    m_path_y.assign(y.begin(), y.end());
+    m_path_theta.assign(theta.begin(), theta.end());
+    calcArcLength();
+    return true;
+  }
+
+  void Controller::readPath(){
+    unsigned int points = m_path_sample.size() / 3;
+    if(points == 0 || points > (unsigned int)m_path_capacity){
+      log(Error) << "(Controller) Received a path of " << points << " points, the path capacity is " << m_path_capacity << endlog();
+      return;
+    }
+    m_path_x.resize(points);
+    m_path_y.resize(points);
+    m_path_theta.resize(points);
+    for(unsigned int i = 0; i < points; i++){
+      m_path_x[i] = m_path_sample[3*i];
+      m_path_y[i] = m_path_sample[3*i + 1];
+      m_path_theta[i] = m_path_sample[3*i + 2];
+    }
+    calcArcLength();
+  }
+
+  void Controller::calcArcLength(){
+    m_path_s.resize(m_path_x.size());
+    m_path_s[0] = 0.0;
+    for(unsigned int i = 1; i < m_path_x.size(); i++){
+      double dx = m_path_x[i] - m_path_x[i-1];
+      double dy = m_path_y[i] - m_path_y[i-1];
+      m_path_s[i] = m_path_s[i-1] + sqrt(dx * dx + dy * dy);
+    }
+    m_path_index = 0;
+  }
+
+  bool Controller::addWaypoint(double x, double y, double theta){
+    if(!m_path_queue) return false;
+    geometry_msgs::Pose2D waypoint;
+    waypoint.x = x;
+    waypoint.y = y;
+    waypoint.theta = theta;
+    return m_path_queue->Push(waypoint);
+  }
+
+  bool Controller::addPath(const std::vector<double>& x, const std::vector<double>& y, const std::vector<double>& theta){
+    if(x.size() != y.size() || x.size() != theta.size()){
+      log(Error) << "(Controller) The waypoint vectors differ in size" << endlog();
+      return false;
+    }
+    for(unsigned int i = 0; i < x.size(); i++){
+      if(!addWaypoint(x[i], y[i], theta[i])){
+        log(Warning) << "(Controller) Path queue full, " << x.size() - i << " waypoints dropped" << endlog();
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void Controller::clearPath(){
+    if(!m_path_queue) return;
+    m_path_queue->clear();
+    m_waypoint_active = false;
+    m_goal_pose.x = m_current_pose[0];
+    m_goal_pose.y = m_current_pose[1];
+    m_goal_pose.theta = m_current_pose[2];
+  }
+
   bool Controller::moveTo(double x, double y, double theta){
-    m_goal_pose.x = x;
-    m_goal_pose.y = y;
-    m_goal_pose.theta = theta;
-    m_goal_reached = false;
+    /// In path mode, the goal is appended to the path
+    if(m_mode == PATH) return addWaypoint(x, y, theta);
+    double goal[3] = {x, y, theta};
+    writeGoalSet(goal, 0, 0, 0);
+    /// Wake up the control loop in event triggered mode
+    this->trigger();
+    return true;
+  }
+
+  bool Controller::setGoalTolerance(double x, double y, double theta){
+    if(x < 0.0 || y < 0.0 || theta < 0.0){
+      log(Error) << "(Controller) The goal tolerance must not be negative" << endlog();
+      return false;
+    }
+    double tolerance[3] = {x, y, theta};
+    writeGoalSet(0, tolerance, 0, 0);
+    return true;
+  }
+
+  bool Controller::setVelocityLimits(double x, double y, double theta){
+    if(x <= 0.0 || y <= 0.0 || theta <= 0.0){
+      log(Error) << "(Controller) The velocity limits must be positive" << endlog();
+      return false;
+    }
+    double velocity[3] = {x, y, theta};
+    writeGoalSet(0, 0, velocity, 0);
+    return true;
+  }
+
+  bool Controller::setSpeedScale(double scale){
+    if(scale <= 0.0 || scale > 1.0){
+      log(Error) << "(Controller) The speed scale must be in ]0, 1]" << endlog();
+      return false;
+    }
+    writeGoalSet(0, 0, 0, &scale);
     return true;
   }
 
@@ -138,5 +923,7 @@ namespace youbot{
   }
 
   void Controller::cleanupHook(){
+    delete m_path_queue;
+    m_path_queue = 0;
   }
 }
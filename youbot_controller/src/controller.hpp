@@ -49,7 +49,13 @@
 #include <rtt/Port.hpp>
 #include <rtt/Property.hpp>
 #include <rtt/base/PortInterface.hpp>
+#include <rtt/base/BufferLockFree.hpp>
+#include <rtt/base/DataObjectLockFree.hpp>
 #include <rtt/Component.hpp>
+#include <rtt/os/Timer.hpp>
+#include <rtt/os/TimeService.hpp>
+#include <rtt/os/Mutex.hpp>
+#include <rtt/os/MutexLock.hpp>
 
 #include <kdl/frames.hpp>
 #include <kdl/frames_io.hpp>
@@ -70,6 +76,14 @@
 
 #include <geometry_msgs/Twist.h>
 #include <geometry_msgs/Pose2D.h>
+#include <sensor_msgs/LaserScan.h>
+
+#include <latencyTracer.hpp>
+#include <hookStatsService.hpp>
+
+#include "jerkLimitedProfile.hpp"
+#include "mpcSolver.hpp"
+#include "dynamicWindow.hpp"
 
 namespace youbot{
 
@@ -83,8 +97,18 @@ namespace youbot{
       //@{
       /// Youbot current pose - the controller get's this one from the Extended Kalman Filter estimator component
       InputPort<ColumnVector> current_pose_port;
+      /// Watchdog timer - in event triggered mode the OCL::TimerComponent fires the watchdog on this port
+      InputPort<RTT::os::Timer::TimerId> timer_port;
+      /// Laser scan - used by the obstacle avoidance
+      InputPort<sensor_msgs::LaserScan> scan_port;
+      /// Path - replaces the path tracked in 'pursuit' and 'mpc' mode [x0 y0 theta0 x1 y1 theta1 ...], e.g. from the Planner component
+      InputPort<std::vector<double> > path_port;
       /// Youbot control input - generated by the controller, these control signals are send to the YouBot, or a YouBot simulator
       OutputPort<geometry_msgs::Twist> ctrl_port;
+      /// Path progress - the number of waypoints of the path that have been reached
+      OutputPort<int> path_progress_port;
+      /// Goal reached - written whenever the YouBot reaches its goal or leaves it for a new one
+      OutputPort<bool> goal_reached_port;
       //@}
       /// @name Properties
       //@{
@@ -92,8 +116,72 @@ namespace youbot{
       std::vector<double> m_goal_tolerance;
       /// Youbot velocity - the YouBot velocity while reaching the goal pose
       std::vector<double> m_velocity;
-      /// Goal reached
-      bool m_goal_reached;
+      /// Event triggered - compute a control signal only when a new pose estimate arrives instead of every period
+      bool m_event_triggered;
+      /// Watchdog timer id - in event triggered mode, this timer makes sure the control law still runs when no estimates arrive
+      int m_watchdog_timer_id;
+      /// Watchdog period - the fallback period of the control law in event triggered mode
+      double m_watchdog_period;
+      /// Control mode - 'threshold' (constant velocity per axis), 'trajectory' (jerk limited trajectory), 'path' (follow the queued waypoints), 'pursuit' (pure pursuit of a path) or 'mpc' (model predictive control)
+      std::string m_control_mode;
+      /// Maximum velocity of the planned trajectories [x y yaw]
+      std::vector<double> m_max_velocity;
+      /// Maximum acceleration of the planned trajectories [x y yaw]
+      std::vector<double> m_max_acceleration;
+      /// Maximum jerk of the planned trajectories [x y yaw]
+      std::vector<double> m_max_jerk;
+      /// Feedback gain on the trajectory tracking error [x y yaw]
+      std::vector<double> m_position_gain;
+      /// Path capacity - the maximum number of waypoints in the path queue
+      int m_path_capacity;
+      /// Blend radius - switch to the next waypoint when the YouBot is this close to the current one
+      double m_blend_radius;
+      /// Lookahead distance - the pursuit mode steers towards the path point this far ahead (along the path)
+      double m_lookahead_distance;
+      /// Search window - the number of path points searched for the closest point in each cycle
+      int m_search_window;
+      /// MPC horizon - the number of steps of the prediction horizon
+      int m_mpc_horizon;
+      /// MPC step - the duration of one step of the prediction horizon, 0 uses the period of the activity
+      double m_mpc_step;
+      /// MPC iterations - the (fixed) number of solver iterations per control step
+      int m_mpc_iterations;
+      /// MPC budget - the time the solver may use per control step
+      double m_mpc_budget;
+      /// MPC gradient step - the step size of the solver iterations
+      double m_mpc_gradient_step;
+      /// Weight on the MPC tracking error [x y yaw]
+      std::vector<double> m_mpc_state_weight;
+      /// Weight on the MPC input [x y yaw]
+      std::vector<double> m_mpc_input_weight;
+      /// Weight on the MPC input change [x y yaw]
+      std::vector<double> m_mpc_rate_weight;
+      /// MPC overruns - the number of control steps in which the solver did not finish within its budget
+      int m_mpc_overruns;
+      /// Latency compensation - predict the pose forward over the pipeline latency with the sent commands
+      bool m_latency_compensation;
+      /// Pipeline latency - the age of a pose estimate when it arrives (timer, estimator, streaming of the commands)
+      double m_pipeline_latency;
+      /// Command history - the number of sent commands remembered for the latency compensation
+      int m_command_history_size;
+      /// Obstacle avoidance - replace the control signal by the closest velocity that does not collide with the laser scan
+      bool m_obstacle_avoidance;
+      /// Number of velocity samples on each axis of the dynamic window
+      int m_dwa_samples;
+      /// Half width of the dynamic window around the current velocity [x y yaw]
+      std::vector<double> m_dwa_window;
+      /// Duration of the rollouts of the velocity samples
+      double m_dwa_horizon;
+      /// Number of steps of the rollouts
+      int m_dwa_steps;
+      /// Weight on the inverse of the clearance to the obstacles
+      double m_clearance_weight;
+      /// Radius of the YouBot
+      double m_robot_radius;
+      /// Pose of the laser in the YouBot frame [x y yaw]
+      std::vector<double> m_laser_pose;
+      /// Maximum number of scan points used by the obstacle avoidance
+      int m_max_scan_points;
       //@}
 
     public:
@@ -129,12 +217,126 @@ namespace youbot{
        * \brief Move to goal pose
        *
        *  Move to the specified goal pose. The state machine will send goal
-       *  poses using this operation.
+       *  poses using this operation. In 'path' mode the goal pose is
+       *  appended to the path. The goal is passed to the control loop
+       *  through the goal mailbox, so this operation never blocks the
+       *  control loop.
        */
       bool moveTo(double x, double y, double theta);
+
+      /**
+       * \brief Set the goal tolerance
+       *
+       * Takes effect in the next control step, through the goal mailbox.
+       * \return false if a tolerance is negative
+       */
+      bool setGoalTolerance(double x, double y, double theta);
+
+      /**
+       * \brief Set the velocity limits
+       *
+       * Sets the control velocity in 'threshold' mode and the maximum
+       * velocity in the other modes. Takes effect in the next control step,
+       * through the goal mailbox. In 'trajectory' mode a running trajectory
+       * is not replanned: it slows down to lower limits with the
+       * acceleration limits (see trajectoryControl()).
+       * \return false if a limit is not positive
+       */
+      bool setVelocityLimits(double x, double y, double theta);
+
+      /**
+       * \brief Scale the velocity limits
+       *
+       * Used by the supervisor to slow the YouBot down when the system is
+       * overloaded. The scale multiplies the limits set with
+       * setVelocityLimits() or the properties, 1.0 restores them. Takes
+       * effect in the next control step, through the goal mailbox.
+       * \return false if the scale is not in ]0, 1]
+       */
+      bool setSpeedScale(double scale);
+
+      /**
+       * \brief Add a waypoint to the path
+       *
+       * Appends a waypoint to the path queue. In 'path' mode the YouBot
+       * drives through all queued waypoints without stopping and stops at
+       * the last one. The queue is lock free, so this operation never
+       * blocks the control loop.
+       * \return false if the path queue is full or not allocated yet
+       */
+      bool addWaypoint(double x, double y, double theta);
+
+      /**
+       * \brief Add a path of waypoints
+       *
+       * Appends all waypoints [x[i], y[i], theta[i]] to the path queue.
+       * \return false if the vectors differ in size or the queue is full;
+       * the waypoints that fit are queued anyway
+       */
+      bool addPath(const std::vector<double>& x, const std::vector<double>& y, const std::vector<double>& theta);
+
+      /**
+       * \brief Clear the path
+       *
+       * Removes all queued waypoints, the YouBot stops at its current pose.
+       */
+      void clearPath();
+
+      /**
+       * \brief Set the path to track
+       *
+       * Replaces the path tracked in 'pursuit' mode. The points are stored
+       * contiguously together with their cumulative arc length, in storage
+       * that is allocated at configuration time.
+       * \return false if the vectors differ in size, are empty or exceed the
+       * path capacity
+       */
+      bool setPath(const std::vector<double>& x, const std::vector<double>& y, const std::vector<double>& theta);
       //@}
 
+      /// Control modes
+      enum ControlMode{
+        /// Constant velocity on each axis until the goal is within tolerance
+        THRESHOLD,
+        /// Track a jerk limited trajectory towards the goal
+        TRAJECTORY,
+        /// Drive through the queued waypoints
+        PATH,
+        /// Pure pursuit of a (long) path
+        PURSUIT,
+        /// Model predictive control towards the goal or along the path
+        MPC
+      };
+
     private:
+      /// Goal, tolerance and velocity limits as set by the operations
+      struct GoalSet{
+        /// Goal pose [x, y, theta]
+        double goal[3];
+        /// Tolerance on the goal pose [x, y, theta]
+        double tolerance[3];
+        /// Velocity limits [x, y, theta]
+        double velocity[3];
+        /// Scale on the velocity limits
+        double speed_scale;
+        /// Incremented whenever the goal changes
+        unsigned int goal_seq;
+        /// Incremented whenever the tolerance, velocity limits or speed scale change
+        unsigned int limits_seq;
+      };
+      /// Goal mailbox - written by the operations, read by the control loop without blocking
+      RTT::base::DataObjectLockFree<GoalSet> m_goal_mailbox;
+      /// Serialises the writers of the goal mailbox, the control loop never takes it
+      RTT::os::Mutex m_goal_mutex;
+      /// Goal set read by the control loop
+      GoalSet m_goal_set;
+      /// Sequence numbers of the goal set that was applied last
+      unsigned int m_goal_seq;
+      unsigned int m_limits_seq;
+      /// Goal reached
+      bool m_goal_reached;
+      /// Goal reached as last written to the goal reached port
+      bool m_goal_reached_published;
       /// YouBot goal pose [x, y, theta]
       geometry_msgs::Pose2D m_goal_pose;
       /// Youbot current pose [x, y, theta]
@@ -143,5 +345,254 @@ namespace youbot{
       geometry_msgs::Twist m_ctrl;
       /// Youbot pose difference - expressed in the YouBot frame
       KDL::Vector m_delta_pose;
+      /// A new goal was set since the last control step
+      bool m_goal_changed;
+      /// A new pose estimate arrived since the last watchdog tick
+      bool m_pose_since_watchdog;
+      /// Active control mode
+      ControlMode m_mode;
+      /// A new goal was set since the last trajectory was planned
+      bool m_replan;
+      /// Start pose of the trajectory [x, y, theta]
+      geometry_msgs::Pose2D m_start_pose;
+      /// Direction of the straight line trajectory in the world frame
+      KDL::Vector m_direction;
+      /// Motion profile along the straight line
+      JerkLimitedProfile m_linear_profile;
+      /// Motion profile of the orientation
+      JerkLimitedProfile m_angular_profile;
+      /// Time of the previous trajectory sample
+      RTT::os::TimeService::ticks m_trajectory_stamp;
+      /// Time along the planned trajectory
+      double m_profile_time;
+      /// Rate of the trajectory time: below 1 when the velocity limits were lowered after planning
+      double m_time_rate;
+      /// Velocity limits the trajectory was planned with [x y yaw]
+      double m_plan_velocity[3];
+      /// Commanded velocity when the trajectory was planned, blended out along it (world frame)
+      KDL::Vector m_blend_velocity;
+      double m_blend_omega;
+      /// Duration of the blend, 0 when the trajectory started at rest
+      double m_blend_time;
+      /// Lock free queue of waypoints, allocated at configuration time
+      RTT::base::BufferLockFree<geometry_msgs::Pose2D>* m_path_queue;
+      /// The waypoint the YouBot is currently driving to is valid
+      bool m_waypoint_active;
+      /// Number of waypoints reached
+      int m_path_progress;
+      /// Commanded velocity in path mode, expressed in the world frame
+      KDL::Vector m_path_velocity;
+      /// Time of the previous control step
+      RTT::os::TimeService::ticks m_last_step;
+      /// @name Pursuit path, one entry per path point
+      //@{
+      std::vector<double> m_path_x;
+      std::vector<double> m_path_y;
+      std::vector<double> m_path_theta;
+      /// Cumulative arc length of the path up to each point
+      std::vector<double> m_path_s;
+      //@}
+      /// Index of the path point closest to the YouBot
+      unsigned int m_path_index;
+      /// Path read from the path port, allocated at configuration time
+      std::vector<double> m_path_sample;
+      /// Model predictive controller
+      MpcSolver m_mpc;
+      /// A sent command and the time it was sent
+      struct Command{
+        RTT::os::TimeService::ticks stamp;
+        double vx;
+        double vy;
+        double omega;
+      };
+      /// Ring buffer of sent commands, allocated at configuration time
+      std::vector<Command> m_command_history;
+      /// Index of the next command in the ring buffer
+      unsigned int m_command_head;
+      /// Number of commands in the ring buffer
+      unsigned int m_command_count;
+      /// Arrival time of the last pose estimate
+      RTT::os::TimeService::ticks m_pose_stamp;
+      /// Last laser scan
+      sensor_msgs::LaserScan m_scan;
+      /// A laser scan was received
+      bool m_scan_received;
+      /// Obstacle avoidance
+      DynamicWindow m_dynamic_window;
+      /// Velocity sent in the previous control step [vx vy omega]
+      double m_sent_velocity[3];
+      /// Latency trace of the scan behind the last pose estimate, see youbot_diagnostics
+      unsigned int m_trace;
+      /// The next command completes m_trace
+      bool m_traced;
+      /// Timing of updateHook(), 0 without the hookstats service
+      HookProbe* m_update_probe;
+
+      /**
+       * \brief Check whether the control law has to run in this activation
+       *
+       * In periodic mode the control law runs every period. In event
+       * triggered mode it only runs on a new pose estimate, on a new goal, or
+       * on a watchdog tick when no estimate arrived during the last watchdog
+       * period.
+       * \param new_pose True if a new pose estimate was read
+       */
+      bool controlStepRequired(bool new_pose);
+
+      /**
+       * \brief Apply the goal mailbox
+       *
+       * Takes over a new goal, tolerance or velocity limits from the goal
+       * mailbox.
+       */
+      void applyGoalSet();
+
+      /**
+       * \brief Write a goal set to the goal mailbox
+       *
+       * \param goal New goal pose, or 0 to keep the goal
+       * \param tolerance New goal tolerance, or 0 to keep the tolerance
+       * \param velocity New velocity limits, or 0 to keep the limits
+       * \param speed_scale New scale on the velocity limits, or 0 to keep the scale
+       */
+      void writeGoalSet(const double* goal, const double* tolerance, const double* velocity, const double* speed_scale);
+
+      /**
+       * \brief Predict the current pose
+       *
+       * The pose estimate describes the YouBot the pipeline latency before
+       * its arrival. The commands sent since then are integrated with the
+       * motion model of the estimator, to predict the pose at this time.
+       */
+      void predictPose();
+
+      /**
+       * \brief Obstacle avoidance
+       *
+       * Replaces the control signal by the velocity in the dynamic window
+       * around the previous command that stays closest to it without
+       * colliding with the last laser scan. Stops the YouBot when all
+       * velocities collide.
+       */
+      void avoidObstacles();
+
+      /**
+       * \brief Remember the command that was just sent
+       */
+      void recordCommand();
+
+      /**
+       * \brief Constant velocity control law
+       *
+       * Outputs the control velocity on each axis until the pose difference
+       * on that axis is within the goal tolerance.
+       */
+      void thresholdControl();
+
+      /**
+       * \brief Plan a trajectory from the current pose to the goal pose
+       *
+       * The translation follows a straight line, the orientation changes
+       * simultaneously. Both use a jerk limited profile; the fastest one is
+       * stretched so that both arrive at the same time. When the YouBot is
+       * moving, its commanded velocity is blended out on top of the profiles
+       * (blend()), which start where the blended out motion ends.
+       */
+      void planTrajectory();
+
+      /**
+       * \brief Blend of the motion commanded before the trajectory
+       *
+       * The velocity of that motion is scaled down from 1 to 0 with a
+       * smoothstep, within the acceleration and jerk limits.
+       * \param t Time along the trajectory
+       * \param factor Scale of the velocity at time t
+       * \param travelled Time integral of factor since the start
+       */
+      void blend(double t, double& factor, double& travelled) const;
+
+      /**
+       * \brief Trajectory tracking control law
+       *
+       * Combines the trajectory velocity (feedforward) with a proportional
+       * feedback on the tracking error. When the velocity limits change
+       * during the trajectory (setSpeedScale(), setVelocityLimits()), the
+       * trajectory is stretched in time: its time rate moves to the new
+       * limits with the acceleration limits, so the command has no step.
+       */
+      void trajectoryControl();
+
+      /**
+       * \brief Path following control law
+       *
+       * Drives towards the active waypoint at the maximum velocity and
+       * switches to the next waypoint as soon as it is within the blend
+       * radius. The acceleration limit blends the velocity between
+       * segments. Only the last waypoint is approached with a decelerating
+       * velocity and has to be reached within the goal tolerance.
+       */
+      void pathControl();
+
+      /**
+       * \brief Take over a path from the path port
+       */
+      void readPath();
+
+      /**
+       * \brief Calculate the cumulative arc length of the path
+       */
+      void calcArcLength();
+
+      /**
+       * \brief Pure pursuit control law
+       *
+       * Finds the path point closest to the YouBot with a windowed search
+       * around the previous closest point, looks up the lookahead point with
+       * a binary search on the arc length and drives towards it. The cost
+       * per cycle does not depend on the length of the path.
+       */
+      void pursuitControl();
+
+      /**
+       * \brief Find the path point closest to the YouBot
+       *
+       * Searches a window ahead of the previous closest point and updates
+       * m_path_index.
+       * \return The squared distance to the closest path point
+       */
+      double updatePathIndex();
+
+      /**
+       * \brief Interpolate the path at an arc length
+       *
+       * Binary search on the arc length, starting from the closest path
+       * point, followed by a linear interpolation between two path points.
+       * Beyond the end of the path, the last path point is returned.
+       */
+      void interpolatePath(double s, double& x, double& y, double& theta) const;
+
+      /**
+       * \brief Model predictive control law
+       *
+       * Predicts the pose over the horizon with the motion model of the
+       * estimator and optimises the velocities with respect to the
+       * reference: the path (when set) travelled at the maximum velocity,
+       * otherwise the goal pose. The solver runs a fixed number of
+       * iterations, warm started from the previous solution. When the
+       * iterations do not fit in the budget, the overrun is counted and the
+       * previous solution is applied.
+       */
+      void mpcControl();
+
+      /**
+       * \brief Send a velocity respecting the YouBot limits
+       *
+       * Limits the change of the world frame velocity to the maximum
+       * acceleration, expresses it in the YouBot frame and scales it down
+       * when it exceeds the maximum velocity on an axis.
+       * \param desired Desired velocity in the world frame
+       * \param omega Desired angular velocity
+       */
+      void commandVelocity(const KDL::Vector& desired, double omega);
   };
 }
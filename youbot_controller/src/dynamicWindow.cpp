@@ -0,0 +1,190 @@
+/******************************************************************************
+*                    OROCOS Youbot controller component                       *
+*                                                                             *
+*                         (C) 2011 Steven Bellens                             *
+*                     steven.bellens@mech.kuleuven.be                         *
+*                    Department of Mechanical Engineering,                    *
+*                   Katholieke Universiteit Leuven, Belgium.                  *
+*                                                                             *
+*       You may redistribute this software and/or modify it under either the  *
+*       terms of the GNU Lesser General Public License version 2.1 (LGPLv2.1  *
+*       <http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>) or (at your *
+*       discretion) of the Modified BSD License:                              *
+*       Redistribution and use in source and binary forms, with or without    *
+*       modification, are permitted provided that the following conditions    *
+*       are met:                                                              *
+*       1. Redistributions of source code must retain the above copyright     *
+*       notice, this list of conditions and the following disclaimer.         *
+*       2. Redistributions in binary form must reproduce the above copyright  *
+*       notice, this list of conditions and the following disclaimer in the   *
+*       documentation and/or other materials provided with the distribution.  *
+*       3. The name of the author may not be used to endorse or promote       *
+*       products derived from this software without specific prior written    *
+*       permission.                                                           *
+*       THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR  *
+*       IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED        *
+*       WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE    *
+*       ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,*
+*       INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    *
+*       (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS       *
+*       OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) *
+*       HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,   *
+*       STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING *
+*       IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE    *
+*       POSSIBILITY OF SUCH DAMAGE.                                           *
+*                                                                             *
+*******************************************************************************/
+#include "dynamicWindow.hpp"
+
+#include <math.h>
+#include <algorithm>
+
+namespace youbot{
+  DynamicWindow::DynamicWindow()
+  :m_points(0)
+  {
+  }
+
+  void DynamicWindow::resize(const std::vector<int>& samples, unsigned int max_points){
+    m_offset_x.clear();
+    m_offset_y.clear();
+    m_offset_theta.clear();
+    // The first candidates are the desired velocity and standing still
+    m_offset_x.push_back(0.0);
+    m_offset_y.push_back(0.0);
+    m_offset_theta.push_back(0.0);
+    m_offset_x.push_back(0.0);
+    m_offset_y.push_back(0.0);
+    m_offset_theta.push_back(0.0);
+    for(int i = 0; i < samples[0]; i++){
+      for(int j = 0; j < samples[1]; j++){
+        for(int k = 0; k < samples[2]; k++){
+          m_offset_x.push_back(samples[0] > 1 ? -1.0 + 2.0 * i / (samples[0] - 1) : 0.0);
+          m_offset_y.push_back(samples[1] > 1 ? -1.0 + 2.0 * j / (samples[1] - 1) : 0.0);
+          m_offset_theta.push_back(samples[2] > 1 ? -1.0 + 2.0 * k / (samples[2] - 1) : 0.0);
+        }
+      }
+    }
+    unsigned int n = m_offset_x.size();
+    m_vx.assign(n, 0.0);
+    m_vy.assign(n, 0.0);
+    m_omega.assign(n, 0.0);
+    m_x.assign(n, 0.0);
+    m_y.assign(n, 0.0);
+    m_cos.assign(n, 0.0);
+    m_sin.assign(n, 0.0);
+    m_cos_step.assign(n, 0.0);
+    m_sin_step.assign(n, 0.0);
+    m_clearance.assign(n, 0.0);
+    m_point_x.assign(max_points, 0.0);
+    m_point_y.assign(max_points, 0.0);
+    m_points = 0;
+  }
+
+  void DynamicWindow::setScan(const std::vector<float>& ranges, double angle_min, double angle_increment,
+                              double range_min, double range_max, const std::vector<double>& laser_pose, double reach){
+    m_points = 0;
+    if(m_point_x.empty()) return;
+    if(ranges.empty()) return;
+    /// Ceiling division: the smallest stride that spreads the budget over the whole scan
+    unsigned int stride = (ranges.size() + m_point_x.size() - 1) / m_point_x.size();
+    double c = cos(laser_pose[2]), s = sin(laser_pose[2]);
+    for(unsigned int i = 0; i < ranges.size() && m_points < m_point_x.size(); i += stride){
+      double r = ranges[i];
+      if(!(r >= range_min && r <= range_max)) continue;
+      double angle = angle_min + i * angle_increment;
+      double lx = r * cos(angle), ly = r * sin(angle);
+      double x = laser_pose[0] + c * lx - s * ly;
+      double y = laser_pose[1] + s * lx + c * ly;
+      if(x * x + y * y > reach * reach) continue;
+      m_point_x[m_points] = x;
+      m_point_y[m_points] = y;
+      m_points++;
+    }
+  }
+
+  unsigned int DynamicWindow::points() const{
+    return m_points;
+  }
+
+  bool DynamicWindow::select(const double* desired, const double* current, const std::vector<double>& max_velocity,
+                             const std::vector<double>& window, double horizon, unsigned int steps, double radius,
+                             double clearance_weight, double* result){
+    const unsigned int n = m_vx.size();
+    const double dt = horizon / steps;
+    // Candidates: the desired velocity, standing still and the window around the current velocity
+    for(unsigned int i = 0; i < n; i++){
+      m_vx[i] = current[0] + m_offset_x[i] * window[0];
+      m_vy[i] = current[1] + m_offset_y[i] * window[1];
+      m_omega[i] = current[2] + m_offset_theta[i] * window[2];
+    }
+    m_vx[0] = desired[0];
+    m_vy[0] = desired[1];
+    m_omega[0] = desired[2];
+    m_vx[1] = m_vy[1] = m_omega[1] = 0.0;
+    for(unsigned int i = 0; i < n; i++){
+      m_vx[i] = std::max(-max_velocity[0], std::min(max_velocity[0], m_vx[i]));
+      m_vy[i] = std::max(-max_velocity[1], std::min(max_velocity[1], m_vy[i]));
+      m_omega[i] = std::max(-max_velocity[2], std::min(max_velocity[2], m_omega[i]));
+      m_x[i] = 0.0;
+      m_y[i] = 0.0;
+      m_cos[i] = 1.0;
+      m_sin[i] = 0.0;
+      m_cos_step[i] = cos(m_omega[i] * dt);
+      m_sin_step[i] = sin(m_omega[i] * dt);
+      m_clearance[i] = 1e30;
+    }
+    // Roll out all candidates step by step, keep the smallest distance to the end points
+    double* x = &m_x[0];
+    double* y = &m_y[0];
+    double* c = &m_cos[0];
+    double* s = &m_sin[0];
+    double* clearance = &m_clearance[0];
+    const double* vx = &m_vx[0];
+    const double* vy = &m_vy[0];
+    const double* cs = &m_cos_step[0];
+    const double* ss = &m_sin_step[0];
+    for(unsigned int k = 0; k < steps; k++){
+      for(unsigned int i = 0; i < n; i++){
+        x[i] += (c[i] * vx[i] - s[i] * vy[i]) * dt;
+        y[i] += (s[i] * vx[i] + c[i] * vy[i]) * dt;
+        double c_next = c[i] * cs[i] - s[i] * ss[i];
+        s[i] = s[i] * cs[i] + c[i] * ss[i];
+        c[i] = c_next;
+      }
+      for(unsigned int j = 0; j < m_points; j++){
+        const double px = m_point_x[j];
+        const double py = m_point_y[j];
+        for(unsigned int i = 0; i < n; i++){
+          double dx = x[i] - px;
+          double dy = y[i] - py;
+          double d = dx * dx + dy * dy;
+          clearance[i] = d < clearance[i] ? d : clearance[i];
+        }
+      }
+    }
+    // Score: distance to the desired velocity (relative to the limits) and inverse clearance
+    int best = -1;
+    double best_cost = 0.0;
+    for(unsigned int i = 0; i < n; i++){
+      double margin = sqrt(clearance[i]) - radius;
+      if(margin <= 0.0) continue;
+      double ex = (m_vx[i] - desired[0]) / max_velocity[0];
+      double ey = (m_vy[i] - desired[1]) / max_velocity[1];
+      double et = (m_omega[i] - desired[2]) / max_velocity[2];
+      double cost = ex * ex + ey * ey + et * et + clearance_weight / margin;
+      if(best < 0 || cost < best_cost){
+        best = i;
+        best_cost = cost;
+      }
+    }
+    if(best < 0){
+      result[0] = result[1] = result[2] = 0.0;
+      return false;
+    }
+    result[0] = m_vx[best];
+    result[1] = m_vy[best];
+    result[2] = m_omega[best];
+    return true;
+  }
+}
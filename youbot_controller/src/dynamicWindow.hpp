@@ -0,0 +1,141 @@
+/******************************************************************************
+*                    OROCOS Youbot controller component                       *
+*                                                                             *
+*                         (C) 2011 Steven Bellens                             *
+*                     steven.bellens@mech.kuleuven.be                         *
+*                    Department of Mechanical Engineering,                    *
+*                   Katholieke Universiteit Leuven, Belgium.                  *
+*                                                                             *
+*       You may redistribute this software and/or modify it under either the  *
+*       terms of the GNU Lesser General Public License version 2.1 (LGPLv2.1  *
+*       <http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>) or (at your *
+*       discretion) of the Modified BSD License:                              *
+*       Redistribution and use in source and binary forms, with or without    *
+*       modification, are permitted provided that the following conditions    *
+*       are met:                                                              *
+*       1. Redistributions of source code must retain the above copyright     *
+*       notice, this list of conditions and the following disclaimer.         *
+*       2. Redistributions in binary form must reproduce the above copyright  *
+*       notice, this list of conditions and the following disclaimer in the   *
+*       documentation and/or other materials provided with the distribution.  *
+*       3. The name of the author may not be used to endorse or promote       *
+*       products derived from this software without specific prior written    *
+*       permission.                                                           *
+*       THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR  *
+*       IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED        *
+*       WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE    *
+*       ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,*
+*       INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    *
+*       (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS       *
+*       OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) *
+*       HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,   *
+*       STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING *
+*       IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE    *
+*       POSSIBILITY OF SUCH DAMAGE.                                           *
+*                                                                             *
+*******************************************************************************/
+/* @Description:
+ * @brief Dynamic window obstacle avoidance for the Youbot controller
+ * @Author: Steven Bellens
+ */
+
+ /*
+  * Local obstacle avoidance for the holonomic YouBot base. Velocity
+  * candidates [vx vy omega] are sampled in a window around the current
+  * velocity, rolled out over a short horizon at constant velocity and
+  * checked against the end points of the last laser scan. The candidate
+  * closest to the desired velocity, with a bonus for clearance, is selected.
+  * The candidates are stored as a structure of arrays, so the rollout and
+  * clearance loops run over all candidates at once and vectorise. All
+  * storage is allocated by resize().
+ */
+#ifndef _YOUBOT_DYNAMIC_WINDOW_
+#define _YOUBOT_DYNAMIC_WINDOW_
+
+#include <vector>
+
+namespace youbot{
+
+  class DynamicWindow{
+    public:
+      /// Constructor, the dynamic window needs to be resized before use
+      DynamicWindow();
+
+      /**
+       * \brief Allocate the candidates and the scan storage
+       *
+       * \param samples Number of samples on each axis [x y yaw]
+       * \param max_points Maximum number of scan end points
+       */
+      void resize(const std::vector<int>& samples, unsigned int max_points);
+
+      /**
+       * \brief Set the laser scan
+       *
+       * Converts the ranges to end points in the YouBot frame. End points
+       * that cannot be reached within the horizon are dropped; when there
+       * are more than max_points ranges, the scan is subsampled.
+       * \param ranges The measured ranges
+       * \param angle_min Angle of the first range
+       * \param angle_increment Angle between two ranges
+       * \param range_min Smaller ranges are invalid
+       * \param range_max Larger ranges are invalid
+       * \param laser_pose Pose of the laser in the YouBot frame [x y yaw]
+       * \param reach Distance beyond which end points are dropped
+       */
+      void setScan(const std::vector<float>& ranges, double angle_min, double angle_increment,
+                   double range_min, double range_max, const std::vector<double>& laser_pose, double reach);
+
+      /// Number of end points of the scan
+      unsigned int points() const;
+
+      /**
+       * \brief Select a velocity
+       *
+       * \param desired Desired velocity [vx vy omega]
+       * \param current Current velocity [vx vy omega], the centre of the window
+       * \param max_velocity Maximum velocity [x y yaw]
+       * \param window Half width of the window [x y yaw]
+       * \param horizon Duration of the rollouts
+       * \param steps Number of steps of the rollouts
+       * \param radius Radius of the YouBot
+       * \param clearance_weight Weight on the inverse of the clearance
+       * \param result Selected velocity [vx vy omega]
+       * \return false if all candidates collide (result is then zero)
+       */
+      bool select(const double* desired, const double* current, const std::vector<double>& max_velocity,
+                  const std::vector<double>& window, double horizon, unsigned int steps, double radius,
+                  double clearance_weight, double* result);
+
+    private:
+      /// @name Candidate offsets in the window, in [-1, 1]
+      //@{
+      std::vector<double> m_offset_x;
+      std::vector<double> m_offset_y;
+      std::vector<double> m_offset_theta;
+      //@}
+      /// @name Candidates, one entry per candidate
+      //@{
+      std::vector<double> m_vx;
+      std::vector<double> m_vy;
+      std::vector<double> m_omega;
+      /// Pose along the rollout
+      std::vector<double> m_x;
+      std::vector<double> m_y;
+      std::vector<double> m_cos;
+      std::vector<double> m_sin;
+      /// Rotation over one rollout step
+      std::vector<double> m_cos_step;
+      std::vector<double> m_sin_step;
+      /// Smallest squared distance to an end point
+      std::vector<double> m_clearance;
+      //@}
+      /// @name Scan end points in the YouBot frame
+      //@{
+      std::vector<double> m_point_x;
+      std::vector<double> m_point_y;
+      unsigned int m_points;
+      //@}
+  };
+}
+#endif // _YOUBOT_DYNAMIC_WINDOW_
@@ -0,0 +1,160 @@
+/******************************************************************************
+*                    OROCOS Youbot controller component                       *
+*                                                                             *
+*                         (C) 2011 Steven Bellens                             *
+*                     steven.bellens@mech.kuleuven.be                         *
+*                    Department of Mechanical Engineering,                    *
+*                   Katholieke Universiteit Leuven, Belgium.                  *
+*                                                                             *
+*       You may redistribute this software and/or modify it under either the  *
+*       terms of the GNU Lesser General Public License version 2.1 (LGPLv2.1  *
+*       <http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>) or (at your *
+*       discretion) of the Modified BSD License:                              *
+*       Redistribution and use in source and binary forms, with or without    *
+*       modification, are permitted provided that the following conditions    *
+*       are met:                                                              *
+*       1. Redistributions of source code must retain the above copyright     *
+*       notice, this list of conditions and the following disclaimer.         *
+*       2. Redistributions in binary form must reproduce the above copyright  *
+*       notice, this list of conditions and the following disclaimer in the   *
+*       documentation and/or other materials provided with the distribution.  *
+*       3. The name of the author may not be used to endorse or promote       *
+*       products derived from this software without specific prior written    *
+*       permission.                                                           *
+*       THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR  *
+*       IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED        *
+*       WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE    *
+*       ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,*
+*       INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    *
+*       (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS       *
+*       OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) *
+*       HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,   *
+*       STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING *
+*       IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE    *
+*       POSSIBILITY OF SUCH DAMAGE.                                           *
+*                                                                             *
+*******************************************************************************/
+#include "jerkLimitedProfile.hpp"
+
+#include <math.h>
+
+namespace youbot{
+  JerkLimitedProfile::JerkLimitedProfile()
+  :m_distance(0.0)
+  ,m_sign(1.0)
+  ,m_tj(0.0)
+  ,m_ta(0.0)
+  ,m_tv(0.0)
+  ,m_jerk(0.0)
+  ,m_acc_lim(0.0)
+  ,m_vel_lim(0.0)
+  ,m_scale(1.0)
+  {
+  }
+
+  bool JerkLimitedProfile::plan(double distance, double max_vel, double max_acc, double max_jerk){
+    m_distance = fabs(distance);
+    m_sign = (distance < 0.0) ? -1.0 : 1.0;
+    m_scale = 1.0;
+    m_tj = m_ta = m_tv = 0.0;
+    m_jerk = m_acc_lim = m_vel_lim = 0.0;
+    if(max_vel <= 0.0 || max_acc <= 0.0 || max_jerk <= 0.0){
+      m_distance = 0.0;
+      return false;
+    }
+    if(m_distance == 0.0) return true;
+
+    // Assume the maximum velocity is reached
+    if(max_vel * max_jerk >= max_acc * max_acc){
+      m_tj = max_acc / max_jerk;
+      m_ta = m_tj + max_vel / max_acc;
+    }
+    else{
+      m_tj = sqrt(max_vel / max_jerk);
+      m_ta = 2.0 * m_tj;
+    }
+    m_tv = m_distance / max_vel - m_ta;
+
+    // The maximum velocity is not reached: there is no constant velocity phase
+    if(m_tv < 0.0){
+      m_tv = 0.0;
+      if(m_distance >= 2.0 * max_acc * max_acc * max_acc / (max_jerk * max_jerk)){
+        m_tj = max_acc / max_jerk;
+        m_ta = 0.5 * m_tj + sqrt(0.25 * m_tj * m_tj + m_distance / max_acc);
+      }
+      else{
+        m_tj = pow(0.5 * m_distance / max_jerk, 1.0 / 3.0);
+        m_ta = 2.0 * m_tj;
+      }
+    }
+    m_jerk = max_jerk;
+    m_acc_lim = max_jerk * m_tj;
+    m_vel_lim = (m_ta - m_tj) * m_acc_lim;
+    return true;
+  }
+
+  void JerkLimitedProfile::stretch(double duration){
+    double optimal = 2.0 * m_ta + m_tv;
+    if(optimal > 0.0 && duration > optimal){
+      m_scale = duration / optimal;
+    }
+  }
+
+  double JerkLimitedProfile::duration() const{
+    return m_scale * (2.0 * m_ta + m_tv);
+  }
+
+  void JerkLimitedProfile::sample(double t, double& pos, double& vel, double& acc) const{
+    double total = 2.0 * m_ta + m_tv;
+    // Time in the unscaled profile
+    double tau = t / m_scale;
+    if(m_distance == 0.0 || tau >= total){
+      pos = m_sign * m_distance;
+      vel = acc = 0.0;
+      return;
+    }
+    if(tau <= 0.0){
+      pos = vel = acc = 0.0;
+      return;
+    }
+    if(tau < m_ta){
+      sampleAcceleration(tau, pos, vel, acc);
+    }
+    else if(tau < m_ta + m_tv){
+      pos = 0.5 * m_vel_lim * m_ta + m_vel_lim * (tau - m_ta);
+      vel = m_vel_lim;
+      acc = 0.0;
+    }
+    else{
+      // The deceleration phase mirrors the acceleration phase
+      sampleAcceleration(total - tau, pos, vel, acc);
+      pos = m_distance - pos;
+      acc = -acc;
+    }
+    pos *= m_sign;
+    vel *= m_sign / m_scale;
+    acc *= m_sign / (m_scale * m_scale);
+  }
+
+  void JerkLimitedProfile::sampleAcceleration(double t, double& pos, double& vel, double& acc) const{
+    if(t < m_tj){
+      // Increasing acceleration
+      pos = m_jerk * t * t * t / 6.0;
+      vel = 0.5 * m_jerk * t * t;
+      acc = m_jerk * t;
+    }
+    else if(t < m_ta - m_tj){
+      // Constant acceleration
+      pos = m_acc_lim / 6.0 * (3.0 * t * t - 3.0 * m_tj * t + m_tj * m_tj);
+      vel = m_acc_lim * (t - 0.5 * m_tj);
+      acc = m_acc_lim;
+    }
+    else{
+      // Decreasing acceleration
+      double rem = m_ta - t;
+      pos = 0.5 * m_vel_lim * m_ta - m_vel_lim * rem + m_jerk * rem * rem * rem / 6.0;
+      vel = m_vel_lim - 0.5 * m_jerk * rem * rem;
+      acc = m_jerk * rem;
+    }
+  }
+}
@@ -0,0 +1,122 @@
+/******************************************************************************
+*                    OROCOS Youbot controller component                       *
+*                                                                             *
+*                         (C) 2011 Steven Bellens                             *
+*                     steven.bellens@mech.kuleuven.be                         *
+*                    Department of Mechanical Engineering,                    *
+*                   Katholieke Universiteit Leuven, Belgium.                  *
+*                                                                             *
+*       You may redistribute this software and/or modify it under either the  *
+*       terms of the GNU Lesser General Public License version 2.1 (LGPLv2.1  *
+*       <http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>) or (at your *
+*       discretion) of the Modified BSD License:                              *
+*       Redistribution and use in source and binary forms, with or without    *
+*       modification, are permitted provided that the following conditions    *
+*       are met:                                                              *
+*       1. Redistributions of source code must retain the above copyright     *
+*       notice, this list of conditions and the following disclaimer.         *
+*       2. Redistributions in binary form must reproduce the above copyright  *
+*       notice, this list of conditions and the following disclaimer in the   *
+*       documentation and/or other materials provided with the distribution.  *
+*       3. The name of the author may not be used to endorse or promote       *
+*       products derived from this software without specific prior written    *
+*       permission.                                                           *
+*       THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR  *
+*       IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED        *
+*       WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE    *
+*       ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,*
+*       INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    *
+*       (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS       *
+*       OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) *
+*       HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,   *
+*       STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING *
+*       IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE    *
+*       POSSIBILITY OF SUCH DAMAGE.                                           *
+*                                                                             *
+*******************************************************************************/
+/* @Description:
+ * @brief Jerk limited motion profile for the Youbot controller
+ * @Author: Steven Bellens
+ */
+
+ /*
+  * A rest-to-rest, time-optimal motion profile with bounded velocity,
+  * acceleration and jerk (the classic seven segment 'double S' profile). The
+  * profile is planned once in closed form; sampling it costs the same for
+  * every point in time.
+ */
+#ifndef _YOUBOT_JERK_LIMITED_PROFILE_
+#define _YOUBOT_JERK_LIMITED_PROFILE_
+
+namespace youbot{
+
+  class JerkLimitedProfile{
+    public:
+      /**
+       * \brief Constructor
+       *
+       * Constructs an empty profile (zero distance, zero duration)
+       */
+      JerkLimitedProfile();
+
+      /**
+       * \brief Plan a rest-to-rest profile
+       *
+       * Plans the time-optimal profile covering the (signed) distance
+       * with the given limits.
+       * \param distance The signed distance to cover
+       * \param max_vel Maximum velocity (> 0)
+       * \param max_acc Maximum acceleration (> 0)
+       * \param max_jerk Maximum jerk (> 0)
+       * \return false if one of the limits is not strictly positive
+       */
+      bool plan(double distance, double max_vel, double max_acc, double max_jerk);
+
+      /**
+       * \brief Stretch the profile in time
+       *
+       * Slows down the profile so that it takes the given duration. Scaling
+       * time keeps all limits satisfied. Durations shorter than the
+       * time-optimal duration are ignored.
+       * \param duration The new duration of the profile
+       */
+      void stretch(double duration);
+
+      /// Duration of the profile
+      double duration() const;
+
+      /**
+       * \brief Sample the profile
+       *
+       * \param t Time since the start of the profile
+       * \param pos Position at time t (relative to the start)
+       * \param vel Velocity at time t
+       * \param acc Acceleration at time t
+       */
+      void sample(double t, double& pos, double& vel, double& acc) const;
+
+    private:
+      /// Sample the acceleration half of the (unscaled) profile
+      void sampleAcceleration(double t, double& pos, double& vel, double& acc) const;
+
+      /// Absolute distance to cover
+      double m_distance;
+      /// Direction of motion (+1 or -1)
+      double m_sign;
+      /// Duration of the constant jerk phases
+      double m_tj;
+      /// Duration of the acceleration (and deceleration) phase
+      double m_ta;
+      /// Duration of the constant velocity phase
+      double m_tv;
+      /// Jerk used by the profile
+      double m_jerk;
+      /// Highest acceleration reached by the profile
+      double m_acc_lim;
+      /// Highest velocity reached by the profile
+      double m_vel_lim;
+      /// Time scale factor (>= 1) applied by stretch()
+      double m_scale;
+  };
+}
+#endif // _YOUBOT_JERK_LIMITED_PROFILE_
@@ -0,0 +1,190 @@
+/******************************************************************************
+*                    OROCOS Youbot controller component                       *
+*                                                                             *
+*                         (C) 2011 Steven Bellens                             *
+*                     steven.bellens@mech.kuleuven.be                         *
+*                    Department of Mechanical Engineering,                    *
+*                   Katholieke Universiteit Leuven, Belgium.                  *
+*                                                                             *
+*       You may redistribute this software and/or modify it under either the  *
+*       terms of the GNU Lesser General Public License version 2.1 (LGPLv2.1  *
+*       <http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>) or (at your *
+*       discretion) of the Modified BSD License:                              *
+*       Redistribution and use in source and binary forms, with or without    *
+*       modification, are permitted provided that the following conditions    *
+*       are met:                                                              *
+*       1. Redistributions of source code must retain the above copyright     *
+*       notice, this list of conditions and the following disclaimer.         *
+*       2. Redistributions in binary form must reproduce the above copyright  *
+*       notice, this list of conditions and the following disclaimer in the   *
+*       documentation and/or other materials provided with the distribution.  *
+*       3. The name of the author may not be used to endorse or promote       *
+*       products derived from this software without specific prior written    *
+*       permission.                                                           *
+*       THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR  *
+*       IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED        *
+*       WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE    *
+*       ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,*
+*       INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    *
+*       (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS       *
+*       OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) *
+*       HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,   *
+*       STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING *
+*       IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE    *
+*       POSSIBILITY OF SUCH DAMAGE.                                           *
+*                                                                             *
+*******************************************************************************/
+#include "mpcSolver.hpp"
+
+#include <math.h>
+#include <algorithm>
+
+namespace youbot{
+  MpcSolver::MpcSolver()
+  :m_horizon(0)
+  ,m_dt(0.0)
+  ,m_period(0.0)
+  ,m_step(0.0)
+  {
+    for(unsigned int i = 0; i < 3; i++){
+      m_q[i] = m_r[i] = m_s[i] = m_vmax[i] = m_dumax[i] = m_dumax_first[i] = 0.0;
+      m_x0[i] = m_u_prev[i] = 0.0;
+    }
+  }
+
+  void MpcSolver::resize(unsigned int horizon, double dt, double period){
+    m_horizon = horizon;
+    m_dt = dt;
+    m_period = period;
+    m_solution.assign(3 * horizon, 0.0);
+    m_u.assign(3 * horizon, 0.0);
+    m_grad.assign(3 * horizon, 0.0);
+    m_x.assign(3 * (horizon + 1), 0.0);
+    m_ref.assign(3 * (horizon + 1), 0.0);
+    m_lambda.assign(3 * (horizon + 1), 0.0);
+  }
+
+  void MpcSolver::setParameters(const std::vector<double>& state_weight, const std::vector<double>& input_weight,
+                                const std::vector<double>& rate_weight, const std::vector<double>& max_velocity,
+                                const std::vector<double>& max_acceleration, double step){
+    for(unsigned int i = 0; i < 3; i++){
+      m_q[i] = state_weight[i];
+      m_r[i] = input_weight[i];
+      m_s[i] = rate_weight[i];
+      m_vmax[i] = fabs(max_velocity[i]);
+      m_dumax[i] = fabs(max_acceleration[i]) * m_dt;
+      m_dumax_first[i] = fabs(max_acceleration[i]) * m_period;
+    }
+    m_step = step;
+  }
+
+  void MpcSolver::reset(){
+    std::fill(m_solution.begin(), m_solution.end(), 0.0);
+    std::fill(m_u.begin(), m_u.end(), 0.0);
+  }
+
+  void MpcSolver::prepare(const double* state, const double* input){
+    for(unsigned int i = 0; i < 3; i++){
+      m_x0[i] = state[i];
+      m_u_prev[i] = input[i];
+    }
+    // Warm start: shift the previous solution, repeat its last input
+    if(m_horizon > 1){
+      std::copy(m_solution.begin() + 3, m_solution.end(), m_solution.begin());
+    }
+    project(m_solution);
+    m_u = m_solution;
+  }
+
+  double MpcSolver::step() const{
+    return m_dt;
+  }
+
+  double* MpcSolver::reference(unsigned int k){
+    return &m_ref[3 * k];
+  }
+
+  void MpcSolver::iterate(){
+    rollout(m_u);
+    // Adjoint states, backwards in time
+    unsigned int n = m_horizon;
+    for(unsigned int i = 0; i < 3; i++){
+      m_lambda[3*n + i] = 2.0 * m_q[i] * (m_x[3*n + i] - m_ref[3*n + i]);
+    }
+    for(unsigned int k = n - 1; k >= 1; k--){
+      const double* u = &m_u[3*k];
+      const double* x = &m_x[3*k];
+      const double* next = &m_lambda[3*(k+1)];
+      double c = cos(x[2]), s = sin(x[2]);
+      for(unsigned int i = 0; i < 3; i++){
+        m_lambda[3*k + i] = 2.0 * m_q[i] * (x[i] - m_ref[3*k + i]) + next[i];
+      }
+      m_lambda[3*k + 2] += m_dt * (next[0] * (-s * u[0] - c * u[1]) + next[1] * (c * u[0] - s * u[1]));
+    }
+    // Gradient with respect to the inputs
+    for(unsigned int k = 0; k < n; k++){
+      const double* u = &m_u[3*k];
+      const double* prev = (k == 0) ? m_u_prev : &m_u[3*(k-1)];
+      const double* next = &m_lambda[3*(k+1)];
+      double c = cos(m_x[3*k + 2]), s = sin(m_x[3*k + 2]);
+      m_grad[3*k + 0] = m_dt * (c * next[0] + s * next[1]);
+      m_grad[3*k + 1] = m_dt * (-s * next[0] + c * next[1]);
+      m_grad[3*k + 2] = m_dt * next[2];
+      for(unsigned int i = 0; i < 3; i++){
+        m_grad[3*k + i] += 2.0 * m_r[i] * u[i] + 2.0 * m_s[i] * (u[i] - prev[i]);
+        if(k + 1 < n) m_grad[3*k + i] -= 2.0 * m_s[i] * (m_u[3*(k+1) + i] - u[i]);
+      }
+    }
+    for(unsigned int j = 0; j < m_u.size(); j++){
+      m_u[j] -= m_step * m_grad[j];
+    }
+    project(m_u);
+  }
+
+  void MpcSolver::accept(){
+    m_solution = m_u;
+  }
+
+  const double* MpcSolver::input() const{
+    return &m_solution[0];
+  }
+
+  double MpcSolver::cost(){
+    return rollout(m_solution);
+  }
+
+  double MpcSolver::rollout(const std::vector<double>& u){
+    double cost = 0.0;
+    for(unsigned int i = 0; i < 3; i++) m_x[i] = m_x0[i];
+    for(unsigned int k = 0; k < m_horizon; k++){
+      const double* uk = &u[3*k];
+      const double* prev = (k == 0) ? m_u_prev : &u[3*(k-1)];
+      const double* x = &m_x[3*k];
+      double* next = &m_x[3*(k+1)];
+      double c = cos(x[2]), s = sin(x[2]);
+      next[0] = x[0] + m_dt * (c * uk[0] - s * uk[1]);
+      next[1] = x[1] + m_dt * (s * uk[0] + c * uk[1]);
+      next[2] = x[2] + m_dt * uk[2];
+      for(unsigned int i = 0; i < 3; i++){
+        double e = next[i] - m_ref[3*(k+1) + i];
+        double du = uk[i] - prev[i];
+        cost += m_q[i] * e * e + m_r[i] * uk[i] * uk[i] + m_s[i] * du * du;
+      }
+    }
+    return cost;
+  }
+
+  void MpcSolver::project(std::vector<double>& u){
+    // Clamp the velocity, then the change with respect to the previous step;
+    // the first input follows the applied input after one control period
+    for(unsigned int k = 0; k < m_horizon; k++){
+      const double* prev = (k == 0) ? m_u_prev : &u[3*(k-1)];
+      const double* dumax = (k == 0) ? m_dumax_first : m_dumax;
+      for(unsigned int i = 0; i < 3; i++){
+        double& v = u[3*k + i];
+        v = std::max(prev[i] - dumax[i], std::min(prev[i] + dumax[i], v));
+        v = std::max(-m_vmax[i], std::min(m_vmax[i], v));
+      }
+    }
+  }
+}
@@ -0,0 +1,155 @@
+/******************************************************************************
+*                    OROCOS Youbot controller component                       *
+*                                                                             *
+*                         (C) 2011 Steven Bellens                             *
+*                     steven.bellens@mech.kuleuven.be                         *
+*                    Department of Mechanical Engineering,                    *
+*                   Katholieke Universiteit Leuven, Belgium.                  *
+*                                                                             *
+*       You may redistribute this software and/or modify it under either the  *
+*       terms of the GNU Lesser General Public License version 2.1 (LGPLv2.1  *
+*       <http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>) or (at your *
+*       discretion) of the Modified BSD License:                              *
+*       Redistribution and use in source and binary forms, with or without    *
+*       modification, are permitted provided that the following conditions    *
+*       are met:                                                              *
+*       1. Redistributions of source code must retain the above copyright     *
+*       notice, this list of conditions and the following disclaimer.         *
+*       2. Redistributions in binary form must reproduce the above copyright  *
+*       notice, this list of conditions and the following disclaimer in the   *
+*       documentation and/or other materials provided with the distribution.  *
+*       3. The name of the author may not be used to endorse or promote       *
+*       products derived from this software without specific prior written    *
+*       permission.                                                           *
+*       THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR  *
+*       IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED        *
+*       WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE    *
+*       ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,*
+*       INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    *
+*       (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS       *
+*       OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) *
+*       HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,   *
+*       STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING *
+*       IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE    *
+*       POSSIBILITY OF SUCH DAMAGE.                                           *
+*                                                                             *
+*******************************************************************************/
+/* @Description:
+ * @brief Model predictive controller for the Youbot controller
+ * @Author: Steven Bellens
+ */
+
+ /*
+  * A model predictive controller for the holonomic YouBot base. The
+  * prediction uses the motion model of the estimator
+  * (NonLinearAnalyticConditionalGaussianMobile, constant position level):
+  *   x(k+1) = x(k) + T (cos(theta) vx - sin(theta) vy)
+  *   y(k+1) = y(k) + T (sin(theta) vx + cos(theta) vy)
+  *   theta(k+1) = theta(k) + T omega
+  * The optimal control problem (tracking cost, input cost and input rate
+  * cost, subject to velocity and acceleration limits) is solved with a
+  * fixed number of projected gradient iterations, warm started from the
+  * previous solution. All workspaces are allocated by resize(), so iterating
+  * does not allocate memory.
+ */
+#ifndef _YOUBOT_MPC_SOLVER_
+#define _YOUBOT_MPC_SOLVER_
+
+#include <vector>
+
+namespace youbot{
+
+  class MpcSolver{
+    public:
+      /// Constructor, the solver needs to be resized before use
+      MpcSolver();
+
+      /**
+       * \brief Allocate the workspaces
+       *
+       * \param horizon The number of steps of the prediction horizon
+       * \param dt The duration of one step of the prediction horizon
+       * \param period The time between two solutions: the first input
+       * changes the previously applied input over this time, not over dt
+       */
+      void resize(unsigned int horizon, double dt, double period);
+
+      /**
+       * \brief Set the weights and the limits
+       *
+       * All vectors have 3 elements [x y yaw]; the inputs are expressed in
+       * the YouBot frame.
+       * \param state_weight Weight on the tracking error
+       * \param input_weight Weight on the input
+       * \param rate_weight Weight on the input change between two steps
+       * \param max_velocity Maximum input
+       * \param max_acceleration Maximum input change per second
+       * \param step Gradient step size
+       */
+      void setParameters(const std::vector<double>& state_weight, const std::vector<double>& input_weight,
+                         const std::vector<double>& rate_weight, const std::vector<double>& max_velocity,
+                         const std::vector<double>& max_acceleration, double step);
+
+      /// Reset the solution to zero inputs
+      void reset();
+
+      /**
+       * \brief Prepare a new optimal control problem
+       *
+       * Shifts the previous solution one step in time; it is both the
+       * starting point of the iterations and the fall back solution.
+       * \param state The current pose [x y theta]
+       * \param input The input applied during the previous step [vx vy omega]
+       */
+      void prepare(const double* state, const double* input);
+
+      /// Duration of one step of the prediction horizon
+      double step() const;
+
+      /// Reference pose [x y theta] at step k (1..horizon) of the horizon
+      double* reference(unsigned int k);
+
+      /// Perform one projected gradient iteration
+      void iterate();
+
+      /// Accept the iterate as the new solution
+      void accept();
+
+      /// Input to apply now [vx vy omega]
+      const double* input() const;
+
+      /// Cost of the accepted solution
+      double cost();
+
+    private:
+      /// Simulate the model over the horizon for the inputs u, returns the cost
+      double rollout(const std::vector<double>& u);
+      /// Project the inputs onto the velocity and acceleration limits
+      void project(std::vector<double>& u);
+
+      unsigned int m_horizon;
+      double m_dt;
+      double m_period;
+      double m_q[3], m_r[3], m_s[3], m_vmax[3], m_dumax[3];
+      /// Maximum change of the first input with respect to the applied input
+      double m_dumax_first[3];
+      double m_step;
+      /// Current pose
+      double m_x0[3];
+      /// Previously applied input
+      double m_u_prev[3];
+      /// Accepted solution, horizon x 3 inputs
+      std::vector<double> m_solution;
+      /// Iterate, horizon x 3 inputs
+      std::vector<double> m_u;
+      /// Predicted states, (horizon + 1) x 3
+      std::vector<double> m_x;
+      /// Reference states, (horizon + 1) x 3
+      std::vector<double> m_ref;
+      /// Adjoint states, (horizon + 1) x 3
+      std::vector<double> m_lambda;
+      /// Gradient, horizon x 3
+      std::vector<double> m_grad;
+  };
+}
+#endif // _YOUBOT_MPC_SOLVER_
@@ -0,0 +1,203 @@
+/******************************************************************************
+*                          OROCOS Youbot diagnostics                          *
+*                                                                             *
+*                         (C) 2011 Steven Bellens                             *
+*                     steven.bellens@mech.kuleuven.be                         *
+*                    Department of Mechanical Engineering,                    *
+*                   Katholieke Universiteit Leuven, Belgium.                  *
+*                                                                             *
+*       You may redistribute this software and/or modify it under either the  *
+*       terms of the GNU Lesser General Public License version 2.1 (LGPLv2.1  *
+*       <http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>) or (at your *
+*       discretion) of the Modified BSD License:                              *
+*       Redistribution and use in source and binary forms, with or without    *
+*       modification, are permitted provided that the following conditions    *
+*       are met:                                                              *
+*       1. Redistributions of source code must retain the above copyright     *
+*       notice, this list of conditions and the following disclaimer.         *
+*       2. Redistributions in binary form must reproduce the above copyright  *
+*       notice, this list of conditions and the following disclaimer in the   *
+*       documentation and/or other materials provided with the distribution.  *
+*       3. The name of the author may not be used to endorse or promote       *
+*       products derived from this software without specific prior written    *
+*       permission.                                                           *
+*       THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR  *
+*       IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED        *
+*       WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE    *
+*       ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,*
+*       INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    *
+*       (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS       *
+*       OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) *
+*       HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,   *
+*       STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING *
+*       IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE    *
+*       POSSIBILITY OF SUCH DAMAGE.                                           *
+*                                                                             *
+*******************************************************************************/
+
+
+#include "healthMonitor.hpp"
+#include "hookStatsService.hpp"
+
+#include <algorithm>
+
+// This macro is used whenever a new Orocos component is generated. Here we
+// generate a Youbot HealthMonitor component.
+ORO_CREATE_COMPONENT(youbot::HealthMonitor)
+
+namespace youbot{
+  HealthMonitor::HealthMonitor(std::string name) : TaskContext(name,PreOperational)
+  ,m_overrun_fraction(0.05)
+  ,m_overload_windows(5)
+  ,m_recovery_windows(20)
+  ,m_level(NOMINAL)
+  ,m_start(0)
+  ,m_overloaded(0)
+  ,m_clean(0)
+  {
+    this->addPort("health",health_port).doc("Health level: 0 nominal, 1 degraded, 2 overloaded, 3 stale; written when it changes");
+    this->addProperty("watch",m_watch).doc("Watched hooks, as \"Peer.hook\" (the peers need the hookstats service)");
+    this->addProperty("timeout",m_timeout).doc("Per watched hook: time without activation after which it is stale [s], 0: not checked");
+    this->addProperty("overrun_fraction",m_overrun_fraction).doc("Fraction of the activations in a window that may exceed the budget");
+    this->addProperty("overload_windows",m_overload_windows).doc("Number of windows in a row over budget before the system is overloaded");
+    this->addProperty("recovery_windows",m_recovery_windows).doc("Number of windows without problems before the level goes down one step");
+    this->addProperty("level",m_level).doc("Current health level (read only)");
+    this->addProperty("cause",m_cause).doc("Cause of the last change of the health level (read only)");
+  }
+
+  HealthMonitor::~HealthMonitor(){}
+
+  const char* HealthMonitor::levelName(int level){
+    switch(level){
+      case NOMINAL: return "nominal";
+      case DEGRADED: return "degraded";
+      case OVERLOADED: return "overloaded";
+      case STALE: return "stale";
+      default: return "unknown";
+    }
+  }
+
+  bool HealthMonitor::configureHook(){
+    if(m_timeout.size() != m_watch.size()){
+      log(Error) << "(HealthMonitor) timeout needs one element per watched hook" << endlog();
+      return false;
+    }
+    if(m_overrun_fraction < 0.0 || m_overload_windows <= 0 || m_recovery_windows <= 0){
+      log(Error) << "(HealthMonitor) The overrun fraction must not be negative, the window counts must be positive" << endlog();
+      return false;
+    }
+    m_hooks.clear();
+    for(unsigned int i = 0; i < m_watch.size(); ++i){
+      std::string::size_type dot = m_watch[i].find('.');
+      if(dot == std::string::npos){
+        log(Error) << "(HealthMonitor) Watched hook " << m_watch[i] << " is not of the form Peer.hook" << endlog();
+        return false;
+      }
+      std::string peer = m_watch[i].substr(0, dot);
+      if(!this->hasPeer(peer)){
+        log(Error) << "(HealthMonitor) component has no peer " << peer << endlog();
+        return false;
+      }
+      Watched w;
+      w.name = m_watch[i];
+      w.probe = HookStatsService::find(this->getPeer(peer), m_watch[i].substr(dot + 1));
+      if(!w.probe){
+        log(Error) << "(HealthMonitor) " << peer << " has no probe for " << m_watch[i].substr(dot + 1)
+                   << ": load its hookstats service and configure it before the monitor" << endlog();
+        return false;
+      }
+      w.timeout = m_timeout[i];
+      w.count = 0;
+      w.overruns = 0;
+      m_hooks.push_back(w);
+    }
+    health_port.setDataSample(NOMINAL);
+    return true;
+  }
+
+  bool HealthMonitor::startHook(){
+    m_start = RTT::os::TimeService::Instance()->getTicks();
+    for(unsigned int i = 0; i < m_hooks.size(); ++i){
+      m_hooks[i].count = m_hooks[i].probe->execution().count();
+      m_hooks[i].overruns = m_hooks[i].probe->overruns();
+    }
+    m_overloaded = 0;
+    m_clean = 0;
+    m_level = NOMINAL;
+    m_cause = "";
+    health_port.write(m_level);
+    return true;
+  }
+
+  void HealthMonitor::updateHook(){
+    RTT::os::TimeService::ticks now = RTT::os::TimeService::Instance()->getTicks();
+    std::string over_budget, stale;
+    for(unsigned int i = 0; i < m_hooks.size(); ++i){
+      Watched& w = m_hooks[i];
+      unsigned long long count = w.probe->execution().count();
+      unsigned long long overruns = w.probe->overruns();
+      /// The statistics of the probe were reset
+      if(count < w.count || overruns < w.overruns) w.count = w.overruns = 0;
+      unsigned long long activations = count - w.count;
+      unsigned long long missed = overruns - w.overruns;
+      w.count = count;
+      w.overruns = overruns;
+      if(missed > 0 && missed > m_overrun_fraction * activations)
+        over_budget = w.name + " over budget";
+      if(w.timeout > 0.0){
+        RTT::os::TimeService::ticks last = std::max(w.probe->lastActivation(), m_start);
+        if(RTT::os::TimeService::ticks2nsecs(now - last) * 1e-9 > w.timeout)
+          stale = w.name + " stale";
+      }
+    }
+
+    if(!over_budget.empty()){
+      ++m_overloaded;
+      m_clean = 0;
+    }
+    else{
+      m_overloaded = 0;
+      if(stale.empty()) ++m_clean;
+      else m_clean = 0;
+    }
+
+    int level = m_level;
+    std::string cause;
+    if(!stale.empty()){
+      level = STALE;
+      cause = stale;
+    }
+    else if(!over_budget.empty()){
+      /// Leaving STALE: only the budget counters decide, the stale level does not count
+      int base = (m_level == STALE) ? (int)NOMINAL : m_level;
+      level = std::max(base, m_overloaded >= m_overload_windows ? (int)OVERLOADED : (int)DEGRADED);
+      cause = over_budget;
+    }
+    else if(m_level == STALE && m_clean >= m_recovery_windows){
+      /// Fresh data and no hook over budget: not through OVERLOADED, which would slow down for nothing
+      level = NOMINAL;
+      cause = "recovering";
+      m_clean = 0;
+    }
+    else if(m_level != NOMINAL && m_clean >= m_recovery_windows){
+      /// Recover one step at a time
+      level = m_level - 1;
+      cause = "recovering";
+      m_clean = 0;
+    }
+
+    if(level != m_level){
+      log(level > m_level ? Warning : Info) << "(HealthMonitor) " << levelName(m_level) << " -> " << levelName(level) << ": " << cause << endlog();
+      m_level = level;
+      m_cause = cause;
+      health_port.write(m_level);
+    }
+  }
+
+  void HealthMonitor::stopHook(){
+  }
+
+  void HealthMonitor::cleanupHook(){
+    m_hooks.clear();
+  }
+}
@@ -0,0 +1,169 @@
+/******************************************************************************
+*                          OROCOS Youbot diagnostics                          *
+*                                                                             *
+*                         (C) 2011 Steven Bellens                             *
+*                     steven.bellens@mech.kuleuven.be                         *
+*                    Department of Mechanical Engineering,                    *
+*                   Katholieke Universiteit Leuven, Belgium.                  *
+*                                                                             *
+*       You may redistribute this software and/or modify it under either the  *
+*       terms of the GNU Lesser General Public License version 2.1 (LGPLv2.1  *
+*       <http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>) or (at your *
+*       discretion) of the Modified BSD License:                              *
+*       Redistribution and use in source and binary forms, with or without    *
+*       modification, are permitted provided that the following conditions    *
+*       are met:                                                              *
+*       1. Redistributions of source code must retain the above copyright     *
+*       notice, this list of conditions and the following disclaimer.         *
+*       2. Redistributions in binary form must reproduce the above copyright  *
+*       notice, this list of conditions and the following disclaimer in the   *
+*       documentation and/or other materials provided with the distribution.  *
+*       3. The name of the author may not be used to endorse or promote       *
+*       products derived from this software without specific prior written    *
+*       permission.                                                           *
+*       THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR  *
+*       IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED        *
+*       WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE    *
+*       ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,*
+*       INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    *
+*       (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS       *
+*       OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) *
+*       HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,   *
+*       STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING *
+*       IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE    *
+*       POSSIBILITY OF SUCH DAMAGE.                                           *
+*                                                                             *
+*******************************************************************************/
+
+
+/* @Description:
+ * @brief Youbot diagnostics - health monitor component
+ * @Author: Steven Bellens
+ */
+
+ /*
+  * The HealthMonitor watches hooks of other components through their
+  * hookstats probes and condenses them into one health level, for the
+  * supervisor. Every period (the monitoring window) it looks at each watched
+  * hook:
+  *
+  *   over budget: more than overrun_fraction of its activations in the
+  *   window exceeded the budget of the probe (<hook>_budget), and
+  *   stale: the hook was not activated for longer than its timeout, so its
+  *   input data stopped arriving.
+  *
+  * A hook over budget makes the system DEGRADED, over budget for
+  * overload_windows windows in a row OVERLOADED. A stale hook makes it STALE
+  * at once. The level only goes down one step at a time, after
+  * recovery_windows windows without problems; STALE is left for the level
+  * the budgets justify (NOMINAL, or DEGRADED/OVERLOADED when a hook is over
+  * budget), as the overload levels say nothing about fresh data. The level is written to the
+  * health port when it changes, so the supervisor can react on the event
+  * instead of polling.
+  *
+  * The monitor only reads the histograms and counters of the probes and
+  * should run at a low, non real-time priority: it never delays the hooks
+  * it is watching. Load the hookstats service in the watched components and
+  * configure them before the monitor.
+ */
+
+#ifndef _YOUBOT_HEALTH_MONITOR_
+#define _YOUBOT_HEALTH_MONITOR_
+
+#include <rtt/TaskContext.hpp>
+#include <rtt/Port.hpp>
+#include <rtt/Property.hpp>
+#include <rtt/Component.hpp>
+#include <rtt/os/TimeService.hpp>
+
+#include "hookProbe.hpp"
+
+#include <string>
+#include <vector>
+
+namespace youbot{
+
+  using namespace std;
+  using namespace RTT;
+
+  class HealthMonitor : public TaskContext{
+    public:
+      /// Health levels, in order of severity
+      enum Level{
+        /// All watched hooks within budget and fresh
+        NOMINAL = 0,
+        /// A hook is over budget
+        DEGRADED = 1,
+        /// A hook is over budget for overload_windows windows in a row
+        OVERLOADED = 2,
+        /// A hook is not activated anymore
+        STALE = 3
+      };
+
+    protected:
+      /// @name Ports
+      //@{
+      /// Health level (Level), written when it changes
+      OutputPort<int> health_port;
+      //@}
+      /// @name Properties
+      //@{
+      /// Watched hooks, as "Peer.hook"
+      std::vector<std::string> m_watch;
+      /// Per watched hook: time without activation after which it is stale [s], 0: not checked
+      std::vector<double> m_timeout;
+      /// Fraction of the activations in a window that may exceed the budget
+      double m_overrun_fraction;
+      /// Number of windows in a row over budget before the system is overloaded
+      int m_overload_windows;
+      /// Number of windows without problems before the level goes down one step
+      int m_recovery_windows;
+      /// Current health level (read only)
+      int m_level;
+      /// Cause of the last change of the health level (read only)
+      std::string m_cause;
+      //@}
+
+    public:
+      /**
+       * \brief Constructor
+       *
+       * Constructor building a Youbot health monitor component
+       * \param name The component name
+       */
+      HealthMonitor(std::string name);
+      //! Destructor
+      ~HealthMonitor();
+
+      /// @name Public methods
+      //@{
+      bool configureHook();
+      bool startHook();
+      void updateHook();
+      void stopHook();
+      void cleanupHook();
+      //@}
+
+      /// Name of a health level, for logging
+      static const char* levelName(int level);
+
+    private:
+      /// A watched hook
+      struct Watched{
+        std::string name;
+        HookProbe* probe;
+        double timeout;
+        /// Activations and overruns at the end of the previous window
+        unsigned long long count;
+        unsigned long long overruns;
+      };
+      std::vector<Watched> m_hooks;
+      /// Start of the monitoring, reference for hooks that were not activated yet
+      RTT::os::TimeService::ticks m_start;
+      /// Number of windows in a row with a hook over budget
+      int m_overloaded;
+      /// Number of windows in a row without problems
+      int m_clean;
+  };
+}
+#endif
@@ -0,0 +1,166 @@
+/******************************************************************************
+*                          OROCOS Youbot diagnostics                          *
+*                                                                             *
+*                         (C) 2011 Steven Bellens                             *
+*                     steven.bellens@mech.kuleuven.be                         *
+*                    Department of Mechanical Engineering,                    *
+*                   Katholieke Universiteit Leuven, Belgium.                  *
+*                                                                             *
+*       You may redistribute this software and/or modify it under either the  *
+*       terms of the GNU Lesser General Public License version 2.1 (LGPLv2.1  *
+*       <http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>) or (at your *
+*       discretion) of the Modified BSD License:                              *
+*       Redistribution and use in source and binary forms, with or without    *
+*       modification, are permitted provided that the following conditions    *
+*       are met:                                                              *
+*       1. Redistributions of source code must retain the above copyright     *
+*       notice, this list of conditions and the following disclaimer.         *
+*       2. Redistributions in binary form must reproduce the above copyright  *
+*       notice, this list of conditions and the following disclaimer in the   *
+*       documentation and/or other materials provided with the distribution.  *
+*       3. The name of the author may not be used to endorse or promote       *
+*       products derived from this software without specific prior written    *
+*       permission.                                                           *
+*       THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR  *
+*       IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED        *
+*       WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE    *
+*       ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,*
+*       INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    *
+*       (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS       *
+*       OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) *
+*       HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,   *
+*       STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING *
+*       IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE    *
+*       POSSIBILITY OF SUCH DAMAGE.                                           *
+*                                                                             *
+*******************************************************************************/
+
+/* @Description:
+ * @brief Youbot diagnostics - execution time and jitter of a hook
+ * @Author: Steven Bellens
+ */
+
+ /*
+  * A HookProbe measures one hook of a component: updateHook() or an event
+  * port callback. A HookTimer at the top of the hook starts the probe and
+  * stops it when the hook returns. Per activation the probe records
+  *
+  *   the execution time of the hook,
+  *   the interval since the previous activation,
+  *   the jitter: how far that interval is off the nominal period, and
+  *   an overrun when the execution took longer than the budget.
+  *
+  * The histograms are only written by the thread running the hook, with
+  * plain increments and two clock reads per activation. A reset requested
+  * from another thread is carried out by that thread at the end of its next
+  * activation. The probes are handed out by the hookstats service
+  * (HookStatsService::probe()); without the service loaded the components
+  * get no probe and the HookTimer does nothing.
+ */
+
+#ifndef _YOUBOT_HOOK_PROBE_
+#define _YOUBOT_HOOK_PROBE_
+
+#include "latencyHistogram.hpp"
+
+#include <rtt/os/TimeService.hpp>
+
+#include <string>
+
+namespace youbot{
+
+  class HookProbe{
+    public:
+      /**
+       * \brief Constructor
+       *
+       * \param name The name of the hook
+       * \param period Nominal period of the hook in seconds (0: not
+       * periodic, the jitter is not recorded); also the default budget
+       */
+      HookProbe(const std::string& name, double period)
+        : m_period(period)
+        , m_budget(period)
+        , m_name(name)
+        , m_start(0)
+        , m_overruns(0)
+        , m_reset(false)
+      {}
+
+      /// @name Real-time, thread of the hook
+      //@{
+      void start(){
+        RTT::os::TimeService::ticks now = RTT::os::TimeService::Instance()->getTicks();
+        if(m_start != 0){
+          long long interval = RTT::os::TimeService::ticks2nsecs(now - m_start);
+          m_interval.record(interval);
+          if(m_period > 0.0){
+            long long jitter = interval - (long long)(m_period * 1e9);
+            m_jitter.record(jitter < 0 ? -jitter : jitter);
+          }
+        }
+        m_start = now;
+      }
+
+      void stop(){
+        long long execution = RTT::os::TimeService::ticks2nsecs(RTT::os::TimeService::Instance()->getTicks() - m_start);
+        if(m_reset){
+          /// Keep m_start: it is the last activation the health monitor checks for stale hooks
+          m_execution.reset();
+          m_interval.reset();
+          m_jitter.reset();
+          m_overruns = 0;
+          m_reset = false;
+          return;
+        }
+        m_execution.record(execution);
+        if(m_budget > 0.0 && execution > m_budget * 1e9) ++m_overruns;
+      }
+      //@}
+
+      /// @name Any thread
+      //@{
+      /// Clear the statistics at the end of the next activation
+      void requestReset(){ m_reset = true; }
+      const std::string& name() const{ return m_name; }
+      /// Execution time of the hook [ns]
+      const LatencyHistogram& execution() const{ return m_execution; }
+      /// Time between two activations [ns]
+      const LatencyHistogram& interval() const{ return m_interval; }
+      /// Deviation of the interval from the nominal period [ns]
+      const LatencyHistogram& jitter() const{ return m_jitter; }
+      /// Number of activations that took longer than the budget
+      unsigned long long overruns() const{ return m_overruns; }
+      /// Start of the last activation (0: none yet)
+      RTT::os::TimeService::ticks lastActivation() const{ return m_start; }
+      //@}
+
+      /// Nominal period [s], may be changed at runtime (property)
+      double m_period;
+      /// Budget of one activation [s], 0 disables the overrun count (property)
+      double m_budget;
+
+    private:
+      std::string m_name;
+      volatile RTT::os::TimeService::ticks m_start;
+      LatencyHistogram m_execution;
+      LatencyHistogram m_interval;
+      LatencyHistogram m_jitter;
+      volatile unsigned long long m_overruns;
+      volatile bool m_reset;
+  };
+
+  /**
+   * \brief Measures the enclosing scope with a HookProbe
+   *
+   * Does nothing when the probe is 0 (hookstats service not loaded).
+   */
+  class HookTimer{
+    public:
+      explicit HookTimer(HookProbe* probe) : m_probe(probe){ if(m_probe) m_probe->start(); }
+      ~HookTimer(){ if(m_probe) m_probe->stop(); }
+    private:
+      HookProbe* m_probe;
+  };
+}
+#endif
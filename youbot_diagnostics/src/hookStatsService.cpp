@@ -0,0 +1,135 @@
+/******************************************************************************
+*                          OROCOS Youbot diagnostics                          *
+*                                                                             *
+*                         (C) 2011 Steven Bellens                             *
+*                     steven.bellens@mech.kuleuven.be                         *
+*                    Department of Mechanical Engineering,                    *
+*                   Katholieke Universiteit Leuven, Belgium.                  *
+*                                                                             *
+*       You may redistribute this software and/or modify it under either the  *
+*       terms of the GNU Lesser General Public License version 2.1 (LGPLv2.1  *
+*       <http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>) or (at your *
+*       discretion) of the Modified BSD License:                              *
+*       Redistribution and use in source and binary forms, with or without    *
+*       modification, are permitted provided that the following conditions    *
+*       are met:                                                              *
+*       1. Redistributions of source code must retain the above copyright     *
+*       notice, this list of conditions and the following disclaimer.         *
+*       2. Redistributions in binary form must reproduce the above copyright  *
+*       notice, this list of conditions and the following disclaimer in the   *
+*       documentation and/or other materials provided with the distribution.  *
+*       3. The name of the author may not be used to endorse or promote       *
+*       products derived from this software without specific prior written    *
+*       permission.                                                           *
+*       THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR  *
+*       IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED        *
+*       WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE    *
+*       ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,*
+*       INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    *
+*       (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS       *
+*       OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) *
+*       HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,   *
+*       STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING *
+*       IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE    *
+*       POSSIBILITY OF SUCH DAMAGE.                                           *
+*                                                                             *
+*******************************************************************************/
+
+#include "hookStatsService.hpp"
+
+#include <iomanip>
+#include <sstream>
+
+namespace youbot{
+
+  HookStatsService::HookStatsService(TaskContext* owner) : Service("hookstats",owner)
+  {
+    this->doc("Execution time, activation jitter and overruns of the hooks of the component");
+    this->addOperation("refresh",&HookStatsService::refresh,this).doc("Update the summary properties");
+    this->addOperation("report",&HookStatsService::report,this).doc("Update the summary properties and report them");
+    this->addOperation("reset",&HookStatsService::reset,this).doc("Clear the statistics of all hooks");
+  }
+
+  HookStatsService::~HookStatsService(){
+    for(unsigned int i = 0; i < m_hooks.size(); ++i){
+      delete m_hooks[i]->probe;
+      delete m_hooks[i];
+    }
+  }
+
+  HookProbe* HookStatsService::probe(TaskContext* owner, const std::string& hook, double period){
+    Service::shared_ptr service = owner->provides()->getService("hookstats");
+    HookStatsService* stats = dynamic_cast<HookStatsService*>(service.get());
+    return stats ? stats->add(hook, period) : 0;
+  }
+
+  HookProbe* HookStatsService::find(TaskContext* owner, const std::string& hook){
+    Service::shared_ptr service = owner->provides()->getService("hookstats");
+    HookStatsService* stats = dynamic_cast<HookStatsService*>(service.get());
+    if(!stats) return 0;
+    for(unsigned int i = 0; i < stats->m_hooks.size(); ++i)
+      if(stats->m_hooks[i]->probe->name() == hook) return stats->m_hooks[i]->probe;
+    return 0;
+  }
+
+  HookProbe* HookStatsService::add(const std::string& hook, double period){
+    for(unsigned int i = 0; i < m_hooks.size(); ++i)
+      if(m_hooks[i]->probe->name() == hook) return m_hooks[i]->probe;
+    Hook* h = new Hook();
+    h->probe = new HookProbe(hook, period);
+    m_hooks.push_back(h);
+    this->addProperty(hook + "_period", h->probe->m_period).doc("Nominal period of " + hook + " [s], 0: not periodic");
+    this->addProperty(hook + "_budget", h->probe->m_budget).doc("Execution time allowed to " + hook + " [s], 0: no overrun detection");
+    this->addProperty(hook + "_count", h->count).doc("Number of activations of " + hook);
+    this->addProperty(hook + "_exec_mean", h->exec_mean).doc("Mean execution time of " + hook + " [us]");
+    this->addProperty(hook + "_exec_p99", h->exec_p99).doc("99th percentile of the execution time of " + hook + " [us]");
+    this->addProperty(hook + "_exec_max", h->exec_max).doc("Maximum execution time of " + hook + " [us]");
+    this->addProperty(hook + "_interval_mean", h->interval_mean).doc("Mean time between activations of " + hook + " [us]");
+    this->addProperty(hook + "_jitter_p99", h->jitter_p99).doc("99th percentile of the deviation from the period of " + hook + " [us]");
+    this->addProperty(hook + "_jitter_max", h->jitter_max).doc("Maximum deviation from the period of " + hook + " [us]");
+    this->addProperty(hook + "_overruns", h->overruns).doc("Number of activations of " + hook + " that exceeded the budget");
+    refresh();
+    return h->probe;
+  }
+
+  void HookStatsService::refresh(){
+    for(unsigned int i = 0; i < m_hooks.size(); ++i){
+      Hook* h = m_hooks[i];
+      const HookProbe& probe = *h->probe;
+      h->count = (unsigned int)probe.execution().count();
+      h->exec_mean = probe.execution().mean() * 1e-3;
+      h->exec_p99 = probe.execution().percentile(0.99) * 1e-3;
+      h->exec_max = probe.execution().max() * 1e-3;
+      h->interval_mean = probe.interval().mean() * 1e-3;
+      h->jitter_p99 = probe.jitter().percentile(0.99) * 1e-3;
+      h->jitter_max = probe.jitter().max() * 1e-3;
+      h->overruns = (unsigned int)probe.overruns();
+    }
+  }
+
+  std::string HookStatsService::report(){
+    refresh();
+    std::ostringstream report;
+    report << std::fixed << std::setprecision(1);
+    report << "hook (us)              count exec mean  exec p99  exec max  interval jitter p99 jitter max overruns";
+    for(unsigned int i = 0; i < m_hooks.size(); ++i){
+      const Hook* h = m_hooks[i];
+      report << "\n" << std::left << std::setw(20) << h->probe->name() << std::right
+             << std::setw(8) << h->count
+             << std::setw(10) << h->exec_mean
+             << std::setw(10) << h->exec_p99
+             << std::setw(10) << h->exec_max
+             << std::setw(10) << h->interval_mean
+             << std::setw(11) << h->jitter_p99
+             << std::setw(11) << h->jitter_max
+             << std::setw(9) << h->overruns;
+    }
+    log(Info) << "(HookStatsService) " << getOwner()->getName() << "\n" << report.str() << endlog();
+    return report.str();
+  }
+
+  void HookStatsService::reset(){
+    for(unsigned int i = 0; i < m_hooks.size(); ++i)
+      m_hooks[i]->probe->requestReset();
+  }
+}
@@ -0,0 +1,134 @@
+/******************************************************************************
+*                          OROCOS Youbot diagnostics                          *
+*                                                                             *
+*                         (C) 2011 Steven Bellens                             *
+*                     steven.bellens@mech.kuleuven.be                         *
+*                    Department of Mechanical Engineering,                    *
+*                   Katholieke Universiteit Leuven, Belgium.                  *
+*                                                                             *
+*       You may redistribute this software and/or modify it under either the  *
+*       terms of the GNU Lesser General Public License version 2.1 (LGPLv2.1  *
+*       <http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>) or (at your *
+*       discretion) of the Modified BSD License:                              *
+*       Redistribution and use in source and binary forms, with or without    *
+*       modification, are permitted provided that the following conditions    *
+*       are met:                                                              *
+*       1. Redistributions of source code must retain the above copyright     *
+*       notice, this list of conditions and the following disclaimer.         *
+*       2. Redistributions in binary form must reproduce the above copyright  *
+*       notice, this list of conditions and the following disclaimer in the   *
+*       documentation and/or other materials provided with the distribution.  *
+*       3. The name of the author may not be used to endorse or promote       *
+*       products derived from this software without specific prior written    *
+*       permission.                                                           *
+*       THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR  *
+*       IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED        *
+*       WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE    *
+*       ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,*
+*       INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    *
+*       (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS       *
+*       OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) *
+*       HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,   *
+*       STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING *
+*       IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE    *
+*       POSSIBILITY OF SUCH DAMAGE.                                           *
+*                                                                             *
+*******************************************************************************/
+
+/* @Description:
+ * @brief Youbot diagnostics - hook statistics service
+ * @Author: Steven Bellens
+ */
+
+ /*
+  * The hookstats service measures the hooks of the component it is loaded
+  * in (loadService("Controller","hookstats"), before the component is
+  * configured). In its configureHook() the component asks the service for a
+  * probe per hook (HookStatsService::probe()) and puts a HookTimer at the
+  * top of each hook. For every probe the service offers properties
+  * <hook>_period and <hook>_budget to tune the jitter and overrun
+  * detection, and read-only summaries (<hook>_count, <hook>_exec_mean,
+  * <hook>_exec_p99, <hook>_exec_max, <hook>_interval_mean,
+  * <hook>_jitter_p99, <hook>_jitter_max, <hook>_overruns, times in
+  * microseconds) that are updated by refresh() and report().
+ */
+
+#ifndef _YOUBOT_HOOK_STATS_SERVICE_
+#define _YOUBOT_HOOK_STATS_SERVICE_
+
+#include <rtt/TaskContext.hpp>
+#include <rtt/Service.hpp>
+
+#include "hookProbe.hpp"
+
+#include <string>
+#include <vector>
+
+namespace youbot{
+
+  using namespace std;
+  using namespace RTT;
+
+  class HookStatsService : public Service{
+    public:
+      /**
+       * \brief Constructor
+       *
+       * Constructor building a Youbot hook statistics service
+       * \param owner The component that loads the service
+       */
+      HookStatsService(TaskContext* owner);
+      //! Destructor
+      ~HookStatsService();
+
+      /**
+       * \brief The probe of a hook of a component
+       *
+       * Call from the configureHook() of the component.
+       * \param owner The component
+       * \param hook The name of the hook
+       * \param period Nominal period of the hook [s] (0: not periodic)
+       * \return 0 if the component has no hookstats service
+       */
+      static HookProbe* probe(TaskContext* owner, const std::string& hook, double period);
+
+      /**
+       * \brief Look up the probe of a hook of a component
+       *
+       * For observers such as the HealthMonitor; does not create the probe.
+       * \return 0 if the component has no hookstats service or did not take
+       * a probe for the hook (yet)
+       */
+      static HookProbe* find(TaskContext* owner, const std::string& hook);
+
+      /// @name Public methods
+      //@{
+      /// Update the summary properties
+      void refresh();
+      /// Update the summary properties, log and return them as a table
+      std::string report();
+      /// Clear the statistics of all hooks (at their next activation)
+      void reset();
+      //@}
+
+    private:
+      /// A probe and its summary properties
+      struct Hook{
+        HookProbe* probe;
+        unsigned int count;
+        double exec_mean;
+        double exec_p99;
+        double exec_max;
+        double interval_mean;
+        double jitter_p99;
+        double jitter_max;
+        unsigned int overruns;
+      };
+
+      /// The probe of hook, created (with its properties) on first use
+      HookProbe* add(const std::string& hook, double period);
+
+      std::vector<Hook*> m_hooks;
+  };
+}
+#endif
@@ -0,0 +1,163 @@
+/******************************************************************************
+*                          OROCOS Youbot diagnostics                          *
+*                                                                             *
+*                         (C) 2011 Steven Bellens                             *
+*                     steven.bellens@mech.kuleuven.be                         *
+*                    Department of Mechanical Engineering,                    *
+*                   Katholieke Universiteit Leuven, Belgium.                  *
+*                                                                             *
+*       You may redistribute this software and/or modify it under either the  *
+*       terms of the GNU Lesser General Public License version 2.1 (LGPLv2.1  *
+*       <http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>) or (at your *
+*       discretion) of the Modified BSD License:                              *
+*       Redistribution and use in source and binary forms, with or without    *
+*       modification, are permitted provided that the following conditions    *
+*       are met:                                                              *
+*       1. Redistributions of source code must retain the above copyright     *
+*       notice, this list of conditions and the following disclaimer.         *
+*       2. Redistributions in binary form must reproduce the above copyright  *
+*       notice, this list of conditions and the following disclaimer in the   *
+*       documentation and/or other materials provided with the distribution.  *
+*       3. The name of the author may not be used to endorse or promote       *
+*       products derived from this software without specific prior written    *
+*       permission.                                                           *
+*       THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR  *
+*       IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED        *
+*       WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE    *
+*       ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,*
+*       INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    *
+*       (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS       *
+*       OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) *
+*       HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,   *
+*       STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING *
+*       IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE    *
+*       POSSIBILITY OF SUCH DAMAGE.                                           *
+*                                                                             *
+*******************************************************************************/
+
+/* @Description:
+ * @brief Youbot diagnostics - lock-free latency histogram
+ * @Author: Steven Bellens
+ */
+
+ /*
+  * A LatencyHistogram counts latencies in nanoseconds in logarithmic
+  * buckets: every power of two is split in four linear sub-buckets, so a
+  * bucket is at most 25% wide, from 4 ns up to about a minute. Any number
+  * of threads may add() samples at the same time; adding is a handful of
+  * atomic increments, it never blocks nor allocates. When only one thread
+  * ever writes the histogram, record() does the same with plain increments.
+  * Reading (count, mean, percentiles) is meant for a non real-time thread
+  * and sees the counters as they are at that moment.
+ */
+
+#ifndef _YOUBOT_LATENCY_HISTOGRAM_
+#define _YOUBOT_LATENCY_HISTOGRAM_
+
+namespace youbot{
+
+  class LatencyHistogram{
+    public:
+      /// Number of sub-buckets per power of two (log2)
+      static const unsigned int SUB_BITS = 2;
+      /// Largest power of two that is counted, larger samples go in the last bucket
+      static const unsigned int MAX_EXPONENT = 36;
+      static const unsigned int BUCKETS = (MAX_EXPONENT - SUB_BITS + 2) << SUB_BITS;
+
+      LatencyHistogram(){ reset(); }
+
+      /**
+       * \brief Count a latency
+       *
+       * \param nsecs The latency in nanoseconds, negative latencies count as 0
+       */
+      void add(long long nsecs){
+        unsigned long long value = nsecs < 0 ? 0 : (unsigned long long)nsecs;
+        __sync_fetch_and_add(&m_buckets[bucket(value)], 1ULL);
+        __sync_fetch_and_add(&m_count, 1ULL);
+        __sync_fetch_and_add(&m_sum, value);
+        unsigned long long max = m_max;
+        while(value > max){
+          unsigned long long seen = __sync_val_compare_and_swap(&m_max, max, value);
+          if(seen == max) break;
+          max = seen;
+        }
+      }
+
+      /**
+       * \brief Count a latency, single writer
+       *
+       * Cheaper than add(), but only correct when no other thread adds or
+       * resets at the same time.
+       */
+      void record(long long nsecs){
+        unsigned long long value = nsecs < 0 ? 0 : (unsigned long long)nsecs;
+        ++m_buckets[bucket(value)];
+        ++m_count;
+        m_sum += value;
+        if(value > m_max) m_max = value;
+      }
+
+      /// Clear all counters; samples added at the same time may be lost
+      void reset(){
+        for(unsigned int i = 0; i < BUCKETS; ++i) m_buckets[i] = 0;
+        m_count = 0;
+        m_sum = 0;
+        m_max = 0;
+        __sync_synchronize();
+      }
+
+      unsigned long long count() const{ return m_count; }
+      /// Mean latency, in nanoseconds
+      double mean() const{ return m_count ? double(m_sum) / double(m_count) : 0.0; }
+      /// Largest latency, in nanoseconds
+      unsigned long long max() const{ return m_max; }
+
+      /**
+       * \brief Latency below which a fraction of the samples lies
+       *
+       * \param fraction The fraction, e.g. 0.99
+       * \return The upper bound of the bucket holding that sample, in
+       * nanoseconds (never more than max())
+       */
+      unsigned long long percentile(double fraction) const{
+        unsigned long long total = 0;
+        for(unsigned int i = 0; i < BUCKETS; ++i) total += m_buckets[i];
+        if(total == 0) return 0;
+        unsigned long long rank = (unsigned long long)(fraction * total);
+        if(rank >= total) rank = total - 1;
+        unsigned long long seen = 0;
+        for(unsigned int i = 0; i < BUCKETS; ++i){
+          seen += m_buckets[i];
+          if(seen > rank){
+            unsigned long long bound = upperBound(i);
+            return bound < m_max ? bound : (unsigned long long)m_max;
+          }
+        }
+        return m_max;
+      }
+
+    private:
+      static unsigned int bucket(unsigned long long value){
+        if(value < (1ULL << SUB_BITS)) return (unsigned int)value;
+        unsigned int exponent = 63 - __builtin_clzll(value);
+        if(exponent > MAX_EXPONENT) return BUCKETS - 1;
+        unsigned int sub = (unsigned int)(value >> (exponent - SUB_BITS)) & ((1U << SUB_BITS) - 1);
+        return ((exponent - SUB_BITS + 1) << SUB_BITS) + sub;
+      }
+
+      /// Smallest value that no longer falls in bucket i
+      static unsigned long long upperBound(unsigned int i){
+        if(i < (1U << SUB_BITS)) return i + 1;
+        unsigned int exponent = (i >> SUB_BITS) + SUB_BITS - 1;
+        unsigned long long sub = i & ((1U << SUB_BITS) - 1);
+        return ((1ULL << SUB_BITS) + sub + 1) << (exponent - SUB_BITS);
+      }
+
+      volatile unsigned long long m_buckets[BUCKETS];
+      volatile unsigned long long m_count;
+      volatile unsigned long long m_sum;
+      volatile unsigned long long m_max;
+  };
+}
+#endif
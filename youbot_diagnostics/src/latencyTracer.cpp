@@ -0,0 +1,145 @@
+/******************************************************************************
+*                          OROCOS Youbot diagnostics                          *
+*                                                                             *
+*                         (C) 2011 Steven Bellens                             *
+*                     steven.bellens@mech.kuleuven.be                         *
+*                    Department of Mechanical Engineering,                    *
+*                   Katholieke Universiteit Leuven, Belgium.                  *
+*                                                                             *
+*       You may redistribute this software and/or modify it under either the  *
+*       terms of the GNU Lesser General Public License version 2.1 (LGPLv2.1  *
+*       <http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>) or (at your *
+*       discretion) of the Modified BSD License:                              *
+*       Redistribution and use in source and binary forms, with or without    *
+*       modification, are permitted provided that the following conditions    *
+*       are met:                                                              *
+*       1. Redistributions of source code must retain the above copyright     *
+*       notice, this list of conditions and the following disclaimer.         *
+*       2. Redistributions in binary form must reproduce the above copyright  *
+*       notice, this list of conditions and the following disclaimer in the   *
+*       documentation and/or other materials provided with the distribution.  *
+*       3. The name of the author may not be used to endorse or promote       *
+*       products derived from this software without specific prior written    *
+*       permission.                                                           *
+*       THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR  *
+*       IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED        *
+*       WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE    *
+*       ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,*
+*       INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    *
+*       (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS       *
+*       OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) *
+*       HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,   *
+*       STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING *
+*       IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE    *
+*       POSSIBILITY OF SUCH DAMAGE.                                           *
+*                                                                             *
+*******************************************************************************/
+
+#include "latencyTracer.hpp"
+
+#include <rtt/os/TimeService.hpp>
+
+#include <algorithm>
+
+namespace youbot{
+
+  namespace{
+    const unsigned long long MARKED = 1ULL << 32;
+
+    bool earlier(const LatencyTracer::Trace& a, const LatencyTracer::Trace& b){
+      return a.stamp[a.origin] < b.stamp[b.origin];
+    }
+  }
+
+  LatencyTracer& LatencyTracer::Instance(){
+    static LatencyTracer tracer;
+    return tracer;
+  }
+
+  LatencyTracer::LatencyTracer()
+    : m_enabled(false)
+  {
+    reset();
+  }
+
+  long long LatencyTracer::now(){
+    return RTT::os::TimeService::ticks2nsecs(RTT::os::TimeService::Instance()->getTicks());
+  }
+
+  void LatencyTracer::begin(unsigned int id, Stage origin){
+    if(!m_enabled || origin >= STAGES) return;
+    Trace& trace = m_traces[id % TRACES];
+    // Claim the slot first, so late marks of the trace it held are ignored
+    trace.id = id;
+    __sync_synchronize();
+    for(unsigned int s = 0; s < STAGES; ++s) trace.stamp[s] = 0;
+    trace.origin = origin;
+    __sync_synchronize();
+    trace.stamp[origin] = now();
+    __sync_lock_test_and_set(&m_latest[origin], MARKED | id);
+  }
+
+  void LatencyTracer::mark(Stage stage, unsigned int id){
+    if(!m_enabled || stage == SCAN || stage >= STAGES) return;
+    Trace& trace = m_traces[id % TRACES];
+    if(trace.id != id || stage <= trace.origin || trace.stamp[trace.origin] == 0) return;
+    long long stamp = now();
+    // First mark wins
+    if(!__sync_bool_compare_and_swap(&trace.stamp[stage], 0LL, stamp)) return;
+    __sync_lock_test_and_set(&m_latest[stage], MARKED | id);
+    long long previous = trace.stamp[stage - 1];
+    if(previous != 0) m_hops[stage].add(stamp - previous);
+    if(stage == COMMAND) m_hops[SCAN].add(stamp - trace.stamp[trace.origin]);
+  }
+
+  bool LatencyTracer::follow(Stage from, Stage stage, unsigned int& id){
+    if(!m_enabled) return false;
+    unsigned long long latest = __sync_fetch_and_add(&m_latest[from], 0ULL);
+    if(!(latest & MARKED)) return false;
+    id = (unsigned int)latest;
+    mark(stage, id);
+    return true;
+  }
+
+  void LatencyTracer::reset(){
+    for(unsigned int i = 0; i < TRACES; ++i){
+      m_traces[i].id = 0;
+      m_traces[i].origin = SCAN;
+      for(unsigned int s = 0; s < STAGES; ++s) m_traces[i].stamp[s] = 0;
+    }
+    for(unsigned int s = 0; s < STAGES; ++s){
+      m_hops[s].reset();
+      m_latest[s] = 0;
+    }
+    __sync_synchronize();
+  }
+
+  const char* LatencyTracer::name(Stage stage){
+    switch(stage){
+      case SCAN: return "scan";
+      case DISTANCE: return "distance";
+      case MEASUREMENT: return "measurement";
+      case ESTIMATE: return "estimate";
+      case CONTROL: return "control";
+      case COMMAND: return "command";
+      default: return "unknown";
+    }
+  }
+
+  unsigned int LatencyTracer::traces(Trace* traces) const{
+    unsigned int n = 0;
+    for(unsigned int i = 0; i < TRACES; ++i){
+      const Trace& trace = m_traces[i];
+      traces[n] = trace;
+      __sync_synchronize();
+      // Skip a slot that was reused while it was copied
+      if(trace.id != traces[n].id || trace.origin != traces[n].origin || trace.stamp[trace.origin] != traces[n].stamp[traces[n].origin]) continue;
+      unsigned int stages = 0;
+      for(unsigned int s = 0; s < STAGES; ++s)
+        if(traces[n].stamp[s] != 0) ++stages;
+      if(stages > 1) ++n;
+    }
+    std::sort(traces, traces + n, earlier);
+    return n;
+  }
+}
@@ -0,0 +1,164 @@
+/******************************************************************************
+*                          OROCOS Youbot diagnostics                          *
+*                                                                             *
+*                         (C) 2011 Steven Bellens                             *
+*                     steven.bellens@mech.kuleuven.be                         *
+*                    Department of Mechanical Engineering,                    *
+*                   Katholieke Universiteit Leuven, Belgium.                  *
+*                                                                             *
+*       You may redistribute this software and/or modify it under either the  *
+*       terms of the GNU Lesser General Public License version 2.1 (LGPLv2.1  *
+*       <http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>) or (at your *
+*       discretion) of the Modified BSD License:                              *
+*       Redistribution and use in source and binary forms, with or without    *
+*       modification, are permitted provided that the following conditions    *
+*       are met:                                                              *
+*       1. Redistributions of source code must retain the above copyright     *
+*       notice, this list of conditions and the following disclaimer.         *
+*       2. Redistributions in binary form must reproduce the above copyright  *
+*       notice, this list of conditions and the following disclaimer in the   *
+*       documentation and/or other materials provided with the distribution.  *
+*       3. The name of the author may not be used to endorse or promote       *
+*       products derived from this software without specific prior written    *
+*       permission.                                                           *
+*       THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR  *
+*       IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED        *
+*       WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE    *
+*       ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,*
+*       INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    *
+*       (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS       *
+*       OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) *
+*       HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,   *
+*       STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING *
+*       IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE    *
+*       POSSIBILITY OF SUCH DAMAGE.                                           *
+*                                                                             *
+*******************************************************************************/
+
+/* @Description:
+ * @brief Youbot diagnostics - scan to command latency tracer
+ * @Author: Steven Bellens
+ */
+
+ /*
+  * The LatencyTracer follows a laser scan through the control loop:
+  *
+  *   SCAN         the scan arrives in CalculateDistanceToWall
+  *   DISTANCE     DistanceToWall is written
+  *   MEASUREMENT  the estimator starts its measurement update
+  *   ESTIMATE     EstimatedState is written after that update
+  *   CONTROL      the Controller reads that estimate
+  *   COMMAND      the resulting velocity is written on the ctrl port
+  *
+  * A trace is identified by the sequence number of the scan header. The
+  * ports in between carry plain data types without a header, so the id
+  * travels next to the data: a component marks a stage before it writes its
+  * port, and the component reading that port follows the id that was
+  * marked last on the upstream stage. Only the first mark of a stage
+  * counts, so COMMAND is the first command computed from an estimate that
+  * includes the scan. The tracer is per process: when the first stages run
+  * in another deployment, a component starts the trace at its own stage
+  * with an id of its own.
+  *
+  * Every mark stamps the time and adds the time since the previous stage to
+  * the histogram of that hop; the COMMAND mark also adds the latency since
+  * the start of the trace. The last TRACES traces are kept for export. Marking takes a
+  * clock read and a few atomic operations, it never blocks nor allocates,
+  * and does nothing while the tracer is disabled. There is one tracer per
+  * process, shared by all components through this library.
+ */
+
+#ifndef _YOUBOT_LATENCY_TRACER_
+#define _YOUBOT_LATENCY_TRACER_
+
+#include "latencyHistogram.hpp"
+
+namespace youbot{
+
+  class LatencyTracer{
+    public:
+      /// The stages of a trace, in the order the scan passes them
+      enum Stage{
+        SCAN,
+        DISTANCE,
+        MEASUREMENT,
+        ESTIMATE,
+        CONTROL,
+        COMMAND,
+        STAGES
+      };
+
+      /// Number of traces kept for export
+      static const unsigned int TRACES = 1024;
+
+      /// A trace: the time of each stage, in nanoseconds (0: not reached)
+      struct Trace{
+        unsigned int id;
+        /// The stage the trace started at
+        Stage origin;
+        long long stamp[STAGES];
+      };
+
+      /// The tracer of this process
+      static LatencyTracer& Instance();
+
+      /// @name Instrumentation
+      //@{
+      /**
+       * \brief Start a trace
+       *
+       * \param id The sequence number of the scan, or an id chosen by the
+       * component that starts the trace at a later stage
+       * \param origin The stage the trace starts at
+       */
+      void begin(unsigned int id, Stage origin = SCAN);
+      /**
+       * \brief Mark a stage of a trace
+       *
+       * Ignored when the trace is unknown (or overwritten) or the stage was
+       * marked before.
+       */
+      void mark(Stage stage, unsigned int id);
+      /**
+       * \brief Continue the trace last marked on an upstream stage
+       *
+       * Marks stage on the trace that was marked last on stage from.
+       * \param id Set to the id of that trace
+       * \return false if no trace was marked on stage from yet
+       */
+      bool follow(Stage from, Stage stage, unsigned int& id);
+      //@}
+
+      /// @name Control and inspection, not real-time
+      //@{
+      void enable(bool enabled){ m_enabled = enabled; __sync_synchronize(); }
+      bool enabled() const{ return m_enabled; }
+      /// Clear the histograms and the kept traces
+      void reset();
+      /// The histogram of the hop from the previous stage to stage (SCAN: from the start of the trace to COMMAND)
+      const LatencyHistogram& hop(Stage stage) const{ return m_hops[stage]; }
+      /// Name of a stage
+      static const char* name(Stage stage);
+      /**
+       * \brief Copy the kept traces that passed more than one stage, oldest first
+       *
+       * \param traces Room for at least TRACES traces
+       * \return The number of traces copied
+       */
+      unsigned int traces(Trace* traces) const;
+      //@}
+
+    private:
+      LatencyTracer();
+
+      static long long now();
+
+      Trace m_traces[TRACES];
+      /// Hop histograms, m_hops[SCAN] holds the latency from the start of the trace to COMMAND
+      LatencyHistogram m_hops[STAGES];
+      /// Per stage: bit 32 set once a trace was marked, the id of that trace in the low bits
+      volatile unsigned long long m_latest[STAGES];
+      volatile bool m_enabled;
+  };
+}
+#endif
@@ -0,0 +1,145 @@
+/******************************************************************************
+*                          OROCOS Youbot diagnostics                          *
+*                                                                             *
+*                         (C) 2011 Steven Bellens                             *
+*                     steven.bellens@mech.kuleuven.be                         *
+*                    Department of Mechanical Engineering,                    *
+*                   Katholieke Universiteit Leuven, Belgium.                  *
+*                                                                             *
+*       You may redistribute this software and/or modify it under either the  *
+*       terms of the GNU Lesser General Public License version 2.1 (LGPLv2.1  *
+*       <http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>) or (at your *
+*       discretion) of the Modified BSD License:                              *
+*       Redistribution and use in source and binary forms, with or without    *
+*       modification, are permitted provided that the following conditions    *
+*       are met:                                                              *
+*       1. Redistributions of source code must retain the above copyright     *
+*       notice, this list of conditions and the following disclaimer.         *
+*       2. Redistributions in binary form must reproduce the above copyright  *
+*       notice, this list of conditions and the following disclaimer in the   *
+*       documentation and/or other materials provided with the distribution.  *
+*       3. The name of the author may not be used to endorse or promote       *
+*       products derived from this software without specific prior written    *
+*       permission.                                                           *
+*       THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR  *
+*       IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED        *
+*       WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE    *
+*       ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,*
+*       INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    *
+*       (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS       *
+*       OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) *
+*       HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,   *
+*       STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING *
+*       IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE    *
+*       POSSIBILITY OF SUCH DAMAGE.                                           *
+*                                                                             *
+*******************************************************************************/
+
+#include "tracingService.hpp"
+#include "latencyTracer.hpp"
+
+#include <rtt/plugin/ServicePlugin.hpp>
+
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+// This macro is used whenever a new Orocos service is generated. Here we
+// generate a Youbot tracing service, loaded as "tracing".
+ORO_SERVICE_NAMED_PLUGIN(youbot::TracingService, "tracing")
+
+namespace youbot{
+
+  namespace{
+    /// Name of the hop ending at stage; SCAN holds the whole trace
+    std::string hopName(LatencyTracer::Stage stage){
+      if(stage == LatencyTracer::SCAN)
+        return "start -> command";
+      return std::string(LatencyTracer::name((LatencyTracer::Stage)(stage - 1))) + " -> " + LatencyTracer::name(stage);
+    }
+  }
+
+  TracingService::TracingService(TaskContext* owner) : Service("tracing",owner)
+  {
+    this->doc("Traces the latency from a laser scan to the resulting velocity command");
+    this->addOperation("enable",&TracingService::enable,this).doc("Start or stop tracing").arg("Enabled","True to trace");
+    this->addOperation("reset",&TracingService::reset,this).doc("Clear the histograms and the kept traces");
+    this->addOperation("dump",&TracingService::dump,this).doc("Report the latency of every hop and of the whole loop");
+    this->addOperation("writeChromeTrace",&TracingService::writeChromeTrace,this).doc("Export the kept traces as a Chrome trace (JSON)").arg("FileName","The file to write");
+  }
+
+  TracingService::~TracingService(){}
+
+  void TracingService::enable(bool enabled){
+    LatencyTracer::Instance().enable(enabled);
+  }
+
+  void TracingService::reset(){
+    LatencyTracer::Instance().reset();
+  }
+
+  std::string TracingService::dump(){
+    LatencyTracer& tracer = LatencyTracer::Instance();
+    std::ostringstream report;
+    report << std::fixed << std::setprecision(1);
+    report << "hop (us)                  count      mean    median       p99       max";
+    for(int s = LatencyTracer::DISTANCE; s <= LatencyTracer::STAGES; ++s){
+      // The end to end histogram is kept at SCAN, report it last
+      LatencyTracer::Stage stage = (LatencyTracer::Stage)(s % LatencyTracer::STAGES);
+      const LatencyHistogram& histogram = tracer.hop(stage);
+      report << "\n" << std::left << std::setw(24) << hopName(stage) << std::right
+             << std::setw(7) << histogram.count()
+             << std::setw(10) << histogram.mean() * 1e-3
+             << std::setw(10) << histogram.percentile(0.5) * 1e-3
+             << std::setw(10) << histogram.percentile(0.99) * 1e-3
+             << std::setw(10) << histogram.max() * 1e-3;
+    }
+    log(Info) << "(TracingService) Latency\n" << report.str() << endlog();
+    return report.str();
+  }
+
+  bool TracingService::writeChromeTrace(const std::string& file_name){
+    std::vector<LatencyTracer::Trace> traces(LatencyTracer::TRACES);
+    unsigned int n = LatencyTracer::Instance().traces(&traces[0]);
+    std::ofstream file(file_name.c_str());
+    if(!file){
+      log(Error) << "(TracingService) Cannot open " << file_name << endlog();
+      return false;
+    }
+    // Chrome traces are in microseconds; start at the oldest trace
+    long long origin = n ? traces[0].stamp[traces[0].origin] : 0;
+    file << std::fixed << std::setprecision(3);
+    file << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    bool first = true;
+    // One row per hop, the whole trace on top
+    for(int s = LatencyTracer::SCAN; s < LatencyTracer::STAGES; ++s){
+      file << (first ? "\n" : ",\n") << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << s
+           << ",\"args\":{\"name\":\"" << hopName((LatencyTracer::Stage)s) << "\"}}";
+      first = false;
+    }
+    for(unsigned int i = 0; i < n; ++i){
+      const LatencyTracer::Trace& trace = traces[i];
+      for(int s = LatencyTracer::SCAN; s < LatencyTracer::STAGES; ++s){
+        LatencyTracer::Stage stage = (LatencyTracer::Stage)s;
+        long long start = trace.stamp[stage == LatencyTracer::SCAN ? trace.origin : stage - 1];
+        long long end = trace.stamp[stage == LatencyTracer::SCAN ? LatencyTracer::COMMAND : stage];
+        // Traces that did not (yet) pass both ends of the hop
+        if(start == 0 || end == 0) continue;
+        file << ",\n{\"ph\":\"X\",\"cat\":\"latency\",\"name\":\"" << hopName(stage)
+             << "\",\"pid\":1,\"tid\":" << s
+             << ",\"ts\":" << (start - origin) * 1e-3
+             << ",\"dur\":" << (end - start) * 1e-3
+             << ",\"args\":{\"trace\":" << trace.id << "}}";
+      }
+    }
+    file << "\n]}\n";
+    file.close();
+    if(!file){
+      log(Error) << "(TracingService) Cannot write " << file_name << endlog();
+      return false;
+    }
+    log(Info) << "(TracingService) Wrote " << n << " traces to " << file_name << endlog();
+    return true;
+  }
+}
@@ -0,0 +1,111 @@
+/******************************************************************************
+*                          OROCOS Youbot diagnostics                          *
+*                                                                             *
+*                         (C) 2011 Steven Bellens                             *
+*                     steven.bellens@mech.kuleuven.be                         *
+*                    Department of Mechanical Engineering,                    *
+*                   Katholieke Universiteit Leuven, Belgium.                  *
+*                                                                             *
+*       You may redistribute this software and/or modify it under either the  *
+*       terms of the GNU Lesser General Public License version 2.1 (LGPLv2.1  *
+*       <http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>) or (at your *
+*       discretion) of the Modified BSD License:                              *
+*       Redistribution and use in source and binary forms, with or without    *
+*       modification, are permitted provided that the following conditions    *
+*       are met:                                                              *
+*       1. Redistributions of source code must retain the above copyright     *
+*       notice, this list of conditions and the following disclaimer.         *
+*       2. Redistributions in binary form must reproduce the above copyright  *
+*       notice, this list of conditions and the following disclaimer in the   *
+*       documentation and/or other materials provided with the distribution.  *
+*       3. The name of the author may not be used to endorse or promote       *
+*       products derived from this software without specific prior written    *
+*       permission.                                                           *
+*       THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR  *
+*       IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED        *
+*       WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE    *
+*       ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,*
+*       INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    *
+*       (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS       *
+*       OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) *
+*       HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,   *
+*       STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING *
+*       IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE    *
+*       POSSIBILITY OF SUCH DAMAGE.                                           *
+*                                                                             *
+*******************************************************************************/
+
+/* @Description:
+ * @brief Youbot diagnostics - latency tracing service
+ * @Author: Steven Bellens
+ */
+
+ /*
+  * The tracing service controls and reads the LatencyTracer of the process.
+  * It is loaded in any component of the deployment
+  * (loadService("Controller","tracing")): the tracer is shared by the whole
+  * process, so the component only provides a place to call the operations
+  * from. All operations run in the calling thread (the deployer or the
+  * TaskBrowser), never in the real-time threads being traced.
+ */
+
+#ifndef _YOUBOT_TRACING_SERVICE_
+#define _YOUBOT_TRACING_SERVICE_
+
+#include <rtt/TaskContext.hpp>
+#include <rtt/Service.hpp>
+
+#include <string>
+
+namespace youbot{
+
+  using namespace std;
+  using namespace RTT;
+
+  class TracingService : public Service{
+    public:
+      /**
+       * \brief Constructor
+       *
+       * Constructor building a Youbot tracing service
+       * \param owner The component that loads the service
+       */
+      TracingService(TaskContext* owner);
+      //! Destructor
+      ~TracingService();
+
+      /// @name Public methods
+      //@{
+      /**
+       * \brief Start or stop tracing
+       *
+       * The instrumented components only stamp their stages while tracing is
+       * enabled.
+       */
+      void enable(bool enabled);
+
+      /// Clear the histograms and the kept traces
+      void reset();
+
+      /**
+       * \brief Report the latency histograms
+       *
+       * Logs and returns, for every hop and for the whole trace, the number of
+       * traces and the mean, median, 99th percentile and maximum latency in
+       * microseconds.
+       */
+      std::string dump();
+
+      /**
+       * \brief Export the kept traces in the Chrome trace format
+       *
+       * Writes every kept trace as one event per hop it passed, with the hops
+       * on separate rows, to a JSON file that chrome://tracing (or Perfetto)
+       * opens.
+       * \return false if the file cannot be written
+       */
+      bool writeChromeTrace(const std::string& file_name);
+      //@}
+  };
+}
+#endif
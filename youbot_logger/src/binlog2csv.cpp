@@ -0,0 +1,358 @@
+/******************************************************************************
+*                        OROCOS Youbot logger component                       *
+*                                                                             *
+*                         (C) 2011 Steven Bellens                             *
+*                     steven.bellens@mech.kuleuven.be                         *
+*                    Department of Mechanical Engineering,                    *
+*                   Katholieke Universiteit Leuven, Belgium.                  *
+*                                                                             *
+*       You may redistribute this software and/or modify it under either the  *
+*       terms of the GNU Lesser General Public License version 2.1 (LGPLv2.1  *
+*       <http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>) or (at your *
+*       discretion) of the Modified BSD License:                              *
+*       Redistribution and use in source and binary forms, with or without    *
+*       modification, are permitted provided that the following conditions    *
+*       are met:                                                              *
+*       1. Redistributions of source code must retain the above copyright     *
+*       notice, this list of conditions and the following disclaimer.         *
+*       2. Redistributions in binary form must reproduce the above copyright  *
+*       notice, this list of conditions and the following disclaimer in the   *
+*       documentation and/or other materials provided with the distribution.  *
+*       3. The name of the author may not be used to endorse or promote       *
+*       products derived from this software without specific prior written    *
+*       permission.                                                           *
+*       THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR  *
+*       IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED        *
+*       WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE    *
+*       ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,*
+*       INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    *
+*       (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS       *
+*       OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) *
+*       HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,   *
+*       STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING *
+*       IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE    *
+*       POSSIBILITY OF SUCH DAMAGE.                                           *
+*                                                                             *
+*******************************************************************************/
+
+/* @Description:
+ * @brief Youbot logger - convert a binary log to CSV
+ * @Author: Steven Bellens
+ */
+
+ /*
+  * binlog2csv reads a log file of the Youbot Logger component and writes one
+  * CSV file per channel, <log>_<Component.port>.csv, with a row per record:
+  * the time in seconds since the start of the logger, the sequence number of
+  * the record and its values. When a channel changes its width (a resized
+  * ColumnVector), its next records go to a new file <log>_<Component.port>_<n>.csv
+  * with its own header. With -m it writes a single <log>.csv instead,
+  * with a row per record of any channel and the last values of all channels
+  * (the layout of the old FileReporting output); it sorts all records by
+  * time, so it keeps the whole log in memory. Dropped records are reported
+  * on stderr.
+ */
+
+#include "logFormat.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace youbot::logformat;
+
+struct Channel{
+  Channel() : width(0), file(0), file_width(0), files(0), records(0), dropped(0){}
+  std::string name;
+  std::string type;
+  unsigned int width;
+  /// The CSV file of the channel
+  FILE* file;
+  /// Width of the header of the CSV file, and the number of files opened for the channel
+  unsigned int file_width;
+  unsigned int files;
+  unsigned long records;
+  unsigned long dropped;
+};
+
+static bool readString(FILE* log, std::string& value){
+  unsigned int size;
+  if(fread(&size,sizeof(size),1,log) != 1)
+    return false;
+  value.resize(size);
+  return size == 0 || fread(&value[0],1,size,log) == size;
+}
+
+static std::string baseName(const std::string& file_name){
+  std::string::size_type dot = file_name.rfind('.');
+  if(dot == std::string::npos || file_name.find('/',dot) != std::string::npos)
+    return file_name;
+  return file_name.substr(0,dot);
+}
+
+/**
+ * \brief Read all chunks of the log
+ *
+ * Calls the channel callback for each CHANNEL chunk and the record callback
+ * for each record; DROPS chunks are added to the channels.
+ */
+template<class ChannelCallback, class RecordCallback>
+static bool readLog(FILE* log, std::map<unsigned int,Channel>& channels, ChannelCallback on_channel, RecordCallback on_record){
+  FileHeader header;
+  if(fread(&header,sizeof(header),1,log) != 1 || memcmp(header.magic,MAGIC,sizeof(MAGIC)) != 0){
+    fprintf(stderr,"Not a youbot log file\n");
+    return false;
+  }
+  if(header.version != VERSION || header.record_header_size != sizeof(RecordHeader)){
+    fprintf(stderr,"Unsupported log version %u\n",header.version);
+    return false;
+  }
+  std::vector<double> values;
+  ChunkHeader chunk;
+  while(fread(&chunk,sizeof(chunk),1,log) == 1){
+    unsigned int id;
+    if(chunk.type == CHANNEL){
+      unsigned int width;
+      std::string name, type;
+      if(fread(&id,sizeof(id),1,log) != 1 || fread(&width,sizeof(width),1,log) != 1
+         || !readString(log,name) || !readString(log,type))
+        break;
+      Channel& channel = channels[id];
+      channel.name = name;
+      channel.type = type;
+      channel.width = width;
+      on_channel(id,channel);
+    }
+    else if(chunk.type == DATA){
+      if(fread(&id,sizeof(id),1,log) != 1 || channels.find(id) == channels.end())
+        break;
+      Channel& channel = channels[id];
+      unsigned int record_size = sizeof(RecordHeader) + channel.width * sizeof(double);
+      unsigned int n = (chunk.size - sizeof(id)) / record_size;
+      values.resize(channel.width);
+      for(unsigned int i = 0; i < n; i++){
+        RecordHeader record;
+        if(fread(&record,sizeof(record),1,log) != 1
+           || fread(values.empty() ? 0 : &values[0],sizeof(double),channel.width,log) != channel.width)
+          return true;
+        channel.records++;
+        on_record(id,channel,record,values);
+      }
+    }
+    else if(chunk.type == DROPS){
+      unsigned int lost;
+      if(fread(&id,sizeof(id),1,log) != 1 || fread(&lost,sizeof(lost),1,log) != 1)
+        break;
+      channels[id].dropped += lost;
+    }
+    else if(fseek(log,chunk.size,SEEK_CUR) != 0)
+      break;
+  }
+  return true;
+}
+
+/// @name Callbacks of the per channel conversion
+//@{
+struct OpenChannel{
+  std::string base;
+  void operator()(unsigned int, Channel& channel) const{
+    if(channel.file){
+      if(channel.width == channel.file_width)
+        return;
+      /// The rows would not match the header: continue in a new file
+      fclose(channel.file);
+      channel.file = 0;
+    }
+    std::string file_name = base + "_" + channel.name;
+    if(channel.files > 0){
+      char part[16];
+      snprintf(part,sizeof(part),"_%u",channel.files);
+      file_name += part;
+    }
+    file_name += ".csv";
+    channel.files++;
+    channel.file = fopen(file_name.c_str(),"w");
+    if(!channel.file){
+      fprintf(stderr,"Could not open %s\n",file_name.c_str());
+      return;
+    }
+    channel.file_width = channel.width;
+    fprintf(channel.file,"TimeStamp,seq");
+    for(unsigned int i = 0; i < channel.width; i++)
+      fprintf(channel.file,",Element%u",i);
+    fprintf(channel.file,"\n");
+  }
+};
+
+struct WriteRecord{
+  void operator()(unsigned int, Channel& channel, const RecordHeader& record, const std::vector<double>& values) const{
+    if(!channel.file)
+      return;
+    fprintf(channel.file,"%.9f,%u",record.stamp * 1e-9,record.seq);
+    for(unsigned int i = 0; i < values.size(); i++)
+      fprintf(channel.file,",%.12g",values[i]);
+    fprintf(channel.file,"\n");
+  }
+};
+//@}
+
+/// @name Callbacks of the merged conversion
+//@{
+/// First pass: the widest definition of each channel
+struct CollectChannel{
+  std::map<unsigned int,unsigned int>* widths;
+  void operator()(unsigned int id, Channel& channel) const{
+    unsigned int& width = (*widths)[id];
+    if(channel.width > width)
+      width = channel.width;
+  }
+};
+
+struct IgnoreRecord{
+  void operator()(unsigned int, Channel&, const RecordHeader&, const std::vector<double>&) const{}
+};
+
+/// A record of the merged file
+struct Row{
+  long long stamp;
+  unsigned int id;
+  /// Index of the first value in the value pool
+  size_t values;
+  unsigned int width;
+  bool operator<(const Row& other) const{ return stamp < other.stamp; }
+};
+
+/// Second pass: collect all records, the chunks of the channels interleave per logger period
+struct CollectRecord{
+  std::vector<Row>* rows;
+  std::vector<double>* pool;
+  void operator()(unsigned int id, Channel&, const RecordHeader& record, const std::vector<double>& values) const{
+    Row row;
+    row.stamp = record.stamp;
+    row.id = id;
+    row.values = pool->size();
+    row.width = values.size();
+    pool->insert(pool->end(),values.begin(),values.end());
+    rows->push_back(row);
+  }
+};
+
+struct IgnoreChannel{
+  void operator()(unsigned int, Channel&) const{}
+};
+//@}
+
+static void reportDrops(const std::map<unsigned int,Channel>& channels){
+  for(std::map<unsigned int,Channel>::const_iterator it = channels.begin(); it != channels.end(); ++it){
+    fprintf(stderr,"%s: %lu records",it->second.name.c_str(),it->second.records);
+    if(it->second.dropped > 0)
+      fprintf(stderr,", %lu dropped",it->second.dropped);
+    fprintf(stderr,"\n");
+  }
+}
+
+int main(int argc, char** argv){
+  bool merged = false;
+  // Coalescing window of the merged file, in ns
+  long long window = 1000000;
+  const char* file_name = 0;
+  for(int i = 1; i < argc; i++){
+    if(strcmp(argv[i],"-m") == 0)
+      merged = true;
+    else if(strcmp(argv[i],"-w") == 0 && i + 1 < argc)
+      window = (long long)(atof(argv[++i]) * 1e9);
+    else
+      file_name = argv[i];
+  }
+  if(!file_name){
+    fprintf(stderr,"Usage: binlog2csv [-m [-w <coalescing window in s>]] <log file>\n");
+    return 1;
+  }
+  FILE* log = fopen(file_name,"rb");
+  if(!log){
+    fprintf(stderr,"Could not open %s\n",file_name);
+    return 1;
+  }
+
+  std::map<unsigned int,Channel> channels;
+  std::string base = baseName(file_name);
+
+  if(!merged){
+    OpenChannel open_channel;
+    open_channel.base = base;
+    bool ok = readLog(log,channels,open_channel,WriteRecord());
+    for(std::map<unsigned int,Channel>::iterator it = channels.begin(); it != channels.end(); ++it)
+      if(it->second.file)
+        fclose(it->second.file);
+    fclose(log);
+    reportDrops(channels);
+    return ok ? 0 : 1;
+  }
+
+  std::map<unsigned int,unsigned int> widths;
+  CollectChannel collect;
+  collect.widths = &widths;
+  std::map<unsigned int,Channel> first_pass;
+  if(!readLog(log,first_pass,collect,IgnoreRecord())){
+    fclose(log);
+    return 1;
+  }
+
+  std::string merged_name = base + ".csv";
+  FILE* file = fopen(merged_name.c_str(),"w");
+  if(!file){
+    fprintf(stderr,"Could not open %s\n",merged_name.c_str());
+    fclose(log);
+    return 1;
+  }
+  std::map<unsigned int,unsigned int> columns;
+  unsigned int n_columns = 0;
+  fprintf(file,"TimeStamp");
+  for(std::map<unsigned int,unsigned int>::iterator it = widths.begin(); it != widths.end(); ++it){
+    columns[it->first] = n_columns;
+    for(unsigned int i = 0; i < it->second; i++)
+      fprintf(file,",%s.Element%u",first_pass[it->first].name.c_str(),i);
+    n_columns += it->second;
+  }
+  fprintf(file,"\n");
+
+  std::vector<Row> rows;
+  std::vector<double> pool;
+  CollectRecord collect_record;
+  collect_record.rows = &rows;
+  collect_record.pool = &pool;
+  rewind(log);
+  readLog(log,channels,IgnoreChannel(),collect_record);
+  std::stable_sort(rows.begin(),rows.end());
+
+  // A row per group of simultaneous records (one per channel at most, all
+  // within the window after the first), holding the last values of the
+  // other channels
+  std::vector<double> row(n_columns,0.0);
+  std::vector<unsigned int> group;
+  unsigned int r = 0;
+  while(r < rows.size()){
+    long long first = rows[r].stamp;
+    group.clear();
+    while(r < rows.size() && rows[r].stamp - first <= window
+          && std::find(group.begin(),group.end(),rows[r].id) == group.end()){
+      group.push_back(rows[r].id);
+      unsigned int column = columns[rows[r].id];
+      for(unsigned int i = 0; i < rows[r].width; i++)
+        row[column + i] = pool[rows[r].values + i];
+      r++;
+    }
+    fprintf(file,"%.9f",first * 1e-9);
+    for(unsigned int i = 0; i < row.size(); i++)
+      fprintf(file,",%.12g",row[i]);
+    fprintf(file,"\n");
+  }
+  fclose(file);
+  fclose(log);
+  reportDrops(channels);
+  return 0;
+}
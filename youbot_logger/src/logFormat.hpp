@@ -0,0 +1,100 @@
+/******************************************************************************
+*                        OROCOS Youbot logger component                       *
+*                                                                             *
+*                         (C) 2011 Steven Bellens                             *
+*                     steven.bellens@mech.kuleuven.be                         *
+*                    Department of Mechanical Engineering,                    *
+*                   Katholieke Universiteit Leuven, Belgium.                  *
+*                                                                             *
+*       You may redistribute this software and/or modify it under either the  *
+*       terms of the GNU Lesser General Public License version 2.1 (LGPLv2.1  *
+*       <http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>) or (at your *
+*       discretion) of the Modified BSD License:                              *
+*       Redistribution and use in source and binary forms, with or without    *
+*       modification, are permitted provided that the following conditions    *
+*       are met:                                                              *
+*       1. Redistributions of source code must retain the above copyright     *
+*       notice, this list of conditions and the following disclaimer.         *
+*       2. Redistributions in binary form must reproduce the above copyright  *
+*       notice, this list of conditions and the following disclaimer in the   *
+*       documentation and/or other materials provided with the distribution.  *
+*       3. The name of the author may not be used to endorse or promote       *
+*       products derived from this software without specific prior written    *
+*       permission.                                                           *
+*       THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR  *
+*       IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED        *
+*       WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE    *
+*       ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,*
+*       INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    *
+*       (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS       *
+*       OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) *
+*       HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,   *
+*       STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING *
+*       IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE    *
+*       POSSIBILITY OF SUCH DAMAGE.                                           *
+*                                                                             *
+*******************************************************************************/
+
+/* @Description:
+ * @brief Youbot logger - binary log format
+ * @Author: Steven Bellens
+ */
+
+ /*
+  * Layout of the binary log files written by the Youbot Logger component and
+  * read by binlog2csv. A file starts with a FileHeader, followed by chunks.
+  * Each chunk starts with a ChunkHeader giving its type and the size of its
+  * payload, so a reader can skip chunks it doesn't know:
+  *  - CHANNEL: defines (or redefines) a channel: its id, the number of values
+  *    per record, its name (Component.port) and its type. It is written
+  *    before the first records of the channel.
+  *  - DATA: the id of a channel followed by records of that channel. Each
+  *    record is a RecordHeader followed by width doubles.
+  *  - DROPS: the id of a channel and the number of records that were dropped
+  *    since the previous DROPS chunk of that channel.
+  * Ids, sizes and strings are stored as unsigned ints (length first, no
+  * terminating zero). All values are in the byte order of the machine that
+  * wrote the file.
+ */
+
+#ifndef _YOUBOT_LOG_FORMAT_
+#define _YOUBOT_LOG_FORMAT_
+
+namespace youbot{
+  namespace logformat{
+    /// First bytes of each log file
+    const char MAGIC[8] = {'Y','B','L','O','G','\0','\0','\0'};
+    /// Version of the format
+    const unsigned int VERSION = 1;
+
+    /// Chunk types
+    enum ChunkType{
+      CHANNEL = 1,
+      DATA = 2,
+      DROPS = 3
+    };
+
+    struct FileHeader{
+      char magic[8];
+      unsigned int version;
+      /// Size of a RecordHeader, to detect incompatible builds
+      unsigned int record_header_size;
+    };
+
+    struct ChunkHeader{
+      unsigned int type;
+      /// Size of the payload following the header, in bytes
+      unsigned int size;
+    };
+
+    struct RecordHeader{
+      /// Time the record was written, in ns since the start of the logger
+      long long stamp;
+      /// Sequence number of the record in its channel; gaps are dropped records
+      unsigned int seq;
+      /// Number of values following the header
+      unsigned int width;
+    };
+  }
+}
+#endif
@@ -0,0 +1,122 @@
+/******************************************************************************
+*                        OROCOS Youbot logger component                       *
+*                                                                             *
+*                         (C) 2011 Steven Bellens                             *
+*                     steven.bellens@mech.kuleuven.be                         *
+*                    Department of Mechanical Engineering,                    *
+*                   Katholieke Universiteit Leuven, Belgium.                  *
+*                                                                             *
+*       You may redistribute this software and/or modify it under either the  *
+*       terms of the GNU Lesser General Public License version 2.1 (LGPLv2.1  *
+*       <http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>) or (at your *
+*       discretion) of the Modified BSD License:                              *
+*       Redistribution and use in source and binary forms, with or without    *
+*       modification, are permitted provided that the following conditions    *
+*       are met:                                                              *
+*       1. Redistributions of source code must retain the above copyright     *
+*       notice, this list of conditions and the following disclaimer.         *
+*       2. Redistributions in binary form must reproduce the above copyright  *
+*       notice, this list of conditions and the following disclaimer in the   *
+*       documentation and/or other materials provided with the distribution.  *
+*       3. The name of the author may not be used to endorse or promote       *
+*       products derived from this software without specific prior written    *
+*       permission.                                                           *
+*       THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR  *
+*       IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED        *
+*       WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE    *
+*       ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,*
+*       INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    *
+*       (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS       *
+*       OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) *
+*       HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,   *
+*       STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING *
+*       IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE    *
+*       POSSIBILITY OF SUCH DAMAGE.                                           *
+*                                                                             *
+*******************************************************************************/
+
+#include "logRing.hpp"
+
+#include <rtt/os/TimeService.hpp>
+
+namespace youbot{
+  using namespace logformat;
+
+  LogRing::LogRing(const std::string& name, const std::string& type, unsigned int capacity, unsigned int max_width)
+  :m_written_width(-1)
+  ,m_reported_drops(0)
+  ,m_name(name)
+  ,m_type(type)
+  ,m_max_width(max_width)
+  ,m_head(0)
+  ,m_tail(0)
+  ,m_seq(0)
+  ,m_dropped(0)
+  ,m_oversized(0)
+  {
+    unsigned int size = 1;
+    while(size < capacity)
+      size <<= 1;
+    m_mask = size - 1;
+    // The header takes the place of two doubles, which keeps the values aligned
+    m_stride = (sizeof(RecordHeader) + sizeof(double) - 1) / sizeof(double) + max_width;
+    m_slots.resize(size * m_stride, 0.0);
+  }
+
+  double* LogRing::slot(unsigned int index){
+    return &m_slots[(index & m_mask) * m_stride];
+  }
+
+  double* LogRing::reserve(){
+    if(m_head - m_tail > m_mask){
+      m_seq++;
+      m_dropped++;
+      return 0;
+    }
+    RecordHeader* header = reinterpret_cast<RecordHeader*>(slot(m_head));
+    header->seq = m_seq++;
+    return slot(m_head) + m_stride - m_max_width;
+  }
+
+  void LogRing::commit(unsigned int width){
+    if(width > m_max_width){
+      m_dropped++;
+      m_oversized++;
+      return;
+    }
+    RecordHeader* header = reinterpret_cast<RecordHeader*>(slot(m_head));
+    header->stamp = RTT::os::TimeService::Instance()->getTicks();
+    header->width = width;
+    // The record must be complete before the consumer can see it
+    __sync_synchronize();
+    m_head = m_head + 1;
+  }
+
+  unsigned int LogRing::available() const{
+    unsigned int available = m_head - m_tail;
+    __sync_synchronize();
+    return available;
+  }
+
+  RecordHeader* LogRing::header(unsigned int i){
+    return reinterpret_cast<RecordHeader*>(slot(m_tail + i));
+  }
+
+  double* LogRing::values(unsigned int i){
+    return slot(m_tail + i) + m_stride - m_max_width;
+  }
+
+  void LogRing::release(unsigned int n){
+    // Done reading the records before the producer can reuse them
+    __sync_synchronize();
+    m_tail = m_tail + n;
+  }
+
+  unsigned int LogRing::dropped() const{
+    return m_dropped;
+  }
+
+  unsigned int LogRing::oversized() const{
+    return m_oversized;
+  }
+}
@@ -0,0 +1,140 @@
+/******************************************************************************
+*                        OROCOS Youbot logger component                       *
+*                                                                             *
+*                         (C) 2011 Steven Bellens                             *
+*                     steven.bellens@mech.kuleuven.be                         *
+*                    Department of Mechanical Engineering,                    *
+*                   Katholieke Universiteit Leuven, Belgium.                  *
+*                                                                             *
+*       You may redistribute this software and/or modify it under either the  *
+*       terms of the GNU Lesser General Public License version 2.1 (LGPLv2.1  *
+*       <http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>) or (at your *
+*       discretion) of the Modified BSD License:                              *
+*       Redistribution and use in source and binary forms, with or without    *
+*       modification, are permitted provided that the following conditions    *
+*       are met:                                                              *
+*       1. Redistributions of source code must retain the above copyright     *
+*       notice, this list of conditions and the following disclaimer.         *
+*       2. Redistributions in binary form must reproduce the above copyright  *
+*       notice, this list of conditions and the following disclaimer in the   *
+*       documentation and/or other materials provided with the distribution.  *
+*       3. The name of the author may not be used to endorse or promote       *
+*       products derived from this software without specific prior written    *
+*       permission.                                                           *
+*       THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR  *
+*       IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED        *
+*       WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE    *
+*       ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,*
+*       INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    *
+*       (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS       *
+*       OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) *
+*       HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,   *
+*       STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING *
+*       IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE    *
+*       POSSIBILITY OF SUCH DAMAGE.                                           *
+*                                                                             *
+*******************************************************************************/
+
+/* @Description:
+ * @brief Youbot logger - lock-free record ring
+ * @Author: Steven Bellens
+ */
+
+ /*
+  * A LogRing is a single producer, single consumer ring of fixed-size log
+  * records: a RecordHeader and up to max_width doubles each. The producer
+  * (the thread writing the logged port) copies a sample into the next free
+  * slot and publishes it; the consumer (the logger thread) reads the
+  * published records in order and releases them. Neither side blocks or
+  * allocates. When the ring is full the producer drops the sample and counts
+  * it, so the consumer can report exactly how much was lost.
+ */
+
+#ifndef _YOUBOT_LOG_RING_
+#define _YOUBOT_LOG_RING_
+
+#include "logFormat.hpp"
+
+#include <string>
+#include <vector>
+
+namespace youbot{
+
+  class LogRing{
+    public:
+      /**
+       * \brief Constructor
+       *
+       * \param name The name of the channel (Component.port)
+       * \param type The name of the logged type
+       * \param capacity Number of records, rounded up to a power of two
+       * \param max_width Maximum number of values per record
+       */
+      LogRing(const std::string& name, const std::string& type, unsigned int capacity, unsigned int max_width);
+
+      /// @name Producer
+      //@{
+      /**
+       * \brief The values of the next free record
+       *
+       * \return 0 if the ring is full; the sample is counted as dropped
+       */
+      double* reserve();
+      /**
+       * \brief Publish the record returned by reserve()
+       *
+       * \param width The number of values the sample has; a sample wider
+       * than max_width is dropped (the values beyond it were not written)
+       */
+      void commit(unsigned int width);
+      //@}
+
+      /// @name Consumer
+      //@{
+      /// Number of published records
+      unsigned int available() const;
+      /// The header of published record i, 0 being the oldest (stamp in ticks)
+      logformat::RecordHeader* header(unsigned int i);
+      /// The values of published record i
+      double* values(unsigned int i);
+      /// Release the n oldest published records
+      void release(unsigned int n);
+      /// Number of dropped samples since the start
+      unsigned int dropped() const;
+      /// Number of samples dropped because they were wider than max_width
+      unsigned int oversized() const;
+      //@}
+
+      const std::string& name() const{ return m_name; }
+      const std::string& type() const{ return m_type; }
+      unsigned int maxWidth() const{ return m_max_width; }
+
+      /// @name Consumer bookkeeping
+      //@{
+      /// Width of the last CHANNEL chunk written for this ring (-1: none yet)
+      int m_written_width;
+      /// Value of dropped() at the last DROPS chunk
+      unsigned int m_reported_drops;
+      //@}
+
+    private:
+      double* slot(unsigned int index);
+
+      std::string m_name;
+      std::string m_type;
+      unsigned int m_max_width;
+      /// Slot size, in doubles (header and values)
+      unsigned int m_stride;
+      unsigned int m_mask;
+      std::vector<double> m_slots;
+      /// Records published by the producer (written by the producer only)
+      volatile unsigned int m_head;
+      /// Records released by the consumer (written by the consumer only)
+      volatile unsigned int m_tail;
+      /// Sequence number of the next sample (written by the producer only)
+      unsigned int m_seq;
+      volatile unsigned int m_dropped;
+      volatile unsigned int m_oversized;
+  };
+}
+#endif
@@ -0,0 +1,267 @@
+/******************************************************************************
+*                        OROCOS Youbot logger component                       *
+*                                                                             *
+*                         (C) 2011 Steven Bellens                             *
+*                     steven.bellens@mech.kuleuven.be                         *
+*                    Department of Mechanical Engineering,                    *
+*                   Katholieke Universiteit Leuven, Belgium.                  *
+*                                                                             *
+*       You may redistribute this software and/or modify it under either the  *
+*       terms of the GNU Lesser General Public License version 2.1 (LGPLv2.1  *
+*       <http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>) or (at your *
+*       discretion) of the Modified BSD License:                              *
+*       Redistribution and use in source and binary forms, with or without    *
+*       modification, are permitted provided that the following conditions    *
+*       are met:                                                              *
+*       1. Redistributions of source code must retain the above copyright     *
+*       notice, this list of conditions and the following disclaimer.         *
+*       2. Redistributions in binary form must reproduce the above copyright  *
+*       notice, this list of conditions and the following disclaimer in the   *
+*       documentation and/or other materials provided with the distribution.  *
+*       3. The name of the author may not be used to endorse or promote       *
+*       products derived from this software without specific prior written    *
+*       permission.                                                           *
+*       THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR  *
+*       IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED        *
+*       WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE    *
+*       ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,*
+*       INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    *
+*       (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS       *
+*       OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) *
+*       HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,   *
+*       STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING *
+*       IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE    *
+*       POSSIBILITY OF SUCH DAMAGE.                                           *
+*                                                                             *
+*******************************************************************************/
+
+#include "logger.hpp"
+
+// This macro is used whenever a new Orocos component is generated. Here we
+// generate a Youbot Logger component.
+ORO_CREATE_COMPONENT(youbot::Logger)
+
+namespace youbot{
+  using namespace logformat;
+
+  Logger::Logger(std::string name) : TaskContext(name)
+  ,m_file_name("reports.bin")
+  ,m_buffer_size(1024)
+  ,m_max_width(64)
+  ,m_records_written(0)
+  ,m_records_dropped(0)
+  ,m_event_driven(false)
+  ,m_flush_period(0.1)
+  ,m_file(0)
+  ,m_start(0)
+  ,m_last_flush(0)
+  ,m_wakeup(this)
+  {
+    this->addOperation("reportPort",&Logger::reportPort,this,RTT::OwnThread).doc("Log an output port of a peer").arg("Component","Name of the peer").arg("Port","Name of the output port");
+    this->addOperation("reportData",&Logger::reportData,this,RTT::OwnThread).doc("Log a property of a peer when it changes").arg("Component","Name of the peer").arg("Property","Name of the property");
+    /// Add property variables to the Orocos interface
+    this->addProperty("file_name",m_file_name).doc("Name of the binary log file");
+    this->addProperty("buffer_size",m_buffer_size).doc("Records buffered per reported port; set before reporting ports");
+    this->addProperty("max_width",m_max_width).doc("Maximum number of values per record; set before reporting ports");
+    this->addProperty("records_written",m_records_written).doc("Records written since the start");
+    this->addProperty("records_dropped",m_records_dropped).doc("Records dropped since the start");
+    this->addProperty("event_driven",m_event_driven).doc("Drain when samples arrive instead of periodically (needs a non-periodic activity)");
+    this->addProperty("flush_period",m_flush_period).doc("Minimum time between two flushes of the file");
+  }
+
+  Logger::~Logger(){
+    if(m_file)
+      fclose(m_file);
+    cleanupHook();
+  }
+
+  bool Logger::startHook(){
+    if(m_event_driven && this->getPeriod() > 0.0){
+      log(Error) << "(Logger) An event driven logger needs a non-periodic activity" << endlog();
+      return false;
+    }
+    m_file = fopen(m_file_name.c_str(),"wb");
+    if(!m_file){
+      log(Error) << "(Logger) Could not open " << m_file_name << endlog();
+      return false;
+    }
+    FileHeader header;
+    memcpy(header.magic,MAGIC,sizeof(MAGIC));
+    header.version = VERSION;
+    header.record_header_size = sizeof(RecordHeader);
+    fwrite(&header,sizeof(header),1,m_file);
+    // Records from before the start don't belong in this file
+    for(unsigned int i = 0; i < m_rings.size(); i++){
+      m_rings[i]->release(m_rings[i]->available());
+      m_rings[i]->m_written_width = -1;
+      m_rings[i]->m_reported_drops = m_rings[i]->dropped();
+    }
+    for(unsigned int i = 0; i < m_sampled.size(); i++)
+      m_sampled[i].logged = false;
+    m_records_written = 0;
+    m_records_dropped = 0;
+    m_start = RTT::os::TimeService::Instance()->getTicks();
+    m_last_flush = m_start;
+    m_wakeup.enable(m_event_driven);
+    return true;
+  }
+
+  void Logger::updateHook(){
+    // Samples arriving from here on wake the logger up again
+    m_wakeup.clear();
+    for(unsigned int i = 0; i < m_sampled.size(); i++){
+      Sampled& sampled = m_sampled[i];
+      double value;
+      if(sampled.real)
+        value = sampled.real->get();
+      else if(sampled.integer)
+        value = sampled.integer->get();
+      else
+        value = sampled.boolean->get();
+      if(sampled.logged && value == sampled.last)
+        continue;
+      double* values = sampled.ring->reserve();
+      if(values){
+        values[0] = value;
+        sampled.ring->commit(1);
+      }
+      sampled.last = value;
+      sampled.logged = true;
+    }
+    for(unsigned int i = 0; i < m_rings.size(); i++)
+      drain(i,m_rings[i]);
+    if(RTT::os::TimeService::Instance()->secondsSince(m_last_flush) >= m_flush_period){
+      fflush(m_file);
+      m_last_flush = RTT::os::TimeService::Instance()->getTicks();
+    }
+    if(ferror(m_file)){
+      log(Error) << "(Logger) Could not write to " << m_file_name << endlog();
+      this->error();
+    }
+  }
+
+  void Logger::stopHook(){
+    m_wakeup.enable(false);
+    updateHook();
+    fclose(m_file);
+    m_file = 0;
+  }
+
+  void Logger::cleanupHook(){
+    for(unsigned int i = 0; i < m_connections.size(); i++)
+      m_connections[i].port->getManager()->removeConnection(m_connections[i].id);
+    // The rings of the ports go with their channels
+    m_connections.clear();
+    for(unsigned int i = 0; i < m_sampled.size(); i++)
+      delete m_sampled[i].ring;
+    m_sampled.clear();
+    m_rings.clear();
+  }
+
+  bool Logger::reportPort(const std::string& component, const std::string& port){
+    TaskContext* peer = this->getPeer(component);
+    if(!peer){
+      log(Error) << "(Logger) " << component << " is not a peer" << endlog();
+      return false;
+    }
+    base::PortInterface* output = peer->ports()->getPort(port);
+    if(!output){
+      log(Error) << "(Logger) " << component << " has no port " << port << endlog();
+      return false;
+    }
+    std::string name = component + "." + port;
+    bool attached = false;
+    if(!attach<ColumnVector>(output,name,"ColumnVector",attached)
+       && !attach<SymmetricMatrix>(output,name,"SymmetricMatrix",attached)
+       && !attach<geometry_msgs::Twist>(output,name,"geometry_msgs/Twist",attached)
+       && !attach<std_msgs::Float64>(output,name,"std_msgs/Float64",attached)
+       && !attach<std::vector<double> >(output,name,"float64[]",attached)
+       && !attach<double>(output,name,"double",attached)
+       && !attach<RTT::os::Timer::TimerId>(output,name,"TimerId",attached)){
+      log(Error) << "(Logger) " << name << " is not an output port of a supported type" << endlog();
+      return false;
+    }
+    return attached;
+  }
+
+  bool Logger::reportData(const std::string& component, const std::string& property){
+    TaskContext* peer = this->getPeer(component);
+    if(!peer){
+      log(Error) << "(Logger) " << component << " is not a peer" << endlog();
+      return false;
+    }
+    Sampled sampled;
+    sampled.real = peer->properties()->getPropertyType<double>(property);
+    sampled.integer = peer->properties()->getPropertyType<int>(property);
+    sampled.boolean = peer->properties()->getPropertyType<bool>(property);
+    if(!sampled.real && !sampled.integer && !sampled.boolean){
+      log(Error) << "(Logger) " << component << " has no property " << property << " of a supported type" << endlog();
+      return false;
+    }
+    const char* type = sampled.real ? "double" : sampled.integer ? "int" : "bool";
+    sampled.ring = new LogRing(component + "." + property,type,m_buffer_size,1);
+    sampled.last = 0.0;
+    sampled.logged = false;
+    m_sampled.push_back(sampled);
+    m_rings.push_back(sampled.ring);
+    return true;
+  }
+
+  void Logger::drain(unsigned int channel, LogRing* ring){
+    unsigned int available = ring->available();
+    unsigned int i = 0;
+    while(i < available){
+      unsigned int width = ring->header(i)->width;
+      if((int)width != ring->m_written_width){
+        writeChunkHeader(CHANNEL,4 * sizeof(unsigned int) + ring->name().size() + ring->type().size());
+        fwrite(&channel,sizeof(channel),1,m_file);
+        fwrite(&width,sizeof(width),1,m_file);
+        writeString(ring->name());
+        writeString(ring->type());
+        ring->m_written_width = width;
+      }
+      // One chunk for the run of records with this width
+      unsigned int n = 1;
+      while(i + n < available && ring->header(i + n)->width == width)
+        n++;
+      writeChunkHeader(DATA,sizeof(unsigned int) + n * (sizeof(RecordHeader) + width * sizeof(double)));
+      fwrite(&channel,sizeof(channel),1,m_file);
+      for(unsigned int k = i; k < i + n; k++){
+        RecordHeader record = *ring->header(k);
+        record.stamp = RTT::os::TimeService::ticks2nsecs(record.stamp - m_start);
+        fwrite(&record,sizeof(record),1,m_file);
+        fwrite(ring->values(k),sizeof(double),width,m_file);
+      }
+      i += n;
+    }
+    ring->release(available);
+    m_records_written += available;
+
+    unsigned int dropped = ring->dropped();
+    if(dropped != ring->m_reported_drops){
+      unsigned int lost = dropped - ring->m_reported_drops;
+      writeChunkHeader(DROPS,2 * sizeof(unsigned int));
+      fwrite(&channel,sizeof(channel),1,m_file);
+      fwrite(&lost,sizeof(lost),1,m_file);
+      if(ring->oversized() > 0)
+        log(Warning) << "(Logger) Dropped " << lost << " records of " << ring->name() << ", " << ring->oversized() << " records since the start were wider than max_width" << endlog();
+      else
+        log(Warning) << "(Logger) Dropped " << lost << " records of " << ring->name() << ", increase buffer_size or the logger rate" << endlog();
+      m_records_dropped += lost;
+      ring->m_reported_drops = dropped;
+    }
+  }
+
+  void Logger::writeChunkHeader(unsigned int type, unsigned int size){
+    ChunkHeader header;
+    header.type = type;
+    header.size = size;
+    fwrite(&header,sizeof(header),1,m_file);
+  }
+
+  void Logger::writeString(const std::string& value){
+    unsigned int size = value.size();
+    fwrite(&size,sizeof(size),1,m_file);
+    fwrite(value.data(),1,size,m_file);
+  }
+}
@@ -0,0 +1,326 @@
+/******************************************************************************
+*                        OROCOS Youbot logger component                       *
+*                                                                             *
+*                         (C) 2011 Steven Bellens                             *
+*                     steven.bellens@mech.kuleuven.be                         *
+*                    Department of Mechanical Engineering,                    *
+*                   Katholieke Universiteit Leuven, Belgium.                  *
+*                                                                             *
+*       You may redistribute this software and/or modify it under either the  *
+*       terms of the GNU Lesser General Public License version 2.1 (LGPLv2.1  *
+*       <http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>) or (at your *
+*       discretion) of the Modified BSD License:                              *
+*       Redistribution and use in source and binary forms, with or without    *
+*       modification, are permitted provided that the following conditions    *
+*       are met:                                                              *
+*       1. Redistributions of source code must retain the above copyright     *
+*       notice, this list of conditions and the following disclaimer.         *
+*       2. Redistributions in binary form must reproduce the above copyright  *
+*       notice, this list of conditions and the following disclaimer in the   *
+*       documentation and/or other materials provided with the distribution.  *
+*       3. The name of the author may not be used to endorse or promote       *
+*       products derived from this software without specific prior written    *
+*       permission.                                                           *
+*       THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR  *
+*       IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED        *
+*       WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE    *
+*       ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,*
+*       INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    *
+*       (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS       *
+*       OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) *
+*       HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,   *
+*       STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING *
+*       IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE    *
+*       POSSIBILITY OF SUCH DAMAGE.                                           *
+*                                                                             *
+*******************************************************************************/
+
+/* @Description:
+ * @brief Youbot logger - OROCOS component
+ * @Author: Steven Bellens
+ */
+
+ /*
+  * The YouBot Logger component replaces OCL::FileReporting with a binary log.
+  * For each reported port it attaches a LogChannel to the output port of the
+  * producer: when the producer writes the port, the channel copies the sample
+  * as a fixed-size record into a lock-free ring (LogRing), so logging costs the
+  * producer a copy of the sample and never blocks it. The logger itself runs
+  * in a low-priority periodic activity and drains the rings into a chunked
+  * binary file (logFormat.hpp); binlog2csv converts it to CSV. Full rings drop
+  * the newest samples, and the drops are counted, written in the log and
+  * reported as warnings. Reported properties are sampled each logger period
+  * and logged when they change.
+  * With event_driven set the logger has a non-periodic activity instead: the
+  * channels wake it up when a sample arrives, like event ports, and samples
+  * arriving while a wake up is pending are drained together. The logger then
+  * only runs when there is data, and properties are sampled at each wake up.
+ */
+
+#ifndef _YOUBOT_LOGGER_
+#define _YOUBOT_LOGGER_
+
+#include "logRing.hpp"
+
+#include <bfl/wrappers/matrix/matrix_wrapper.h>
+#include <bfl/wrappers/matrix/vector_wrapper.h>
+
+#include <rtt/TaskContext.hpp>
+#include <rtt/Port.hpp>
+#include <rtt/Property.hpp>
+#include <rtt/Component.hpp>
+#include <rtt/base/ChannelElement.hpp>
+#include <rtt/internal/ConnID.hpp>
+#include <rtt/os/TimeService.hpp>
+#include <rtt/os/Timer.hpp>
+
+#include <geometry_msgs/Twist.h>
+#include <std_msgs/Float64.h>
+
+#include <stdio.h>
+#include <string.h>
+
+namespace youbot{
+
+  using namespace std;
+  using namespace RTT;
+  using namespace MatrixWrapper;
+
+  /// @name Flattening of the logged types into records
+  /// Each function returns the width of the sample and only writes the
+  /// values if the width fits in max_width.
+  //@{
+  inline unsigned int flatten(const ColumnVector& sample, double* values, unsigned int max_width){
+    unsigned int width = sample.rows();
+    if(width <= max_width)
+      for(unsigned int i = 0; i < width; i++)
+        values[i] = sample(i+1);
+    return width;
+  }
+
+  /// The upper triangle, row by row
+  inline unsigned int flatten(const SymmetricMatrix& sample, double* values, unsigned int max_width){
+    unsigned int rows = sample.rows();
+    unsigned int width = rows * (rows + 1) / 2;
+    if(width <= max_width){
+      unsigned int k = 0;
+      for(unsigned int i = 1; i <= rows; i++)
+        for(unsigned int j = i; j <= rows; j++)
+          values[k++] = sample(i,j);
+    }
+    return width;
+  }
+
+  /// linear x, y, z, angular x, y, z
+  inline unsigned int flatten(const geometry_msgs::Twist& sample, double* values, unsigned int max_width){
+    if(max_width >= 6){
+      values[0] = sample.linear.x;
+      values[1] = sample.linear.y;
+      values[2] = sample.linear.z;
+      values[3] = sample.angular.x;
+      values[4] = sample.angular.y;
+      values[5] = sample.angular.z;
+    }
+    return 6;
+  }
+
+  inline unsigned int flatten(const std_msgs::Float64& sample, double* values, unsigned int max_width){
+    if(max_width >= 1)
+      values[0] = sample.data;
+    return 1;
+  }
+
+  inline unsigned int flatten(const std::vector<double>& sample, double* values, unsigned int max_width){
+    if(sample.size() <= max_width && !sample.empty())
+      memcpy(values,&sample[0],sample.size() * sizeof(double));
+    return sample.size();
+  }
+
+  inline unsigned int flatten(double sample, double* values, unsigned int max_width){
+    if(max_width >= 1)
+      values[0] = sample;
+    return 1;
+  }
+
+  /// Timer ids (RTT::os::Timer::TimerId)
+  inline unsigned int flatten(int sample, double* values, unsigned int max_width){
+    if(max_width >= 1)
+      values[0] = sample;
+    return 1;
+  }
+  //@}
+
+  /**
+   * \brief Wakes up an event driven logger
+   *
+   * Signalled by the producers after each record; only the first signal
+   * after the logger cleared the wake up triggers the logger.
+   */
+  class LogWakeup{
+    public:
+      LogWakeup(TaskContext* logger) : m_logger(logger), m_enabled(false), m_pending(0){}
+
+      void enable(bool enabled){ m_enabled = enabled; }
+
+      void signal(){
+        if(m_enabled && __sync_bool_compare_and_swap(&m_pending,0,1))
+          m_logger->trigger();
+      }
+
+      /// Called by the logger before it drains the rings
+      void clear(){ __sync_lock_release(&m_pending); }
+
+    private:
+      TaskContext* m_logger;
+      volatile bool m_enabled;
+      volatile int m_pending;
+  };
+
+  /**
+   * \brief Connection end that writes the samples of a port into a LogRing
+   *
+   * The channel is attached to the output port of the producer, so write()
+   * runs in the thread of the producer.
+   */
+  template<class T>
+  class LogChannel : public base::ChannelElement<T>{
+    public:
+      typedef typename base::ChannelElement<T>::param_t param_t;
+
+      /// The channel owns the ring: the port may hold on to it after the logger let go
+      LogChannel(LogRing* ring, LogWakeup* wakeup) : m_ring(ring), m_wakeup(wakeup){}
+      ~LogChannel(){ delete m_ring; }
+
+      bool write(param_t sample){
+        double* values = m_ring->reserve();
+        if(values)
+          m_ring->commit(flatten(sample,values,m_ring->maxWidth()));
+        m_wakeup->signal();
+        // Never report a failure: the port would drop the connection
+        return true;
+      }
+
+      bool data_sample(param_t sample){
+        return true;
+      }
+
+    private:
+      LogRing* m_ring;
+      LogWakeup* m_wakeup;
+  };
+
+  class Logger : public TaskContext{
+    protected:
+      /// @name Properties
+      //@{
+      /// Name of the binary log file
+      std::string m_file_name;
+      /// Records per reported port
+      int m_buffer_size;
+      /// Maximum number of values per record
+      int m_max_width;
+      /// Records written since the start
+      int m_records_written;
+      /// Records dropped since the start
+      int m_records_dropped;
+      /// Drain when samples arrive instead of periodically (needs a non-periodic activity)
+      bool m_event_driven;
+      /// Minimum time between two flushes of the file
+      double m_flush_period;
+      //@}
+
+    public:
+      /**
+       * \brief Constructor
+       *
+       * Constructor building a Youbot logger component
+       * \param name The component name
+       */
+      Logger(std::string name);
+      //! Destructor
+      ~Logger();
+
+      /// @name Public methods
+      //@{
+      bool startHook();
+      void updateHook();
+      void stopHook();
+      void cleanupHook();
+
+      /**
+       * \brief Log an output port of a peer
+       *
+       * Supported types: ColumnVector, SymmetricMatrix, geometry_msgs::Twist,
+       * std_msgs::Float64, std::vector<double> and double.
+       */
+      bool reportPort(const std::string& component, const std::string& port);
+
+      /**
+       * \brief Log a property of a peer
+       *
+       * Supported types: double, int and bool. The property is sampled each
+       * period of the logger and logged when it changes.
+       */
+      bool reportData(const std::string& component, const std::string& property);
+      //@}
+
+    private:
+      /**
+       * \brief Attach a LogChannel to the port if it is an OutputPort<T>
+       *
+       * \param attached Set to whether the channel could be connected
+       * \return false if the port is not an OutputPort<T>
+       */
+      template<class T>
+      bool attach(base::PortInterface* port, const std::string& name, const std::string& type, bool& attached){
+        OutputPort<T>* output = dynamic_cast<OutputPort<T>*>(port);
+        if(!output)
+          return false;
+        LogRing* ring = new LogRing(name,type,m_buffer_size,m_max_width);
+        Connection connection;
+        connection.port = output;
+        connection.id = new internal::SimpleConnID();
+        connection.channel = new LogChannel<T>(ring,&m_wakeup);
+        attached = output->addConnection(connection.id,connection.channel,ConnPolicy());
+        if(!attached){
+          log(Error) << "(Logger) Could not connect to " << name << endlog();
+          delete connection.id;
+          return true;
+        }
+        m_connections.push_back(connection);
+        m_rings.push_back(ring);
+        return true;
+      }
+
+      /// Write the records and drops of one ring
+      void drain(unsigned int channel, LogRing* ring);
+      void writeChunkHeader(unsigned int type, unsigned int size);
+      void writeString(const std::string& value);
+
+      struct Connection{
+        base::OutputPortInterface* port;
+        internal::ConnID* id;
+        base::ChannelElementBase::shared_ptr channel;
+      };
+      /// A reported property, of one of the supported types
+      struct Sampled{
+        Property<double>* real;
+        Property<int>* integer;
+        Property<bool>* boolean;
+        LogRing* ring;
+        /// Last logged value
+        double last;
+        bool logged;
+      };
+
+      /// The rings, in channel id order (the rings of the properties are owned by the logger)
+      std::vector<LogRing*> m_rings;
+      std::vector<Connection> m_connections;
+      std::vector<Sampled> m_sampled;
+      FILE* m_file;
+      RTT::os::TimeService::ticks m_start;
+      RTT::os::TimeService::ticks m_last_flush;
+      LogWakeup m_wakeup;
+  };
+}
+#endif
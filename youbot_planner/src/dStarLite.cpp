@@ -0,0 +1,352 @@
+/******************************************************************************
+*                       OROCOS Youbot planner component                       *
+*                                                                             *
+*                         (C) 2011 Steven Bellens                             *
+*                     steven.bellens@mech.kuleuven.be                         *
+*                    Department of Mechanical Engineering,                    *
+*                   Katholieke Universiteit Leuven, Belgium.                  *
+*                                                                             *
+*       You may redistribute this software and/or modify it under either the  *
+*       terms of the GNU Lesser General Public License version 2.1 (LGPLv2.1  *
+*       <http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>) or (at your *
+*       discretion) of the Modified BSD License:                              *
+*       Redistribution and use in source and binary forms, with or without    *
+*       modification, are permitted provided that the following conditions    *
+*       are met:                                                              *
+*       1. Redistributions of source code must retain the above copyright     *
+*       notice, this list of conditions and the following disclaimer.         *
+*       2. Redistributions in binary form must reproduce the above copyright  *
+*       notice, this list of conditions and the following disclaimer in the   *
+*       documentation and/or other materials provided with the distribution.  *
+*       3. The name of the author may not be used to endorse or promote       *
+*       products derived from this software without specific prior written    *
+*       permission.                                                           *
+*       THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR  *
+*       IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED        *
+*       WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE    *
+*       ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,*
+*       INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    *
+*       (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS       *
+*       OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) *
+*       HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,   *
+*       STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING *
+*       IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE    *
+*       POSSIBILITY OF SUCH DAMAGE.                                           *
+*                                                                             *
+*******************************************************************************/
+#include "dStarLite.hpp"
+
+#include <math.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <limits>
+
+namespace youbot{
+  static const double infinity = std::numeric_limits<double>::infinity();
+
+  DStarLite::DStarLite()
+  :m_width(0)
+  ,m_height(0)
+  ,m_start(0)
+  ,m_last(0)
+  ,m_goal(-1)
+  ,m_km(0.0)
+  ,m_initialised(false)
+  ,m_expansions(0)
+  ,m_heap_size(0)
+  {
+    for(int n = 0; n < 8; n++){
+      m_neighbour[n] = 0;
+      m_neighbour_x[n] = 0;
+      m_neighbour_y[n] = 0;
+      m_neighbour_cost[n] = 0.0;
+    }
+  }
+
+  void DStarLite::resize(int width, int height, double inflation){
+    m_width = width;
+    m_height = height;
+    int cells = width * height;
+    m_occupancy.assign(cells, 0);
+    m_inflation.assign(cells, 0);
+    // The border is always blocked
+    for(int x = 0; x < width; x++){
+      m_inflation[index(x, 0)] = 1;
+      m_inflation[index(x, height - 1)] = 1;
+    }
+    for(int y = 0; y < height; y++){
+      m_inflation[index(0, y)] = 1;
+      m_inflation[index(width - 1, y)] = 1;
+    }
+    // Orthogonal neighbours first, then the diagonal ones
+    const int dx[8] = {1, -1, 0, 0, 1, 1, -1, -1};
+    const int dy[8] = {0, 0, 1, -1, 1, -1, 1, -1};
+    for(int n = 0; n < 8; n++){
+      m_neighbour_x[n] = dx[n];
+      m_neighbour_y[n] = dy[n];
+      m_neighbour[n] = dy[n] * width + dx[n];
+      m_neighbour_cost[n] = (n < 4) ? 1.0 : sqrt(2.0);
+    }
+    int r = (int)ceil(inflation);
+    m_disc_x.clear();
+    m_disc_y.clear();
+    for(int y = -r; y <= r; y++){
+      for(int x = -r; x <= r; x++){
+        if(x * x + y * y <= inflation * inflation){
+          m_disc_x.push_back(x);
+          m_disc_y.push_back(y);
+        }
+      }
+    }
+    m_g.assign(cells, infinity);
+    m_rhs.assign(cells, infinity);
+    m_changed.clear();
+    m_changed.reserve(cells);
+    m_changed_flag.assign(cells, 0);
+    m_heap.assign(cells, 0);
+    m_heap_key.assign(cells, Key());
+    m_heap_position.assign(cells, -1);
+    m_heap_size = 0;
+    m_goal = -1;
+    m_initialised = false;
+  }
+
+  int DStarLite::width() const{
+    return m_width;
+  }
+
+  int DStarLite::height() const{
+    return m_height;
+  }
+
+  int DStarLite::index(int x, int y) const{
+    return y * m_width + x;
+  }
+
+  int DStarLite::goal() const{
+    return m_goal;
+  }
+
+  bool DStarLite::pending() const{
+    return !m_initialised || !m_changed.empty();
+  }
+
+  unsigned int DStarLite::expansions() const{
+    return m_expansions;
+  }
+
+  bool DStarLite::border(int cell) const{
+    int x = cell % m_width;
+    int y = cell / m_width;
+    return x == 0 || y == 0 || x == m_width - 1 || y == m_height - 1;
+  }
+
+  bool DStarLite::blocked(int x, int y) const{
+    if(x < 0 || y < 0 || x >= m_width || y >= m_height) return true;
+    return m_inflation[index(x, y)] > 0;
+  }
+
+  void DStarLite::setOccupied(int x, int y, bool occupied, bool fixed){
+    if(x <= 0 || y <= 0 || x >= m_width - 1 || y >= m_height - 1) return;
+    int cell = index(x, y);
+    unsigned char state = occupied ? (fixed ? 2 : 1) : 0;
+    if(m_occupancy[cell] == state) return;
+    // Sensor updates do not clear the map
+    if(m_occupancy[cell] == 2 && !fixed) return;
+    bool was_occupied = m_occupancy[cell] != 0;
+    m_occupancy[cell] = state;
+    if(was_occupied != occupied) inflate(x, y, occupied ? 1 : -1);
+  }
+
+  void DStarLite::inflate(int x, int y, int delta){
+    for(unsigned int i = 0; i < m_disc_x.size(); i++){
+      int cx = x + m_disc_x[i];
+      int cy = y + m_disc_y[i];
+      if(cx < 0 || cy < 0 || cx >= m_width || cy >= m_height) continue;
+      int c = index(cx, cy);
+      bool was_blocked = m_inflation[c] > 0;
+      m_inflation[c] += delta;
+      if(was_blocked != (m_inflation[c] > 0) && !m_changed_flag[c]){
+        m_changed_flag[c] = 1;
+        m_changed.push_back(c);
+      }
+    }
+  }
+
+  bool DStarLite::setGoal(int x, int y){
+    if(x <= 0 || y <= 0 || x >= m_width - 1 || y >= m_height - 1) return false;
+    m_goal = index(x, y);
+    m_initialised = false;
+    return true;
+  }
+
+  double DStarLite::heuristic(int a, int b) const{
+    int dx = abs(a % m_width - b % m_width);
+    int dy = abs(a / m_width - b / m_width);
+    return std::max(dx, dy) + (sqrt(2.0) - 1.0) * std::min(dx, dy);
+  }
+
+  double DStarLite::cost(int a, int n) const{
+    int b = a + m_neighbour[n];
+    if(m_inflation[a] > 0 || m_inflation[b] > 0) return infinity;
+    // No cutting of corners
+    if(n >= 4 && (m_inflation[a + m_neighbour_x[n]] > 0 || m_inflation[a + m_neighbour_y[n] * m_width] > 0)) return infinity;
+    return m_neighbour_cost[n];
+  }
+
+  DStarLite::Key DStarLite::calculateKey(int cell) const{
+    Key key;
+    key.k2 = std::min(m_g[cell], m_rhs[cell]);
+    key.k1 = key.k2 + heuristic(m_start, cell) + m_km;
+    return key;
+  }
+
+  void DStarLite::updateVertex(int cell){
+    if(border(cell)) return;
+    if(cell != m_goal){
+      double rhs = infinity;
+      for(int n = 0; n < 8; n++){
+        rhs = std::min(rhs, cost(cell, n) + m_g[cell + m_neighbour[n]]);
+      }
+      m_rhs[cell] = rhs;
+    }
+    if(m_heap_position[cell] >= 0){
+      if(m_g[cell] != m_rhs[cell]) heapUpdate(cell, calculateKey(cell));
+      else heapRemove(cell);
+    }
+    else if(m_g[cell] != m_rhs[cell]){
+      heapPush(cell, calculateKey(cell));
+    }
+  }
+
+  void DStarLite::computeShortestPath(){
+    while(m_heap_size > 0 && (m_heap_key[0].clearlyBelow(calculateKey(m_start)) || m_rhs[m_start] != m_g[m_start])){
+      int u = m_heap[0];
+      Key k_old = m_heap_key[0];
+      Key k_new = calculateKey(u);
+      m_expansions++;
+      if(k_old < k_new){
+        heapUpdate(u, k_new);
+      }
+      else if(m_g[u] > m_rhs[u]){
+        m_g[u] = m_rhs[u];
+        heapRemove(u);
+        for(int n = 0; n < 8; n++) updateVertex(u + m_neighbour[n]);
+      }
+      else{
+        m_g[u] = infinity;
+        updateVertex(u);
+        for(int n = 0; n < 8; n++) updateVertex(u + m_neighbour[n]);
+      }
+    }
+  }
+
+  bool DStarLite::plan(int x, int y){
+    if(m_goal < 0 || x <= 0 || y <= 0 || x >= m_width - 1 || y >= m_height - 1) return false;
+    int start = index(x, y);
+    m_expansions = 0;
+    if(!m_initialised){
+      // New search, from the goal towards the start
+      for(int i = 0; i < m_heap_size; i++) m_heap_position[m_heap[i]] = -1;
+      m_heap_size = 0;
+      std::fill(m_g.begin(), m_g.end(), infinity);
+      std::fill(m_rhs.begin(), m_rhs.end(), infinity);
+      m_km = 0.0;
+      m_start = start;
+      m_last = start;
+      m_rhs[m_goal] = 0.0;
+      heapPush(m_goal, calculateKey(m_goal));
+      m_initialised = true;
+    }
+    else{
+      m_start = start;
+      if(!m_changed.empty()){
+        // Repair the search around the cells that changed
+        m_km += heuristic(m_last, m_start);
+        m_last = m_start;
+        for(unsigned int i = 0; i < m_changed.size(); i++){
+          int cell = m_changed[i];
+          updateVertex(cell);
+          if(!border(cell)){
+            for(int n = 0; n < 8; n++) updateVertex(cell + m_neighbour[n]);
+          }
+        }
+      }
+    }
+    for(unsigned int i = 0; i < m_changed.size(); i++) m_changed_flag[m_changed[i]] = 0;
+    m_changed.clear();
+    computeShortestPath();
+    return m_g[m_start] != infinity;
+  }
+
+  int DStarLite::next(int cell) const{
+    if(cell == m_goal || border(cell)) return -1;
+    int best = -1;
+    double best_cost = infinity;
+    for(int n = 0; n < 8; n++){
+      double c = cost(cell, n) + m_g[cell + m_neighbour[n]];
+      if(c < best_cost){
+        best_cost = c;
+        best = cell + m_neighbour[n];
+      }
+    }
+    return best;
+  }
+
+  void DStarLite::heapPush(int cell, const Key& key){
+    int position = m_heap_size++;
+    m_heap[position] = cell;
+    m_heap_key[position] = key;
+    m_heap_position[cell] = position;
+    heapUp(position);
+  }
+
+  void DStarLite::heapRemove(int cell){
+    int position = m_heap_position[cell];
+    m_heap_position[cell] = -1;
+    m_heap_size--;
+    if(position == m_heap_size) return;
+    m_heap[position] = m_heap[m_heap_size];
+    m_heap_key[position] = m_heap_key[m_heap_size];
+    int moved = m_heap[position];
+    m_heap_position[moved] = position;
+    heapUp(position);
+    heapDown(m_heap_position[moved]);
+  }
+
+  void DStarLite::heapUpdate(int cell, const Key& key){
+    int position = m_heap_position[cell];
+    m_heap_key[position] = key;
+    heapUp(position);
+    heapDown(m_heap_position[cell]);
+  }
+
+  void DStarLite::heapUp(int position){
+    while(position > 0){
+      int parent = (position - 1) / 2;
+      if(!(m_heap_key[position] < m_heap_key[parent])) break;
+      heapSwap(position, parent);
+      position = parent;
+    }
+  }
+
+  void DStarLite::heapDown(int position){
+    while(true){
+      int smallest = position;
+      int left = 2 * position + 1;
+      int right = left + 1;
+      if(left < m_heap_size && m_heap_key[left] < m_heap_key[smallest]) smallest = left;
+      if(right < m_heap_size && m_heap_key[right] < m_heap_key[smallest]) smallest = right;
+      if(smallest == position) break;
+      heapSwap(position, smallest);
+      position = smallest;
+    }
+  }
+
+  void DStarLite::heapSwap(int a, int b){
+    std::swap(m_heap[a], m_heap[b]);
+    std::swap(m_heap_key[a], m_heap_key[b]);
+    m_heap_position[m_heap[a]] = a;
+    m_heap_position[m_heap[b]] = b;
+  }
+}
@@ -0,0 +1,206 @@
+/******************************************************************************
+*                       OROCOS Youbot planner component                       *
+*                                                                             *
+*                         (C) 2011 Steven Bellens                             *
+*                     steven.bellens@mech.kuleuven.be                         *
+*                    Department of Mechanical Engineering,                    *
+*                   Katholieke Universiteit Leuven, Belgium.                  *
+*                                                                             *
+*       You may redistribute this software and/or modify it under either the  *
+*       terms of the GNU Lesser General Public License version 2.1 (LGPLv2.1  *
+*       <http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>) or (at your *
+*       discretion) of the Modified BSD License:                              *
+*       Redistribution and use in source and binary forms, with or without    *
+*       modification, are permitted provided that the following conditions    *
+*       are met:                                                              *
+*       1. Redistributions of source code must retain the above copyright     *
+*       notice, this list of conditions and the following disclaimer.         *
+*       2. Redistributions in binary form must reproduce the above copyright  *
+*       notice, this list of conditions and the following disclaimer in the   *
+*       documentation and/or other materials provided with the distribution.  *
+*       3. The name of the author may not be used to endorse or promote       *
+*       products derived from this software without specific prior written    *
+*       permission.                                                           *
+*       THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR  *
+*       IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED        *
+*       WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE    *
+*       ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,*
+*       INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    *
+*       (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS       *
+*       OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) *
+*       HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,   *
+*       STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING *
+*       IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE    *
+*       POSSIBILITY OF SUCH DAMAGE.                                           *
+*                                                                             *
+*******************************************************************************/
+/* @Description:
+ * @brief Incremental grid planner for the Youbot planner
+ * @Author: Steven Bellens
+ */
+
+ /*
+  * D* Lite on an 8-connected occupancy grid. The search runs from the goal
+  * to the start, so the first search is a backward A* search; after changes
+  * of the grid (or moves of the start) only the affected part of the search
+  * is repaired. Occupied cells are inflated with the radius of the YouBot,
+  * so the YouBot can be planned for as a point.
+  *
+  * The grid is stored row major (cell index = y * width + x), so the eight
+  * neighbours of a cell are at fixed index offsets. The cells on the border
+  * of the grid are always blocked, which removes all bounds checks from the
+  * search. The priority queue is an indexed binary heap over all cells, and
+  * all storage is allocated by resize().
+ */
+#ifndef _YOUBOT_DSTAR_LITE_
+#define _YOUBOT_DSTAR_LITE_
+
+#include <vector>
+
+namespace youbot{
+
+  class DStarLite{
+    public:
+      /// Constructor, the grid needs to be resized before use
+      DStarLite();
+
+      /**
+       * \brief Allocate the grid and the search storage
+       *
+       * All cells become free.
+       * \param width Number of cells along x
+       * \param height Number of cells along y
+       * \param inflation Inflation radius of the occupied cells, in cells
+       */
+      void resize(int width, int height, double inflation);
+
+      /// Number of cells along x
+      int width() const;
+      /// Number of cells along y
+      int height() const;
+
+      /**
+       * \brief Change the occupancy of a cell
+       *
+       * \param x Column of the cell
+       * \param y Row of the cell
+       * \param occupied The new occupancy
+       * \param fixed A fixed (map) cell can only be changed by another
+       * fixed update, not by a sensor update
+       */
+      void setOccupied(int x, int y, bool occupied, bool fixed);
+
+      /// A cell is blocked if it is occupied, inflated or on the border
+      bool blocked(int x, int y) const;
+
+      /**
+       * \brief Set a new goal
+       *
+       * The next plan() starts a new search.
+       * \return false if the goal is outside or on the border of the grid
+       */
+      bool setGoal(int x, int y);
+
+      /**
+       * \brief Plan from the start to the goal
+       *
+       * The first call after setGoal() searches from scratch, next calls
+       * repair the search for the grid changes since the previous call.
+       * \return false if there is no path
+       */
+      bool plan(int x, int y);
+
+      /**
+       * \brief Next cell on the path
+       *
+       * \param cell Index of a cell
+       * \return Index of the next cell towards the goal, or -1 if there is none
+       */
+      int next(int cell) const;
+
+      /// Index of a cell
+      int index(int x, int y) const;
+      /// Index of the goal cell
+      int goal() const;
+
+      /// The grid changed or a new goal was set since the last plan()
+      bool pending() const;
+
+      /// Number of cells expanded by the last plan()
+      unsigned int expansions() const;
+
+    private:
+      /// Search key of a cell
+      struct Key{
+        double k1;
+        double k2;
+        /// Exact lexicographic order of the heap
+        bool operator<(const Key& other) const{
+          return k1 < other.k1 || (k1 == other.k1 && k2 < other.k2);
+        }
+        /// Less by more than a rounding error (km accumulates over the replans), only for the termination test
+        bool clearlyBelow(const Key& other) const{
+          const double eps = 1e-9;
+          return k1 < other.k1 - eps || (k1 <= other.k1 + eps && k2 < other.k2 - eps);
+        }
+      };
+
+      /// Heuristic (octile distance) between two cells
+      double heuristic(int a, int b) const;
+      /// Cost of the edge from a to its neighbour with offset number n
+      double cost(int a, int n) const;
+      Key calculateKey(int cell) const;
+      void updateVertex(int cell);
+      void computeShortestPath();
+      bool border(int cell) const;
+      /// Add delta to the inflation count of the cells around a cell, remember the cells whose blocked state changed
+      void inflate(int x, int y, int delta);
+
+      /// @name Indexed binary heap
+      //@{
+      void heapPush(int cell, const Key& key);
+      void heapRemove(int cell);
+      void heapUpdate(int cell, const Key& key);
+      void heapUp(int position);
+      void heapDown(int position);
+      void heapSwap(int a, int b);
+      //@}
+
+      int m_width;
+      int m_height;
+      /// Occupancy of each cell: 0 free, 1 occupied (sensor), 2 occupied (map)
+      std::vector<unsigned char> m_occupancy;
+      /// Number of occupied cells within the inflation radius of each cell
+      std::vector<unsigned short> m_inflation;
+      /// Coordinate offsets of the cells within the inflation radius
+      std::vector<int> m_disc_x;
+      std::vector<int> m_disc_y;
+      /// Index and coordinate offsets of the eight neighbours
+      int m_neighbour[8];
+      int m_neighbour_x[8];
+      int m_neighbour_y[8];
+      double m_neighbour_cost[8];
+      /// @name Search
+      //@{
+      std::vector<double> m_g;
+      std::vector<double> m_rhs;
+      int m_start;
+      int m_last;
+      int m_goal;
+      double m_km;
+      bool m_initialised;
+      unsigned int m_expansions;
+      //@}
+      /// Cells whose blocked state changed since the last plan(), and a flag per cell
+      std::vector<int> m_changed;
+      std::vector<unsigned char> m_changed_flag;
+      /// @name Heap storage: cells and their keys, and the heap position of each cell (-1 if not queued)
+      //@{
+      std::vector<int> m_heap;
+      std::vector<Key> m_heap_key;
+      std::vector<int> m_heap_position;
+      int m_heap_size;
+      //@}
+  };
+}
+#endif // _YOUBOT_DSTAR_LITE_
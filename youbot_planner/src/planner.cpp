@@ -0,0 +1,294 @@
+/******************************************************************************
+*                       OROCOS Youbot planner component                       *
+*                                                                             *
+*                         (C) 2011 Steven Bellens                             *
+*                     steven.bellens@mech.kuleuven.be                         *
+*                    Department of Mechanical Engineering,                    *
+*                   Katholieke Universiteit Leuven, Belgium.                  *
+*                                                                             *
+*       You may redistribute this software and/or modify it under either the  *
+*       terms of the GNU Lesser General Public License version 2.1 (LGPLv2.1  *
+*       <http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>) or (at your *
+*       discretion) of the Modified BSD License:                              *
+*       Redistribution and use in source and binary forms, with or without    *
+*       modification, are permitted provided that the following conditions    *
+*       are met:                                                              *
+*       1. Redistributions of source code must retain the above copyright     *
+*       notice, this list of conditions and the following disclaimer.         *
+*       2. Redistributions in binary form must reproduce the above copyright  *
+*       notice, this list of conditions and the following disclaimer in the   *
+*       documentation and/or other materials provided with the distribution.  *
+*       3. The name of the author may not be used to endorse or promote       *
+*       products derived from this software without specific prior written    *
+*       permission.                                                           *
+*       THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR  *
+*       IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED        *
+*       WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE    *
+*       ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,*
+*       INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    *
+*       (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS       *
+*       OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) *
+*       HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,   *
+*       STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING *
+*       IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE    *
+*       POSSIBILITY OF SUCH DAMAGE.                                           *
+*                                                                             *
+*******************************************************************************/
+#include "planner.hpp"
+
+#include <math.h>
+#include <fstream>
+
+// This macro is used whenever a new Orocos component is generated. Here we
+// generate a Youbot Planner component.
+ORO_CREATE_COMPONENT(youbot::Planner)
+
+namespace youbot{
+  Planner::Planner(std::string name) : TaskContext(name,PreOperational)
+  ,m_map_file("")
+  ,m_resolution(0.05)
+  ,m_origin(2,-5.0)
+  ,m_map_width(200)
+  ,m_map_height(200)
+  ,m_occupied_threshold(0.65)
+  ,m_inflation_radius(0.25)
+  ,m_scan_mapping(false)
+  ,m_laser_pose(3,0.0)
+  ,m_max_path_length(1000)
+  ,m_replan_time(0.0)
+  ,m_expansions(0)
+  ,m_goal_x(0.0)
+  ,m_goal_y(0.0)
+  ,m_goal_theta(0.0)
+  ,m_goal_active(false)
+  ,m_start_cell(-1)
+  {
+    /// Add the input and output ports to the Orocos interface
+    this->addPort("current_pose",current_pose_port).doc("Youbot pose");
+    this->addPort("scan",scan_port).doc("Laser scan to build the occupancy grid online");
+    this->addPort("path",path_port).doc("Planned path [x0 y0 theta0 x1 y1 theta1 ...]");
+    this->addOperation("planTo",&Planner::planTo,this,RTT::OwnThread).doc("Plan a path to a goal pose").arg("X","Goal X position").arg("Y","Goal Y position").arg("Theta","Goal Theta orientation");
+    this->addOperation("setObstacle",&Planner::setObstacle,this,RTT::OwnThread).doc("Mark a position of the grid as occupied or free").arg("X","X position").arg("Y","Y position").arg("Occupied","Occupied or free");
+    /// Add property variables to the Orocos interface
+    this->addProperty("map_file",m_map_file).doc("Occupancy grid in PGM format, the grid starts free if empty");
+    this->addProperty("resolution",m_resolution).doc("Size of a grid cell");
+    this->addProperty("origin",m_origin).doc("Position of the lower left corner of the grid [x y]");
+    this->addProperty("map_width",m_map_width).doc("Number of cells along x without a map file");
+    this->addProperty("map_height",m_map_height).doc("Number of cells along y without a map file");
+    this->addProperty("occupied_threshold",m_occupied_threshold).doc("Cells darker than this fraction of black are occupied");
+    this->addProperty("inflation_radius",m_inflation_radius).doc("Obstacles are inflated with this radius");
+    this->addProperty("scan_mapping",m_scan_mapping).doc("Build the occupancy grid online from the laser scans");
+    this->addProperty("laser_pose",m_laser_pose).doc("Pose of the laser in the YouBot frame [x y yaw]");
+    this->addProperty("max_path_length",m_max_path_length).doc("Maximum number of points of the path");
+    this->addProperty("replan_time",m_replan_time).doc("Duration of the last (re)plan");
+    this->addProperty("expansions",m_expansions).doc("Number of cells expanded by the last (re)plan");
+  }
+
+  Planner::~Planner(){}
+
+  bool Planner::configureHook(){
+    if(m_resolution <= 0.0 || m_inflation_radius < 0.0 || m_max_path_length < 2){
+      log(Error) << "(Planner) The resolution and maximum path length must be positive" << endlog();
+      return false;
+    }
+    if(m_origin.size() != 2 || m_laser_pose.size() != 3){
+      log(Error) << "(Planner) The origin needs 2 elements [x y], the laser pose 3 [x y yaw]" << endlog();
+      return false;
+    }
+    if(m_map_file.empty()){
+      if(m_map_width < 3 || m_map_height < 3){
+        log(Error) << "(Planner) The map needs at least 3 by 3 cells" << endlog();
+        return false;
+      }
+      m_grid.resize(m_map_width, m_map_height, m_inflation_radius / m_resolution);
+    }
+    else if(!loadMap(m_map_file)){
+      return false;
+    }
+    /// Allocate the path
+    m_path.assign(3 * m_max_path_length, 0.0);
+    path_port.setDataSample(m_path);
+    m_path.clear();
+    m_goal_active = false;
+    return true;
+  }
+
+  bool Planner::loadMap(const std::string& file){
+    std::ifstream in(file.c_str(), std::ios::in | std::ios::binary);
+    std::string magic;
+    in >> magic;
+    if(!in || (magic != "P5" && magic != "P2")){
+      log(Error) << "(Planner) " << file << " is not a PGM file" << endlog();
+      return false;
+    }
+    /// Width, height and maximum value, skipping comments
+    int header[3];
+    for(unsigned int i = 0; i < 3; i++){
+      in >> std::ws;
+      while(in.peek() == '#'){
+        std::string comment;
+        std::getline(in, comment);
+        in >> std::ws;
+      }
+      in >> header[i];
+    }
+    int width = header[0], height = header[1], max_value = header[2];
+    in.get();
+    if(!in || width < 3 || height < 3 || max_value <= 0 || max_value > 65535){
+      log(Error) << "(Planner) Invalid PGM header in " << file << endlog();
+      return false;
+    }
+    m_grid.resize(width, height, m_inflation_radius / m_resolution);
+    /// The first row of the image is the top of the map
+    for(int row = 0; row < height; row++){
+      for(int x = 0; x < width; x++){
+        int value;
+        if(magic == "P2"){
+          in >> value;
+        }
+        else{
+          value = in.get();
+          if(max_value > 255) value = (value << 8) | in.get();
+        }
+        double occupancy = (double)(max_value - value) / max_value;
+        if(occupancy > m_occupied_threshold) m_grid.setOccupied(x, height - 1 - row, true, true);
+      }
+    }
+    if(!in){
+      log(Error) << "(Planner) " << file << " is truncated" << endlog();
+      return false;
+    }
+#ifndef NDEBUG
+    log(Debug) << "(Planner) Loaded a map of " << width << " x " << height << " cells" << endlog();
+#endif
+    return true;
+  }
+
+  bool Planner::startHook(){
+    m_start_cell = -1;
+    return true;
+  }
+
+  void Planner::updateHook(){
+    if(current_pose_port.read(m_current_pose) == NoData) return;
+    if(m_scan_mapping && scan_port.read(m_scan) == NewData) mapScan();
+    if(!m_goal_active) return;
+    int cx, cy;
+    if(!cell(m_current_pose[0], m_current_pose[1], cx, cy)){
+      log(Warning) << "(Planner) The YouBot is outside the grid" << endlog();
+      return;
+    }
+    /// Replan only when the grid changed or the YouBot moved to another cell
+    int start = m_grid.index(cx, cy);
+    if(start == m_start_cell && !m_grid.pending()) return;
+    m_start_cell = start;
+    RTT::os::TimeService::ticks begin = RTT::os::TimeService::Instance()->getTicks();
+    bool found = m_grid.plan(cx, cy);
+    m_replan_time = RTT::os::TimeService::Instance()->secondsSince(begin);
+    m_expansions = m_grid.expansions();
+#ifndef NDEBUG
+    log(Debug) << "(Planner) Planned in " << m_replan_time << " s, " << m_expansions << " expansions" << endlog();
+#endif
+    if(!found){
+      log(Warning) << "(Planner) No path to the goal" << endlog();
+      return;
+    }
+    writePath();
+  }
+
+  void Planner::mapScan(){
+    double c = cos(m_current_pose[2]), s = sin(m_current_pose[2]);
+    double laser_x = m_current_pose[0] + c * m_laser_pose[0] - s * m_laser_pose[1];
+    double laser_y = m_current_pose[1] + s * m_laser_pose[0] + c * m_laser_pose[1];
+    double laser_theta = m_current_pose[2] + m_laser_pose[2];
+    int x0, y0;
+    if(!cell(laser_x, laser_y, x0, y0)) return;
+    for(unsigned int i = 0; i < m_scan.ranges.size(); i++){
+      double r = m_scan.ranges[i];
+      if(!(r >= m_scan.range_min)) continue;
+      bool hit = r < m_scan.range_max;
+      if(!hit) r = m_scan.range_max;
+      double angle = laser_theta + m_scan.angle_min + i * m_scan.angle_increment;
+      int x1, y1;
+      bool inside = cell(laser_x + r * cos(angle), laser_y + r * sin(angle), x1, y1);
+      /// Clear the cells along the beam (Bresenham), mark the end point
+      int dx = abs(x1 - x0), dy = -abs(y1 - y0);
+      int sx = x0 < x1 ? 1 : -1, sy = y0 < y1 ? 1 : -1;
+      int error = dx + dy;
+      int x = x0, y = y0;
+      while(x != x1 || y != y1){
+        if(x < 0 || y < 0 || x >= m_grid.width() || y >= m_grid.height()) break;
+        m_grid.setOccupied(x, y, false, false);
+        int e2 = 2 * error;
+        if(e2 >= dy){ error += dy; x += sx; }
+        if(e2 <= dx){ error += dx; y += sy; }
+      }
+      if(hit && inside) m_grid.setOccupied(x1, y1, true, false);
+    }
+  }
+
+  void Planner::writePath(){
+    m_path.clear();
+    int width = m_grid.width();
+    int current = m_start_cell;
+    int dx = 0, dy = 0;
+    unsigned int points = 0;
+    while(current >= 0 && current != m_grid.goal() && points + 1 < (unsigned int)m_max_path_length){
+      int next = m_grid.next(current);
+      if(next < 0) break;
+      /// Only keep the cells where the direction changes
+      int ndx = next % width - current % width;
+      int ndy = next / width - current / width;
+      if(current == m_start_cell || ndx != dx || ndy != dy){
+        m_path.push_back(m_origin[0] + (current % width + 0.5) * m_resolution);
+        m_path.push_back(m_origin[1] + (current / width + 0.5) * m_resolution);
+        m_path.push_back(m_goal_theta);
+        points++;
+      }
+      dx = ndx;
+      dy = ndy;
+      current = next;
+    }
+    if(current != m_grid.goal()){
+      log(Warning) << "(Planner) The path exceeds " << m_max_path_length << " points, sending the first part" << endlog();
+    }
+    m_path.push_back(current == m_grid.goal() ? m_goal_x : m_origin[0] + (current % width + 0.5) * m_resolution);
+    m_path.push_back(current == m_grid.goal() ? m_goal_y : m_origin[1] + (current / width + 0.5) * m_resolution);
+    m_path.push_back(m_goal_theta);
+    path_port.write(m_path);
+  }
+
+  bool Planner::cell(double x, double y, int& cx, int& cy) const{
+    cx = (int)floor((x - m_origin[0]) / m_resolution);
+    cy = (int)floor((y - m_origin[1]) / m_resolution);
+    return cx >= 0 && cy >= 0 && cx < m_grid.width() && cy < m_grid.height();
+  }
+
+  bool Planner::planTo(double x, double y, double theta){
+    int cx, cy;
+    if(!cell(x, y, cx, cy) || !m_grid.setGoal(cx, cy)){
+      log(Error) << "(Planner) The goal lies outside the grid" << endlog();
+      return false;
+    }
+    if(m_grid.blocked(cx, cy)){
+      log(Warning) << "(Planner) The goal lies in an obstacle" << endlog();
+    }
+    m_goal_x = x;
+    m_goal_y = y;
+    m_goal_theta = theta;
+    m_goal_active = true;
+    return true;
+  }
+
+  void Planner::setObstacle(double x, double y, bool occupied){
+    int cx, cy;
+    if(cell(x, y, cx, cy)) m_grid.setOccupied(cx, cy, occupied, true);
+  }
+
+  void Planner::stopHook(){
+  }
+
+  void Planner::cleanupHook(){
+    m_goal_active = false;
+  }
+}
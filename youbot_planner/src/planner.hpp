@@ -0,0 +1,184 @@
+/******************************************************************************
+*                       OROCOS Youbot planner component                       *
+*                                                                             *
+*                         (C) 2011 Steven Bellens                             *
+*                     steven.bellens@mech.kuleuven.be                         *
+*                    Department of Mechanical Engineering,                    *
+*                   Katholieke Universiteit Leuven, Belgium.                  *
+*                                                                             *
+*       You may redistribute this software and/or modify it under either the  *
+*       terms of the GNU Lesser General Public License version 2.1 (LGPLv2.1  *
+*       <http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>) or (at your *
+*       discretion) of the Modified BSD License:                              *
+*       Redistribution and use in source and binary forms, with or without    *
+*       modification, are permitted provided that the following conditions    *
+*       are met:                                                              *
+*       1. Redistributions of source code must retain the above copyright     *
+*       notice, this list of conditions and the following disclaimer.         *
+*       2. Redistributions in binary form must reproduce the above copyright  *
+*       notice, this list of conditions and the following disclaimer in the   *
+*       documentation and/or other materials provided with the distribution.  *
+*       3. The name of the author may not be used to endorse or promote       *
+*       products derived from this software without specific prior written    *
+*       permission.                                                           *
+*       THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR  *
+*       IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED        *
+*       WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE    *
+*       ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,*
+*       INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    *
+*       (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS       *
+*       OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) *
+*       HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,   *
+*       STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING *
+*       IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE    *
+*       POSSIBILITY OF SUCH DAMAGE.                                           *
+*                                                                             *
+*******************************************************************************/
+/* @Description:
+ * @brief Youbot planner - OROCOS component
+ * @Author: Steven Bellens
+ */
+
+ /*
+  * The YouBot Planner component plans a path from the current pose estimate
+  * to a goal pose around the obstacles of an occupancy grid. The grid is
+  * loaded from a map file (PGM, as used by the ROS map_server) and/or built
+  * online from the laser scans. The first search for a goal is a backward
+  * A* search; when the grid changes or the YouBot moves, the search is
+  * repaired incrementally (D* Lite). The path is sent to the Controller,
+  * which tracks it in 'pursuit' or 'mpc' mode.
+ */
+
+#include <rtt/TaskContext.hpp>
+#include <rtt/Port.hpp>
+#include <rtt/Property.hpp>
+#include <rtt/Component.hpp>
+#include <rtt/os/TimeService.hpp>
+
+#include <bfl/wrappers/matrix/matrix_wrapper.h>
+#include <bfl/wrappers/matrix/vector_wrapper.h>
+
+#include <sensor_msgs/LaserScan.h>
+
+#include "dStarLite.hpp"
+
+namespace youbot{
+
+  using namespace std;
+  using namespace RTT;
+  using namespace MatrixWrapper;
+
+  class Planner : public TaskContext{
+    protected:
+      /// @name Ports
+      //@{
+      /// Youbot current pose - from the Extended Kalman Filter estimator component
+      InputPort<ColumnVector> current_pose_port;
+      /// Laser scan - used to build the occupancy grid online
+      InputPort<sensor_msgs::LaserScan> scan_port;
+      /// Path - the planned path [x0 y0 theta0 x1 y1 theta1 ...], for the Controller component
+      OutputPort<std::vector<double> > path_port;
+      //@}
+      /// @name Properties
+      //@{
+      /// Map file - occupancy grid in PGM format; if empty, the grid starts free
+      std::string m_map_file;
+      /// Resolution - the size of a grid cell
+      double m_resolution;
+      /// Origin - the position of the lower left corner of the grid [x y]
+      std::vector<double> m_origin;
+      /// Map width and height - the number of cells of the grid without a map file
+      int m_map_width;
+      int m_map_height;
+      /// Occupied threshold - cells darker than this fraction of black are occupied
+      double m_occupied_threshold;
+      /// Inflation radius - the obstacles are inflated with this radius, so the YouBot can be planned for as a point
+      double m_inflation_radius;
+      /// Scan mapping - mark the laser scan end points as occupied and clear the cells along the beams
+      bool m_scan_mapping;
+      /// Pose of the laser in the YouBot frame [x y yaw]
+      std::vector<double> m_laser_pose;
+      /// Maximum number of points of the path
+      int m_max_path_length;
+      /// Duration of the last (re)plan
+      double m_replan_time;
+      /// Number of cells expanded by the last (re)plan
+      int m_expansions;
+      //@}
+
+    public:
+      /**
+       * \brief Constructor
+       *
+       * Constructor building a Youbot planner component
+       * \param name The component name
+       */
+      Planner(std::string name);
+      //! Destructor
+      ~Planner();
+
+      /// @name Public methods
+      //@{
+      bool configureHook();
+      bool startHook();
+      void updateHook();
+      void stopHook();
+      void cleanupHook();
+
+      /**
+       * \brief Plan to a goal pose
+       *
+       * Starts a new search; the path is sent in the next update.
+       * \return false if the goal lies outside the grid
+       */
+      bool planTo(double x, double y, double theta);
+
+      /**
+       * \brief Mark an obstacle
+       *
+       * Changes the occupancy of the cell at a position, the path is
+       * repaired in the next update.
+       */
+      void setObstacle(double x, double y, bool occupied);
+      //@}
+
+    private:
+      /// The occupancy grid and the search
+      DStarLite m_grid;
+      /// Youbot current pose [x, y, theta]
+      ColumnVector m_current_pose;
+      /// Last laser scan
+      sensor_msgs::LaserScan m_scan;
+      /// Goal pose
+      double m_goal_x;
+      double m_goal_y;
+      double m_goal_theta;
+      /// A goal was set
+      bool m_goal_active;
+      /// Grid cell of the YouBot at the last plan
+      int m_start_cell;
+      /// The path
+      std::vector<double> m_path;
+
+      /**
+       * \brief Load the occupancy grid from a PGM file
+       */
+      bool loadMap(const std::string& file);
+
+      /**
+       * \brief Update the occupancy grid with the laser scan
+       */
+      void mapScan();
+
+      /**
+       * \brief Send the path from the YouBot to the goal
+       *
+       * Follows the search from the start cell to the goal; only the cells
+       * where the path changes direction are sent.
+       */
+      void writePath();
+
+      /// Grid cell of a position, returns false if it lies outside the grid
+      bool cell(double x, double y, int& cx, int& cy) const;
+  };
+}
@@ -0,0 +1,124 @@
+/******************************************************************************
+*                       OROCOS Youbot planner component                       *
+*                                                                             *
+*                         (C) 2011 Steven Bellens                             *
+*                     steven.bellens@mech.kuleuven.be                         *
+*                    Department of Mechanical Engineering,                    *
+*                   Katholieke Universiteit Leuven, Belgium.                  *
+*                                                                             *
+*       You may redistribute this software and/or modify it under either the  *
+*       terms of the GNU Lesser General Public License version 2.1 (LGPLv2.1  *
+*       <http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>) or (at your *
+*       discretion) of the Modified BSD License:                              *
+*       Redistribution and use in source and binary forms, with or without    *
+*       modification, are permitted provided that the following conditions    *
+*       are met:                                                              *
+*       1. Redistributions of source code must retain the above copyright     *
+*       notice, this list of conditions and the following disclaimer.         *
+*       2. Redistributions in binary form must reproduce the above copyright  *
+*       notice, this list of conditions and the following disclaimer in the   *
+*       documentation and/or other materials provided with the distribution.  *
+*       3. The name of the author may not be used to endorse or promote       *
+*       products derived from this software without specific prior written    *
+*       permission.                                                           *
+*       THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR  *
+*       IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED        *
+*       WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE    *
+*       ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,*
+*       INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    *
+*       (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS       *
+*       OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) *
+*       HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,   *
+*       STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING *
+*       IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE    *
+*       POSSIBILITY OF SUCH DAMAGE.                                           *
+*                                                                             *
+*******************************************************************************/
+/* @Description:
+ * @brief Regression test: incremental D* Lite replans against fresh searches
+ * @Author: Steven Bellens
+ */
+
+#include <gtest/gtest.h>
+#include <cmath>
+#include <cstdlib>
+
+#include "../src/dStarLite.hpp"
+
+using namespace youbot;
+
+namespace{
+
+  const int width = 60;
+  const int height = 40;
+
+  /// Cost of the path the planner follows from (x, y) to the goal, -1 if it does not reach the goal
+  double pathCost(const DStarLite& planner, int x, int y){
+    int cell = planner.index(x, y);
+    double cost = 0.0;
+    for(int steps = 0; steps < width * height; steps++){
+      if(cell == planner.goal()) return cost;
+      int next = planner.next(cell);
+      if(next < 0) return -1.0;
+      int dx = next % width - cell % width;
+      int dy = next / width - cell / width;
+      cost += (dx != 0 && dy != 0) ? std::sqrt(2.0) : 1.0;
+      cell = next;
+    }
+    return -1.0;
+  }
+
+  /// Fresh planner on the same grid as the reference
+  void copyGrid(const DStarLite& reference, const std::vector<unsigned char>& occupied, DStarLite& planner){
+    planner.resize(reference.width(), reference.height(), 1.0);
+    for(int y = 0; y < height; y++){
+      for(int x = 0; x < width; x++){
+        if(occupied[y * width + x]) planner.setOccupied(x, y, true, false);
+      }
+    }
+  }
+
+}
+
+TEST(DStarLite, IncrementalReplansMatchFreshSearches){
+  srand(42);
+  DStarLite incremental;
+  incremental.resize(width, height, 1.0);
+  std::vector<unsigned char> occupied(width * height, 0);
+  ASSERT_TRUE(incremental.setGoal(width - 5, height / 2));
+  int x = 4, y = height / 2;
+  for(int replan = 0; replan < 200; replan++){
+    // Toggle a few random cells away from the start and the goal
+    for(int i = 0; i < 6; i++){
+      int cx = 2 + rand() % (width - 4);
+      int cy = 2 + rand() % (height - 4);
+      if(std::abs(cx - x) <= 2 && std::abs(cy - y) <= 2) continue;
+      if(std::abs(cx - (width - 5)) <= 2 && std::abs(cy - height / 2) <= 2) continue;
+      occupied[cy * width + cx] = !occupied[cy * width + cx];
+      incremental.setOccupied(cx, cy, occupied[cy * width + cx] != 0, false);
+    }
+    bool found = incremental.plan(x, y);
+
+    DStarLite fresh;
+    copyGrid(incremental, occupied, fresh);
+    ASSERT_TRUE(fresh.setGoal(width - 5, height / 2));
+    ASSERT_EQ(fresh.plan(x, y), found) << "replan " << replan;
+    if(!found) continue;
+    double incremental_cost = pathCost(incremental, x, y);
+    double fresh_cost = pathCost(fresh, x, y);
+    ASSERT_GE(incremental_cost, 0.0) << "replan " << replan;
+    EXPECT_NEAR(fresh_cost, incremental_cost, 1e-6) << "replan " << replan;
+
+    // Move the start along the path, as the YouBot does between replans
+    int cell = incremental.next(incremental.index(x, y));
+    if(cell >= 0 && cell != incremental.goal()){
+      x = cell % width;
+      y = cell / width;
+    }
+  }
+}
+
+int main(int argc, char** argv){
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
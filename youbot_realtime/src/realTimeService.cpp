@@ -0,0 +1,241 @@
+/******************************************************************************
+*                        OROCOS Youbot realtime service                       *
+*                                                                             *
+*                         (C) 2011 Steven Bellens                             *
+*                     steven.bellens@mech.kuleuven.be                         *
+*                    Department of Mechanical Engineering,                    *
+*                   Katholieke Universiteit Leuven, Belgium.                  *
+*                                                                             *
+*       You may redistribute this software and/or modify it under either the  *
+*       terms of the GNU Lesser General Public License version 2.1 (LGPLv2.1  *
+*       <http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>) or (at your *
+*       discretion) of the Modified BSD License:                              *
+*       Redistribution and use in source and binary forms, with or without    *
+*       modification, are permitted provided that the following conditions    *
+*       are met:                                                              *
+*       1. Redistributions of source code must retain the above copyright     *
+*       notice, this list of conditions and the following disclaimer.         *
+*       2. Redistributions in binary form must reproduce the above copyright  *
+*       notice, this list of conditions and the following disclaimer in the   *
+*       documentation and/or other materials provided with the distribution.  *
+*       3. The name of the author may not be used to endorse or promote       *
+*       products derived from this software without specific prior written    *
+*       permission.                                                           *
+*       THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR  *
+*       IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED        *
+*       WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE    *
+*       ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,*
+*       INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    *
+*       (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS       *
+*       OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) *
+*       HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,   *
+*       STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING *
+*       IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE    *
+*       POSSIBILITY OF SUCH DAMAGE.                                           *
+*                                                                             *
+*******************************************************************************/
+
+#include "realTimeService.hpp"
+
+#include <rtt/plugin/ServicePlugin.hpp>
+#include <rtt/os/fosi.h>
+#include <rtt/extras/SlaveActivity.hpp>
+
+#include <sstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <alloca.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+
+// This macro is used whenever a new Orocos service is generated. Here we
+// generate a Youbot realtime service, loaded as "realtime".
+ORO_SERVICE_NAMED_PLUGIN(youbot::RealTimeService, "realtime")
+
+namespace youbot{
+  /// Stack kept free below the prefaulted part, for the frames of the prefault itself
+  static const size_t STACK_MARGIN = 16384;
+  /// Number of CPUs covered by the (int) CPU masks
+  static const int MAX_CPUS = 31;
+
+  RealTimeService::RealTimeService(TaskContext* owner) : Service("realtime",owner)
+  ,m_minor_faults(0)
+  ,m_major_faults(0)
+  ,m_new_minor_faults(0)
+  ,m_new_major_faults(0)
+  {
+    this->doc("Pins, prefaults and validates the thread of the component");
+    this->addOperation("setCpuAffinity",&RealTimeService::setCpuAffinity,this).doc("Pin the activity of the component to a set of CPUs").arg("CpuMask","Bit i set allows the thread to run on CPU i");
+    this->addOperation("lockMemory",&RealTimeService::lockMemory,this).doc("Lock all memory of the process and prefault the heap").arg("HeapSize","Heap to prefault, in bytes");
+    this->addOperation("prefaultStack",&RealTimeService::prefaultStack,this,RTT::OwnThread).doc("Prefault the stack of the component thread").arg("StackSize","Stack to prefault, in bytes");
+    this->addOperation("validate",&RealTimeService::validate,this,RTT::OwnThread).doc("Check the scheduler, priority and CPU set of the component thread and the locked memory").arg("Scheduler","ORO_SCHED_RT or ORO_SCHED_OTHER").arg("Priority","Priority (only checked for ORO_SCHED_RT)").arg("CpuMask","Expected CPU set (0: don't check)");
+    this->addOperation("report",&RealTimeService::report,this,RTT::OwnThread).doc("Describe the component thread and its page faults since the previous report");
+  }
+
+  RealTimeService::~RealTimeService(){}
+
+  bool RealTimeService::setCpuAffinity(int cpu_mask){
+    if(cpu_mask <= 0){
+      log(Error) << "(RealTimeService) " << getOwner()->getName() << ": invalid CPU mask " << cpu_mask << endlog();
+      return false;
+    }
+    if(refuseSlave("pin"))
+      return false;
+    base::ActivityInterface* activity = getOwner()->getActivity();
+    if(!activity || !activity->thread()){
+      log(Error) << "(RealTimeService) " << getOwner()->getName() << " has no thread of its own to pin" << endlog();
+      return false;
+    }
+    if(!activity->setCpuAffinity((unsigned int)cpu_mask)){
+      log(Error) << "(RealTimeService) " << getOwner()->getName() << ": could not set the CPU mask to " << cpu_mask << endlog();
+      return false;
+    }
+    return true;
+  }
+
+  bool RealTimeService::lockMemory(int heap_size){
+    // Keep freed memory in the heap and serve large blocks from it as well,
+    // so the prefaulted pages stay with the process
+    mallopt(M_TRIM_THRESHOLD,-1);
+    mallopt(M_MMAP_MAX,0);
+    if(mlockall(MCL_CURRENT | MCL_FUTURE) != 0){
+      log(Error) << "(RealTimeService) Could not lock the memory: " << strerror(errno) << " (check ulimit -l)" << endlog();
+      return false;
+    }
+    if(heap_size > 0){
+      long page = sysconf(_SC_PAGESIZE);
+      char* block = (char*)malloc(heap_size);
+      if(!block){
+        log(Error) << "(RealTimeService) Could not allocate " << heap_size << " bytes of heap to prefault" << endlog();
+        return false;
+      }
+      // Through a volatile pointer: the compiler drops plain stores to a block that is freed next
+      volatile char* heap = block;
+      for(int i = 0; i < heap_size; i += page)
+        heap[i] = 0;
+      free(block);
+    }
+    log(Info) << "(RealTimeService) Memory locked, " << lockedMemory() << " kB" << endlog();
+    return true;
+  }
+
+  bool RealTimeService::prefaultStack(int stack_size){
+    if(stack_size <= 0 || refuseSlave("prefault the stack of"))
+      return false;
+    pthread_attr_t attr;
+    size_t available = 0;
+    if(pthread_getattr_np(pthread_self(),&attr) == 0){
+      pthread_attr_getstacksize(&attr,&available);
+      pthread_attr_destroy(&attr);
+    }
+    if(available > 0 && (size_t)stack_size + STACK_MARGIN > available){
+      log(Error) << "(RealTimeService) " << getOwner()->getName() << ": cannot prefault " << stack_size << " bytes of a " << available << " bytes stack" << endlog();
+      return false;
+    }
+    long page = sysconf(_SC_PAGESIZE);
+    volatile char* stack = (volatile char*)alloca(stack_size);
+    for(int i = 0; i < stack_size; i += page)
+      stack[i] = 0;
+    return true;
+  }
+
+  bool RealTimeService::validate(int scheduler, int priority, int cpu_mask){
+    if(refuseSlave("validate"))
+      return false;
+    int policy = 0;
+    int actual_priority = 0;
+    unsigned int actual_mask = 0;
+    std::string description = describeThread(policy,actual_priority,actual_mask);
+    bool valid = true;
+    std::ostringstream problems;
+    int expected_policy = (scheduler == ORO_SCHED_RT) ? SCHED_FIFO : SCHED_OTHER;
+    if(policy != expected_policy){
+      problems << " [scheduler is not " << (scheduler == ORO_SCHED_RT ? "ORO_SCHED_RT" : "ORO_SCHED_OTHER") << "]";
+      valid = false;
+    }
+    else if(scheduler == ORO_SCHED_RT && actual_priority != priority){
+      problems << " [priority is not " << priority << "]";
+      valid = false;
+    }
+    if(cpu_mask > 0 && actual_mask != (unsigned int)cpu_mask){
+      problems << " [CPU mask is not 0x" << std::hex << cpu_mask << std::dec << "]";
+      valid = false;
+    }
+    if(lockedMemory() <= 0){
+      problems << " [memory is not locked]";
+      valid = false;
+    }
+    if(valid)
+      log(Info) << "(RealTimeService) " << getOwner()->getName() << ": " << description << ": OK" << endlog();
+    else
+      log(Error) << "(RealTimeService) " << getOwner()->getName() << ": " << description << ":" << problems.str() << endlog();
+    return valid;
+  }
+
+  std::string RealTimeService::report(){
+    int policy = 0;
+    int priority = 0;
+    unsigned int cpu_mask = 0;
+    bool slave = dynamic_cast<extras::SlaveActivity*>(getOwner()->getActivity()) != 0;
+    return getOwner()->getName() + (slave ? " (slave activity, thread of its master): " : ": ") + describeThread(policy,priority,cpu_mask);
+  }
+
+  bool RealTimeService::refuseSlave(const char* operation){
+    // SlaveActivity::thread() is the thread of the master: acting on it would silently change the master
+    if(!dynamic_cast<extras::SlaveActivity*>(getOwner()->getActivity()))
+      return false;
+    log(Error) << "(RealTimeService) " << getOwner()->getName() << " has a slave activity, which runs in the thread of its master: " << operation << " the master instead" << endlog();
+    return true;
+  }
+
+  std::string RealTimeService::describeThread(int& policy, int& priority, unsigned int& cpu_mask){
+    struct sched_param param;
+    pthread_getschedparam(pthread_self(),&policy,&param);
+    priority = param.sched_priority;
+
+    cpu_mask = 0;
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    if(pthread_getaffinity_np(pthread_self(),sizeof(cpus),&cpus) == 0){
+      for(int i = 0; i < MAX_CPUS; i++)
+        if(CPU_ISSET(i,&cpus))
+          cpu_mask |= 1u << i;
+    }
+
+    struct rusage usage;
+    if(getrusage(RUSAGE_THREAD,&usage) == 0){
+      m_new_minor_faults = usage.ru_minflt - m_minor_faults;
+      m_new_major_faults = usage.ru_majflt - m_major_faults;
+      m_minor_faults = usage.ru_minflt;
+      m_major_faults = usage.ru_majflt;
+    }
+
+    std::ostringstream description;
+    description << (policy == SCHED_FIFO ? "SCHED_FIFO" : policy == SCHED_RR ? "SCHED_RR" : "SCHED_OTHER")
+                << " priority " << priority
+                << ", CPU mask 0x" << std::hex << cpu_mask << std::dec
+                << ", " << lockedMemory() << " kB locked"
+                << ", " << m_new_minor_faults << " minor / " << m_new_major_faults << " major page faults";
+    return description.str();
+  }
+
+  long RealTimeService::lockedMemory() const{
+    FILE* status = fopen("/proc/self/status","r");
+    if(!status)
+      return -1;
+    char line[128];
+    long locked = -1;
+    while(fgets(line,sizeof(line),status)){
+      if(sscanf(line,"VmLck: %ld",&locked) == 1)
+        break;
+    }
+    fclose(status);
+    return locked;
+  }
+}
@@ -0,0 +1,152 @@
+/******************************************************************************
+*                        OROCOS Youbot realtime service                       *
+*                                                                             *
+*                         (C) 2011 Steven Bellens                             *
+*                     steven.bellens@mech.kuleuven.be                         *
+*                    Department of Mechanical Engineering,                    *
+*                   Katholieke Universiteit Leuven, Belgium.                  *
+*                                                                             *
+*       You may redistribute this software and/or modify it under either the  *
+*       terms of the GNU Lesser General Public License version 2.1 (LGPLv2.1  *
+*       <http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>) or (at your *
+*       discretion) of the Modified BSD License:                              *
+*       Redistribution and use in source and binary forms, with or without    *
+*       modification, are permitted provided that the following conditions    *
+*       are met:                                                              *
+*       1. Redistributions of source code must retain the above copyright     *
+*       notice, this list of conditions and the following disclaimer.         *
+*       2. Redistributions in binary form must reproduce the above copyright  *
+*       notice, this list of conditions and the following disclaimer in the   *
+*       documentation and/or other materials provided with the distribution.  *
+*       3. The name of the author may not be used to endorse or promote       *
+*       products derived from this software without specific prior written    *
+*       permission.                                                           *
+*       THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR  *
+*       IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED        *
+*       WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE    *
+*       ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,*
+*       INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    *
+*       (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS       *
+*       OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) *
+*       HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,   *
+*       STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING *
+*       IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE    *
+*       POSSIBILITY OF SUCH DAMAGE.                                           *
+*                                                                             *
+*******************************************************************************/
+
+/* @Description:
+ * @brief Youbot realtime - OROCOS service
+ * @Author: Steven Bellens
+ */
+
+ /*
+  * The realtime service prepares the thread of a component for real-time
+  * execution. It is loaded in a component from the deployment script
+  * (loadService("Controller","realtime")) and offers operations to pin the
+  * activity of the component to a set of CPUs, to lock and prefault the
+  * memory of the process and the stack of the component thread, and to
+  * validate that the thread really runs with the requested scheduler,
+  * priority and CPU set. The validation runs in the thread of the component
+  * and reports what the operating system reports, not what was requested:
+  * without the right permissions the RTT silently falls back to
+  * ORO_SCHED_OTHER, which is exactly what this service should catch before
+  * the robot moves. A slave activity runs in the thread of its master, so
+  * the operations on the thread refuse a component with a slave activity:
+  * pin, prefault and validate its master instead.
+ */
+
+#include <rtt/TaskContext.hpp>
+#include <rtt/Service.hpp>
+
+#include <string>
+
+namespace youbot{
+
+  using namespace std;
+  using namespace RTT;
+
+  class RealTimeService : public Service{
+    public:
+      /**
+       * \brief Constructor
+       *
+       * Constructor building a Youbot realtime service
+       * \param owner The component that loads the service
+       */
+      RealTimeService(TaskContext* owner);
+      //! Destructor
+      ~RealTimeService();
+
+      /// @name Public methods
+      //@{
+      /**
+       * \brief Pin the activity of the component to a set of CPUs
+       *
+       * \param cpu_mask Bit i set allows the thread to run on CPU i
+       * \return false if the activity has no thread of its own (no activity
+       * or a slave activity, which runs in the thread of its master) or the
+       * mask is refused
+       */
+      bool setCpuAffinity(int cpu_mask);
+
+      /**
+       * \brief Lock and prefault the memory of the process
+       *
+       * Locks all current and future pages of the process (mlockall),
+       * disables returning heap memory to the system and touches heap_size
+       * bytes of heap, so later allocations in real-time code don't page
+       * fault. This acts on the whole process: calling it on one component
+       * is enough.
+       * \return false if the memory could not be locked (RLIMIT_MEMLOCK)
+       */
+      bool lockMemory(int heap_size);
+
+      /**
+       * \brief Prefault the stack of the component thread
+       *
+       * Runs in the thread of the component and touches stack_size bytes of
+       * its stack.
+       * \return false for a slave activity or a stack that is too small
+       */
+      bool prefaultStack(int stack_size);
+
+      /**
+       * \brief Validate the scheduler, priority and CPU set of the thread
+       *
+       * Runs in the thread of the component, compares what the operating
+       * system reports against the requested values and logs a report. The
+       * priority is only checked for ORO_SCHED_RT; a cpu_mask of 0 skips the
+       * affinity check.
+       * \return false if the thread does not run as requested, the memory
+       * of the process is not locked or the component has a slave activity
+       */
+      bool validate(int scheduler, int priority, int cpu_mask);
+
+      /**
+       * \brief Report the state of the component thread
+       *
+       * Runs in the thread of the component. The report contains the
+       * scheduler, priority, CPU set, locked memory and the page faults of
+       * the thread since the previous report. For a slave activity the
+       * report says it describes the thread of the master.
+       */
+      std::string report();
+      //@}
+
+    private:
+      /// The component has a slave activity, logs an error for the operation if so
+      bool refuseSlave(const char* operation);
+      /// Describe the calling thread, update the page fault counters
+      std::string describeThread(int& policy, int& priority, unsigned int& cpu_mask);
+      /// Locked memory of the process, in kB (-1 if unknown)
+      long lockedMemory() const;
+
+      /// Page faults of the thread at the previous report
+      long m_minor_faults;
+      long m_major_faults;
+      /// Page faults of the thread since the previous report
+      long m_new_minor_faults;
+      long m_new_major_faults;
+  };
+}
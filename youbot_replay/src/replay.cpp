@@ -0,0 +1,289 @@
+/******************************************************************************
+*                             OROCOS Youbot replay                            *
+*                                                                             *
+*                         (C) 2011 Steven Bellens                             *
+*                     steven.bellens@mech.kuleuven.be                         *
+*                    Department of Mechanical Engineering,                    *
+*                   Katholieke Universiteit Leuven, Belgium.                  *
+*                                                                             *
+*       You may redistribute this software and/or modify it under either the  *
+*       terms of the GNU Lesser General Public License version 2.1 (LGPLv2.1  *
+*       <http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>) or (at your *
+*       discretion) of the Modified BSD License:                              *
+*       Redistribution and use in source and binary forms, with or without    *
+*       modification, are permitted provided that the following conditions    *
+*       are met:                                                              *
+*       1. Redistributions of source code must retain the above copyright     *
+*       notice, this list of conditions and the following disclaimer.         *
+*       2. Redistributions in binary form must reproduce the above copyright  *
+*       notice, this list of conditions and the following disclaimer in the   *
+*       documentation and/or other materials provided with the distribution.  *
+*       3. The name of the author may not be used to endorse or promote       *
+*       products derived from this software without specific prior written    *
+*       permission.                                                           *
+*       THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR  *
+*       IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED        *
+*       WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE    *
+*       ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,*
+*       INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    *
+*       (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS       *
+*       OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) *
+*       HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,   *
+*       STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING *
+*       IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE    *
+*       POSSIBILITY OF SUCH DAMAGE.                                           *
+*                                                                             *
+*******************************************************************************/
+
+
+/* @Description:
+ * @brief Youbot replay - feed a recorded log through the estimator offline
+ * @Author: Steven Bellens
+ */
+
+ /*
+  * youbot_replay replays the inputs of the ExtendedKalmanFilterComponentRobot
+  * recorded by the Youbot Logger through the same filter (RobotFilter),
+  * without the deployer, the components or any thread, as fast as the filter
+  * runs:
+  *
+  *   youbot_replay [-t <timer channel>] [-i <input channel>]
+  *                 [-o <odometry channel>] [-m <measurement channel>]
+  *                 [-e <estimate channel>] <ekf.cpf> <log.bin> <estimates.bin>
+  *
+  * The filter is configured from the property file of the estimator. The
+  * timer ids (-t, default: the first channel of type TimerId), the inputs
+  * (-i, default Controller.ctrl) and the measurements (-m, default
+  * Simulator.measurement; the robot and remote simulation deployments log
+  * them as ExtendedKalmanFilterComponentRobot.ReceivedMeasurement, as they
+  * arrive over a stream) of the log are merged in the order they were
+  * written, and processed like the component does: a timer id equal to
+  * TimerIdSystemUpdate runs a system update with the last input, a
+  * measurement runs a measurement update. With an odometry channel (-o, the
+  * measured twists on the Odometry port, none by default) a system update
+  * uses the odometry integrated since the previous one instead, if any. The estimates (the prior, then one
+  * per update) are written to estimates.bin in the log format, as channels
+  * Replay.EstimatedState and Replay.CovarianceState stamped with the time of
+  * the recorded event; binlog2csv converts them.
+  * When the log holds the estimates of the live run (-e, default
+  * ExtendedKalmanFilterComponentRobot.EstimatedState), the replayed
+  * estimates the component publishes (OutputDecimation, AverageOutput) are
+  * compared with them bit by bit. They are equal when the log
+  * covers the run from the start of the estimator (start the logger first)
+  * without dropped records, and the estimator handled each event before the
+  * next one was written, as in the scheduled deployment. The robot does not
+  * log the 1kHz odometry of the base (BaseOdometry), so its logs replay with
+  * the commanded input and only approximate the live estimates.
+ */
+
+#include "replayLog.hpp"
+
+#include <logFormat.hpp>
+
+#include <rtt/os/main.h>
+#include <rtt/os/TimeService.hpp>
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+using namespace youbot::logformat;
+using namespace youbot::replay;
+
+/// @name Writing the estimates, in the log format
+//@{
+class EstimateWriter{
+  public:
+    EstimateWriter(FILE* file, unsigned int dimension)
+      : m_file(file), m_state_width(dimension), m_covariance_width(dimension * (dimension + 1) / 2), m_seq(0){
+      FileHeader header;
+      memcpy(header.magic,MAGIC,sizeof(MAGIC));
+      header.version = VERSION;
+      header.record_header_size = sizeof(RecordHeader);
+      fwrite(&header,sizeof(header),1,m_file);
+      writeChannel(STATE,"Replay.EstimatedState","ColumnVector",m_state_width);
+      writeChannel(COVARIANCE,"Replay.CovarianceState","SymmetricMatrix",m_covariance_width);
+    }
+
+    ~EstimateWriter(){ flush(); }
+
+    void write(long long stamp, const ColumnVector& state, const SymmetricMatrix& covariance){
+      RecordHeader record;
+      record.stamp = stamp;
+      record.seq = m_seq++;
+      record.width = m_state_width;
+      append(m_state,record);
+      for(unsigned int i = 1; i <= m_state_width; i++)
+        append(m_state,state(i));
+      record.width = m_covariance_width;
+      append(m_covariance,record);
+      for(unsigned int i = 1; i <= m_state_width; i++)
+        for(unsigned int j = i; j <= m_state_width; j++)
+          append(m_covariance,covariance(i,j));
+      if(m_seq % RECORDS_PER_CHUNK == 0)
+        flush();
+    }
+
+    void flush(){
+      writeData(STATE,m_state,m_state_width);
+      writeData(COVARIANCE,m_covariance,m_covariance_width);
+    }
+
+  private:
+    enum{ STATE = 0, COVARIANCE = 1, RECORDS_PER_CHUNK = 1024 };
+    FILE* m_file;
+    unsigned int m_state_width;
+    unsigned int m_covariance_width;
+    unsigned int m_seq;
+    std::vector<char> m_state;
+    std::vector<char> m_covariance;
+
+    template<class T> static void append(std::vector<char>& buffer, const T& value){
+      buffer.insert(buffer.end(),(const char*)&value,(const char*)&value + sizeof(value));
+    }
+
+    void writeChannel(unsigned int id, const std::string& name, const std::string& type, unsigned int width){
+      ChunkHeader chunk;
+      chunk.type = CHANNEL;
+      chunk.size = 4 * sizeof(unsigned int) + name.size() + type.size();
+      fwrite(&chunk,sizeof(chunk),1,m_file);
+      fwrite(&id,sizeof(id),1,m_file);
+      fwrite(&width,sizeof(width),1,m_file);
+      unsigned int size = name.size();
+      fwrite(&size,sizeof(size),1,m_file);
+      fwrite(name.data(),1,size,m_file);
+      size = type.size();
+      fwrite(&size,sizeof(size),1,m_file);
+      fwrite(type.data(),1,size,m_file);
+    }
+
+    void writeData(unsigned int id, std::vector<char>& buffer, unsigned int width){
+      if(buffer.empty())
+        return;
+      ChunkHeader chunk;
+      chunk.type = DATA;
+      chunk.size = sizeof(id) + buffer.size();
+      fwrite(&chunk,sizeof(chunk),1,m_file);
+      fwrite(&id,sizeof(id),1,m_file);
+      fwrite(&buffer[0],1,buffer.size(),m_file);
+      buffer.clear();
+    }
+};
+//@}
+
+int ORO_main(int argc, char** argv){
+  Replay replay;
+  replay.input_channel = "Controller.ctrl";
+  replay.measurement_channel = "Simulator.measurement";
+  replay.estimate_channel = "ExtendedKalmanFilterComponentRobot.EstimatedState";
+  std::vector<const char*> files;
+  for(int i = 1; i < argc; i++){
+    if(strcmp(argv[i],"-t") == 0 && i + 1 < argc)
+      replay.timer_channel = argv[++i];
+    else if(strcmp(argv[i],"-i") == 0 && i + 1 < argc)
+      replay.input_channel = argv[++i];
+    else if(strcmp(argv[i],"-o") == 0 && i + 1 < argc)
+      replay.odometry_channel = argv[++i];
+    else if(strcmp(argv[i],"-m") == 0 && i + 1 < argc)
+      replay.measurement_channel = argv[++i];
+    else if(strcmp(argv[i],"-e") == 0 && i + 1 < argc)
+      replay.estimate_channel = argv[++i];
+    else
+      files.push_back(argv[i]);
+  }
+  if(files.size() != 3){
+    fprintf(stderr,"Usage: youbot_replay [-t <timer channel>] [-i <input channel>] [-o <odometry channel>] [-m <measurement channel>] [-e <estimate channel>] <ekf.cpf> <log.bin> <estimates.bin>\n");
+    return 1;
+  }
+
+  RobotFilterParameters parameters;
+  ComponentParameters component;
+  if(!loadParameters(files[0],parameters,component))
+    return 1;
+  RobotFilter filter;
+  if(!filter.configure(parameters))
+    return 1;
+
+  if(!replay.read(files[1]))
+    return 1;
+
+  FILE* out = fopen(files[2],"wb");
+  if(!out){
+    fprintf(stderr,"youbot_replay: could not open %s\n",files[2]);
+    return 1;
+  }
+
+  RTT::os::TimeService::ticks start = RTT::os::TimeService::Instance()->getTicks();
+  unsigned long estimates = 0;
+  unsigned long outputs = 0;
+  unsigned long mismatches = 0;
+  long long first_mismatch = -1;
+  unsigned int dimension = filter.dimension();
+  bool compare = replay.recorded_count > 0 && replay.recorded_width == dimension;
+  {
+    EstimateWriter writer(out,dimension);
+    MotionInput input(component.odometry_sample_period);
+    /// The estimates the component writes to its ports
+    EstimateDecimator decimator;
+    decimator.configure(dimension,component.output_decimation,component.average_output);
+    std::vector<double> output(dimension);
+    /// The prior, as published by the start of the component
+    writer.write(0,filter.state(),filter.covariance());
+    bool system_update = true;
+    for(unsigned int i = 0; ; i++){
+      estimates++;
+      if(decimator.add(filter.state(),system_update)){
+        for(unsigned int k = 0; k < dimension; k++)
+          output[k] = decimator.output()(k+1);
+        if(compare && outputs < replay.recorded_count
+           && memcmp(&output[0],&replay.recorded[outputs * dimension],dimension * sizeof(double)) != 0){
+          if(mismatches++ == 0)
+            first_mismatch = outputs;
+        }
+        outputs++;
+      }
+      /// The next event that updates the filter
+      while(i < replay.events.size()){
+        const Event& event = replay.events[i];
+        if(event.kind == Event::MEASUREMENT || (event.kind == Event::TIMER && (int)event.values[0] == component.timer_id))
+          break;
+        input.add(event);
+        i++;
+      }
+      if(i == replay.events.size())
+        break;
+      const Event& event = replay.events[i];
+      system_update = event.kind != Event::MEASUREMENT;
+      if(system_update)
+        input.sysUpdate(filter);
+      else
+        filter.measUpdate(event.values[0]);
+      writer.write(event.stamp,filter.state(),filter.covariance());
+    }
+  }
+  double elapsed = RTT::os::TimeService::Instance()->secondsSince(start);
+  if(fclose(out) != 0){
+    fprintf(stderr,"youbot_replay: could not write %s\n",files[2]);
+    return 1;
+  }
+
+  printf("Replayed %.1f s of log in %.3f s: %lu estimates, %lu published\n",replay.duration * 1e-9,elapsed,estimates,outputs);
+  if(replay.input_dropped > 0)
+    printf("The log dropped %lu timer, input or measurement records: the replay differs from the live run\n",replay.input_dropped);
+  if(!compare){
+    printf("No recorded estimates of dimension %u in %s to compare with\n",dimension,replay.estimate_channel.c_str());
+    return 0;
+  }
+  unsigned long compared = std::min(outputs,replay.recorded_count);
+  if(mismatches == 0 && outputs == replay.recorded_count && replay.recorded_dropped == 0){
+    printf("Bit-exact with the %lu recorded estimates\n",replay.recorded_count);
+    return 0;
+  }
+  printf("%lu of %lu compared estimates differ from the live run",mismatches,compared);
+  if(mismatches > 0)
+    printf(", the first is estimate %lld",first_mismatch);
+  printf("; %lu published, %lu recorded, %lu recorded estimates dropped\n",outputs,replay.recorded_count,replay.recorded_dropped);
+  return 2;
+}
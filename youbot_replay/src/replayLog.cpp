@@ -0,0 +1,362 @@
+/******************************************************************************
+*                             OROCOS Youbot replay                            *
+*                                                                             *
+*                         (C) 2011 Steven Bellens                             *
+*                     steven.bellens@mech.kuleuven.be                         *
+*                    Department of Mechanical Engineering,                    *
+*                   Katholieke Universiteit Leuven, Belgium.                  *
+*                                                                             *
+*       You may redistribute this software and/or modify it under either the  *
+*       terms of the GNU Lesser General Public License version 2.1 (LGPLv2.1  *
+*       <http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>) or (at your *
+*       discretion) of the Modified BSD License:                              *
+*       Redistribution and use in source and binary forms, with or without    *
+*       modification, are permitted provided that the following conditions    *
+*       are met:                                                              *
+*       1. Redistributions of source code must retain the above copyright     *
+*       notice, this list of conditions and the following disclaimer.         *
+*       2. Redistributions in binary form must reproduce the above copyright  *
+*       notice, this list of conditions and the following disclaimer in the   *
+*       documentation and/or other materials provided with the distribution.  *
+*       3. The name of the author may not be used to endorse or promote       *
+*       products derived from this software without specific prior written    *
+*       permission.                                                           *
+*       THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR  *
+*       IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED        *
+*       WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE    *
+*       ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,*
+*       INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    *
+*       (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS       *
+*       OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) *
+*       HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,   *
+*       STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING *
+*       IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE    *
+*       POSSIBILITY OF SUCH DAMAGE.                                           *
+*                                                                             *
+*******************************************************************************/
+
+
+/* @Description:
+ * @brief Youbot replay - reading the filter parameters and the recorded log
+ * @Author: Steven Bellens
+ */
+
+#include "replayLog.hpp"
+
+#include <logFormat.hpp>
+
+#include <rtt/Property.hpp>
+#include <rtt/marsh/CPFDemarshaller.hpp>
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <map>
+
+using namespace RTT;
+using namespace youbot::logformat;
+
+namespace youbot{
+  namespace replay{
+
+    static bool getNumber(const PropertyBag& bag, const std::string& name, double& value){
+      base::PropertyBase* property = bag.getProperty(name);
+      Property<double> d(property);
+      Property<int> i(property);
+      Property<unsigned int> u(property);
+      if(d.ready()) value = d.value();
+      else if(i.ready()) value = i.value();
+      else if(u.ready()) value = u.value();
+      else{
+        fprintf(stderr,"youbot_replay: no number %s in the property file\n",name.c_str());
+        return false;
+      }
+      return true;
+    }
+
+    /// The elements of a vector (ColumnVector, float64[]) or of a matrix, row by row
+    static bool getElements(const PropertyBag& bag, std::vector<double>& values, unsigned int& rows){
+      rows = 0;
+      for(PropertyBag::const_iterator it = bag.begin(); it != bag.end(); ++it){
+        Property<PropertyBag> row(*it);
+        double value;
+        unsigned int nested;
+        if(row.ready()){
+          if(!getElements(row.value(),values,nested)) return false;
+          rows++;
+        }
+        else if(getNumber(bag,(*it)->getName(),value)) values.push_back(value);
+        else return false;
+      }
+      return true;
+    }
+
+    static bool getVector(const PropertyBag& bag, const std::string& name, ColumnVector& vector){
+      Property<PropertyBag> property(bag.getProperty(name));
+      std::vector<double> values;
+      unsigned int rows;
+      if(!property.ready() || !getElements(property.value(),values,rows)){
+        fprintf(stderr,"youbot_replay: no vector %s in the property file\n",name.c_str());
+        return false;
+      }
+      vector.resize(values.size());
+      for(unsigned int i = 0; i < values.size(); i++)
+        vector(i+1) = values[i];
+      return true;
+    }
+
+    static bool getSymmetricMatrix(const PropertyBag& bag, const std::string& name, SymmetricMatrix& matrix){
+      Property<PropertyBag> property(bag.getProperty(name));
+      std::vector<double> values;
+      unsigned int rows;
+      if(!property.ready() || !getElements(property.value(),values,rows) || rows == 0 || values.size() != rows * rows){
+        fprintf(stderr,"youbot_replay: no square matrix %s in the property file\n",name.c_str());
+        return false;
+      }
+      matrix.resize(rows);
+      for(unsigned int i = 0; i < rows; i++)
+        for(unsigned int j = 0; j <= i; j++)
+          matrix(i+1,j+1) = values[i*rows + j];
+      return true;
+    }
+
+    bool getParameters(const PropertyBag& bag, RobotFilterParameters& parameters, ComponentParameters& component){
+      double level, pos_state_dimension, meas_dimension, id;
+      bool ok = getVector(bag,"PriorMean",parameters.priorMean)
+        && getVector(bag,"PriorCovariance",parameters.priorCovariance)
+        && getNumber(bag,"Level",level)
+        && getNumber(bag,"SysNoiseMean",parameters.sysNoiseMean)
+        && getNumber(bag,"SysNoiseCovariance",parameters.sysNoiseCovariance)
+        && getNumber(bag,"PosStateDimension",pos_state_dimension)
+        && getNumber(bag,"MeasDimension",meas_dimension)
+        && getSymmetricMatrix(bag,"MeasModelCovariance",parameters.measModelCovariance)
+        && getVector(bag,"MeasNoiseMean",parameters.measNoiseMean)
+        && getNumber(bag,"Period",parameters.period)
+        && getNumber(bag,"TimerIdSystemUpdate",id);
+      if(!ok)
+        return false;
+      parameters.level = (int)level;
+      parameters.posStateDimension = (int)pos_state_dimension;
+      parameters.measDimension = (int)meas_dimension;
+      component.timer_id = (int)id;
+      component.odometry_sample_period = 0.001;
+      component.output_decimation = 1;
+      component.average_output = false;
+      if(bag.getProperty("OdometrySamplePeriod") && !getNumber(bag,"OdometrySamplePeriod",component.odometry_sample_period))
+        return false;
+      if(bag.getProperty("OutputDecimation")){
+        if(!getNumber(bag,"OutputDecimation",id))
+          return false;
+        component.output_decimation = (int)id;
+      }
+      Property<bool> average(bag.getProperty("AverageOutput"));
+      if(average.ready())
+        component.average_output = average.value();
+      return true;
+    }
+
+    bool loadProperties(const char* file_name, PropertyBag& bag){
+      marsh::CPFDemarshaller demarshaller(file_name);
+      if(!demarshaller.deserialize(bag)){
+        fprintf(stderr,"youbot_replay: could not read %s\n",file_name);
+        return false;
+      }
+      return true;
+    }
+
+    bool loadParameters(const char* file_name, RobotFilterParameters& parameters, ComponentParameters& component){
+      PropertyBag bag;
+      if(!loadProperties(file_name,bag))
+        return false;
+      bool ok = getParameters(bag,parameters,component);
+      deletePropertyBag(bag);
+      return ok;
+    }
+
+    struct LogChannel{
+      LogChannel() : width(0), dropped(0){}
+      std::string name;
+      std::string type;
+      unsigned int width;
+      unsigned long dropped;
+    };
+
+    class LogReader{
+      public:
+        LogReader(const char* begin, const char* end) : m_pos(begin), m_end(end){}
+        bool get(void* data, unsigned int size){
+          if(size > (unsigned int)(m_end - m_pos)) return false;
+          memcpy(data,m_pos,size);
+          m_pos += size;
+          return true;
+        }
+        bool getString(std::string& value){
+          unsigned int size;
+          if(!get(&size,sizeof(size)) || size > (unsigned int)(m_end - m_pos)) return false;
+          value.assign(m_pos,size);
+          m_pos += size;
+          return true;
+        }
+        bool getValues(std::vector<double>& values, unsigned int count){
+          values.resize(count);
+          return count == 0 || get(&values[0],count * sizeof(double));
+        }
+        /// Skips chunks of unknown types
+        bool skip(unsigned int size){
+          if(size > (unsigned int)(m_end - m_pos)) return false;
+          m_pos += size;
+          return true;
+        }
+      private:
+        const char* m_pos;
+        const char* m_end;
+    };
+
+    Replay::Replay()
+      : recorded_width(0), recorded_count(0), recorded_dropped(0), input_dropped(0), truth_count(0), duration(0){}
+
+    bool Replay::read(const std::vector<char>& log){
+      FileHeader header;
+      if(log.size() < sizeof(header)){
+        fprintf(stderr,"youbot_replay: not a youbot log file\n");
+        return false;
+      }
+      memcpy(&header,&log[0],sizeof(header));
+      if(memcmp(header.magic,MAGIC,sizeof(MAGIC)) != 0 || header.version != VERSION || header.record_header_size != sizeof(RecordHeader)){
+        fprintf(stderr,"youbot_replay: not a version %u youbot log file\n",VERSION);
+        return false;
+      }
+      std::map<unsigned int,LogChannel> channels;
+      std::vector<double> values;
+      LogReader reader(&log[0] + sizeof(header),&log[0] + log.size());
+      ChunkHeader chunk;
+      bool truncated = false;
+      while(!truncated && reader.get(&chunk,sizeof(chunk))){
+        unsigned int id;
+        if(chunk.type == CHANNEL){
+          LogChannel channel;
+          if(!reader.get(&id,sizeof(id)) || !reader.get(&channel.width,sizeof(channel.width))
+             || !reader.getString(channel.name) || !reader.getString(channel.type))
+            break;
+          channel.dropped = channels[id].dropped;
+          channels[id] = channel;
+          if(timer_channel.empty() && channel.type == "TimerId")
+            timer_channel = channel.name;
+        }
+        else if(chunk.type == DATA){
+          if(!reader.get(&id,sizeof(id)) || channels.find(id) == channels.end())
+            break;
+          const LogChannel& channel = channels[id];
+          unsigned int record_size = sizeof(RecordHeader) + channel.width * sizeof(double);
+          unsigned int n = (chunk.size - sizeof(id)) / record_size;
+          for(unsigned int i = 0; i < n; i++){
+            RecordHeader record;
+            if(!reader.get(&record,sizeof(record)) || !reader.getValues(values,channel.width)){
+              truncated = true;
+              break;
+            }
+            if(record.stamp > duration)
+              duration = record.stamp;
+            Event event;
+            event.stamp = record.stamp;
+            event.order = events.size();
+            if(channel.name == timer_channel && channel.width >= 1){
+              event.kind = Event::TIMER;
+              event.values[0] = values[0];
+            }
+            else if(channel.name == input_channel && channel.width >= 6){
+              /// linear x, y, z, angular x, y, z
+              event.kind = Event::INPUT;
+              event.values[0] = values[0];
+              event.values[1] = values[1];
+              event.values[2] = values[5];
+            }
+            else if(channel.name == odometry_channel && channel.width >= 6){
+              event.kind = Event::ODOMETRY;
+              event.values[0] = values[0];
+              event.values[1] = values[1];
+              event.values[2] = values[5];
+            }
+            else if(channel.name == measurement_channel && channel.width >= 1){
+              event.kind = Event::MEASUREMENT;
+              event.values[0] = values[0];
+            }
+            else if(channel.name == truth_channel && channel.width >= 3){
+              event.kind = Event::TRUTH;
+              event.values[0] = values[0];
+              event.values[1] = values[1];
+              event.values[2] = values[2];
+              truth_count++;
+            }
+            else{
+              if(channel.name == estimate_channel && (recorded_count == 0 || channel.width == recorded_width)){
+                recorded_width = channel.width;
+                recorded.insert(recorded.end(),values.begin(),values.end());
+                recorded_count++;
+              }
+              continue;
+            }
+            events.push_back(event);
+          }
+        }
+        else if(chunk.type == DROPS){
+          unsigned int lost;
+          if(!reader.get(&id,sizeof(id)) || !reader.get(&lost,sizeof(lost)))
+            break;
+          const std::string& name = channels[id].name;
+          if(name == estimate_channel)
+            recorded_dropped += lost;
+          else if(name == timer_channel || name == input_channel || name == odometry_channel || name == measurement_channel)
+            input_dropped += lost;
+        }
+        else if(!reader.skip(chunk.size))
+          break;
+      }
+      if(timer_channel.empty())
+        fprintf(stderr,"youbot_replay: warning: the log has no timer channel, no system updates\n");
+      std::stable_sort(events.begin(),events.end(),EarlierEvent());
+      return true;
+    }
+
+    bool Replay::read(const char* file_name){
+      std::vector<char> log;
+      FILE* in = fopen(file_name,"rb");
+      if(!in){
+        fprintf(stderr,"youbot_replay: could not open %s\n",file_name);
+        return false;
+      }
+      fseek(in,0,SEEK_END);
+      long size = ftell(in);
+      fseek(in,0,SEEK_SET);
+      log.resize(size > 0 ? size : 0);
+      bool ok = size > 0 && fread(&log[0],size,1,in) == 1;
+      fclose(in);
+      if(!ok){
+        fprintf(stderr,"youbot_replay: could not read %s\n",file_name);
+        return false;
+      }
+      return read(log);
+    }
+
+    MotionInput::MotionInput(double odometry_sample_period)
+      : m_odometry_sample_period(odometry_sample_period){
+      m_input[0] = m_input[1] = m_input[2] = 0.0;
+    }
+
+    void MotionInput::add(const Event& event){
+      if(event.kind == Event::INPUT)
+        memcpy(m_input,event.values,sizeof(m_input));
+      else if(event.kind == Event::ODOMETRY)
+        m_odometry.add(event.values[0],event.values[1],event.values[2],m_odometry_sample_period);
+    }
+
+    void MotionInput::sysUpdate(RobotFilter& filter){
+      if(m_odometry.samples() > 0)
+        filter.sysUpdateDelta(m_odometry.dx(),m_odometry.dy(),m_odometry.dtheta());
+      else
+        filter.sysUpdate(m_input[0],m_input[1],m_input[2]);
+      m_odometry.reset();
+    }
+
+  }
+}
@@ -0,0 +1,158 @@
+/******************************************************************************
+*                             OROCOS Youbot replay                            *
+*                                                                             *
+*                         (C) 2011 Steven Bellens                             *
+*                     steven.bellens@mech.kuleuven.be                         *
+*                    Department of Mechanical Engineering,                    *
+*                   Katholieke Universiteit Leuven, Belgium.                  *
+*                                                                             *
+*       You may redistribute this software and/or modify it under either the  *
+*       terms of the GNU Lesser General Public License version 2.1 (LGPLv2.1  *
+*       <http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>) or (at your *
+*       discretion) of the Modified BSD License:                              *
+*       Redistribution and use in source and binary forms, with or without    *
+*       modification, are permitted provided that the following conditions    *
+*       are met:                                                              *
+*       1. Redistributions of source code must retain the above copyright     *
+*       notice, this list of conditions and the following disclaimer.         *
+*       2. Redistributions in binary form must reproduce the above copyright  *
+*       notice, this list of conditions and the following disclaimer in the   *
+*       documentation and/or other materials provided with the distribution.  *
+*       3. The name of the author may not be used to endorse or promote       *
+*       products derived from this software without specific prior written    *
+*       permission.                                                           *
+*       THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR  *
+*       IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED        *
+*       WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE    *
+*       ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,*
+*       INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    *
+*       (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS       *
+*       OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) *
+*       HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,   *
+*       STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING *
+*       IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE    *
+*       POSSIBILITY OF SUCH DAMAGE.                                           *
+*                                                                             *
+*******************************************************************************/
+
+
+/* @Description:
+ * @brief Youbot replay - reading the filter parameters and the recorded log
+ * @Author: Steven Bellens
+ */
+
+ /*
+  * Shared by youbot_replay and youbot_tune: the parameters of the
+  * RobotFilter are read from the property file of the estimator, the events
+  * that drive it are decoded from a log of the Youbot Logger and merged in the
+  * order they were written. The decoded log is never modified after
+  * Replay::read(), so several filters can replay it concurrently.
+ */
+
+#ifndef _YOUBOT_REPLAY_LOG_
+#define _YOUBOT_REPLAY_LOG_
+
+#include <robotFilter.hpp>
+#include <odometryIntegrator.hpp>
+#include <estimateDecimator.hpp>
+
+#include <rtt/PropertyBag.hpp>
+
+#include <string>
+#include <vector>
+
+namespace youbot{
+  namespace replay{
+    /// The properties of the component that drive the filter
+    struct ComponentParameters{
+      /// TimerIdSystemUpdate
+      int timer_id;
+      /// OdometrySamplePeriod (0.001 if the file has none)
+      double odometry_sample_period;
+      /// OutputDecimation (1 if the file has none)
+      int output_decimation;
+      /// AverageOutput (false if the file has none)
+      bool average_output;
+    };
+
+    /// @name Reading the filter parameters from the property file
+    //@{
+    /// The parameters of the filter and of the component in bag
+    bool getParameters(const RTT::PropertyBag& bag, RobotFilterParameters& parameters, ComponentParameters& component);
+    /// Reads file_name into bag; the caller deletes the bag with deletePropertyBag()
+    bool loadProperties(const char* file_name, RTT::PropertyBag& bag);
+    bool loadParameters(const char* file_name, RobotFilterParameters& parameters, ComponentParameters& component);
+    //@}
+
+    /// @name Reading the log
+    //@{
+    struct Event{
+      enum Kind{ TIMER, INPUT, ODOMETRY, MEASUREMENT, TRUTH };
+      long long stamp;
+      /// Position in the log, orders events with the same stamp
+      unsigned int order;
+      Kind kind;
+      /// TIMER: the id; INPUT, ODOMETRY: vx, vy, omega; MEASUREMENT: the
+      /// distance; TRUTH: x, y, theta
+      double values[3];
+    };
+
+    /// Sorts the events in the order they were written
+    struct EarlierEvent{
+      bool operator()(const Event& a, const Event& b) const{
+        return a.stamp < b.stamp || (a.stamp == b.stamp && a.order < b.order);
+      }
+    };
+
+    struct Replay{
+      Replay();
+
+      /// @name Channels to replay, set before read(); empty names are not read
+      /// (the timer channel defaults to the first channel of type TimerId)
+      //@{
+      std::string timer_channel;
+      std::string input_channel;
+      /// Measured twists, on the Odometry port of the estimator
+      std::string odometry_channel;
+      std::string measurement_channel;
+      std::string estimate_channel;
+      /// Simulated (or otherwise measured) true state: x, y, theta
+      std::string truth_channel;
+      //@}
+      std::vector<Event> events;
+      /// The estimates of the live run, in the order they were written
+      std::vector<double> recorded;
+      unsigned int recorded_width;
+      unsigned long recorded_count;
+      unsigned long recorded_dropped;
+      unsigned long input_dropped;
+      unsigned long truth_count;
+      long long duration;
+
+      bool read(const std::vector<char>& log);
+      /// One read of the whole file, then read(log)
+      bool read(const char* file_name);
+    };
+    //@}
+
+    /**
+     * \brief The motion input of the filter, kept like the component does
+     *
+     * The odometry received since the last system update, or else the last
+     * input.
+     */
+    class MotionInput{
+      public:
+        MotionInput(double odometry_sample_period);
+        /// Keeps INPUT and ODOMETRY events
+        void add(const Event& event);
+        /// The system update of the component
+        void sysUpdate(RobotFilter& filter);
+      private:
+        double m_odometry_sample_period;
+        double m_input[3];
+        OdometryIntegrator m_odometry;
+    };
+  }
+}
+#endif
@@ -0,0 +1,383 @@
+/******************************************************************************
+*                             OROCOS Youbot replay                            *
+*                                                                             *
+*                         (C) 2011 Steven Bellens                             *
+*                     steven.bellens@mech.kuleuven.be                         *
+*                    Department of Mechanical Engineering,                    *
+*                   Katholieke Universiteit Leuven, Belgium.                  *
+*                                                                             *
+*       You may redistribute this software and/or modify it under either the  *
+*       terms of the GNU Lesser General Public License version 2.1 (LGPLv2.1  *
+*       <http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>) or (at your *
+*       discretion) of the Modified BSD License:                              *
+*       Redistribution and use in source and binary forms, with or without    *
+*       modification, are permitted provided that the following conditions    *
+*       are met:                                                              *
+*       1. Redistributions of source code must retain the above copyright     *
+*       notice, this list of conditions and the following disclaimer.         *
+*       2. Redistributions in binary form must reproduce the above copyright  *
+*       notice, this list of conditions and the following disclaimer in the   *
+*       documentation and/or other materials provided with the distribution.  *
+*       3. The name of the author may not be used to endorse or promote       *
+*       products derived from this software without specific prior written    *
+*       permission.                                                           *
+*       THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR  *
+*       IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED        *
+*       WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE    *
+*       ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,*
+*       INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    *
+*       (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS       *
+*       OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) *
+*       HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,   *
+*       STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING *
+*       IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE    *
+*       POSSIBILITY OF SUCH DAMAGE.                                           *
+*                                                                             *
+*******************************************************************************/
+
+
+/* @Description:
+ * @brief Youbot tune - tune the noise parameters of the estimator on a log
+ * @Author: Steven Bellens
+ */
+
+ /*
+  * youbot_tune replays one log of the Youbot Logger (see youbot_replay)
+  * through many RobotFilters at once, each with other noise parameters, and
+  * writes the property file of the estimator with the best ones:
+  *
+  *   youbot_tune [-j <threads>] [-p <grid points>] [-s <generations>]
+  *               [-w <decades>] [-c] [-t <timer channel>] [-i <input channel>]
+  *               [-o <odometry channel>] [-m <measurement channel>]
+  *               [-r <truth channel>]
+  *               <ekf.cpf> <log.bin> <tuned.cpf>
+  *
+  * Three factors on the values of ekf.cpf are tuned, in decades: on
+  * SysNoiseCovariance, on MeasModelCovariance and on PriorCovariance, within
+  * -w (default 2) decades of the values in the file. The search first
+  * evaluates a grid of -p (default 5) points per factor, then refines the
+  * best point of the grid during -s (default 10) generations of an evolution
+  * strategy with a separate step size per factor.
+  * A parameter set scores the RMS error of the estimated position when the
+  * log holds the true state (-r, default Simulator.simulatedState: x, y,
+  * theta, as in the simulation), or else the consistency of the filter: the
+  * distance between the mean normalized innovation squared of the
+  * measurements and 1, its expected value (-c scores the consistency even
+  * when the true state is logged). Lower is better.
+  * The log is decoded once and shared, read only, by -j worker threads
+  * (default: one per online cpu); each evaluates whole replays, with a filter
+  * of its own. The result does not depend on the number of threads.
+ */
+
+#include "replayLog.hpp"
+
+#include <rtt/os/main.h>
+#include <rtt/os/TimeService.hpp>
+#include <rtt/Property.hpp>
+#include <rtt/marsh/CPFMarshaller.hpp>
+
+#include <pthread.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace RTT;
+using namespace youbot::replay;
+
+/// The tuned factors
+enum{ SYSTEM_NOISE = 0, MEASUREMENT_NOISE = 1, PRIOR = 2, FACTORS = 3 };
+static const char* const factor_names[FACTORS] = { "SysNoiseCovariance", "MeasModelCovariance", "PriorCovariance" };
+
+/// One set of noise parameters and its score
+struct Candidate{
+  /// log10 of the factors on the values of the property file
+  double decades[FACTORS];
+  double score;
+  /// Mean normalized innovation squared of the measurements
+  double nis;
+  /// RMS error of the estimated position, against the true state
+  double error;
+};
+
+struct LowerScore{
+  bool operator()(const Candidate& a, const Candidate& b) const{ return a.score < b.score; }
+};
+
+/// What the workers share, read only
+struct Tuning{
+  const Replay* replay;
+  RobotFilterParameters parameters;
+  ComponentParameters component;
+  bool use_truth;
+};
+
+/// Replays the whole log with the parameters of candidate
+static void evaluate(const Tuning& tuning, Candidate& candidate){
+  RobotFilterParameters parameters = tuning.parameters;
+  parameters.sysNoiseCovariance *= pow(10.0,candidate.decades[SYSTEM_NOISE]);
+  parameters.measModelCovariance = parameters.measModelCovariance * pow(10.0,candidate.decades[MEASUREMENT_NOISE]);
+  parameters.priorCovariance = parameters.priorCovariance * pow(10.0,candidate.decades[PRIOR]);
+  candidate.score = HUGE_VAL;
+  candidate.nis = HUGE_VAL;
+  candidate.error = HUGE_VAL;
+  RobotFilter filter;
+  if(!filter.configure(parameters))
+    return;
+
+  const std::vector<Event>& events = tuning.replay->events;
+  MotionInput input(tuning.component.odometry_sample_period);
+  double nis = 0.0, error = 0.0;
+  unsigned long measurements = 0, truths = 0;
+  for(unsigned int i = 0; i < events.size(); i++){
+    const Event& event = events[i];
+    switch(event.kind){
+      case Event::INPUT:
+      case Event::ODOMETRY:
+        input.add(event);
+        break;
+      case Event::TIMER:
+        if((int)event.values[0] == tuning.component.timer_id)
+          input.sysUpdate(filter);
+        break;
+      case Event::MEASUREMENT:
+        nis += filter.nis(event.values[0]);
+        measurements++;
+        filter.measUpdate(event.values[0]);
+        break;
+      case Event::TRUTH:{
+        double dx = filter.state()(1) - event.values[0];
+        double dy = filter.state()(2) - event.values[1];
+        error += dx * dx + dy * dy;
+        truths++;
+        break;
+      }
+    }
+  }
+  if(measurements > 0)
+    candidate.nis = nis / measurements;
+  if(truths > 0)
+    candidate.error = sqrt(error / truths);
+  double score = tuning.use_truth ? candidate.error : fabs(log(candidate.nis));
+  /// A diverged filter scores NaN
+  if(score == score)
+    candidate.score = score;
+}
+
+/// @name Evaluating candidates in parallel
+//@{
+struct Batch{
+  const Tuning* tuning;
+  std::vector<Candidate>* candidates;
+  unsigned int next;
+  pthread_mutex_t mutex;
+};
+
+static void* work(void* arg){
+  Batch* batch = static_cast<Batch*>(arg);
+  for(;;){
+    pthread_mutex_lock(&batch->mutex);
+    unsigned int i = batch->next++;
+    pthread_mutex_unlock(&batch->mutex);
+    if(i >= batch->candidates->size())
+      return 0;
+    evaluate(*batch->tuning,(*batch->candidates)[i]);
+  }
+}
+
+static void evaluate(const Tuning& tuning, std::vector<Candidate>& candidates, unsigned int threads){
+  Batch batch;
+  batch.tuning = &tuning;
+  batch.candidates = &candidates;
+  batch.next = 0;
+  pthread_mutex_init(&batch.mutex,0);
+  std::vector<pthread_t> workers;
+  for(unsigned int i = 1; i < std::min<unsigned int>(threads,candidates.size()); i++){
+    pthread_t worker;
+    if(pthread_create(&worker,0,work,&batch) == 0)
+      workers.push_back(worker);
+  }
+  /// This thread works too
+  work(&batch);
+  for(unsigned int i = 0; i < workers.size(); i++)
+    pthread_join(workers[i],0);
+  pthread_mutex_destroy(&batch.mutex);
+}
+//@}
+
+/// Standard normal samples, reproducible
+static double normal(unsigned int& seed){
+  double u1 = (rand_r(&seed) + 1.0) / (RAND_MAX + 2.0);
+  double u2 = (rand_r(&seed) + 1.0) / (RAND_MAX + 2.0);
+  return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+}
+
+/// Multiplies all numbers of property name in bag by factor
+static void scale(const PropertyBag& bag, const std::string& name, double factor){
+  base::PropertyBase* property = bag.getProperty(name);
+  Property<double> number(property);
+  Property<PropertyBag> elements(property);
+  if(number.ready())
+    number.set(number.value() * factor);
+  else if(elements.ready())
+    for(PropertyBag::const_iterator it = elements.value().begin(); it != elements.value().end(); ++it)
+      scale(elements.value(),(*it)->getName(),factor);
+}
+
+static void print(const char* what, const Candidate& candidate){
+  printf("%s: score %g (mean NIS %g, RMS position error %g m), factors",what,candidate.score,candidate.nis,candidate.error);
+  for(unsigned int k = 0; k < FACTORS; k++)
+    printf(" %s 1e%+.2f",factor_names[k],candidate.decades[k]);
+  printf("\n");
+}
+
+int ORO_main(int argc, char** argv){
+  Replay replay;
+  replay.input_channel = "Controller.ctrl";
+  replay.measurement_channel = "Simulator.measurement";
+  replay.truth_channel = "Simulator.simulatedState";
+  long threads = sysconf(_SC_NPROCESSORS_ONLN);
+  int points = 5;
+  int generations = 10;
+  double decades = 2.0;
+  bool consistency = false;
+  std::vector<const char*> files;
+  for(int i = 1; i < argc; i++){
+    if(strcmp(argv[i],"-j") == 0 && i + 1 < argc)
+      threads = atol(argv[++i]);
+    else if(strcmp(argv[i],"-p") == 0 && i + 1 < argc)
+      points = atoi(argv[++i]);
+    else if(strcmp(argv[i],"-s") == 0 && i + 1 < argc)
+      generations = atoi(argv[++i]);
+    else if(strcmp(argv[i],"-w") == 0 && i + 1 < argc)
+      decades = atof(argv[++i]);
+    else if(strcmp(argv[i],"-c") == 0)
+      consistency = true;
+    else if(strcmp(argv[i],"-t") == 0 && i + 1 < argc)
+      replay.timer_channel = argv[++i];
+    else if(strcmp(argv[i],"-i") == 0 && i + 1 < argc)
+      replay.input_channel = argv[++i];
+    else if(strcmp(argv[i],"-o") == 0 && i + 1 < argc)
+      replay.odometry_channel = argv[++i];
+    else if(strcmp(argv[i],"-m") == 0 && i + 1 < argc)
+      replay.measurement_channel = argv[++i];
+    else if(strcmp(argv[i],"-r") == 0 && i + 1 < argc)
+      replay.truth_channel = argv[++i];
+    else
+      files.push_back(argv[i]);
+  }
+  if(files.size() != 3 || points < 1 || generations < 0 || decades < 0.0){
+    fprintf(stderr,"Usage: youbot_tune [-j <threads>] [-p <grid points>] [-s <generations>] [-w <decades>] [-c] [-t <timer channel>] [-i <input channel>] [-o <odometry channel>] [-m <measurement channel>] [-r <truth channel>] <ekf.cpf> <log.bin> <tuned.cpf>\n");
+    return 1;
+  }
+  if(threads < 1)
+    threads = 1;
+
+  PropertyBag bag;
+  Tuning tuning;
+  if(!loadProperties(files[0],bag))
+    return 1;
+  if(!getParameters(bag,tuning.parameters,tuning.component)){
+    deletePropertyBag(bag);
+    return 1;
+  }
+  if(!replay.read(files[1])){
+    deletePropertyBag(bag);
+    return 1;
+  }
+  tuning.replay = &replay;
+  tuning.use_truth = !consistency && replay.truth_count > 0;
+  if(replay.input_dropped > 0)
+    printf("The log dropped %lu timer, input or measurement records\n",replay.input_dropped);
+  printf("Scoring the %s on %.1f s of log, %ld threads\n",
+         tuning.use_truth ? "RMS position error against the true state" : "consistency of the innovations",
+         replay.duration * 1e-9,threads);
+
+  RTT::os::TimeService::ticks start = RTT::os::TimeService::Instance()->getTicks();
+  unsigned long replays = 0;
+
+  /// The parameters of the property file, then the grid
+  std::vector<Candidate> candidates(1);
+  for(unsigned int k = 0; k < FACTORS; k++)
+    candidates[0].decades[k] = 0.0;
+  double step = points > 1 ? 2.0 * decades / (points - 1) : decades;
+  unsigned int grid = 1;
+  for(unsigned int k = 0; k < FACTORS; k++)
+    grid *= points;
+  for(unsigned int i = 0; i < grid; i++){
+    Candidate candidate;
+    for(unsigned int k = 0, index = i; k < FACTORS; k++, index /= points)
+      candidate.decades[k] = points > 1 ? -decades + step * (index % points) : 0.0;
+    candidates.push_back(candidate);
+  }
+  evaluate(tuning,candidates,threads);
+  replays += candidates.size();
+  const Candidate original = candidates[0];
+  Candidate best = *std::min_element(candidates.begin(),candidates.end(),LowerScore());
+  print("Property file",original);
+  print("Grid",best);
+
+  /// Refinement: each generation samples lambda candidates around the mean
+  /// and moves the mean and the step sizes to the weighted mu best ones
+  const unsigned int lambda = 16, mu = lambda / 2;
+  double weights[mu], sum = 0.0;
+  for(unsigned int i = 0; i < mu; i++)
+    sum += weights[i] = log(mu + 0.5) - log(i + 1.0);
+  for(unsigned int i = 0; i < mu; i++)
+    weights[i] /= sum;
+  double mean[FACTORS], sigma[FACTORS];
+  for(unsigned int k = 0; k < FACTORS; k++){
+    mean[k] = best.decades[k];
+    sigma[k] = step > 0.0 ? step / 2.0 : 0.5;
+  }
+  unsigned int seed = 1;
+  for(int generation = 0; generation < generations && best.score < HUGE_VAL; generation++){
+    candidates.resize(lambda);
+    for(unsigned int i = 0; i < lambda; i++)
+      for(unsigned int k = 0; k < FACTORS; k++)
+        candidates[i].decades[k] = std::max(-decades,std::min(decades,mean[k] + sigma[k] * normal(seed)));
+    evaluate(tuning,candidates,threads);
+    replays += candidates.size();
+    std::sort(candidates.begin(),candidates.end(),LowerScore());
+    if(candidates[0].score < best.score)
+      best = candidates[0];
+    for(unsigned int k = 0; k < FACTORS; k++){
+      double next = 0.0, spread = 0.0;
+      for(unsigned int i = 0; i < mu; i++){
+        next += weights[i] * candidates[i].decades[k];
+        spread += weights[i] * (candidates[i].decades[k] - mean[k]) * (candidates[i].decades[k] - mean[k]);
+      }
+      mean[k] = next;
+      sigma[k] = std::max(sqrt(spread),1e-3);
+    }
+  }
+  double elapsed = RTT::os::TimeService::Instance()->secondsSince(start);
+  print("Tuned",best);
+  printf("%lu replays in %.3f s\n",replays,elapsed);
+  if(!(best.score < HUGE_VAL)){
+    fprintf(stderr,"youbot_tune: no parameters give a converging filter\n");
+    deletePropertyBag(bag);
+    return 2;
+  }
+
+  for(unsigned int k = 0; k < FACTORS; k++)
+    scale(bag,factor_names[k],pow(10.0,best.decades[k]));
+  std::ofstream out(files[2]);
+  {
+    marsh::CPFMarshaller<std::ostream> marshaller(out);
+    marshaller.serialize(bag);
+    marshaller.flush();
+  }
+  deletePropertyBag(bag);
+  if(!out){
+    fprintf(stderr,"youbot_tune: could not write %s\n",files[2]);
+    return 1;
+  }
+  printf("Wrote %s\n",files[2]);
+  return 0;
+}
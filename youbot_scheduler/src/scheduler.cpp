@@ -0,0 +1,151 @@
+/******************************************************************************
+*                      OROCOS Youbot scheduler component                      *
+*                                                                             *
+*                         (C) 2011 Steven Bellens                             *
+*                     steven.bellens@mech.kuleuven.be                         *
+*                    Department of Mechanical Engineering,                    *
+*                   Katholieke Universiteit Leuven, Belgium.                  *
+*                                                                             *
+*       You may redistribute this software and/or modify it under either the  *
+*       terms of the GNU Lesser General Public License version 2.1 (LGPLv2.1  *
+*       <http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>) or (at your *
+*       discretion) of the Modified BSD License:                              *
+*       Redistribution and use in source and binary forms, with or without    *
+*       modification, are permitted provided that the following conditions    *
+*       are met:                                                              *
+*       1. Redistributions of source code must retain the above copyright     *
+*       notice, this list of conditions and the following disclaimer.         *
+*       2. Redistributions in binary form must reproduce the above copyright  *
+*       notice, this list of conditions and the following disclaimer in the   *
+*       documentation and/or other materials provided with the distribution.  *
+*       3. The name of the author may not be used to endorse or promote       *
+*       products derived from this software without specific prior written    *
+*       permission.                                                           *
+*       THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR  *
+*       IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED        *
+*       WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE    *
+*       ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,*
+*       INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    *
+*       (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS       *
+*       OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) *
+*       HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,   *
+*       STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING *
+*       IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE    *
+*       POSSIBILITY OF SUCH DAMAGE.                                           *
+*                                                                             *
+*******************************************************************************/
+#include "scheduler.hpp"
+
+#include <math.h>
+
+// This macro is used whenever a new Orocos component is generated. Here we
+// generate a Youbot Scheduler component.
+ORO_CREATE_COMPONENT(youbot::Scheduler)
+
+namespace youbot{
+  Scheduler::Scheduler(std::string name) : TaskContext(name,PreOperational)
+  ,m_max_timers(16)
+  ,m_cycle_time(0.0)
+  ,m_max_cycle_time(0.0)
+  {
+    /// Add the output port to the Orocos interface
+    this->addPort("timeout",timeout_port).doc("Id of each expired timer");
+    this->addOperation("startTimer",&Scheduler::startTimer,this,RTT::OwnThread).doc("Start a periodic timer").arg("Id","Timer id").arg("Period","Timer period, rounded to a multiple of the scheduler period");
+    this->addOperation("killTimer",&Scheduler::killTimer,this,RTT::OwnThread).doc("Stop a timer").arg("Id","Timer id");
+    /// Add property variables to the Orocos interface
+    this->addProperty("execution_order",m_execution_order).doc("Names of the peers to update, in dataflow order");
+    this->addProperty("max_timers",m_max_timers).doc("Maximum number of timers");
+    this->addProperty("cycle_time",m_cycle_time).doc("Duration of the last cycle");
+    this->addProperty("max_cycle_time",m_max_cycle_time).doc("Longest cycle since the start");
+  }
+
+  Scheduler::~Scheduler(){}
+
+  bool Scheduler::configureHook(){
+    if(this->getPeriod() <= 0.0){
+      log(Error) << "(Scheduler) The scheduler needs a periodic activity" << endlog();
+      return false;
+    }
+    if(m_max_timers < 0){
+      log(Error) << "(Scheduler) The maximum number of timers must not be negative" << endlog();
+      return false;
+    }
+    m_peers.clear();
+    for(unsigned int i = 0; i < m_execution_order.size(); i++){
+      TaskContext* peer = this->getPeer(m_execution_order[i]);
+      if(!peer){
+        log(Error) << "(Scheduler) " << m_execution_order[i] << " is not a peer" << endlog();
+        return false;
+      }
+      m_peers.push_back(peer);
+    }
+    m_timer_id.assign(m_max_timers, 0);
+    m_timer_period.assign(m_max_timers, 0);
+    m_timer_countdown.assign(m_max_timers, 0);
+    return true;
+  }
+
+  bool Scheduler::startHook(){
+    m_max_cycle_time = 0.0;
+    return true;
+  }
+
+  void Scheduler::updateHook(){
+    RTT::os::TimeService::ticks start = RTT::os::TimeService::Instance()->getTicks();
+    /// Fire the expired timers first, so the components see them in this cycle
+    for(unsigned int i = 0; i < m_timer_period.size(); i++){
+      if(m_timer_period[i] == 0) continue;
+      if(--m_timer_countdown[i] == 0){
+        m_timer_countdown[i] = m_timer_period[i];
+        timeout_port.write(m_timer_id[i]);
+      }
+    }
+    /// Execute the slave components in dataflow order
+    for(unsigned int i = 0; i < m_peers.size(); i++){
+      m_peers[i]->update();
+    }
+    m_cycle_time = RTT::os::TimeService::Instance()->secondsSince(start);
+    if(m_cycle_time > m_max_cycle_time) m_max_cycle_time = m_cycle_time;
+  }
+
+  bool Scheduler::startTimer(RTT::os::Timer::TimerId id, double period){
+    double scheduler_period = this->getPeriod();
+    if(scheduler_period <= 0.0) return false;
+    unsigned int periods = (unsigned int)floor(period / scheduler_period + 0.5);
+    if(periods == 0) periods = 1;
+    int free = -1;
+    for(unsigned int i = 0; i < m_timer_period.size(); i++){
+      /// Restart a running timer with the same id
+      if(m_timer_period[i] != 0 && m_timer_id[i] == id){
+        free = i;
+        break;
+      }
+      if(free < 0 && m_timer_period[i] == 0) free = i;
+    }
+    if(free < 0){
+      log(Error) << "(Scheduler) All " << m_max_timers << " timers are in use" << endlog();
+      return false;
+    }
+    m_timer_id[free] = id;
+    m_timer_period[free] = periods;
+    m_timer_countdown[free] = periods;
+    return true;
+  }
+
+  bool Scheduler::killTimer(RTT::os::Timer::TimerId id){
+    for(unsigned int i = 0; i < m_timer_period.size(); i++){
+      if(m_timer_period[i] != 0 && m_timer_id[i] == id){
+        m_timer_period[i] = 0;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void Scheduler::stopHook(){
+  }
+
+  void Scheduler::cleanupHook(){
+    m_peers.clear();
+  }
+}
@@ -0,0 +1,130 @@
+/******************************************************************************
+*                      OROCOS Youbot scheduler component                      *
+*                                                                             *
+*                         (C) 2011 Steven Bellens                             *
+*                     steven.bellens@mech.kuleuven.be                         *
+*                    Department of Mechanical Engineering,                    *
+*                   Katholieke Universiteit Leuven, Belgium.                  *
+*                                                                             *
+*       You may redistribute this software and/or modify it under either the  *
+*       terms of the GNU Lesser General Public License version 2.1 (LGPLv2.1  *
+*       <http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>) or (at your *
+*       discretion) of the Modified BSD License:                              *
+*       Redistribution and use in source and binary forms, with or without    *
+*       modification, are permitted provided that the following conditions    *
+*       are met:                                                              *
+*       1. Redistributions of source code must retain the above copyright     *
+*       notice, this list of conditions and the following disclaimer.         *
+*       2. Redistributions in binary form must reproduce the above copyright  *
+*       notice, this list of conditions and the following disclaimer in the   *
+*       documentation and/or other materials provided with the distribution.  *
+*       3. The name of the author may not be used to endorse or promote       *
+*       products derived from this software without specific prior written    *
+*       permission.                                                           *
+*       THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR  *
+*       IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED        *
+*       WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE    *
+*       ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,*
+*       INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    *
+*       (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS       *
+*       OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) *
+*       HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,   *
+*       STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING *
+*       IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE    *
+*       POSSIBILITY OF SUCH DAMAGE.                                           *
+*                                                                             *
+*******************************************************************************/
+/* @Description:
+ * @brief Youbot scheduler - OROCOS component
+ * @Author: Steven Bellens
+ */
+
+ /*
+  * The YouBot Scheduler component executes a chain of components (e.g.
+  * Simulator -> ExtendedKalmanFilterComponentRobot -> Controller) in one
+  * thread. The components get a slave activity with the scheduler as master
+  * (setMasterSlaveActivity in the deployer); each period the scheduler
+  * fires its timers and then updates its peers in the configured execution
+  * order, so each component sees the data its predecessors produced in the
+  * same period. It replaces the OCL::TimerComponent of the chain: the
+  * timers have the same startTimer/killTimer interface and the same timeout
+  * port, but fire in the scheduler thread, at multiples of its period.
+ */
+
+#include <rtt/TaskContext.hpp>
+#include <rtt/Port.hpp>
+#include <rtt/Property.hpp>
+#include <rtt/Component.hpp>
+#include <rtt/os/Timer.hpp>
+#include <rtt/os/TimeService.hpp>
+
+namespace youbot{
+
+  using namespace std;
+  using namespace RTT;
+
+  class Scheduler : public TaskContext{
+    protected:
+      /// @name Ports
+      //@{
+      /// Timer ids - the id of each expired timer is written on this port
+      OutputPort<RTT::os::Timer::TimerId> timeout_port;
+      //@}
+      /// @name Properties
+      //@{
+      /// Execution order - the names of the peers to update, in dataflow order
+      std::vector<std::string> m_execution_order;
+      /// Maximum number of timers
+      int m_max_timers;
+      /// Duration of the last cycle (timers and all updates)
+      double m_cycle_time;
+      /// Longest cycle since the start
+      double m_max_cycle_time;
+      //@}
+
+    public:
+      /**
+       * \brief Constructor
+       *
+       * Constructor building a Youbot scheduler component
+       * \param name The component name
+       */
+      Scheduler(std::string name);
+      //! Destructor
+      ~Scheduler();
+
+      /// @name Public methods
+      //@{
+      bool configureHook();
+      bool startHook();
+      void updateHook();
+      void stopHook();
+      void cleanupHook();
+
+      /**
+       * \brief Start a periodic timer
+       *
+       * The period is rounded to a multiple of the period of the scheduler.
+       * \return false if all timers are in use or the scheduler has no period
+       */
+      bool startTimer(RTT::os::Timer::TimerId id, double period);
+
+      /**
+       * \brief Stop a timer
+       */
+      bool killTimer(RTT::os::Timer::TimerId id);
+      //@}
+
+    private:
+      /// The peers to update, in execution order
+      std::vector<TaskContext*> m_peers;
+      /// @name Timers, allocated at configuration time
+      //@{
+      std::vector<RTT::os::Timer::TimerId> m_timer_id;
+      /// Period of each timer, in scheduler periods (0 if unused)
+      std::vector<unsigned int> m_timer_period;
+      /// Scheduler periods until each timer expires
+      std::vector<unsigned int> m_timer_countdown;
+      //@}
+  };
+}
@@ -0,0 +1,180 @@
+/******************************************************************************
+*                    OROCOS Youbot shared memory transport                    *
+*                                                                             *
+*                         (C) 2011 Steven Bellens                             *
+*                     steven.bellens@mech.kuleuven.be                         *
+*                    Department of Mechanical Engineering,                    *
+*                   Katholieke Universiteit Leuven, Belgium.                  *
+*                                                                             *
+*       You may redistribute this software and/or modify it under either the  *
+*       terms of the GNU Lesser General Public License version 2.1 (LGPLv2.1  *
+*       <http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>) or (at your *
+*       discretion) of the Modified BSD License:                              *
+*       Redistribution and use in source and binary forms, with or without    *
+*       modification, are permitted provided that the following conditions    *
+*       are met:                                                              *
+*       1. Redistributions of source code must retain the above copyright     *
+*       notice, this list of conditions and the following disclaimer.         *
+*       2. Redistributions in binary form must reproduce the above copyright  *
+*       notice, this list of conditions and the following disclaimer in the   *
+*       documentation and/or other materials provided with the distribution.  *
+*       3. The name of the author may not be used to endorse or promote       *
+*       products derived from this software without specific prior written    *
+*       permission.                                                           *
+*       THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR  *
+*       IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED        *
+*       WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE    *
+*       ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,*
+*       INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    *
+*       (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS       *
+*       OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) *
+*       HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,   *
+*       STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING *
+*       IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE    *
+*       POSSIBILITY OF SUCH DAMAGE.                                           *
+*                                                                             *
+*******************************************************************************/
+
+/* @Description:
+ * @brief Youbot shared memory transport - seqlock published value
+ * @Author: Steven Bellens
+ */
+
+ /*
+  * A SeqlockBlock publishes the latest value of a plain (memcpy-able) type
+  * from one writer to any number of readers. The writer makes the sequence
+  * number odd, copies the value and makes it even again; a reader copies the
+  * value and retries (a bounded number of times) if the sequence number was
+  * odd or changed meanwhile.
+  * Readers never block the writer and the writer does the same work however
+  * many readers there are. The block can live in the memory of a component
+  * (in-process readers) or in a named shared memory segment (ShmSeqlock,
+  * readers in other processes).
+ */
+
+#ifndef _YOUBOT_SEQLOCK_BLOCK_
+#define _YOUBOT_SEQLOCK_BLOCK_
+
+#include "shmSegment.hpp"
+
+#include <new>
+#include <sched.h>
+
+namespace youbot{
+
+  template<class T>
+  class SeqlockBlock{
+    public:
+      SeqlockBlock() : m_seq(0){ memset(&m_value,0,sizeof(T)); }
+
+      /**
+       * \brief Publish a value (one writer only)
+       *
+       * The sequence number is made odd with seq | 1 instead of seq + 1: a
+       * writer that died in the middle of a write leaves it odd, and the next
+       * writer of the shared memory block makes it even again.
+       */
+      void write(const T& value){
+        unsigned int seq = m_seq | 1;
+        m_seq = seq;
+        __sync_synchronize();
+        memcpy(&m_value,&value,sizeof(T));
+        __sync_synchronize();
+        m_seq = seq + 1;
+      }
+
+      /// Attempts of read() before it gives up on a writer that does not finish its write
+      static const unsigned int MAX_ATTEMPTS = 1000;
+
+      /**
+       * \brief Take a consistent copy of the latest value
+       *
+       * Gives up after MAX_ATTEMPTS: a writer process that died in the middle
+       * of a write (or a writer of lower priority on the same CPU) never
+       * makes the sequence number even again.
+       * \return false if nothing was published yet or no consistent copy
+       * could be taken
+       */
+      bool read(T& value) const{
+        for(unsigned int attempt = 0; attempt < MAX_ATTEMPTS; attempt++){
+          unsigned int seq = m_seq;
+          __sync_synchronize();
+          if((seq & 1) == 0){
+            memcpy(&value,&m_value,sizeof(T));
+            __sync_synchronize();
+            if(m_seq == seq)
+              return seq != 0;
+          }
+          // The writer is preempted in the middle of a write: let it finish
+          if(attempt > 100)
+            sched_yield();
+        }
+        return false;
+      }
+
+      /// Number of values published
+      unsigned int count() const{ return m_seq / 2; }
+
+    private:
+      volatile unsigned int m_seq;
+      T m_value;
+  };
+
+  /**
+   * \brief A SeqlockBlock in a named shared memory segment
+   */
+  template<class T>
+  class ShmSeqlock{
+    public:
+      /// "YBSL"
+      static const unsigned int MAGIC = 0x4c534259;
+
+      ShmSeqlock() : m_layout(0){}
+
+      /**
+       * \brief Map the block, creating it if it does not exist yet
+       *
+       * \param name Name of the segment
+       * \param error Set to a description of the problem on failure
+       */
+      bool open(const std::string& name, std::string& error){
+        bool created;
+        m_layout = 0;
+        if(!m_segment.open(name,sizeof(Layout),created,error))
+          return false;
+        Layout* layout = static_cast<Layout*>(m_segment.address());
+        if(created){
+          new(&layout->block) SeqlockBlock<T>();
+          layout->size = sizeof(T);
+          __sync_synchronize();
+          layout->magic = MAGIC;
+        }
+        else{
+          for(int i = 0; i < 100 && layout->magic != MAGIC; i++)
+            usleep(1000);
+        }
+        __sync_synchronize();
+        if(layout->magic != MAGIC || layout->size != sizeof(T)){
+          error = m_segment.name() + " has another layout, remove it if it is stale";
+          m_segment.close();
+          return false;
+        }
+        m_layout = layout;
+        return true;
+      }
+
+      bool isOpen() const{ return m_layout != 0; }
+      SeqlockBlock<T>& block(){ return m_layout->block; }
+
+    private:
+      struct Layout{
+        volatile unsigned int magic;
+        unsigned int size;
+        SeqlockBlock<T> block;
+      };
+
+      ShmSegment m_segment;
+      Layout* m_layout;
+  };
+}
+#endif
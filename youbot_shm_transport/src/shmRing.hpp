@@ -0,0 +1,289 @@
+/******************************************************************************
+*                    OROCOS Youbot shared memory transport                    *
+*                                                                             *
+*                         (C) 2011 Steven Bellens                             *
+*                     steven.bellens@mech.kuleuven.be                         *
+*                    Department of Mechanical Engineering,                    *
+*                   Katholieke Universiteit Leuven, Belgium.                  *
+*                                                                             *
+*       You may redistribute this software and/or modify it under either the  *
+*       terms of the GNU Lesser General Public License version 2.1 (LGPLv2.1  *
+*       <http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>) or (at your *
+*       discretion) of the Modified BSD License:                              *
+*       Redistribution and use in source and binary forms, with or without    *
+*       modification, are permitted provided that the following conditions    *
+*       are met:                                                              *
+*       1. Redistributions of source code must retain the above copyright     *
+*       notice, this list of conditions and the following disclaimer.         *
+*       2. Redistributions in binary form must reproduce the above copyright  *
+*       notice, this list of conditions and the following disclaimer in the   *
+*       documentation and/or other materials provided with the distribution.  *
+*       3. The name of the author may not be used to endorse or promote       *
+*       products derived from this software without specific prior written    *
+*       permission.                                                           *
+*       THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR  *
+*       IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED        *
+*       WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE    *
+*       ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,*
+*       INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    *
+*       (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS       *
+*       OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) *
+*       HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,   *
+*       STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING *
+*       IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE    *
+*       POSSIBILITY OF SUCH DAMAGE.                                           *
+*                                                                             *
+*******************************************************************************/
+
+/* @Description:
+ * @brief Youbot shared memory transport - lock-free ring in a shm segment
+ * @Author: Steven Bellens
+ */
+
+ /*
+  * A ShmRing is a ring of samples in a named POSIX shared memory segment,
+  * written by one process and read by any number of local processes. The
+  * writer never waits for the readers: it overwrites the oldest slot, and a
+  * sequence number per slot lets a reader detect that the slot it copied
+  * was overwritten meanwhile (a seqlock per slot). Readers that fall more
+  * than a ring behind skip the lost samples and count them. The writer
+  * bumps a futex word in the segment after each sample; idle readers sleep
+  * on it and the writer only makes the wake up system call when a reader is
+  * waiting.
+  * This header does not depend on the RTT, so processes outside Orocos
+  * (e.g. a visualization) can read the rings as well.
+ */
+
+#ifndef _YOUBOT_SHM_RING_
+#define _YOUBOT_SHM_RING_
+
+#include "shmSegment.hpp"
+
+#include <string>
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+
+namespace youbot{
+
+  class ShmRing{
+    public:
+      /// "YBSH"
+      static const unsigned int MAGIC = 0x48534259;
+      static const unsigned int VERSION = 1;
+
+      /// Result of a read
+      enum ReadStatus{
+        NO_DATA,
+        NEW_DATA
+      };
+
+      ShmRing() : m_header(0), m_slots(0){}
+      ~ShmRing(){ close(); }
+
+      /**
+       * \brief Open the segment, creating it if it does not exist yet
+       *
+       * All users of a segment must agree on its type, element size and
+       * capacity; a stale segment with another layout is reported and must
+       * be removed (rm /dev/shm/<name>).
+       * \param name Name of the segment (a leading '/' is added if missing)
+       * \param type Name of the type of the samples
+       * \param element_size Maximum size of a sample, in bytes
+       * \param capacity Number of slots
+       * \param error Set to a description of the problem on failure
+       */
+      bool open(const std::string& name, const std::string& type, unsigned int element_size, unsigned int capacity, std::string& error){
+        close();
+        unsigned int stride = slotStride(element_size);
+        bool created;
+        if(!m_segment.open(name,sizeof(Header) + capacity * stride,created,error))
+          return false;
+        m_header = static_cast<Header*>(m_segment.address());
+        m_slots = static_cast<char*>(m_segment.address()) + sizeof(Header);
+        if(created){
+          memset(m_header->type,0,sizeof(m_header->type));
+          strncpy(m_header->type,type.c_str(),sizeof(m_header->type) - 1);
+          m_header->element_size = element_size;
+          m_header->capacity = capacity;
+          m_header->stride = stride;
+          m_header->write_index = 0;
+          m_header->futex = 0;
+          m_header->waiters = 0;
+          m_header->version = VERSION;
+          // Publish the layout last: the other users wait for the magic
+          __sync_synchronize();
+          m_header->magic = MAGIC;
+        }
+        else{
+          for(int i = 0; i < 100 && m_header->magic != MAGIC; i++)
+            usleep(1000);
+        }
+        __sync_synchronize();
+        if(m_header->magic != MAGIC || m_header->version != VERSION || m_header->element_size != element_size
+           || m_header->capacity != capacity || type.compare(0,sizeof(m_header->type) - 1,m_header->type) != 0){
+          error = m_segment.name() + " has another layout, remove it if it is stale";
+          close();
+          return false;
+        }
+        return true;
+      }
+
+      void close(){
+        m_segment.close();
+        m_header = 0;
+        m_slots = 0;
+      }
+
+      bool isOpen() const{ return m_header != 0; }
+      unsigned int elementSize() const{ return m_header->element_size; }
+      unsigned int capacity() const{ return m_header->capacity; }
+
+      /// @name Writer
+      //@{
+      /// The data of the next slot; the previous contents are invalidated
+      void* begin(){
+        Slot* slot = slotAt(m_header->write_index);
+        slot->seq = 0;
+        __sync_synchronize();
+        return slot->data();
+      }
+
+      /// Publish the slot returned by begin() and wake up the readers
+      void commit(unsigned int size){
+        unsigned int index = m_header->write_index;
+        Slot* slot = slotAt(index);
+        slot->size = size;
+        __sync_synchronize();
+        slot->seq = index + 1;
+        m_header->write_index = index + 1;
+        __sync_fetch_and_add(&m_header->futex,1);
+        if(m_header->waiters > 0)
+          futex(FUTEX_WAKE,INT_MAX,0);
+      }
+
+      /// Wake up all waiting readers without publishing anything
+      void wake(){
+        __sync_fetch_and_add(&m_header->futex,1);
+        futex(FUTEX_WAKE,INT_MAX,0);
+      }
+      //@}
+
+      /// @name Readers
+      /// Each reader keeps its own index: the index of the next sample it
+      /// reads. Start with latest() to only see new samples.
+      //@{
+      unsigned int latest() const{
+        return m_header->write_index;
+      }
+
+      /**
+       * \brief Copy the sample at index and advance the index
+       *
+       * \param newest Skip to the newest sample instead of the next one
+       * (the skipped samples are not counted as lost)
+       * \param lost Incremented with the samples that were overwritten
+       * before they could be read
+       */
+      ReadStatus read(unsigned int& index, void* data, unsigned int& size, bool newest, unsigned int& lost){
+        while(true){
+          unsigned int write_index = m_header->write_index;
+          __sync_synchronize();
+          if(index == write_index)
+            return NO_DATA;
+          if(newest)
+            index = write_index - 1;
+          else if(write_index - index > m_header->capacity){
+            lost += write_index - index - m_header->capacity;
+            index = write_index - m_header->capacity;
+          }
+          Slot* slot = slotAt(index);
+          unsigned int seq = slot->seq;
+          __sync_synchronize();
+          if(seq == index + 1){
+            size = slot->size;
+            if(size > m_header->element_size)
+              size = m_header->element_size;
+            memcpy(data,slot->data(),size);
+            __sync_synchronize();
+            if(slot->seq == seq){
+              index++;
+              return NEW_DATA;
+            }
+          }
+          // Overwritten while copying: the writer is a ring ahead
+          lost++;
+          index++;
+        }
+      }
+
+      /**
+       * \brief Wait until a sample after index is written
+       *
+       * \return false on timeout or wake()
+       */
+      bool wait(unsigned int index, int timeout_ms){
+        __sync_fetch_and_add(&m_header->waiters,1);
+        int value = m_header->futex;
+        __sync_synchronize();
+        bool available = m_header->write_index != index;
+        if(!available){
+          struct timespec timeout;
+          timeout.tv_sec = timeout_ms / 1000;
+          timeout.tv_nsec = (timeout_ms % 1000) * 1000000L;
+          futex(FUTEX_WAIT,value,&timeout);
+          available = m_header->write_index != index;
+        }
+        __sync_fetch_and_sub(&m_header->waiters,1);
+        return available;
+      }
+      //@}
+
+    private:
+      struct Header{
+        volatile unsigned int magic;
+        unsigned int version;
+        char type[64];
+        unsigned int element_size;
+        unsigned int capacity;
+        /// Size of a slot, in bytes
+        unsigned int stride;
+        /// Index of the next sample to write
+        volatile unsigned int write_index;
+        /// Bumped after each sample; the readers sleep on it
+        volatile int futex;
+        /// Number of sleeping readers
+        volatile int waiters;
+      };
+
+      struct Slot{
+        /// index + 1 of the sample in the slot, 0 while it is written
+        volatile unsigned int seq;
+        unsigned int size;
+        /// Keeps the data 8 byte aligned
+        double pad;
+        char* data(){ return reinterpret_cast<char*>(&pad); }
+      };
+
+      static unsigned int slotStride(unsigned int element_size){
+        unsigned int stride = sizeof(Slot) - sizeof(double) + element_size;
+        return (stride + 7) & ~7u;
+      }
+
+      Slot* slotAt(unsigned int index){
+        return reinterpret_cast<Slot*>(m_slots + (index % m_header->capacity) * m_header->stride);
+      }
+
+      long futex(int op, int value, const struct timespec* timeout){
+        return syscall(SYS_futex,&m_header->futex,op,value,timeout,0,0);
+      }
+
+      ShmSegment m_segment;
+      Header* m_header;
+      char* m_slots;
+  };
+}
+#endif
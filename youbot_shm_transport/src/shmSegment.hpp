@@ -0,0 +1,131 @@
+/******************************************************************************
+*                    OROCOS Youbot shared memory transport                    *
+*                                                                             *
+*                         (C) 2011 Steven Bellens                             *
+*                     steven.bellens@mech.kuleuven.be                         *
+*                    Department of Mechanical Engineering,                    *
+*                   Katholieke Universiteit Leuven, Belgium.                  *
+*                                                                             *
+*       You may redistribute this software and/or modify it under either the  *
+*       terms of the GNU Lesser General Public License version 2.1 (LGPLv2.1  *
+*       <http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>) or (at your *
+*       discretion) of the Modified BSD License:                              *
+*       Redistribution and use in source and binary forms, with or without    *
+*       modification, are permitted provided that the following conditions    *
+*       are met:                                                              *
+*       1. Redistributions of source code must retain the above copyright     *
+*       notice, this list of conditions and the following disclaimer.         *
+*       2. Redistributions in binary form must reproduce the above copyright  *
+*       notice, this list of conditions and the following disclaimer in the   *
+*       documentation and/or other materials provided with the distribution.  *
+*       3. The name of the author may not be used to endorse or promote       *
+*       products derived from this software without specific prior written    *
+*       permission.                                                           *
+*       THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR  *
+*       IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED        *
+*       WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE    *
+*       ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,*
+*       INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    *
+*       (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS       *
+*       OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) *
+*       HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,   *
+*       STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING *
+*       IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE    *
+*       POSSIBILITY OF SUCH DAMAGE.                                           *
+*                                                                             *
+*******************************************************************************/
+
+/* @Description:
+ * @brief Youbot shared memory transport - named shared memory segment
+ * @Author: Steven Bellens
+ */
+
+ /*
+  * A ShmSegment maps a named POSIX shared memory segment of a fixed size,
+  * creating it if it does not exist yet. Exactly one of the users creates
+  * it (O_EXCL); the creator initializes the contents and then publishes
+  * them (e.g. by writing a magic number last), the others wait for that.
+  * Segments outlive the processes: a stale segment of another size is
+  * reported and must be removed (rm /dev/shm/<name>).
+ */
+
+#ifndef _YOUBOT_SHM_SEGMENT_
+#define _YOUBOT_SHM_SEGMENT_
+
+#include <string>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace youbot{
+
+  class ShmSegment{
+    public:
+      ShmSegment() : m_address(0), m_size(0){}
+      ~ShmSegment(){ close(); }
+
+      /**
+       * \brief Map the segment, creating it if it does not exist yet
+       *
+       * \param name Name of the segment (a leading '/' is added if missing)
+       * \param size Size of the segment, in bytes
+       * \param created Set if this call created the segment
+       * \param error Set to a description of the problem on failure
+       */
+      bool open(const std::string& name, size_t size, bool& created, std::string& error){
+        close();
+        m_name = (!name.empty() && name[0] == '/') ? name : "/" + name;
+        created = true;
+        int fd = shm_open(m_name.c_str(),O_RDWR | O_CREAT | O_EXCL,0666);
+        if(fd < 0 && errno == EEXIST){
+          created = false;
+          fd = shm_open(m_name.c_str(),O_RDWR,0666);
+        }
+        if(fd < 0){
+          error = "cannot open " + m_name + ": " + strerror(errno);
+          return false;
+        }
+        if(created && ftruncate(fd,size) != 0){
+          error = "cannot size " + m_name + ": " + strerror(errno);
+          ::close(fd);
+          return false;
+        }
+        // The creator may still be sizing the segment
+        struct stat status;
+        for(int i = 0; i < 100 && fstat(fd,&status) == 0 && status.st_size == 0; i++)
+          usleep(1000);
+        if(fstat(fd,&status) != 0 || (size_t)status.st_size != size){
+          error = m_name + " has another size, remove it if it is stale";
+          ::close(fd);
+          return false;
+        }
+        void* address = mmap(0,size,PROT_READ | PROT_WRITE,MAP_SHARED,fd,0);
+        ::close(fd);
+        if(address == MAP_FAILED){
+          error = "cannot map " + m_name + ": " + strerror(errno);
+          return false;
+        }
+        m_address = address;
+        m_size = size;
+        return true;
+      }
+
+      void close(){
+        if(m_address)
+          munmap(m_address,m_size);
+        m_address = 0;
+      }
+
+      void* address() const{ return m_address; }
+      const std::string& name() const{ return m_name; }
+
+    private:
+      std::string m_name;
+      void* m_address;
+      size_t m_size;
+  };
+}
+#endif
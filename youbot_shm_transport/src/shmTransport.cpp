@@ -0,0 +1,71 @@
+/******************************************************************************
+*                    OROCOS Youbot shared memory transport                    *
+*                                                                             *
+*                         (C) 2011 Steven Bellens                             *
+*                     steven.bellens@mech.kuleuven.be                         *
+*                    Department of Mechanical Engineering,                    *
+*                   Katholieke Universiteit Leuven, Belgium.                  *
+*                                                                             *
+*       You may redistribute this software and/or modify it under either the  *
+*       terms of the GNU Lesser General Public License version 2.1 (LGPLv2.1  *
+*       <http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>) or (at your *
+*       discretion) of the Modified BSD License:                              *
+*       Redistribution and use in source and binary forms, with or without    *
+*       modification, are permitted provided that the following conditions    *
+*       are met:                                                              *
+*       1. Redistributions of source code must retain the above copyright     *
+*       notice, this list of conditions and the following disclaimer.         *
+*       2. Redistributions in binary form must reproduce the above copyright  *
+*       notice, this list of conditions and the following disclaimer in the   *
+*       documentation and/or other materials provided with the distribution.  *
+*       3. The name of the author may not be used to endorse or promote       *
+*       products derived from this software without specific prior written    *
+*       permission.                                                           *
+*       THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR  *
+*       IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED        *
+*       WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE    *
+*       ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,*
+*       INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    *
+*       (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS       *
+*       OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) *
+*       HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,   *
+*       STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING *
+*       IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE    *
+*       POSSIBILITY OF SUCH DAMAGE.                                           *
+*                                                                             *
+*******************************************************************************/
+
+#include "shmTransport.hpp"
+
+#include <rtt/types/TransportPlugin.hpp>
+#include <rtt/types/TypekitPlugin.hpp>
+
+namespace youbot{
+
+  /**
+   * \brief Registers the shared memory transport for the flat types
+   *
+   * Type names are matched without a leading '/', so both the old and new
+   * naming of the ROS typekits work.
+   */
+  class ShmTransportPlugin : public types::TransportPlugin{
+    public:
+      bool registerTransport(std::string name, types::TypeInfo* ti){
+        if(!name.empty() && name[0] == '/')
+          name = name.substr(1);
+        if(name == "ColumnVector" || name == "MatrixWrapper::ColumnVector")
+          return ti->addProtocol(ORO_SHM_PROTOCOL_ID,new ShmTransporter<ColumnVector>());
+        if(name == "geometry_msgs/Twist")
+          return ti->addProtocol(ORO_SHM_PROTOCOL_ID,new ShmTransporter<geometry_msgs::Twist>());
+        if(name == "std_msgs/Float64")
+          return ti->addProtocol(ORO_SHM_PROTOCOL_ID,new ShmTransporter<std_msgs::Float64>());
+        return false;
+      }
+
+      std::string getTransportName() const{ return "shm"; }
+      std::string getTypekitName() const{ return "youbot-shm"; }
+      std::string getName() const{ return "youbot-shm-transport"; }
+  };
+}
+
+ORO_TYPEKIT_PLUGIN(youbot::ShmTransportPlugin)
@@ -0,0 +1,301 @@
+/******************************************************************************
+*                    OROCOS Youbot shared memory transport                    *
+*                                                                             *
+*                         (C) 2011 Steven Bellens                             *
+*                     steven.bellens@mech.kuleuven.be                         *
+*                    Department of Mechanical Engineering,                    *
+*                   Katholieke Universiteit Leuven, Belgium.                  *
+*                                                                             *
+*       You may redistribute this software and/or modify it under either the  *
+*       terms of the GNU Lesser General Public License version 2.1 (LGPLv2.1  *
+*       <http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>) or (at your *
+*       discretion) of the Modified BSD License:                              *
+*       Redistribution and use in source and binary forms, with or without    *
+*       modification, are permitted provided that the following conditions    *
+*       are met:                                                              *
+*       1. Redistributions of source code must retain the above copyright     *
+*       notice, this list of conditions and the following disclaimer.         *
+*       2. Redistributions in binary form must reproduce the above copyright  *
+*       notice, this list of conditions and the following disclaimer in the   *
+*       documentation and/or other materials provided with the distribution.  *
+*       3. The name of the author may not be used to endorse or promote       *
+*       products derived from this software without specific prior written    *
+*       permission.                                                           *
+*       THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR  *
+*       IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED        *
+*       WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE    *
+*       ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,*
+*       INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    *
+*       (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS       *
+*       OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) *
+*       HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,   *
+*       STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING *
+*       IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE    *
+*       POSSIBILITY OF SUCH DAMAGE.                                           *
+*                                                                             *
+*******************************************************************************/
+
+/* @Description:
+ * @brief Youbot shared memory transport - RTT transport
+ * @Author: Steven Bellens
+ */
+
+ /*
+  * RTT transport (protocol ORO_SHM_PROTOCOL_ID) that streams ports through
+  * ShmRings, used like the ROS streams in the deployment scripts:
+  *   cp.transport = 4
+  *   cp.name_id = "/youbot_estimate"
+  *   stream("ExtendedKalmanFilterComponentRobot.EstimatedState",cp)
+  * The samples are copied flat into the ring (ShmFlat), without
+  * serialization. An output port gets a ShmSender, which writes in the thread
+  * of the producer. An input port gets a ShmReceiver with its own thread,
+  * which sleeps on the ring and forwards each sample to the port (so event
+  * ports are triggered); with a data policy (cp.type = 0) it only forwards
+  * the newest sample, with a buffer policy every sample in order.
+  * cp.size sets the number of slots of the ring (default 16) and
+  * cp.data_size the maximum size of a variable size sample in bytes; both
+  * ends must use the same values.
+ */
+
+#ifndef _YOUBOT_SHM_TRANSPORT_
+#define _YOUBOT_SHM_TRANSPORT_
+
+#include "shmRing.hpp"
+
+#include <bfl/wrappers/matrix/matrix_wrapper.h>
+#include <bfl/wrappers/matrix/vector_wrapper.h>
+
+#include <rtt/Activity.hpp>
+#include <rtt/ConnPolicy.hpp>
+#include <rtt/Logger.hpp>
+#include <rtt/base/ChannelElement.hpp>
+#include <rtt/base/RunnableInterface.hpp>
+#include <rtt/types/TypeTransporter.hpp>
+
+#include <geometry_msgs/Twist.h>
+#include <std_msgs/Float64.h>
+
+#define ORO_SHM_PROTOCOL_ID 4
+
+namespace youbot{
+
+  using namespace RTT;
+  using namespace MatrixWrapper;
+
+  /// Slots of a ring when the policy does not set a size
+  const unsigned int SHM_DEFAULT_CAPACITY = 16;
+
+  /**
+   * \brief Flat layout of a type in a ring
+   *
+   * size() is the maximum size of a sample, pack() copies a sample into a
+   * slot (returning its size, 0 if it does not fit) and unpack() copies it
+   * back.
+   */
+  template<class T>
+  struct ShmFlat;
+
+  /// The number of rows followed by the values
+  template<>
+  struct ShmFlat<ColumnVector>{
+    static const char* type(){ return "ColumnVector"; }
+    static unsigned int size(const ConnPolicy& policy){
+      return policy.data_size > 0 ? policy.data_size : sizeof(double) * 65;
+    }
+    static unsigned int pack(const ColumnVector& sample, void* data, unsigned int size){
+      unsigned int rows = sample.rows();
+      if(sizeof(double) * (rows + 1) > size)
+        return 0;
+      double* values = static_cast<double*>(data);
+      values[0] = rows;
+      for(unsigned int i = 1; i <= rows; i++)
+        values[i] = sample(i);
+      return sizeof(double) * (rows + 1);
+    }
+    static void unpack(const void* data, unsigned int size, ColumnVector& sample){
+      const double* values = static_cast<const double*>(data);
+      unsigned int rows = (unsigned int)values[0];
+      if(sizeof(double) * (rows + 1) > size)
+        return;
+      // Only allocates when the size changes
+      if(sample.rows() != rows)
+        sample.resize(rows);
+      for(unsigned int i = 1; i <= rows; i++)
+        sample(i) = values[i];
+    }
+  };
+
+  template<>
+  struct ShmFlat<geometry_msgs::Twist>{
+    static const char* type(){ return "geometry_msgs/Twist"; }
+    static unsigned int size(const ConnPolicy&){ return sizeof(double) * 6; }
+    static unsigned int pack(const geometry_msgs::Twist& sample, void* data, unsigned int){
+      double* values = static_cast<double*>(data);
+      values[0] = sample.linear.x;
+      values[1] = sample.linear.y;
+      values[2] = sample.linear.z;
+      values[3] = sample.angular.x;
+      values[4] = sample.angular.y;
+      values[5] = sample.angular.z;
+      return sizeof(double) * 6;
+    }
+    static void unpack(const void* data, unsigned int, geometry_msgs::Twist& sample){
+      const double* values = static_cast<const double*>(data);
+      sample.linear.x = values[0];
+      sample.linear.y = values[1];
+      sample.linear.z = values[2];
+      sample.angular.x = values[3];
+      sample.angular.y = values[4];
+      sample.angular.z = values[5];
+    }
+  };
+
+  template<>
+  struct ShmFlat<std_msgs::Float64>{
+    static const char* type(){ return "std_msgs/Float64"; }
+    static unsigned int size(const ConnPolicy&){ return sizeof(double); }
+    static unsigned int pack(const std_msgs::Float64& sample, void* data, unsigned int){
+      *static_cast<double*>(data) = sample.data;
+      return sizeof(double);
+    }
+    static void unpack(const void* data, unsigned int, std_msgs::Float64& sample){
+      sample.data = *static_cast<const double*>(data);
+    }
+  };
+
+  /// Open the ring of a stream, logging the problem on failure
+  template<class T>
+  bool openRing(ShmRing& ring, const ConnPolicy& policy){
+    std::string error;
+    unsigned int capacity = policy.size > 0 ? policy.size : SHM_DEFAULT_CAPACITY;
+    if(!ring.open(policy.name_id,ShmFlat<T>::type(),ShmFlat<T>::size(policy),capacity,error)){
+      log(Error) << "(ShmTransport) Stream " << policy.name_id << ": " << error << endlog();
+      return false;
+    }
+    return true;
+  }
+
+  /**
+   * \brief Stream end of an output port: writes the samples into the ring
+   */
+  template<class T>
+  class ShmSender : public base::ChannelElement<T>{
+    public:
+      typedef typename base::ChannelElement<T>::param_t param_t;
+
+      ShmSender() : m_oversized(false){}
+
+      bool open(const ConnPolicy& policy){
+        m_name = policy.name_id;
+        return openRing<T>(m_ring,policy);
+      }
+
+      bool write(param_t sample){
+        void* data = m_ring.begin();
+        unsigned int size = ShmFlat<T>::pack(sample,data,m_ring.elementSize());
+        // A sample that does not fit is not published (the slot stays invalid).
+        // Still report success: the port would drop the connection otherwise
+        if(size > 0)
+          m_ring.commit(size);
+        else if(!m_oversized){
+          m_oversized = true;
+          log(Error) << "(ShmTransport) Stream " << m_name << ": a sample does not fit in " << m_ring.elementSize() << " bytes, raise data_size of the policy; dropping the samples that don't fit" << endlog();
+        }
+        return true;
+      }
+
+      bool data_sample(param_t sample){
+        return true;
+      }
+
+    private:
+      ShmRing m_ring;
+      std::string m_name;
+      /// A sample was dropped because it did not fit, reported once
+      bool m_oversized;
+  };
+
+  /**
+   * \brief Stream end of an input port: forwards the samples of the ring
+   *
+   * Runs its own thread, which sleeps on the ring.
+   */
+  template<class T>
+  class ShmReceiver : public base::ChannelElement<T>, public base::RunnableInterface{
+    public:
+      ShmReceiver() : m_activity(0), m_newest(true), m_lost(0), m_index(0), m_stop(false){}
+
+      ~ShmReceiver(){
+        if(m_activity){
+          m_activity->stop();
+          delete m_activity;
+        }
+      }
+
+      bool open(const ConnPolicy& policy){
+        if(!openRing<T>(m_ring,policy))
+          return false;
+        m_buffer.resize(m_ring.elementSize() / sizeof(double) + 1);
+        m_newest = policy.type == ConnPolicy::DATA;
+        m_index = m_ring.latest();
+        m_activity = new Activity(ORO_SCHED_RT,os::HighestPriority,0.0,this,"ShmReceiver " + policy.name_id);
+        return m_activity->start();
+      }
+
+      void loop(){
+        while(!m_stop){
+          unsigned int size;
+          unsigned int lost = m_lost;
+          while(m_ring.read(m_index,&m_buffer[0],size,m_newest,m_lost) == ShmRing::NEW_DATA){
+            ShmFlat<T>::unpack(&m_buffer[0],size,m_sample);
+            base::ChannelElement<T>::write(m_sample);
+          }
+          if(m_lost != lost)
+            log(Warning) << "(ShmTransport) Lost " << m_lost - lost << " samples, the ring is too small" << endlog();
+          m_ring.wait(m_index,100);
+        }
+      }
+
+      bool breakLoop(){
+        m_stop = true;
+        m_ring.wake();
+        return true;
+      }
+
+    private:
+      ShmRing m_ring;
+      Activity* m_activity;
+      /// Only forward the newest sample (data policy)
+      bool m_newest;
+      unsigned int m_lost;
+      unsigned int m_index;
+      volatile bool m_stop;
+      /// Copy of the slot, doubles to keep it aligned
+      std::vector<double> m_buffer;
+      T m_sample;
+  };
+
+  template<class T>
+  class ShmTransporter : public types::TypeTransporter{
+    public:
+      base::ChannelElementBase::shared_ptr createStream(base::PortInterface* port, const ConnPolicy& policy, bool is_sender) const{
+        if(policy.name_id.empty()){
+          log(Error) << "(ShmTransport) Set the name of the segment in the name_id of the policy to stream " << port->getName() << endlog();
+          return base::ChannelElementBase::shared_ptr();
+        }
+        if(is_sender){
+          ShmSender<T>* sender = new ShmSender<T>();
+          base::ChannelElementBase::shared_ptr channel(sender);
+          if(!sender->open(policy))
+            return base::ChannelElementBase::shared_ptr();
+          return channel;
+        }
+        ShmReceiver<T>* receiver = new ShmReceiver<T>();
+        base::ChannelElementBase::shared_ptr channel(receiver);
+        if(!receiver->open(policy))
+          return base::ChannelElementBase::shared_ptr();
+        return channel;
+      }
+  };
+}
+#endif
@@ -46,6 +46,7 @@ namespace youbot{
     ,m_measDimension(0)
     ,prop_timer_state(10)
     ,prop_timer_meas(11)
+    ,m_timer_probe(0)
   {
     this->addPort("ctrl",ctrl_port).doc("Youbot control input");
     this->addPort("measurement",measurement_port).doc("Laser measurement output");
@@ -147,6 +148,7 @@ namespace youbot{
     simulatedState_port.setDataSample(ColumnVector(m_dimension));
     m_measurementFloat.data=0.0;
     measurement_port.setDataSample(m_measurementFloat);
+    m_timer_probe = HookStatsService::probe(this, "triggerTimer", 0.0);
     return true;
   }
 
@@ -158,6 +160,7 @@ namespace youbot{
   }
 
   void Simulator::triggerTimer(RTT::base::PortInterface* port){
+    HookTimer timer(m_timer_probe);
     int timer_id;
     // Check which timer triggered the port and act accordingly
     _timerId.read(timer_id);
@@ -68,6 +68,7 @@
 
 #include <nonlinearanalyticconditionalgaussianmobile.h>
 #include <youbotLaserPdf.h>
+#include <hookStatsService.hpp>
 
 #include <geometry_msgs/Twist.h>
 #include <std_msgs/Float64.h>
@@ -158,6 +159,8 @@ namespace youbot{
       std_msgs::Float64  m_measurementFloat;
       /// System inputs
       ColumnVector m_inputs;
+      /// Timing of triggerTimer(), 0 without the hookstats service
+      HookProbe* m_timer_probe;
       /*!
       * helper function calculating the factorial of an int
       * @param the integer of which to calculate the factorial
@@ -0,0 +1,3 @@
+#!/bin/sh
+# Compile the deployment, then run it without the deployer
+rosrun youbot_static deploy2bin simulationScheduled.xml simulationScheduled.bin && rosrun youbot_static youbot_static simulationScheduled.bin
@@ -0,0 +1,444 @@
+/******************************************************************************
+*                       OROCOS Youbot static deployment                       *
+*                                                                             *
+*                         (C) 2011 Steven Bellens                             *
+*                     steven.bellens@mech.kuleuven.be                         *
+*                    Department of Mechanical Engineering,                    *
+*                   Katholieke Universiteit Leuven, Belgium.                  *
+*                                                                             *
+*       You may redistribute this software and/or modify it under either the  *
+*       terms of the GNU Lesser General Public License version 2.1 (LGPLv2.1  *
+*       <http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>) or (at your *
+*       discretion) of the Modified BSD License:                              *
+*       Redistribution and use in source and binary forms, with or without    *
+*       modification, are permitted provided that the following conditions    *
+*       are met:                                                              *
+*       1. Redistributions of source code must retain the above copyright     *
+*       notice, this list of conditions and the following disclaimer.         *
+*       2. Redistributions in binary form must reproduce the above copyright  *
+*       notice, this list of conditions and the following disclaimer in the   *
+*       documentation and/or other materials provided with the distribution.  *
+*       3. The name of the author may not be used to endorse or promote       *
+*       products derived from this software without specific prior written    *
+*       permission.                                                           *
+*       THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR  *
+*       IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED        *
+*       WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE    *
+*       ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,*
+*       INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    *
+*       (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS       *
+*       OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) *
+*       HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,   *
+*       STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING *
+*       IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE    *
+*       POSSIBILITY OF SUCH DAMAGE.                                           *
+*                                                                             *
+*******************************************************************************/
+
+
+/* @Description:
+ * @brief Youbot static deployment - compile a deployment to the binary format
+ * @Author: Steven Bellens
+ */
+
+ /*
+  * deploy2bin reads a deployment description in the XML format of the OCL
+  * deployer and the property files (cpf) it refers to, and writes it in the
+  * binary deployment format (deploymentFormat.hpp) for youbot_static. All
+  * XML parsing and file lookups happen here, offline; youbot_static only
+  * reads back flat values.
+  *
+  *   deploy2bin <deployment.xml> <deployment.bin>
+  *
+  * The deployment is a list of structs, one per component in deployment
+  * order (the struct type is the component type), with the elements
+  *   Activity (type Activity or SlaveActivity): Period, Priority (a number,
+  *     HighestPriority or LowestPriority), Scheduler (ORO_SCHED_RT or
+  *     ORO_SCHED_OTHER) and, for a slave activity, Master,
+  *   AutoConf, AutoStart: configure / start after the deployment,
+  *   PropertyFile: cpf file to load the properties from,
+  *   Properties: properties set after the property file,
+  *   Peers: the peers of the component (connected both ways),
+  *   Ports: port name - connection name; the ports with the same connection
+  *     name are connected,
+  *   Services: built-in services to add (hookstats),
+  *   Timers: structs with an Id and a Period, started on the component
+  *     after the deployment.
+  * A struct of type ConnPolicy with the name of a connection sets its
+  * policy (type, size, lock_policy). Numbers in Activity may refer to a
+  * property of a component deployed before, numbers in Timers to a
+  * property of any component, as "Component.Property".
+ */
+
+#include "deploymentFormat.hpp"
+
+#include <rtt/os/main.h>
+#include <rtt/os/threads.hpp>
+#include <rtt/os/fosi.h>
+#include <rtt/Property.hpp>
+#include <rtt/PropertyBag.hpp>
+#include <rtt/ConnPolicy.hpp>
+#include <rtt/marsh/CPFDemarshaller.hpp>
+
+#include <stdio.h>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace RTT;
+using namespace youbot::deployformat;
+
+/// Payload of one chunk
+class Chunk{
+  public:
+    explicit Chunk(unsigned int type) : m_type(type){}
+    void putUInt(unsigned int value){ put(&value, sizeof(value)); }
+    void putInt(int value){ put(&value, sizeof(value)); }
+    void putDouble(double value){ put(&value, sizeof(value)); }
+    void putString(const std::string& value){
+      putUInt(value.size());
+      put(value.data(), value.size());
+    }
+    bool write(FILE* file) const{
+      ChunkHeader header;
+      header.type = m_type;
+      header.size = m_data.size();
+      return fwrite(&header, sizeof(header), 1, file) == 1
+          && (m_data.empty() || fwrite(&m_data[0], m_data.size(), 1, file) == 1);
+    }
+  private:
+    void put(const void* data, unsigned int size){
+      m_data.insert(m_data.end(), (const char*)data, (const char*)data + size);
+    }
+    unsigned int m_type;
+    std::vector<char> m_data;
+};
+
+class Compiler{
+  public:
+    explicit Compiler(FILE* out) : m_out(out){}
+
+    bool compile(const PropertyBag& deployment){
+      FileHeader header;
+      for(unsigned int i = 0; i < sizeof(header.magic); ++i) header.magic[i] = MAGIC[i];
+      header.version = VERSION;
+      if(fwrite(&header, sizeof(header), 1, m_out) != 1) return false;
+      for(PropertyBag::const_iterator it = deployment.begin(); it != deployment.end(); ++it){
+        Property<PropertyBag> element(*it);
+        if(!element.ready()){
+          fprintf(stderr, "deploy2bin: %s is not a struct\n", (*it)->getName().c_str());
+          return false;
+        }
+        bool ok = element.value().getType() == "ConnPolicy"
+          ? policy(element.getName(), element.value())
+          : component(element.getName(), element.value());
+        if(!ok) return false;
+      }
+      /// Peers, connections and timers refer to the components, write them last
+      for(unsigned int i = 0; i < m_chunks.size(); ++i)
+        if(!m_chunks[i].write(m_out)) return false;
+      for(std::map<std::string, std::vector<std::string> >::const_iterator it = m_connections.begin(); it != m_connections.end(); ++it){
+        if(it->second.size() < 2){
+          fprintf(stderr, "deploy2bin: connection %s has only one port\n", it->first.c_str());
+          return false;
+        }
+        ConnPolicy policy = m_policies.count(it->first) ? m_policies[it->first] : ConnPolicy();
+        Chunk chunk(CONNECTION);
+        chunk.putString(it->first);
+        chunk.putInt(policy.type);
+        chunk.putInt(policy.size);
+        chunk.putInt(policy.lock_policy);
+        chunk.putUInt(it->second.size());
+        for(unsigned int i = 0; i < it->second.size(); ++i) chunk.putString(it->second[i]);
+        if(!chunk.write(m_out)) return false;
+      }
+      for(unsigned int i = 0; i < m_timers.size(); ++i)
+        if(!timer(m_timers[i])) return false;
+      return true;
+    }
+
+  private:
+    FILE* m_out;
+    /// Numeric property values of the components so far, by Component.Property
+    std::map<std::string, double> m_values;
+    std::set<std::string> m_components;
+    std::map<std::string, std::vector<std::string> > m_connections;
+    std::map<std::string, ConnPolicy> m_policies;
+    /// Peer chunks, written after all components
+    std::vector<Chunk> m_chunks;
+    /// Timers, compiled last: their numbers may refer to any component
+    std::vector<std::pair<std::string, base::PropertyBase*> > m_timers;
+
+    bool component(const std::string& name, const PropertyBag& bag){
+      if(m_components.count(name)){
+        fprintf(stderr, "deploy2bin: component %s is deployed twice\n", name.c_str());
+        return false;
+      }
+      m_components.insert(name);
+      Property<bool> autoconf(bag.getProperty("AutoConf"));
+      Property<bool> autostart(bag.getProperty("AutoStart"));
+      Chunk chunk(COMPONENT);
+      chunk.putString(name);
+      chunk.putString(bag.getType());
+      chunk.putUInt(autoconf.ready() && autoconf.value());
+      chunk.putUInt(autostart.ready() && autostart.value());
+      if(!chunk.write(m_out)) return false;
+
+      /// The properties first: activities and timers may refer to them
+      Property<std::string> file(bag.getProperty("PropertyFile"));
+      if(file.ready() && !propertyFile(name, file.value())) return false;
+      Property<PropertyBag> properties(bag.getProperty("Properties"));
+      if(properties.ready() && !propertySet(name, properties.value())) return false;
+
+      for(PropertyBag::const_iterator it = bag.begin(); it != bag.end(); ++it){
+        const std::string& element = (*it)->getName();
+        Property<PropertyBag> sub(*it);
+        if(element == "Activity"){
+          if(!sub.ready() || !activity(name, sub.value())) return false;
+        }
+        else if(element == "Peers" || element == "Services"){
+          if(!sub.ready()) return false;
+          for(PropertyBag::const_iterator p = sub.value().begin(); p != sub.value().end(); ++p){
+            Property<std::string> value(*p);
+            if(!value.ready()){
+              fprintf(stderr, "deploy2bin: %s.%s needs strings\n", name.c_str(), element.c_str());
+              return false;
+            }
+            Chunk chunk(element == "Peers" ? PEER : SERVICE);
+            chunk.putString(name);
+            chunk.putString(value.value());
+            if(element == "Peers") m_chunks.push_back(chunk);
+            else if(!chunk.write(m_out)) return false;
+          }
+        }
+        else if(element == "Ports"){
+          if(!sub.ready()) return false;
+          for(PropertyBag::const_iterator p = sub.value().begin(); p != sub.value().end(); ++p){
+            Property<std::string> connection(*p);
+            if(!connection.ready()){
+              fprintf(stderr, "deploy2bin: port %s.%s needs a connection name\n", name.c_str(), (*p)->getName().c_str());
+              return false;
+            }
+            m_connections[connection.value()].push_back(name + "." + (*p)->getName());
+          }
+        }
+        else if(element == "Timers"){
+          if(!sub.ready()) return false;
+          for(PropertyBag::const_iterator t = sub.value().begin(); t != sub.value().end(); ++t)
+            m_timers.push_back(std::make_pair(name, *t));
+        }
+        else if(element != "AutoConf" && element != "AutoStart" && element != "PropertyFile" && element != "Properties"){
+          fprintf(stderr, "deploy2bin: unknown element %s of %s\n", element.c_str(), name.c_str());
+          return false;
+        }
+      }
+      return true;
+    }
+
+    bool activity(const std::string& name, const PropertyBag& bag){
+      double period = 0.0, priority = os::LowestPriority;
+      int scheduler = ORO_SCHED_OTHER;
+      std::string master;
+      if(bag.getProperty("Period") && !number(bag.getProperty("Period"), period)) return false;
+      Property<std::string> priority_name(bag.getProperty("Priority"));
+      if(priority_name.ready() && priority_name.value() == "HighestPriority") priority = os::HighestPriority;
+      else if(priority_name.ready() && priority_name.value() == "LowestPriority") priority = os::LowestPriority;
+      else if(bag.getProperty("Priority") && !number(bag.getProperty("Priority"), priority)) return false;
+      Property<std::string> scheduler_name(bag.getProperty("Scheduler"));
+      if(scheduler_name.ready()){
+        if(scheduler_name.value() == "ORO_SCHED_RT") scheduler = ORO_SCHED_RT;
+        else if(scheduler_name.value() == "ORO_SCHED_OTHER") scheduler = ORO_SCHED_OTHER;
+        else{
+          fprintf(stderr, "deploy2bin: unknown scheduler %s of %s\n", scheduler_name.value().c_str(), name.c_str());
+          return false;
+        }
+      }
+      Property<std::string> master_name(bag.getProperty("Master"));
+      if(master_name.ready()) master = master_name.value();
+      if(bag.getType() == "SlaveActivity" && master.empty()){
+        fprintf(stderr, "deploy2bin: the slave activity of %s needs a Master\n", name.c_str());
+        return false;
+      }
+      if(!master.empty() && !m_components.count(master)){
+        fprintf(stderr, "deploy2bin: master %s of %s is not deployed before it\n", master.c_str(), name.c_str());
+        return false;
+      }
+      Chunk chunk(ACTIVITY);
+      chunk.putString(name);
+      chunk.putDouble(period);
+      chunk.putInt((int)priority);
+      chunk.putInt(scheduler);
+      chunk.putString(master);
+      return chunk.write(m_out);
+    }
+
+    bool timer(const std::pair<std::string, base::PropertyBase*>& pending){
+      Property<PropertyBag> timer(pending.second);
+      double id, period;
+      if(!timer.ready() || !number(timer.value().getProperty("Id"), id) || !number(timer.value().getProperty("Period"), period)){
+        fprintf(stderr, "deploy2bin: timer %s of %s needs an Id and a Period\n", pending.second->getName().c_str(), pending.first.c_str());
+        return false;
+      }
+      Chunk chunk(TIMER);
+      chunk.putString(pending.first);
+      chunk.putInt((int)id);
+      chunk.putDouble(period);
+      return chunk.write(m_out);
+    }
+
+    bool policy(const std::string& name, const PropertyBag& bag){
+      ConnPolicy policy;
+      double value;
+      if(bag.getProperty("type") && number(bag.getProperty("type"), value)) policy.type = (int)value;
+      if(bag.getProperty("size") && number(bag.getProperty("size"), value)) policy.size = (int)value;
+      if(bag.getProperty("lock_policy") && number(bag.getProperty("lock_policy"), value)) policy.lock_policy = (int)value;
+      m_policies[name] = policy;
+      return true;
+    }
+
+    /// A number, or the value of a numeric property "Component.Property" compiled before
+    bool number(base::PropertyBase* property, double& value){
+      if(!property) return false;
+      Property<double> d(property);
+      if(d.ready()){ value = d.value(); return true; }
+      Property<int> i(property);
+      if(i.ready()){ value = i.value(); return true; }
+      Property<unsigned int> u(property);
+      if(u.ready()){ value = u.value(); return true; }
+      Property<float> f(property);
+      if(f.ready()){ value = f.value(); return true; }
+      Property<std::string> s(property);
+      if(s.ready() && m_values.count(s.value())){ value = m_values[s.value()]; return true; }
+      fprintf(stderr, "deploy2bin: %s is not a number or a numeric property\n", property->getName().c_str());
+      return false;
+    }
+
+    bool propertyFile(const std::string& component, const std::string& file){
+      PropertyBag bag;
+      marsh::CPFDemarshaller demarshaller(file);
+      if(!demarshaller.deserialize(bag)){
+        fprintf(stderr, "deploy2bin: could not read %s\n", file.c_str());
+        return false;
+      }
+      bool ok = propertySet(component, bag);
+      deletePropertyBag(bag);
+      return ok;
+    }
+
+    bool propertySet(const std::string& component, const PropertyBag& bag){
+      for(PropertyBag::const_iterator it = bag.begin(); it != bag.end(); ++it)
+        if(!property(component, *it)) return false;
+      return true;
+    }
+
+    bool property(const std::string& component, base::PropertyBase* property){
+      Chunk chunk(PROPERTY);
+      chunk.putString(component);
+      chunk.putString(property->getName());
+      std::string key = component + "." + property->getName();
+      Property<bool> b(property);
+      Property<std::string> s(property);
+      Property<PropertyBag> bag(property);
+      double number;
+      if(b.ready()){
+        chunk.putUInt(BOOL);
+        chunk.putInt(b.value());
+      }
+      else if(s.ready()){
+        chunk.putUInt(STRING);
+        chunk.putString(s.value());
+      }
+      else if(bag.ready()){
+        if(!sequence(chunk, bag.value(), key)) return false;
+      }
+      else if(Property<double>(property).ready() || Property<float>(property).ready()){
+        this->number(property, number);
+        chunk.putUInt(DOUBLE);
+        chunk.putDouble(number);
+        m_values[key] = number;
+      }
+      else if(this->number(property, number)){
+        chunk.putUInt(LONG);
+        chunk.putInt((int)number);
+        m_values[key] = number;
+      }
+      else return false;
+      return chunk.write(m_out);
+    }
+
+    /// A sequence of doubles or strings, or a matrix as a sequence of rows
+    bool sequence(Chunk& chunk, const PropertyBag& bag, const std::string& key){
+      std::vector<double> values;
+      std::vector<std::string> strings;
+      unsigned int rows = 0, columns = 0;
+      for(PropertyBag::const_iterator it = bag.begin(); it != bag.end(); ++it){
+        Property<std::string> s(*it);
+        Property<PropertyBag> row(*it);
+        double value;
+        if(s.ready()) strings.push_back(s.value());
+        else if(row.ready()){
+          if(rows == 0) columns = row.value().size();
+          if(row.value().size() != columns){
+            fprintf(stderr, "deploy2bin: the rows of %s differ in length\n", key.c_str());
+            return false;
+          }
+          for(PropertyBag::const_iterator e = row.value().begin(); e != row.value().end(); ++e){
+            if(!number(*e, value)) return false;
+            values.push_back(value);
+          }
+          ++rows;
+        }
+        else if(number(*it, value)) values.push_back(value);
+        else return false;
+      }
+      if(!strings.empty() && !values.empty()){
+        fprintf(stderr, "deploy2bin: %s mixes strings and numbers\n", key.c_str());
+        return false;
+      }
+      if(!strings.empty() || bag.getType() == "strings"){
+        chunk.putUInt(STRINGS);
+        chunk.putUInt(strings.size());
+        for(unsigned int i = 0; i < strings.size(); ++i) chunk.putString(strings[i]);
+      }
+      else if(rows > 0){
+        chunk.putUInt(MATRIX);
+        chunk.putUInt(rows);
+        chunk.putUInt(columns);
+        for(unsigned int i = 0; i < values.size(); ++i) chunk.putDouble(values[i]);
+      }
+      else{
+        chunk.putUInt(DOUBLES);
+        chunk.putUInt(values.size());
+        for(unsigned int i = 0; i < values.size(); ++i) chunk.putDouble(values[i]);
+      }
+      return true;
+    }
+};
+
+int ORO_main(int argc, char** argv){
+  if(argc != 3){
+    fprintf(stderr, "usage: %s <deployment.xml> <deployment.bin>\n", argv[0]);
+    return 1;
+  }
+  PropertyBag deployment;
+  marsh::CPFDemarshaller demarshaller(argv[1]);
+  if(!demarshaller.deserialize(deployment)){
+    fprintf(stderr, "deploy2bin: could not read %s\n", argv[1]);
+    return 1;
+  }
+  FILE* out = fopen(argv[2], "wb");
+  if(!out){
+    perror(argv[2]);
+    return 1;
+  }
+  Compiler compiler(out);
+  bool ok = compiler.compile(deployment);
+  ok = (fclose(out) == 0) && ok;
+  deletePropertyBag(deployment);
+  if(!ok){
+    remove(argv[2]);
+    return 1;
+  }
+  return 0;
+}
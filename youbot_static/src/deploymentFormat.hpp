@@ -0,0 +1,114 @@
+/******************************************************************************
+*                       OROCOS Youbot static deployment                       *
+*                                                                             *
+*                         (C) 2011 Steven Bellens                             *
+*                     steven.bellens@mech.kuleuven.be                         *
+*                    Department of Mechanical Engineering,                    *
+*                   Katholieke Universiteit Leuven, Belgium.                  *
+*                                                                             *
+*       You may redistribute this software and/or modify it under either the  *
+*       terms of the GNU Lesser General Public License version 2.1 (LGPLv2.1  *
+*       <http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>) or (at your *
+*       discretion) of the Modified BSD License:                              *
+*       Redistribution and use in source and binary forms, with or without    *
+*       modification, are permitted provided that the following conditions    *
+*       are met:                                                              *
+*       1. Redistributions of source code must retain the above copyright     *
+*       notice, this list of conditions and the following disclaimer.         *
+*       2. Redistributions in binary form must reproduce the above copyright  *
+*       notice, this list of conditions and the following disclaimer in the   *
+*       documentation and/or other materials provided with the distribution.  *
+*       3. The name of the author may not be used to endorse or promote       *
+*       products derived from this software without specific prior written    *
+*       permission.                                                           *
+*       THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR  *
+*       IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED        *
+*       WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE    *
+*       ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,*
+*       INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    *
+*       (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS       *
+*       OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) *
+*       HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,   *
+*       STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING *
+*       IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE    *
+*       POSSIBILITY OF SUCH DAMAGE.                                           *
+*                                                                             *
+*******************************************************************************/
+
+
+/* @Description:
+ * @brief Youbot static deployment - binary deployment format
+ * @Author: Steven Bellens
+ */
+
+ /*
+  * Layout of the binary deployment files written by deploy2bin and read by
+  * the StaticDeployer of youbot_static. A file starts with a FileHeader,
+  * followed by chunks. Each chunk starts with a ChunkHeader giving its type
+  * and the size of its payload, so a reader can skip chunks it doesn't know.
+  * The chunks are in deployment order: a chunk only refers to components
+  * of earlier COMPONENT chunks.
+  *  - COMPONENT: name, type, auto configure flag, auto start flag.
+  *  - ACTIVITY: component, period, priority, scheduler and the name of the
+  *    master component (empty: not a slave activity).
+  *  - PEER: component and peer; the peers are connected both ways.
+  *  - SERVICE: component and the name of a built-in service.
+  *  - PROPERTY: component, property, a ValueKind and the value:
+  *      BOOL, LONG: int; DOUBLE: double; STRING: string;
+  *      DOUBLES: count, doubles; STRINGS: count, strings;
+  *      MATRIX: rows, columns, the doubles row by row.
+  *  - CONNECTION: name, type, size and lock policy of the ConnPolicy, the
+  *    number of ports and the ports (Component.port).
+  *  - TIMER: component (with a startTimer operation), timer id and period;
+  *    started after all components are started.
+  * Sizes, counts, flags and ints are stored as unsigned ints or ints,
+  * strings as an unsigned int length and the characters (no terminating
+  * zero). All values are in the byte order of the machine that wrote the
+  * file.
+ */
+
+#ifndef _YOUBOT_DEPLOYMENT_FORMAT_
+#define _YOUBOT_DEPLOYMENT_FORMAT_
+
+namespace youbot{
+  namespace deployformat{
+    /// First bytes of each deployment file
+    const char MAGIC[8] = {'Y','B','D','E','P','L','O','Y'};
+    /// Version of the format
+    const unsigned int VERSION = 1;
+
+    /// Chunk types
+    enum ChunkType{
+      COMPONENT = 1,
+      ACTIVITY = 2,
+      PEER = 3,
+      SERVICE = 4,
+      PROPERTY = 5,
+      CONNECTION = 6,
+      TIMER = 7
+    };
+
+    /// Kinds of property values
+    enum ValueKind{
+      BOOL = 1,
+      LONG = 2,
+      DOUBLE = 3,
+      STRING = 4,
+      DOUBLES = 5,
+      STRINGS = 6,
+      MATRIX = 7
+    };
+
+    struct FileHeader{
+      char magic[8];
+      unsigned int version;
+    };
+
+    struct ChunkHeader{
+      unsigned int type;
+      /// Size of the payload following the header, in bytes
+      unsigned int size;
+    };
+  }
+}
+#endif
@@ -0,0 +1,391 @@
+/******************************************************************************
+*                       OROCOS Youbot static deployment                       *
+*                                                                             *
+*                         (C) 2011 Steven Bellens                             *
+*                     steven.bellens@mech.kuleuven.be                         *
+*                    Department of Mechanical Engineering,                    *
+*                   Katholieke Universiteit Leuven, Belgium.                  *
+*                                                                             *
+*       You may redistribute this software and/or modify it under either the  *
+*       terms of the GNU Lesser General Public License version 2.1 (LGPLv2.1  *
+*       <http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>) or (at your *
+*       discretion) of the Modified BSD License:                              *
+*       Redistribution and use in source and binary forms, with or without    *
+*       modification, are permitted provided that the following conditions    *
+*       are met:                                                              *
+*       1. Redistributions of source code must retain the above copyright     *
+*       notice, this list of conditions and the following disclaimer.         *
+*       2. Redistributions in binary form must reproduce the above copyright  *
+*       notice, this list of conditions and the following disclaimer in the   *
+*       documentation and/or other materials provided with the distribution.  *
+*       3. The name of the author may not be used to endorse or promote       *
+*       products derived from this software without specific prior written    *
+*       permission.                                                           *
+*       THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR  *
+*       IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED        *
+*       WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE    *
+*       ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,*
+*       INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    *
+*       (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS       *
+*       OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) *
+*       HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,   *
+*       STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING *
+*       IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE    *
+*       POSSIBILITY OF SUCH DAMAGE.                                           *
+*                                                                             *
+*******************************************************************************/
+
+
+#include "staticDeployer.hpp"
+#include "deploymentFormat.hpp"
+
+#include <rtt/Logger.hpp>
+#include <rtt/Activity.hpp>
+#include <rtt/extras/SlaveActivity.hpp>
+#include <rtt/OperationCaller.hpp>
+#include <rtt/os/Timer.hpp>
+#include <bfl/wrappers/matrix/matrix_wrapper.h>
+
+#include <cstdio>
+#include <cstring>
+
+namespace youbot{
+
+  using namespace deployformat;
+
+  /// Reads the fields of one chunk, in place in the file buffer
+  class StaticDeployer::Reader{
+    public:
+      Reader(const char* begin, const char* end) : m_pos(begin), m_end(end){}
+      bool getUInt(unsigned int& value){ return get(&value, sizeof(value)); }
+      bool getInt(int& value){ return get(&value, sizeof(value)); }
+      bool getDouble(double& value){ return get(&value, sizeof(value)); }
+      bool getString(std::string& value){
+        unsigned int size;
+        if(!getUInt(size) || size > (unsigned int)(m_end - m_pos)) return false;
+        value.assign(m_pos, size);
+        m_pos += size;
+        return true;
+      }
+      bool getDoubles(std::vector<double>& values, unsigned int count){
+        if(count > (unsigned int)(m_end - m_pos) / sizeof(double)) return false;
+        values.resize(count);
+        return count == 0 || get(&values[0], count * sizeof(double));
+      }
+    private:
+      bool get(void* data, unsigned int size){
+        if(size > (unsigned int)(m_end - m_pos)) return false;
+        memcpy(data, m_pos, size);
+        m_pos += size;
+        return true;
+      }
+      const char* m_pos;
+      const char* m_end;
+  };
+
+  StaticDeployer::StaticDeployer(){}
+
+  StaticDeployer::~StaticDeployer(){
+    shutdown();
+    for(std::vector<Deployed>::reverse_iterator it = m_components.rbegin(); it != m_components.rend(); ++it)
+      delete it->component;
+  }
+
+  void StaticDeployer::addComponentType(const std::string& type, ComponentFactory factory){
+    m_component_types[type] = factory;
+  }
+
+  void StaticDeployer::addServiceType(const std::string& name, ServiceFactory factory){
+    m_service_types[name] = factory;
+  }
+
+  bool StaticDeployer::load(const std::string& file){
+    FILE* in = fopen(file.c_str(), "rb");
+    if(!in){
+      log(Error) << "(StaticDeployer) Can not open " << file << endlog();
+      return false;
+    }
+    /// One read of the whole file, the chunks are parsed from memory
+    std::vector<char> buffer;
+    fseek(in, 0, SEEK_END);
+    long size = ftell(in);
+    fseek(in, 0, SEEK_SET);
+    if(size > 0){
+      buffer.resize(size);
+      if(fread(&buffer[0], size, 1, in) != 1) buffer.clear();
+    }
+    fclose(in);
+
+    FileHeader header;
+    if(buffer.size() < sizeof(header)){
+      log(Error) << "(StaticDeployer) Can not read " << file << endlog();
+      return false;
+    }
+    memcpy(&header, &buffer[0], sizeof(header));
+    if(memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION){
+      log(Error) << "(StaticDeployer) " << file << " is not a version " << VERSION << " deployment file" << endlog();
+      return false;
+    }
+    const char* pos = &buffer[0] + sizeof(header);
+    const char* end = &buffer[0] + buffer.size();
+    while(pos != end){
+      ChunkHeader chunk;
+      if((unsigned int)(end - pos) < sizeof(chunk)) break;
+      memcpy(&chunk, pos, sizeof(chunk));
+      pos += sizeof(chunk);
+      if(chunk.size > (unsigned int)(end - pos)) break;
+      Reader reader(pos, pos + chunk.size);
+      pos += chunk.size;
+      bool ok = false;
+      switch(chunk.type){
+        case COMPONENT: ok = deployComponent(reader); break;
+        case ACTIVITY: ok = setActivity(reader); break;
+        case PEER: ok = connectPeers(reader); break;
+        case SERVICE: ok = addService(reader); break;
+        case PROPERTY: ok = setProperty(reader); break;
+        case CONNECTION: ok = connectPorts(reader); break;
+        case TIMER: ok = addTimer(reader); break;
+        default:
+          /// Unknown chunks are skipped, newer tools may add chunk types
+          log(Warning) << "(StaticDeployer) Skipping chunk of unknown type " << chunk.type << endlog();
+          ok = true;
+      }
+      if(!ok){
+        log(Error) << "(StaticDeployer) Invalid deployment chunk of type " << chunk.type << " in " << file << endlog();
+        return false;
+      }
+    }
+    if(pos != end){
+      log(Error) << "(StaticDeployer) " << file << " is truncated" << endlog();
+      return false;
+    }
+    log(Info) << "(StaticDeployer) Deployed " << m_components.size() << " components from " << file << endlog();
+    return true;
+  }
+
+  bool StaticDeployer::startup(){
+    for(std::vector<Deployed>::iterator it = m_components.begin(); it != m_components.end(); ++it){
+      if(it->autoconf && !it->component->isConfigured() && !it->component->configure()){
+        log(Error) << "(StaticDeployer) Could not configure " << it->component->getName() << endlog();
+        return false;
+      }
+    }
+    /// The masters of slave activities are deployed before their slaves: SlaveActivity::start() fails while the master is not running
+    for(std::vector<Deployed>::iterator it = m_components.begin(); it != m_components.end(); ++it){
+      if(it->autostart && !it->component->isRunning() && !it->component->start()){
+        log(Error) << "(StaticDeployer) Could not start " << it->component->getName() << endlog();
+        return false;
+      }
+    }
+    for(std::vector<Timer>::iterator it = m_timers.begin(); it != m_timers.end(); ++it){
+      OperationCaller<bool(RTT::os::Timer::TimerId, double)> startTimer;
+      startTimer = it->component->getOperation("startTimer");
+      if(!startTimer.ready() || !startTimer(it->id, it->period)){
+        log(Error) << "(StaticDeployer) Could not start timer " << it->id << " of " << it->component->getName() << endlog();
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void StaticDeployer::shutdown(){
+    for(std::vector<Deployed>::reverse_iterator it = m_components.rbegin(); it != m_components.rend(); ++it)
+      if(it->component->isRunning()) it->component->stop();
+    for(std::vector<Deployed>::reverse_iterator it = m_components.rbegin(); it != m_components.rend(); ++it)
+      if(it->component->isConfigured()) it->component->cleanup();
+  }
+
+  TaskContext* StaticDeployer::component(const std::string& name) const{
+    for(std::vector<Deployed>::const_iterator it = m_components.begin(); it != m_components.end(); ++it)
+      if(it->component->getName() == name) return it->component;
+    return 0;
+  }
+
+  TaskContext* StaticDeployer::findComponent(Reader& reader){
+    std::string name;
+    if(!reader.getString(name)) return 0;
+    TaskContext* comp = component(name);
+    if(!comp) log(Error) << "(StaticDeployer) No component " << name << endlog();
+    return comp;
+  }
+
+  bool StaticDeployer::deployComponent(Reader& reader){
+    std::string name, type;
+    unsigned int autoconf, autostart;
+    if(!reader.getString(name) || !reader.getString(type) || !reader.getUInt(autoconf) || !reader.getUInt(autostart))
+      return false;
+    std::map<std::string, ComponentFactory>::const_iterator factory = m_component_types.find(type);
+    if(factory == m_component_types.end()){
+      log(Error) << "(StaticDeployer) Component type " << type << " of " << name << " is not linked in" << endlog();
+      return false;
+    }
+    Deployed deployed;
+    deployed.component = factory->second(name);
+    deployed.autoconf = autoconf;
+    deployed.autostart = autostart;
+    m_components.push_back(deployed);
+    return true;
+  }
+
+  bool StaticDeployer::setActivity(Reader& reader){
+    TaskContext* comp = findComponent(reader);
+    double period;
+    int priority, scheduler;
+    std::string master;
+    if(!comp || !reader.getDouble(period) || !reader.getInt(priority) || !reader.getInt(scheduler) || !reader.getString(master))
+      return false;
+    if(master.empty())
+      return comp->setActivity(new RTT::Activity(scheduler, priority, period, comp->engine(), comp->getName()));
+    TaskContext* masterComp = component(master);
+    if(!masterComp){
+      log(Error) << "(StaticDeployer) No master component " << master << " for " << comp->getName() << endlog();
+      return false;
+    }
+    return comp->setActivity(new extras::SlaveActivity(masterComp->getActivity(), comp->engine()));
+  }
+
+  bool StaticDeployer::connectPeers(Reader& reader){
+    TaskContext* comp = findComponent(reader);
+    TaskContext* peer = comp ? findComponent(reader) : 0;
+    return peer && comp->connectPeers(peer);
+  }
+
+  bool StaticDeployer::addService(Reader& reader){
+    TaskContext* comp = findComponent(reader);
+    std::string name;
+    if(!comp || !reader.getString(name)) return false;
+    std::map<std::string, ServiceFactory>::const_iterator factory = m_service_types.find(name);
+    if(factory == m_service_types.end()){
+      log(Error) << "(StaticDeployer) Service " << name << " of " << comp->getName() << " is not linked in" << endlog();
+      return false;
+    }
+    if(comp->provides()->hasService(name)) return true;
+    return comp->provides()->addService(factory->second(comp));
+  }
+
+  /// Sets prop to value if prop has type T
+  template<class T> static bool assign(base::PropertyBase* prop, const T& value){
+    Property<T> typed(prop);
+    if(!typed.ready()) return false;
+    typed.set(value);
+    return true;
+  }
+
+  bool StaticDeployer::setProperty(Reader& reader){
+    TaskContext* comp = findComponent(reader);
+    std::string name;
+    unsigned int kind;
+    if(!comp || !reader.getString(name) || !reader.getUInt(kind)) return false;
+    base::PropertyBase* prop = comp->properties()->getProperty(name);
+    if(!prop){
+      log(Error) << "(StaticDeployer) " << comp->getName() << " has no property " << name << endlog();
+      return false;
+    }
+    bool ok = false;
+    switch(kind){
+      case BOOL:
+      case LONG:{
+        int value;
+        if(!reader.getInt(value)) return false;
+        ok = assign(prop, value) || assign(prop, (unsigned int)value) || assign(prop, value != 0)
+          || assign(prop, (double)value) || assign(prop, (float)value);
+        break;
+      }
+      case DOUBLE:{
+        double value;
+        if(!reader.getDouble(value)) return false;
+        ok = assign(prop, value) || assign(prop, (float)value);
+        break;
+      }
+      case STRING:{
+        std::string value;
+        if(!reader.getString(value)) return false;
+        ok = assign(prop, value);
+        break;
+      }
+      case DOUBLES:{
+        unsigned int count;
+        std::vector<double> values;
+        if(!reader.getUInt(count) || !reader.getDoubles(values, count)) return false;
+        MatrixWrapper::ColumnVector column(count);
+        MatrixWrapper::RowVector row(count);
+        for(unsigned int i = 0; i < count; ++i){
+          column(i+1) = values[i];
+          row(i+1) = values[i];
+        }
+        ok = assign(prop, values) || assign(prop, column) || assign(prop, row);
+        break;
+      }
+      case STRINGS:{
+        unsigned int count;
+        if(!reader.getUInt(count)) return false;
+        std::vector<std::string> values(count);
+        for(unsigned int i = 0; i < count; ++i)
+          if(!reader.getString(values[i])) return false;
+        ok = assign(prop, values);
+        break;
+      }
+      case MATRIX:{
+        unsigned int rows, columns;
+        std::vector<double> values;
+        if(!reader.getUInt(rows) || !reader.getUInt(columns) || !reader.getDoubles(values, rows * columns)) return false;
+        MatrixWrapper::Matrix matrix(rows, columns);
+        for(unsigned int i = 0; i < rows; ++i)
+          for(unsigned int j = 0; j < columns; ++j)
+            matrix(i+1, j+1) = values[i*columns + j];
+        if(rows == columns){
+          MatrixWrapper::SymmetricMatrix symmetric(rows);
+          for(unsigned int i = 0; i < rows; ++i)
+            for(unsigned int j = 0; j <= i; ++j)
+              symmetric(i+1, j+1) = values[i*columns + j];
+          ok = assign(prop, symmetric);
+        }
+        ok = ok || assign(prop, matrix);
+        break;
+      }
+    }
+    if(!ok)
+      log(Error) << "(StaticDeployer) Value of " << comp->getName() << "." << name << " does not match its type" << endlog();
+    return ok;
+  }
+
+  bool StaticDeployer::connectPorts(Reader& reader){
+    std::string name;
+    ConnPolicy policy;
+    unsigned int count;
+    if(!reader.getString(name) || !reader.getInt(policy.type) || !reader.getInt(policy.size)
+        || !reader.getInt(policy.lock_policy) || !reader.getUInt(count))
+      return false;
+    std::vector<base::OutputPortInterface*> outputs;
+    std::vector<base::PortInterface*> inputs;
+    for(unsigned int i = 0; i < count; ++i){
+      std::string port;
+      if(!reader.getString(port)) return false;
+      std::string::size_type dot = port.find('.');
+      TaskContext* comp = dot == std::string::npos ? 0 : component(port.substr(0, dot));
+      base::PortInterface* p = comp ? comp->ports()->getPort(port.substr(dot+1)) : 0;
+      if(!p){
+        log(Error) << "(StaticDeployer) No port " << port << " for connection " << name << endlog();
+        return false;
+      }
+      base::OutputPortInterface* out = dynamic_cast<base::OutputPortInterface*>(p);
+      if(out) outputs.push_back(out);
+      else inputs.push_back(p);
+    }
+    for(unsigned int i = 0; i < outputs.size(); ++i)
+      for(unsigned int j = 0; j < inputs.size(); ++j)
+        if(!outputs[i]->connectTo(inputs[j], policy)){
+          log(Error) << "(StaticDeployer) Could not connect " << name << endlog();
+          return false;
+        }
+    return true;
+  }
+
+  bool StaticDeployer::addTimer(Reader& reader){
+    Timer timer;
+    timer.component = findComponent(reader);
+    if(!timer.component || !reader.getInt(timer.id) || !reader.getDouble(timer.period)) return false;
+    m_timers.push_back(timer);
+    return true;
+  }
+}
@@ -0,0 +1,137 @@
+/******************************************************************************
+*                       OROCOS Youbot static deployment                       *
+*                                                                             *
+*                         (C) 2011 Steven Bellens                             *
+*                     steven.bellens@mech.kuleuven.be                         *
+*                    Department of Mechanical Engineering,                    *
+*                   Katholieke Universiteit Leuven, Belgium.                  *
+*                                                                             *
+*       You may redistribute this software and/or modify it under either the  *
+*       terms of the GNU Lesser General Public License version 2.1 (LGPLv2.1  *
+*       <http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>) or (at your *
+*       discretion) of the Modified BSD License:                              *
+*       Redistribution and use in source and binary forms, with or without    *
+*       modification, are permitted provided that the following conditions    *
+*       are met:                                                              *
+*       1. Redistributions of source code must retain the above copyright     *
+*       notice, this list of conditions and the following disclaimer.         *
+*       2. Redistributions in binary form must reproduce the above copyright  *
+*       notice, this list of conditions and the following disclaimer in the   *
+*       documentation and/or other materials provided with the distribution.  *
+*       3. The name of the author may not be used to endorse or promote       *
+*       products derived from this software without specific prior written    *
+*       permission.                                                           *
+*       THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR  *
+*       IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED        *
+*       WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE    *
+*       ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,*
+*       INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    *
+*       (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS       *
+*       OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) *
+*       HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,   *
+*       STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING *
+*       IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE    *
+*       POSSIBILITY OF SUCH DAMAGE.                                           *
+*                                                                             *
+*******************************************************************************/
+
+
+/* @Description:
+ * @brief Youbot static deployment - deploy components from a binary deployment
+ * @Author: Steven Bellens
+ */
+
+ /*
+  * The StaticDeployer deploys the components of a binary deployment file
+  * (deploymentFormat.hpp, written by deploy2bin) without the deployer: no
+  * script or XML parsing and no component libraries to load. The component
+  * and service types it can create are registered by the executable that
+  * links them in (addComponentType(), addServiceType()). load() creates the
+  * components, sets their properties and activities, adds the services and
+  * connects the peers and ports; startup() configures them in deployment
+  * order, starts them in deployment order (a master is deployed before its
+  * slaves, and a slave activity only starts while its master runs) and
+  * starts the timers; shutdown() stops and cleans them up in reverse order.
+ */
+
+#ifndef _YOUBOT_STATIC_DEPLOYER_
+#define _YOUBOT_STATIC_DEPLOYER_
+
+#include <rtt/TaskContext.hpp>
+#include <rtt/Service.hpp>
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace youbot{
+
+  using namespace std;
+  using namespace RTT;
+
+  /// Factory of a component type linked into the executable
+  template<class T> TaskContext* createComponent(const std::string& name){ return new T(name); }
+  /// Factory of a service type linked into the executable
+  template<class T> Service::shared_ptr createService(TaskContext* owner){ return Service::shared_ptr(new T(owner)); }
+
+  class StaticDeployer{
+    public:
+      typedef TaskContext* (*ComponentFactory)(const std::string& name);
+      typedef Service::shared_ptr (*ServiceFactory)(TaskContext* owner);
+
+      StaticDeployer();
+      /// Shuts down and deletes the components
+      ~StaticDeployer();
+
+      /// @name Public methods
+      //@{
+      void addComponentType(const std::string& type, ComponentFactory factory);
+      void addServiceType(const std::string& name, ServiceFactory factory);
+
+      /**
+       * \brief Deploy the components of a binary deployment file
+       *
+       * \return false if the file can not be read, or refers to an unknown
+       * type, component, property or port
+       */
+      bool load(const std::string& file);
+
+      /// Configure and start the components, then start the timers
+      bool startup();
+
+      /// Stop and clean up the components in reverse order, the slaves before their masters
+      void shutdown();
+
+      /// The component with this name, 0 if it is not deployed
+      TaskContext* component(const std::string& name) const;
+      //@}
+
+    private:
+      class Reader;
+      struct Deployed{
+        TaskContext* component;
+        bool autoconf;
+        bool autostart;
+      };
+      struct Timer{
+        TaskContext* component;
+        int id;
+        double period;
+      };
+      std::map<std::string, ComponentFactory> m_component_types;
+      std::map<std::string, ServiceFactory> m_service_types;
+      /// The components, in deployment order
+      std::vector<Deployed> m_components;
+      std::vector<Timer> m_timers;
+
+      bool deployComponent(Reader& reader);
+      bool setActivity(Reader& reader);
+      bool connectPeers(Reader& reader);
+      bool addService(Reader& reader);
+      bool setProperty(Reader& reader);
+      bool connectPorts(Reader& reader);
+      bool addTimer(Reader& reader);
+      TaskContext* findComponent(Reader& reader);
+  };
+}
+#endif
@@ -0,0 +1,103 @@
+/******************************************************************************
+*                       OROCOS Youbot static deployment                       *
+*                                                                             *
+*                         (C) 2011 Steven Bellens                             *
+*                     steven.bellens@mech.kuleuven.be                         *
+*                    Department of Mechanical Engineering,                    *
+*                   Katholieke Universiteit Leuven, Belgium.                  *
+*                                                                             *
+*       You may redistribute this software and/or modify it under either the  *
+*       terms of the GNU Lesser General Public License version 2.1 (LGPLv2.1  *
+*       <http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>) or (at your *
+*       discretion) of the Modified BSD License:                              *
+*       Redistribution and use in source and binary forms, with or without    *
+*       modification, are permitted provided that the following conditions    *
+*       are met:                                                              *
+*       1. Redistributions of source code must retain the above copyright     *
+*       notice, this list of conditions and the following disclaimer.         *
+*       2. Redistributions in binary form must reproduce the above copyright  *
+*       notice, this list of conditions and the following disclaimer in the   *
+*       documentation and/or other materials provided with the distribution.  *
+*       3. The name of the author may not be used to endorse or promote       *
+*       products derived from this software without specific prior written    *
+*       permission.                                                           *
+*       THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR  *
+*       IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED        *
+*       WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE    *
+*       ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,*
+*       INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    *
+*       (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS       *
+*       OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) *
+*       HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,   *
+*       STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING *
+*       IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE    *
+*       POSSIBILITY OF SUCH DAMAGE.                                           *
+*                                                                             *
+*******************************************************************************/
+
+
+/* @Description:
+ * @brief Youbot static deployment - single binary with the youbot components
+ * @Author: Steven Bellens
+ */
+
+ /*
+  * youbot_static <deployment.bin>
+  *
+  * Runs a deployment compiled by deploy2bin without the deployer. The
+  * components and services below are linked into this executable (built
+  * with RTT_STATIC), so no component library, typekit or plugin is
+  * loaded at startup. The time from process entry to running components
+  * is logged. SIGINT or SIGTERM stops and cleans up the components.
+ */
+
+#include "staticDeployer.hpp"
+
+#include <rtt/os/main.h>
+#include <rtt/os/TimeService.hpp>
+#include <rtt/Logger.hpp>
+
+#include <scheduler.hpp>
+#include <simulator.hpp>
+#include <controller.hpp>
+#include <extendedKalmanFilterComponentRobot.hpp>
+#include <hookStatsService.hpp>
+
+#include <signal.h>
+#include <pthread.h>
+#include <cstdio>
+
+using namespace RTT;
+
+int ORO_main(int argc, char** argv){
+  RTT::os::TimeService::ticks start = RTT::os::TimeService::Instance()->getTicks();
+  if(argc != 2){
+    fprintf(stderr, "usage: %s <deployment.bin>\n", argv[0]);
+    return 1;
+  }
+  /// Block the stop signals before the component threads inherit the mask
+  sigset_t stop_signals;
+  sigemptyset(&stop_signals);
+  sigaddset(&stop_signals, SIGINT);
+  sigaddset(&stop_signals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &stop_signals, 0);
+
+  youbot::StaticDeployer deployer;
+  deployer.addComponentType("youbot::Scheduler", &youbot::createComponent<youbot::Scheduler>);
+  deployer.addComponentType("youbot::Simulator", &youbot::createComponent<youbot::Simulator>);
+  deployer.addComponentType("youbot::Controller", &youbot::createComponent<youbot::Controller>);
+  deployer.addComponentType("ExtendedKalmanFilterComponentRobot", &youbot::createComponent<ExtendedKalmanFilterComponentRobot>);
+  deployer.addServiceType("hookstats", &youbot::createService<youbot::HookStatsService>);
+
+  if(!deployer.load(argv[1]) || !deployer.startup()){
+    deployer.shutdown();
+    return 1;
+  }
+  log(Info) << "(youbot_static) Running after " << RTT::os::TimeService::Instance()->secondsSince(start) * 1000.0 << " ms" << endlog();
+
+  int sig;
+  sigwait(&stop_signals, &sig);
+  log(Info) << "(youbot_static) Stopping on signal " << sig << endlog();
+  deployer.shutdown();
+  return 0;
+}
@@ -0,0 +1,2 @@
+#!/bin/sh
+rosrun ocl deployer-gnulinux -s simulationScheduled.ops #-ldebug
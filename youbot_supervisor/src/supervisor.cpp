@@ -0,0 +1,130 @@
+/******************************************************************************
+*                      OROCOS Youbot supervisor component                     *
+*                                                                             *
+*                         (C) 2011 Steven Bellens                             *
+*                     steven.bellens@mech.kuleuven.be                         *
+*                    Department of Mechanical Engineering,                    *
+*                   Katholieke Universiteit Leuven, Belgium.                  *
+*                                                                             *
+*       You may redistribute this software and/or modify it under either the  *
+*       terms of the GNU Lesser General Public License version 2.1 (LGPLv2.1  *
+*       <http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>) or (at your *
+*       discretion) of the Modified BSD License:                              *
+*       Redistribution and use in source and binary forms, with or without    *
+*       modification, are permitted provided that the following conditions    *
+*       are met:                                                              *
+*       1. Redistributions of source code must retain the above copyright     *
+*       notice, this list of conditions and the following disclaimer.         *
+*       2. Redistributions in binary form must reproduce the above copyright  *
+*       notice, this list of conditions and the following disclaimer in the   *
+*       documentation and/or other materials provided with the distribution.  *
+*       3. The name of the author may not be used to endorse or promote       *
+*       products derived from this software without specific prior written    *
+*       permission.                                                           *
+*       THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR  *
+*       IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED        *
+*       WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE    *
+*       ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,*
+*       INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    *
+*       (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS       *
+*       OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) *
+*       HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,   *
+*       STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING *
+*       IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE    *
+*       POSSIBILITY OF SUCH DAMAGE.                                           *
+*                                                                             *
+*******************************************************************************/
+#include "supervisor.hpp"
+
+// This macro is used whenever a new Orocos component is generated. Here we
+// generate a Youbot Supervisor component.
+ORO_CREATE_COMPONENT(youbot::Supervisor)
+
+namespace youbot{
+  Supervisor::Supervisor(std::string name) : TaskContext(name,PreOperational)
+  ,m_controller("Controller")
+  ,m_estimator("ExtendedKalmanFilterComponentRobot")
+  ,m_scan_processor("CalculateDistanceToWall")
+  ,m_scan_decimation(2)
+  ,m_covariance_decimation(10)
+  ,m_scan_decimation_property(0)
+  ,m_covariance_decimation_property(0)
+  {
+    /// Add the input port to the Orocos interface, a new health level wakes up the state machine
+    this->addEventPort("health",health_port).doc("Health level from the HealthMonitor: 0 nominal, 1 degraded, 2 overloaded, 3 stale");
+    /// Add property variables to the Orocos interface
+    this->addProperty("controller",m_controller).doc("Peer name of the Controller");
+    this->addProperty("estimator",m_estimator).doc("Peer name of the ExtendedKalmanFilterComponentRobot");
+    this->addProperty("scan_processor",m_scan_processor).doc("Peer name of the CalculateDistanceToWall component");
+    this->addProperty("scan_decimation",m_scan_decimation).doc("Process every n-th laser scan only when shedding load");
+    this->addProperty("covariance_decimation",m_covariance_decimation).doc("Write the covariance on every n-th estimate only when shedding load");
+    /// Add operations to the Orocos interface, for the state machine
+    this->addOperation("shedLoad",&Supervisor::shedLoad,this,RTT::ClientThread).doc("Decimate the laser scans and the covariance output, or process everything again").arg("Shed","True to shed load, false to restore");
+    this->addOperation("setSpeed",&Supervisor::setSpeed,this,RTT::ClientThread).doc("Scale the velocity limits of the Controller").arg("Scale","Scale in ]0, 1], 1.0: nominal");
+  }
+
+  Supervisor::~Supervisor(){}
+
+  bool Supervisor::configureHook(){
+    if(m_scan_decimation <= 0 || m_covariance_decimation <= 0){
+      log(Error) << "(Supervisor) The decimations must be positive" << endlog();
+      return false;
+    }
+    m_scan_decimation_property = 0;
+    if(this->hasPeer(m_scan_processor)){
+      m_scan_decimation_property = this->getPeer(m_scan_processor)->properties()->getPropertyType<int>("ScanDecimation");
+      if(!m_scan_decimation_property){
+        log(Error) << "(Supervisor) peer " << m_scan_processor << " has no property ScanDecimation" << endlog();
+        return false;
+      }
+    }
+    else log(Info) << "(Supervisor) no peer " << m_scan_processor << ", the laser scans are not decimated" << endlog();
+    m_covariance_decimation_property = 0;
+    if(this->hasPeer(m_estimator)){
+      m_covariance_decimation_property = this->getPeer(m_estimator)->properties()->getPropertyType<int>("CovarianceDecimation");
+      if(!m_covariance_decimation_property){
+        log(Error) << "(Supervisor) peer " << m_estimator << " has no property CovarianceDecimation" << endlog();
+        return false;
+      }
+    }
+    else log(Info) << "(Supervisor) no peer " << m_estimator << ", the covariance is not decimated" << endlog();
+    m_set_speed_scale = OperationCaller<bool(double)>();
+    if(this->hasPeer(m_controller)){
+      if(!this->getPeer(m_controller)->operations()->hasMember("setSpeedScale")){
+        log(Error) << "(Supervisor) peer " << m_controller << " has no operation setSpeedScale" << endlog();
+        return false;
+      }
+      m_set_speed_scale = this->getPeer(m_controller)->provides()->getOperation("setSpeedScale");
+    }
+    else log(Info) << "(Supervisor) no peer " << m_controller << ", the speed is not scaled" << endlog();
+    return true;
+  }
+
+  bool Supervisor::startHook(){
+    return true;
+  }
+
+  void Supervisor::updateHook(){
+    /// The state machine does the work
+  }
+
+  void Supervisor::shedLoad(bool shed){
+    if(m_scan_decimation_property) m_scan_decimation_property->set(shed ? m_scan_decimation : 1);
+    if(m_covariance_decimation_property) m_covariance_decimation_property->set(shed ? m_covariance_decimation : 1);
+    log(Info) << "(Supervisor) " << (shed ? "shedding load" : "processing every scan and estimate") << endlog();
+  }
+
+  bool Supervisor::setSpeed(double scale){
+    if(!m_set_speed_scale.ready()) return true;
+    log(Info) << "(Supervisor) speed scale " << scale << endlog();
+    return m_set_speed_scale(scale);
+  }
+
+  void Supervisor::stopHook(){
+  }
+
+  void Supervisor::cleanupHook(){
+    m_scan_decimation_property = 0;
+    m_covariance_decimation_property = 0;
+  }
+}
@@ -0,0 +1,137 @@
+/******************************************************************************
+*                      OROCOS Youbot supervisor component                     *
+*                                                                             *
+*                         (C) 2011 Steven Bellens                             *
+*                     steven.bellens@mech.kuleuven.be                         *
+*                    Department of Mechanical Engineering,                    *
+*                   Katholieke Universiteit Leuven, Belgium.                  *
+*                                                                             *
+*       You may redistribute this software and/or modify it under either the  *
+*       terms of the GNU Lesser General Public License version 2.1 (LGPLv2.1  *
+*       <http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>) or (at your *
+*       discretion) of the Modified BSD License:                              *
+*       Redistribution and use in source and binary forms, with or without    *
+*       modification, are permitted provided that the following conditions    *
+*       are met:                                                              *
+*       1. Redistributions of source code must retain the above copyright     *
+*       notice, this list of conditions and the following disclaimer.         *
+*       2. Redistributions in binary form must reproduce the above copyright  *
+*       notice, this list of conditions and the following disclaimer in the   *
+*       documentation and/or other materials provided with the distribution.  *
+*       3. The name of the author may not be used to endorse or promote       *
+*       products derived from this software without specific prior written    *
+*       permission.                                                           *
+*       THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR  *
+*       IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED        *
+*       WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE    *
+*       ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,*
+*       INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    *
+*       (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS       *
+*       OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) *
+*       HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,   *
+*       STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING *
+*       IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE    *
+*       POSSIBILITY OF SUCH DAMAGE.                                           *
+*                                                                             *
+*******************************************************************************/
+
+/* @Description:
+ * @brief Youbot supervisor - OROCOS component
+ * @Author: Steven Bellens
+ */
+
+ /*
+  * The YouBot Supervisor runs the supervisor state machine
+  * (statemachine.osd). It has no activity of its own: it is woken up by the
+  * health level of the HealthMonitor (youbot_diagnostics) on its health
+  * event port, and the state machine switches modes on that event. The
+  * Supervisor offers the actions of the modes as operations:
+  *
+  *   shedLoad(): let CalculateDistanceToWall process fewer laser scans and
+  *   the ExtendedKalmanFilterComponentRobot write its covariance less often,
+  *   setSpeed(): scale the velocity limits of the Controller.
+  *
+  * The components are looked up among the peers in configureHook(), an
+  * action on a component that is not deployed with the Supervisor is
+  * skipped. This way the same state machine serves the deployments with
+  * and without the laser scan processing.
+ */
+
+#include <rtt/TaskContext.hpp>
+#include <rtt/Port.hpp>
+#include <rtt/Property.hpp>
+#include <rtt/OperationCaller.hpp>
+#include <rtt/Component.hpp>
+
+namespace youbot{
+
+  using namespace std;
+  using namespace RTT;
+
+  class Supervisor : public TaskContext{
+    protected:
+      /// @name Ports
+      //@{
+      /// Health level - from the HealthMonitor component, triggers the state machine
+      InputPort<int> health_port;
+      //@}
+      /// @name Properties
+      //@{
+      /// Peer names of the components the actions apply to
+      std::string m_controller;
+      std::string m_estimator;
+      std::string m_scan_processor;
+      /// Process every n-th laser scan only when shedding load
+      int m_scan_decimation;
+      /// Write the covariance on every n-th estimate only when shedding load
+      int m_covariance_decimation;
+      //@}
+
+    public:
+      /**
+       * \brief Constructor
+       *
+       * Constructor building a Youbot supervisor component
+       * \param name The component name
+       */
+      Supervisor(std::string name);
+      //! Destructor
+      ~Supervisor();
+
+      /// @name Public methods
+      //@{
+      bool configureHook();
+      bool startHook();
+      void updateHook();
+      void stopHook();
+      void cleanupHook();
+      //@}
+
+      /// @name Operations
+      //@{
+      /**
+       * \brief Shed or restore the load of the estimation pipeline
+       *
+       * \param shed True to decimate the laser scans and the covariance
+       * output, false to process everything again
+       */
+      void shedLoad(bool shed);
+
+      /**
+       * \brief Scale the velocity limits of the Controller
+       *
+       * \param scale Scale in ]0, 1], 1.0 restores the configured limits
+       * \return false if the Controller refused the scale
+       */
+      bool setSpeed(double scale);
+      //@}
+
+    private:
+      /// ScanDecimation of the scan processor, 0 if it is not a peer
+      Property<int>* m_scan_decimation_property;
+      /// CovarianceDecimation of the estimator, 0 if it is not a peer
+      Property<int>* m_covariance_decimation_property;
+      /// setSpeedScale of the Controller, not ready if it is not a peer
+      OperationCaller<bool(double)> m_set_speed_scale;
+  };
+}